@@ -10,6 +10,8 @@
  *
  */
 
+#include <cerrno>
+#include <cstdlib>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
@@ -17,27 +19,163 @@
 
 #include <glibmm/i18n.h> // Internationalization
 
+#include <glib/gstdio.h>
+
 #include "auto-save.h"
 #include "document.h"
 #include "inkscape-application.h"
 #include "preferences.h"
 
-#include "extension/output.h"
+#include "debug/trace.h"
 #include "io/sys.h"
+#include "undo-stack-observer.h"
+#include "xml/journal.h"
 #include "xml/repr.h"
 
 #ifdef _WIN32
 #include <process.h>
+#include <windows.h>
 typedef int uid_t;
 #define getuid() 0
+#else
+#include <csignal>
 #endif
 
 namespace Inkscape {
 
+namespace {
+
+/// Finds or creates the autosave directory, returning an empty string if it cannot be created.
+std::string autosave_directory()
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+
+    std::string autosave_dir = prefs->getString("/options/autosave/path"); // Filenames should be std::string
+    if (autosave_dir.empty()) {
+        autosave_dir = Glib::build_filename(Glib::get_user_cache_dir(), "inkscape");
+    }
+
+    Glib::RefPtr<Gio::File> dir_file = Gio::File::create_for_path(autosave_dir);
+    if (!dir_file->query_exists()) {
+        if (!dir_file->make_directory_with_parents()) {
+            std::cerr << "InkscapeApplication::document_autosave: Failed to create autosave directory: " << Glib::filename_to_utf8(autosave_dir) << std::endl;
+            return std::string();
+        }
+    }
+    return autosave_dir;
+}
+
+std::string current_datetime()
+{
+    std::time_t time = std::time(nullptr);
+    std::tm tm = *std::localtime(&time);
+    std::stringstream datetime;
+    datetime << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S");
+    return datetime.str();
+}
+
+bool process_running(int pid)
+{
+#ifdef _WIN32
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!process) {
+        return false;
+    }
+    DWORD code = 0;
+    bool running = GetExitCodeProcess(process, &code) && code == STILL_ACTIVE;
+    CloseHandle(process);
+    return running;
+#else
+    return kill(pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+std::string journal_base_name()
+{
+    return "automatic-journal-" + std::to_string(getuid()) + "-";
+}
+
+/// Appends the changes to the journal whenever the document's undo stack moves.
+class JournalUndoObserver : public UndoStackObserver {
+public:
+    JournalUndoObserver(sigc::slot<void> const &commit) : _commit(commit) {}
+
+    void notifyUndoEvent(Event *) override { _commit(); }
+    void notifyRedoEvent(Event *) override { _commit(); }
+    void notifyUndoCommitEvent(Event *) override {}
+    void notifyClearUndoEvent() override {}
+    void notifyClearRedoEvent() override {}
+
+private:
+    sigc::slot<void> _commit;
+};
+
+} // namespace
+
+// Either an auto-save of a document or a checkpoint of its journal.
+struct AutoSave::Job {
+    std::unique_ptr<SPDocument> document; // keeps the document while it is being written
+    std::string path;
+    std::unique_ptr<XML::DocumentSnapshot> snapshot;
+    std::unique_ptr<XML::Journal::Checkpoint> checkpoint;
+    bool saved = false;
+};
+
+struct AutoSave::DocumentJournal {
+    DocumentJournal(SPDocument *document, std::string const &checkpoint_path, std::string const &journal_path,
+                    sigc::slot<void> const &commit)
+        : document(document)
+        , checkpoint_path(checkpoint_path)
+        , journal_path(journal_path)
+        , journal(document->getReprDoc(), checkpoint_path, journal_path)
+        , undo_observer(commit)
+    {
+        // undo and redo change the tree without committing, so those are journaled by the observer
+        commit_connection = document->connectCommit(commit);
+        document->addUndoObserver(undo_observer);
+    }
+
+    ~DocumentJournal()
+    {
+        commit_connection.disconnect();
+        document->removeUndoObserver(undo_observer);
+    }
+
+    SPDocument *document;
+    std::string checkpoint_path;
+    std::string journal_path;
+    XML::Journal journal;
+    JournalUndoObserver undo_observer;
+    sigc::connection commit_connection;
+};
+
+AutoSave::~AutoSave()
+{
+    if (_worker.joinable()) {
+        // Let a save that is under way finish. The process is exiting, so the documents and
+        // copies are left alone rather than torn down from a static destructor.
+        _worker.join();
+        for (auto &job : _jobs) {
+            job->snapshot.release();
+            job->checkpoint.release();
+            job->document.release();
+        }
+    }
+
+    // Exiting normally, so the journals are not needed to recover anything. The documents may
+    // be gone already, so only the files are removed.
+    for (auto &entry : _journals) {
+        auto journal = entry.second.release();
+        g_unlink(journal->checkpoint_path.c_str());
+        g_unlink(journal->journal_path.c_str());
+    }
+}
+
 void
 AutoSave::init(InkscapeApplication* app)
 {
     _app = app;
+    recover();
     start();
 }
 
@@ -71,20 +209,17 @@ AutoSave::save()
         return true;
     }
 
+    if (!_jobs.empty()) {
+        // Still writing the last copies: the documents are saved next time.
+        g_debug("AutoSave::save: previous auto-save still being written, skipping");
+        return true;
+    }
+
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
 
-    // Find/create autosave directory
-    std::string autosave_dir = prefs->getString("/options/autosave/path"); // Filenames should be std::string
+    std::string autosave_dir = autosave_directory();
     if (autosave_dir.empty()) {
-        autosave_dir = Glib::build_filename(Glib::get_user_cache_dir(), "inkscape");
-    }
-
-    Glib::RefPtr<Gio::File> dir_file = Gio::File::create_for_path(autosave_dir);
-    if (!dir_file->query_exists()) {
-        if (!dir_file->make_directory_with_parents()) {
-            std::cerr << "InkscapeApplication::document_autosave: Failed to create autosave directory: " << Glib::filename_to_utf8(autosave_dir) << std::endl;
-            return true;
-        }
+        return true;
     }
 
     // Get unique info
@@ -92,10 +227,7 @@ AutoSave::save()
     int pid = ::getpid(); // Avoid naming conflicts between processes
 
     // Get time stamp
-    std::time_t time = std::time(nullptr);
-    std::tm tm = *std::localtime(&time);
-    std::stringstream datetime;
-    datetime << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S");
+    std::string datetime = current_datetime();
 
     int docnum = 0;
     int autosave_max = prefs->getInt("/options/autosave/max", 10);
@@ -103,7 +235,16 @@ AutoSave::save()
 
         ++docnum; // Give each document a unique number.
 
-        if (document->isModifiedSinceAutoSave()) {
+        // A journal that could not be written no longer protects its document, which is then
+        // auto-saved as a whole again.
+        auto journal = _journals.find(document);
+        if (journal != _journals.end() && journal->second->journal.failed()) {
+            _journals.erase(journal);
+            document->setModifiedSinceAutoSave();
+        }
+
+        // Documents with a journal are kept on disk as they change.
+        if (document->isModifiedSinceAutoSave() && !_journals.count(document)) {
 
             std::string base_name = "automatic-save-" + std::to_string(uid);
 
@@ -136,43 +277,260 @@ AutoSave::save()
 
             // Construct save file path
             // datetime MUST happen first, otherwise the above sorting will fail
-            std::string filename = base_name + "-" + datetime.str() + "-" + std::to_string(pid) + "-" + std::to_string(docnum) + ".svg";
+            std::string filename = base_name + "-" + datetime + "-" + std::to_string(pid) + "-" + std::to_string(docnum) + ".svg";
             std::string path = Glib::build_filename(autosave_dir, filename.c_str());
 
-            // Try to save the file
-            // Following code needs to be reviewed
-            FILE *file = Inkscape::IO::fopen_utf8name(path.c_str(), "w");
-            gchar *errortext = nullptr;
-            if (file) {
-                try {
-                    Inkscape::XML::Node *repr = document->getReprRoot();
-                    sp_repr_save_stream(repr->document(), file, SP_SVG_NS_URI);
-                } catch (Inkscape::Extension::Output::no_extension_found &e) {
-                    errortext = g_strdup(_("Autosave failed! Could not find inkscape extension to save document."));
-                } catch (Inkscape::Extension::Output::save_failed &e) {
-                    gchar *safeUri = Inkscape::IO::sanitizeString(path.c_str());
-                    errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri);
-                    g_free(safeUri);
-                }
-                fclose(file);
-            } else {
-                gchar *safeUri = Inkscape::IO::sanitizeString(path.c_str());
-                errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri);
-                g_free(safeUri);
+            // Copy the document, to be written without holding up the user.
+            gint64 start = g_get_monotonic_time();
+            auto job = std::make_unique<Job>();
+            {
+                Debug::TraceScope trace("AutoSave::snapshot", Debug::Event::DOCUMENT);
+                Inkscape::XML::Node *repr = document->getReprRoot();
+                job->snapshot = std::make_unique<XML::DocumentSnapshot>(repr->document(), SP_SVG_NS_URI);
             }
+            g_debug("AutoSave::save: copied document %d in %.1f ms", docnum,
+                    (g_get_monotonic_time() - start) / 1000.0);
 
-            if (errortext) {
-                g_warning("%s", errortext);
-                g_free(errortext);
-            } else {
-                document->setModifiedSinceAutoSaveFalse();
-            }
+            job->document = document->doRef();
+            job->path = path;
+            _jobs.push_back(std::move(job));
+
+            // Changes from now on are in the next auto-save.
+            document->setModifiedSinceAutoSaveFalse();
         }
     } // Loop over documents
 
+    if (!_jobs.empty()) {
+        _worker = std::thread(&AutoSave::write, this);
+    }
+
     return true;
 }
 
+/**
+ * Writes the copies of the documents, in the worker thread.
+ */
+void
+AutoSave::write()
+{
+    for (auto &job : _jobs) {
+        gint64 start = g_get_monotonic_time();
+        Debug::TraceScope trace("AutoSave::write", Debug::Event::DOCUMENT);
+
+        if (job->checkpoint) {
+            job->saved = job->checkpoint->write();
+            g_debug("AutoSave::write: wrote checkpoint %s in %.1f ms", job->path.c_str(),
+                    (g_get_monotonic_time() - start) / 1000.0);
+            continue;
+        }
+
+        // Written under another name first, so that there is never half an auto-save.
+        std::string tmp_path = job->path + ".tmp";
+        FILE *file = Inkscape::IO::fopen_utf8name(tmp_path.c_str(), "w");
+        if (file) {
+            job->snapshot->save(file);
+            bool written = !ferror(file);
+            written = (fclose(file) == 0) && written;
+            job->saved = written && g_rename(tmp_path.c_str(), job->path.c_str()) == 0;
+            if (!job->saved) {
+                g_unlink(tmp_path.c_str());
+            }
+        }
+
+        g_debug("AutoSave::write: wrote %s in %.1f ms", job->path.c_str(),
+                (g_get_monotonic_time() - start) / 1000.0);
+    }
+
+    g_idle_add(&AutoSave::on_written, this);
+}
+
+int
+AutoSave::on_written(void *data)
+{
+    static_cast<AutoSave *>(data)->finish();
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Reports failures and drops the copies, in the main thread once they have been written.
+ */
+void
+AutoSave::finish()
+{
+    _worker.join();
+
+    for (auto &job : _jobs) {
+        if (job->checkpoint) {
+            auto journal = _journals.find(job->document.get());
+            if (journal == _journals.end() || journal->second->checkpoint_path != job->path) {
+                // the journal was stopped while its checkpoint was written
+                g_unlink(job->path.c_str());
+            } else {
+                // a journal that failed is dropped by the next auto-save
+                journal->second->journal.checkpointWritten(*job->checkpoint);
+            }
+        } else if (!job->saved) {
+            gchar *safeUri = Inkscape::IO::sanitizeString(job->path.c_str());
+            g_warning(_("Autosave failed! File %s could not be saved."), safeUri);
+            g_free(safeUri);
+
+            // try again next time
+            job->document->setModifiedSinceAutoSave();
+        }
+    }
+    _jobs.clear();
+
+    checkpoint_journals();
+}
+
+/**
+ * Appends the changes to the journal of a document, and starts a checkpoint if one is due.
+ */
+void
+AutoSave::journal_commit(SPDocument *document)
+{
+    auto journal = _journals.find(document);
+    if (journal != _journals.end() && journal->second->journal.commit() &&
+        journal->second->journal.wantsCheckpoint()) {
+        checkpoint_journals();
+    }
+}
+
+/**
+ * Copies the documents whose journals are due a checkpoint, to be written by the worker thread.
+ */
+void
+AutoSave::checkpoint_journals()
+{
+    if (!_jobs.empty()) {
+        // asked again once the worker is done
+        return;
+    }
+
+    for (auto &entry : _journals) {
+        XML::Journal &journal = entry.second->journal;
+        if (!journal.wantsCheckpoint()) {
+            continue;
+        }
+
+        gint64 start = g_get_monotonic_time();
+        auto job = std::make_unique<Job>();
+        {
+            Debug::TraceScope trace("AutoSave::checkpoint", Debug::Event::DOCUMENT);
+            job->checkpoint = journal.checkpoint();
+        }
+        if (!job->checkpoint) {
+            continue;
+        }
+        g_debug("AutoSave::checkpoint_journals: copied %s in %.1f ms", entry.second->checkpoint_path.c_str(),
+                (g_get_monotonic_time() - start) / 1000.0);
+
+        job->document = entry.first->doRef();
+        job->path = entry.second->checkpoint_path;
+        _jobs.push_back(std::move(job));
+    }
+
+    if (!_jobs.empty()) {
+        _worker = std::thread(&AutoSave::write, this);
+    }
+}
+
+/**
+ * Starts a crash-recovery journal of the document, if journals are enabled.
+ */
+void
+AutoSave::journal_start(SPDocument *document)
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    if (!_app || !prefs->getBool("/options/autosave/journal", false) || _journals.count(document)) {
+        return;
+    }
+
+    std::string autosave_dir = autosave_directory();
+    if (autosave_dir.empty()) {
+        return;
+    }
+
+    std::string base_name = journal_base_name() + std::to_string(::getpid()) + "-" + std::to_string(++_journal_count);
+    std::string checkpoint_path = Glib::build_filename(autosave_dir, base_name + ".checkpoint");
+    std::string journal_path = Glib::build_filename(autosave_dir, base_name + ".journal");
+
+    _journals[document] = std::make_unique<DocumentJournal>(document, checkpoint_path, journal_path,
+                                                            [this, document]() { journal_commit(document); });
+
+    // The document can only be recovered once its first checkpoint has been written.
+    checkpoint_journals();
+}
+
+/**
+ * Stops the journal of a document that is being closed, removing its files.
+ */
+void
+AutoSave::journal_stop(SPDocument *document)
+{
+    _journals.erase(document);
+}
+
+/**
+ * Rebuilds the documents whose journals were left behind by an Inkscape that crashed, and saves
+ * them in the autosave directory.
+ */
+void
+AutoSave::recover()
+{
+    std::string autosave_dir = autosave_directory();
+    if (autosave_dir.empty()) {
+        return;
+    }
+
+    std::string const base_name = journal_base_name();
+    std::string const suffix = ".checkpoint";
+
+    Glib::Dir directory(autosave_dir);
+    std::vector<std::string> file_names(directory.begin(), directory.end());
+
+    int docnum = 0;
+    for (auto &file_name : file_names) {
+        if (file_name.compare(0, base_name.size(), base_name) != 0 || file_name.size() <= suffix.size() ||
+            file_name.compare(file_name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+
+        // automatic-journal-<uid>-<pid>-<number>.checkpoint
+        int pid = std::atoi(file_name.c_str() + base_name.size());
+        if (pid <= 0 || pid == ::getpid() || process_running(pid)) {
+            // still in use
+            continue;
+        }
+
+        std::string stem = file_name.substr(0, file_name.size() - suffix.size());
+        std::string checkpoint_path = Glib::build_filename(autosave_dir, file_name);
+        std::string journal_path = Glib::build_filename(autosave_dir, stem + ".journal");
+
+        gint64 start = g_get_monotonic_time();
+        XML::Document *doc = XML::Journal::recover(checkpoint_path, journal_path);
+        if (!doc) {
+            g_warning("Could not recover the document journaled in %s.", checkpoint_path.c_str());
+            continue;
+        }
+
+        std::string filename = "automatic-save-" + std::to_string(getuid()) + "-" + current_datetime() + "-" +
+                               std::to_string(pid) + "-recovered-" + std::to_string(++docnum) + ".svg";
+        std::string path = Glib::build_filename(autosave_dir, filename);
+        bool saved = sp_repr_save_file(doc, path.c_str(), SP_SVG_NS_URI);
+        Inkscape::GC::release(doc);
+
+        if (saved) {
+            g_message(_("Recovered a document from an Inkscape session that did not close: %s"), path.c_str());
+            g_unlink(journal_path.c_str());
+            g_unlink(checkpoint_path.c_str());
+        } else {
+            g_warning(_("Autosave failed! File %s could not be saved."), path.c_str());
+        }
+        g_debug("AutoSave::recover: recovered %s in %.1f ms", path.c_str(), (g_get_monotonic_time() - start) / 1000.0);
+    }
+}
+
 void
 AutoSave::restart()
 {
@@ -13,13 +13,20 @@
 #ifndef INKSCAPE_AUTOSAVE_H
 #define INKSCAPE_AUTOSAVE_H
 
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
 class InkscapeApplication;
+class SPDocument;
 
 namespace Inkscape {
 
 class AutoSave {
 private:
     AutoSave() = default;
+    ~AutoSave();
 
 public:
     AutoSave(const AutoSave &) = delete;
@@ -38,8 +45,32 @@ public:
     void start(); // Includes restarting.
     bool save();
 
+    void journal_start(SPDocument *document);
+    void journal_stop(SPDocument *document);
+
 private:
+    struct Job;
+    struct DocumentJournal;
+
+    void recover();
+    void write();
+    void finish();
+    static int on_written(void *data);
+    void journal_commit(SPDocument *document);
+    void checkpoint_journals();
+
     InkscapeApplication* _app = nullptr;
+
+    // Documents, and checkpoints of their journals, are copied in the main thread and written by
+    // _worker, after which finish() runs in the main thread again. _jobs is only empty while no
+    // copies are being written.
+    std::thread _worker;
+    std::vector<std::unique_ptr<Job>> _jobs;
+
+    // Documents with a crash-recovery journal, which are not auto-saved as a whole while the
+    // journal can be written.
+    std::map<SPDocument *, std::unique_ptr<DocumentJournal>> _journals;
+    int _journal_count = 0;
 };
 
 } // namespace Inkscape
@@ -35,6 +35,7 @@ public:
         FINALIZERS,
         INTERACTION,
         CONFIGURATION,
+        RENDERING,
         OTHER
     };
     enum { N_CATEGORIES=OTHER+1 };
@@ -19,6 +19,7 @@
 #include "inkscape-version.h"
 #include "debug/logger.h"
 #include "debug/simple-event.h"
+#include "debug/trace.h"
 
 namespace Inkscape {
 
@@ -111,6 +112,7 @@ static void set_category_mask(bool * const mask, char const *filter) {
                 { "FINALIZERS", Event::FINALIZERS },
                 { "INTERACTION", Event::INTERACTION },
                 { "CONFIGURATION", Event::CONFIGURATION },
+                { "RENDERING", Event::RENDERING },
                 { "OTHER", Event::OTHER },
                 { nullptr, Event::OTHER }
             };
@@ -143,6 +145,7 @@ public:
 }
 
 void Logger::init() {
+    Trace::init();
     if (!_enabled) {
         char const *log_filename=std::getenv("INKSCAPE_DEBUG_LOG");
         if (log_filename) {
@@ -213,6 +216,7 @@ void Logger::shutdown() {
             finish();
         }
     }
+    Trace::shutdown();
 }
 
 }
@@ -13,6 +13,8 @@
 #ifndef SEEN_INKSCAPE_DEBUG_TIMESTAMP_H
 #define SEEN_INKSCAPE_DEBUG_TIMESTAMP_H
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -22,6 +24,13 @@ namespace Debug {
 
 std::shared_ptr<std::string> timestamp();
 
+/// Monotonic time in nanoseconds, cheap enough to take around hot code paths.
+inline std::int64_t timestamp_ns()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
 }
 
 }
@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Inkscape::Debug::Trace - timing of hot code paths for trace viewers
+ *
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include <glib.h>
+#include "debug/trace.h"
+
+namespace Inkscape {
+
+namespace Debug {
+
+std::atomic<bool> Trace::_enabled{false};
+
+namespace {
+
+char const *const category_names[Event::N_CATEGORIES] = {
+    "CORE", "XML", "SPOBJECT", "DOCUMENT", "REFCOUNT", "EXTENSION",
+    "FINALIZERS", "INTERACTION", "CONFIGURATION", "RENDERING", "OTHER"
+};
+
+struct TraceEvent {
+    char const *name;
+    std::int64_t start;
+    std::int64_t duration;
+    Event::Category category;
+};
+
+/// The events of one thread. The lock is only ever contended while the trace is written.
+struct ThreadBuffer {
+    ThreadBuffer(unsigned id, std::size_t capacity) : id(id), events(capacity) {}
+
+    unsigned const id;
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    std::uint64_t count = 0; ///< Number of events recorded, of which the last events.size() are kept.
+};
+
+struct Registry {
+    std::mutex mutex;
+    // kept after their threads exit, so that the events of worker threads are not lost
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::size_t capacity = Trace::DEFAULT_CAPACITY;
+    std::int64_t origin = 0;
+    std::string filename;
+};
+
+Registry &registry()
+{
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+ThreadBuffer &thread_buffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        auto &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        buffer = std::make_shared<ThreadBuffer>(reg.buffers.size() + 1, reg.capacity);
+        reg.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void write_escaped(std::ostream &os, char const *value)
+{
+    for (char const *current = value; *current; ++current) {
+        unsigned char c = *current;
+        if (c == '"' || c == '\\') {
+            os << '\\' << *current;
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            os << escaped;
+        } else {
+            os.put(*current);
+        }
+    }
+}
+
+void do_shutdown()
+{
+    Trace::shutdown();
+}
+
+}
+
+void Trace::init()
+{
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+
+    char const *filename = std::getenv("INKSCAPE_TRACE");
+    if (!filename || !*filename) {
+        return;
+    }
+    std::size_t capacity = DEFAULT_CAPACITY;
+    if (char const *events = std::getenv("INKSCAPE_TRACE_EVENTS")) {
+        capacity = std::max<unsigned long>(std::strtoul(events, nullptr, 10), 1);
+    }
+    start(filename, capacity);
+    std::atexit(&do_shutdown);
+}
+
+void Trace::start(std::string filename, std::size_t capacity)
+{
+    capacity = std::max<std::size_t>(capacity, 1);
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.filename = std::move(filename);
+    reg.capacity = capacity;
+    reg.origin = timestamp_ns();
+    for (auto &buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.assign(capacity, TraceEvent());
+        buffer->count = 0;
+    }
+    _enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::record(char const *name, Event::Category category, std::int64_t start, std::int64_t end)
+{
+    auto &buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events[buffer.count++ % buffer.events.size()] = {name, start, end - start, category};
+}
+
+void Trace::write(std::ostream &os)
+{
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    os << "{\"traceEvents\":[\n"
+       << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"inkscape\"}}";
+
+    std::vector<TraceEvent> events;
+    std::uint64_t dropped = 0;
+    for (auto &buffer : reg.buffers) {
+        {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            std::size_t const capacity = buffer->events.size();
+            std::uint64_t const first = buffer->count > capacity ? buffer->count - capacity : 0;
+            events.clear();
+            for (auto i = first; i < buffer->count; ++i) {
+                events.push_back(buffer->events[i % capacity]);
+            }
+            dropped += first;
+        }
+
+        for (auto const &event : events) {
+            // microseconds, as the format wants them
+            char times[64];
+            std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+                          (event.start - reg.origin) / 1000.0, event.duration / 1000.0);
+            os << ",\n{\"name\":\"";
+            write_escaped(os, event.name);
+            os << "\",\"cat\":\"" << category_names[event.category] << "\",\"ph\":\"X\","
+               << times << ",\"pid\":1,\"tid\":" << buffer->id << "}";
+        }
+    }
+
+    os << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+}
+
+void Trace::shutdown()
+{
+    if (!_enabled.exchange(false)) {
+        return;
+    }
+    std::string filename;
+    {
+        auto &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        filename = reg.filename;
+    }
+    if (filename.empty()) {
+        return;
+    }
+    std::ofstream stream(filename);
+    if (stream.is_open()) {
+        write(stream);
+    }
+    if (!stream) {
+        g_warning("Could not write the trace to '%s'.", filename.c_str());
+    }
+}
+
+}
+
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Inkscape::Debug::Trace - timing of hot code paths for trace viewers
+ *
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DEBUG_TRACE_H
+#define SEEN_INKSCAPE_DEBUG_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "debug/event.h"
+#include "debug/timestamp.h"
+
+namespace Inkscape {
+
+namespace Debug {
+
+/**
+ * Records how long trace points take, for viewing in chrome://tracing or Perfetto.
+ *
+ * Unlike Logger, which writes every event as it happens, the trace keeps fixed size binary
+ * records in a ring buffer per thread, so that it can stay on while working with a slow document
+ * and only the most recent events are kept. Tracing is switched on by setting INKSCAPE_TRACE to
+ * the name of the file to write the trace to when Inkscape exits. While it is off, a trace point
+ * costs a load and a branch.
+ */
+class Trace {
+public:
+    /// Number of events kept per thread unless INKSCAPE_TRACE_EVENTS says otherwise.
+    static constexpr std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+    /// Starts tracing if INKSCAPE_TRACE is set.
+    static void init();
+
+    /**
+     * Starts tracing into ring buffers holding the given number of events per thread.
+     * @param filename The file shutdown() writes the trace to, or empty to only write it with write().
+     */
+    static void start(std::string filename, std::size_t capacity = DEFAULT_CAPACITY);
+
+    inline static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * Records an event that started and ended at the given timestamp_ns() times. As with Event,
+     * the name must be allocated statically.
+     */
+    static void record(char const *name, Event::Category category, std::int64_t start, std::int64_t end);
+
+    /// Writes the events kept so far in Chrome's trace event format.
+    static void write(std::ostream &os);
+
+    /// Stops tracing, writing the trace to the file given to start().
+    static void shutdown();
+
+private:
+    static std::atomic<bool> _enabled;
+};
+
+/**
+ * Records the time from its construction to its destruction, e.g.
+ *
+ *     Debug::TraceScope trace("SPDocument::ensureUpToDate", Debug::Event::DOCUMENT);
+ */
+class TraceScope {
+public:
+    TraceScope(char const *name, Event::Category category)
+        : _name(Trace::enabled() ? name : nullptr)
+        , _category(category)
+        , _start(_name ? timestamp_ns() : 0)
+    {}
+
+    ~TraceScope()
+    {
+        if (_name) {
+            Trace::record(_name, _category, _start, timestamp_ns());
+        }
+    }
+
+    TraceScope(TraceScope const &) = delete;
+    TraceScope &operator=(TraceScope const &) = delete;
+
+private:
+    char const *_name;
+    Event::Category _category;
+    std::int64_t _start;
+};
+
+}
+
+}
+
+#endif
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,513 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * SIMD versions of per-pixel filter functors.
+ *
+ * Each kernel exists in an SSE2 and an AVX2 flavour, compiled with the matching target
+ * attribute so that the rest of Inkscape does not need to be built for a newer CPU. The
+ * flavour is chosen at run time. All arithmetic reproduces the integer math of the scalar
+ * functors exactly; divisions are done in single precision and then corrected, which is
+ * exact as long as all operands stay below 2^24.
+ *//*
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/cairo-simd.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INK_SIMD_X86 1
+#include <immintrin.h>
+#define INK_TARGET_SSE2 __attribute__((target("sse2")))
+#define INK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace Inkscape {
+namespace Display {
+
+#ifdef INK_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// SSE2, 4 pixels at a time
+
+INK_TARGET_SSE2 static inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+INK_TARGET_SSE2 static inline __m128i clamp_sse2(__m128i x, __m128i low, __m128i high)
+{
+    x = select_sse2(_mm_cmplt_epi32(x, low), low, x);
+    return select_sse2(_mm_cmpgt_epi32(x, high), high, x);
+}
+
+// SSE2 lacks _mm_mullo_epi32, multiply even and odd lanes separately.
+INK_TARGET_SSE2 static inline __m128i mullo_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// num / den rounded down, for 0 <= num < 2^24 and (num / den + 1) * den < 2^24.
+INK_TARGET_SSE2 static inline __m128i div_sse2(__m128i num, __m128 den)
+{
+    __m128 numf = _mm_cvtepi32_ps(num);
+    __m128i q = _mm_cvttps_epi32(_mm_div_ps(numf, den));
+    __m128 qf = _mm_cvtepi32_ps(q);
+    // the rounded quotient may be off by one in either direction
+    __m128 too_small = _mm_cmple_ps(_mm_mul_ps(_mm_add_ps(qf, _mm_set1_ps(1.0f)), den), numf);
+    __m128 too_large = _mm_cmpgt_ps(_mm_mul_ps(qf, den), numf);
+    q = _mm_sub_epi32(q, _mm_castps_si128(too_small));
+    return _mm_add_epi32(q, _mm_castps_si128(too_large));
+}
+
+INK_TARGET_SSE2 static inline __m128i channel_sse2(__m128i px, int shift)
+{
+    return _mm_and_si128(_mm_srli_epi32(px, shift), _mm_set1_epi32(0xff));
+}
+
+INK_TARGET_SSE2 static inline __m128i assemble_sse2(__m128i a, __m128i r, __m128i g, __m128i b)
+{
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(r, 16)),
+                        _mm_or_si128(_mm_slli_epi32(g, 8), b));
+}
+
+// unpremul_alpha(): (255 * c + a/2) / a
+INK_TARGET_SSE2 static inline __m128i unpremul_sse2(__m128i c, __m128i half_a, __m128 af)
+{
+    __m128i num = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(c, 8), c), half_a);
+    return div_sse2(num, af);
+}
+
+// premul_alpha() on 32-bit lanes
+INK_TARGET_SSE2 static inline __m128i premul_sse2(__m128i c, __m128i a)
+{
+    __m128i t = _mm_add_epi32(mullo_sse2(c, a), _mm_set1_epi32(128));
+    return _mm_srli_epi32(_mm_add_epi32(t, _mm_srli_epi32(t, 8)), 8);
+}
+
+// premul_alpha() on all four 16-bit channels of two unpacked pixels
+INK_TARGET_SSE2 static inline __m128i premul_epi16_sse2(__m128i x)
+{
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// k1 * x1 * x2 + k2 * x1 + k3 * x2 + k4
+INK_TARGET_SSE2 static inline __m128i arithmetic_sse2(__m128i x1, __m128i x2, __m128i k1, __m128i k2, __m128i k3, __m128i k4)
+{
+    __m128i o = _mm_add_epi32(mullo_sse2(k1, mullo_sse2(x1, x2)), mullo_sse2(k2, x1));
+    return _mm_add_epi32(_mm_add_epi32(o, mullo_sse2(k3, x2)), k4);
+}
+
+// (clamp(x, 0, 255*255) + 127) / 255
+INK_TARGET_SSE2 static inline __m128i scale_sse2(__m128i x)
+{
+    __m128i y = _mm_add_epi32(clamp_sse2(x, _mm_setzero_si128(), _mm_set1_epi32(255 * 255)), _mm_set1_epi32(127));
+    return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(y, _mm_srli_epi32(y, 8)), _mm_set1_epi32(1)), 8);
+}
+
+// One row of the color matrix
+INK_TARGET_SSE2 static inline __m128i matrix_row_sse2(__m128i r, __m128i g, __m128i b, __m128i a, __m128i const *v)
+{
+    __m128i o = _mm_add_epi32(mullo_sse2(r, v[0]), mullo_sse2(g, v[1]));
+    o = _mm_add_epi32(o, _mm_add_epi32(mullo_sse2(b, v[2]), mullo_sse2(a, v[3])));
+    return scale_sse2(_mm_add_epi32(o, v[4]));
+}
+
+INK_TARGET_SSE2 static int premultiply_sse2(guint32 const *in, guint32 *out, int n)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const alpha_mask = _mm_set1_epi32(0xff000000);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+        __m128i lo = premul_epi16_sse2(_mm_unpacklo_epi8(px, zero));
+        __m128i hi = premul_epi16_sse2(_mm_unpackhi_epi8(px, zero));
+        __m128i alpha = _mm_and_si128(px, alpha_mask);
+        __m128i res = _mm_or_si128(_mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi)), alpha);
+        // fully transparent pixels are left alone
+        res = select_sse2(_mm_cmpeq_epi32(alpha, zero), px, res);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), res);
+    }
+    return i;
+}
+
+INK_TARGET_SSE2 static int unpremultiply_sse2(guint32 const *in, guint32 *out, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+        __m128i a = _mm_srli_epi32(px, 24);
+        __m128i half_a = _mm_srli_epi32(a, 1);
+        __m128 af = _mm_cvtepi32_ps(a);
+        __m128i r = unpremul_sse2(channel_sse2(px, 16), half_a, af);
+        __m128i g = unpremul_sse2(channel_sse2(px, 8), half_a, af);
+        __m128i b = unpremul_sse2(channel_sse2(px, 0), half_a, af);
+        __m128i res = select_sse2(_mm_cmpeq_epi32(a, _mm_setzero_si128()), px, assemble_sse2(a, r, g, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), res);
+    }
+    return i;
+}
+
+INK_TARGET_SSE2 static int composite_arithmetic_sse2(guint32 const *in1, guint32 const *in2, guint32 *out, int n,
+                                                     gint32 k1, gint32 k2, gint32 k3, gint32 k4)
+{
+    __m128i const vk1 = _mm_set1_epi32(k1);
+    __m128i const vk2 = _mm_set1_epi32(k2);
+    __m128i const vk3 = _mm_set1_epi32(k3);
+    __m128i const vk4 = _mm_set1_epi32(k4);
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const half = _mm_set1_epi32(255 * 255 / 2);
+    __m128 const den = _mm_set1_ps(255 * 255);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in1 + i));
+        __m128i p2 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in2 + i));
+
+        __m128i ao = clamp_sse2(arithmetic_sse2(_mm_srli_epi32(p1, 24), _mm_srli_epi32(p2, 24), vk1, vk2, vk3, vk4),
+                                zero, _mm_set1_epi32(255 * 255 * 255));
+        __m128i ro = clamp_sse2(arithmetic_sse2(channel_sse2(p1, 16), channel_sse2(p2, 16), vk1, vk2, vk3, vk4), zero, ao);
+        __m128i go = clamp_sse2(arithmetic_sse2(channel_sse2(p1, 8), channel_sse2(p2, 8), vk1, vk2, vk3, vk4), zero, ao);
+        __m128i bo = clamp_sse2(arithmetic_sse2(channel_sse2(p1, 0), channel_sse2(p2, 0), vk1, vk2, vk3, vk4), zero, ao);
+
+        ro = div_sse2(_mm_add_epi32(ro, half), den);
+        go = div_sse2(_mm_add_epi32(go, half), den);
+        bo = div_sse2(_mm_add_epi32(bo, half), den);
+        ao = div_sse2(_mm_add_epi32(ao, half), den);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), assemble_sse2(ao, ro, go, bo));
+    }
+    return i;
+}
+
+INK_TARGET_SSE2 static int color_matrix_sse2(guint32 const *in, guint32 *out, int n, gint32 const *v)
+{
+    __m128i vv[20];
+    for (int j = 0; j < 20; ++j) {
+        vv[j] = _mm_set1_epi32(v[j]);
+    }
+    __m128i const zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+        __m128i a = _mm_srli_epi32(px, 24);
+        __m128i r = channel_sse2(px, 16);
+        __m128i g = channel_sse2(px, 8);
+        __m128i b = channel_sse2(px, 0);
+
+        __m128i transparent = _mm_cmpeq_epi32(a, zero);
+        __m128i half_a = _mm_srli_epi32(a, 1);
+        __m128 af = _mm_cvtepi32_ps(a);
+        r = select_sse2(transparent, r, unpremul_sse2(r, half_a, af));
+        g = select_sse2(transparent, g, unpremul_sse2(g, half_a, af));
+        b = select_sse2(transparent, b, unpremul_sse2(b, half_a, af));
+
+        __m128i ro = matrix_row_sse2(r, g, b, a, vv);
+        __m128i go = matrix_row_sse2(r, g, b, a, vv + 5);
+        __m128i bo = matrix_row_sse2(r, g, b, a, vv + 10);
+        __m128i ao = matrix_row_sse2(r, g, b, a, vv + 15);
+
+        ro = premul_sse2(ro, ao);
+        go = premul_sse2(go, ao);
+        bo = premul_sse2(bo, ao);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), assemble_sse2(ao, ro, go, bo));
+    }
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// AVX2, 8 pixels at a time
+
+INK_TARGET_AVX2 static inline __m256i select_avx2(__m256i mask, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+INK_TARGET_AVX2 static inline __m256i clamp_avx2(__m256i x, __m256i low, __m256i high)
+{
+    return _mm256_min_epi32(_mm256_max_epi32(x, low), high);
+}
+
+INK_TARGET_AVX2 static inline __m256i div_avx2(__m256i num, __m256 den)
+{
+    __m256 numf = _mm256_cvtepi32_ps(num);
+    __m256i q = _mm256_cvttps_epi32(_mm256_div_ps(numf, den));
+    __m256 qf = _mm256_cvtepi32_ps(q);
+    __m256 too_small = _mm256_cmp_ps(_mm256_mul_ps(_mm256_add_ps(qf, _mm256_set1_ps(1.0f)), den), numf, _CMP_LE_OQ);
+    __m256 too_large = _mm256_cmp_ps(_mm256_mul_ps(qf, den), numf, _CMP_GT_OQ);
+    q = _mm256_sub_epi32(q, _mm256_castps_si256(too_small));
+    return _mm256_add_epi32(q, _mm256_castps_si256(too_large));
+}
+
+INK_TARGET_AVX2 static inline __m256i channel_avx2(__m256i px, int shift)
+{
+    return _mm256_and_si256(_mm256_srli_epi32(px, shift), _mm256_set1_epi32(0xff));
+}
+
+INK_TARGET_AVX2 static inline __m256i assemble_avx2(__m256i a, __m256i r, __m256i g, __m256i b)
+{
+    return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(a, 24), _mm256_slli_epi32(r, 16)),
+                           _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+}
+
+INK_TARGET_AVX2 static inline __m256i unpremul_avx2(__m256i c, __m256i half_a, __m256 af)
+{
+    __m256i num = _mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(c, 8), c), half_a);
+    return div_avx2(num, af);
+}
+
+INK_TARGET_AVX2 static inline __m256i premul_avx2(__m256i c, __m256i a)
+{
+    __m256i t = _mm256_add_epi32(_mm256_mullo_epi32(c, a), _mm256_set1_epi32(128));
+    return _mm256_srli_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 8)), 8);
+}
+
+INK_TARGET_AVX2 static inline __m256i premul_epi16_avx2(__m256i x)
+{
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+INK_TARGET_AVX2 static inline __m256i arithmetic_avx2(__m256i x1, __m256i x2, __m256i k1, __m256i k2, __m256i k3, __m256i k4)
+{
+    __m256i o = _mm256_add_epi32(_mm256_mullo_epi32(k1, _mm256_mullo_epi32(x1, x2)), _mm256_mullo_epi32(k2, x1));
+    return _mm256_add_epi32(_mm256_add_epi32(o, _mm256_mullo_epi32(k3, x2)), k4);
+}
+
+INK_TARGET_AVX2 static inline __m256i scale_avx2(__m256i x)
+{
+    __m256i y = _mm256_add_epi32(clamp_avx2(x, _mm256_setzero_si256(), _mm256_set1_epi32(255 * 255)), _mm256_set1_epi32(127));
+    return _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(y, _mm256_srli_epi32(y, 8)), _mm256_set1_epi32(1)), 8);
+}
+
+INK_TARGET_AVX2 static inline __m256i matrix_row_avx2(__m256i r, __m256i g, __m256i b, __m256i a, __m256i const *v)
+{
+    __m256i o = _mm256_add_epi32(_mm256_mullo_epi32(r, v[0]), _mm256_mullo_epi32(g, v[1]));
+    o = _mm256_add_epi32(o, _mm256_add_epi32(_mm256_mullo_epi32(b, v[2]), _mm256_mullo_epi32(a, v[3])));
+    return scale_avx2(_mm256_add_epi32(o, v[4]));
+}
+
+INK_TARGET_AVX2 static int premultiply_avx2(guint32 const *in, guint32 *out, int n)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const alpha_mask = _mm256_set1_epi32(0xff000000);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i));
+        // unpack and pack both work within 128-bit lanes, so the pixel order is preserved
+        __m256i lo = premul_epi16_avx2(_mm256_unpacklo_epi8(px, zero));
+        __m256i hi = premul_epi16_avx2(_mm256_unpackhi_epi8(px, zero));
+        __m256i alpha = _mm256_and_si256(px, alpha_mask);
+        __m256i res = _mm256_or_si256(_mm256_andnot_si256(alpha_mask, _mm256_packus_epi16(lo, hi)), alpha);
+        res = select_avx2(_mm256_cmpeq_epi32(alpha, zero), px, res);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), res);
+    }
+    return i;
+}
+
+INK_TARGET_AVX2 static int unpremultiply_avx2(guint32 const *in, guint32 *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i));
+        __m256i a = _mm256_srli_epi32(px, 24);
+        __m256i half_a = _mm256_srli_epi32(a, 1);
+        __m256 af = _mm256_cvtepi32_ps(a);
+        __m256i r = unpremul_avx2(channel_avx2(px, 16), half_a, af);
+        __m256i g = unpremul_avx2(channel_avx2(px, 8), half_a, af);
+        __m256i b = unpremul_avx2(channel_avx2(px, 0), half_a, af);
+        __m256i res = select_avx2(_mm256_cmpeq_epi32(a, _mm256_setzero_si256()), px, assemble_avx2(a, r, g, b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), res);
+    }
+    return i;
+}
+
+INK_TARGET_AVX2 static int composite_arithmetic_avx2(guint32 const *in1, guint32 const *in2, guint32 *out, int n,
+                                                     gint32 k1, gint32 k2, gint32 k3, gint32 k4)
+{
+    __m256i const vk1 = _mm256_set1_epi32(k1);
+    __m256i const vk2 = _mm256_set1_epi32(k2);
+    __m256i const vk3 = _mm256_set1_epi32(k3);
+    __m256i const vk4 = _mm256_set1_epi32(k4);
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const half = _mm256_set1_epi32(255 * 255 / 2);
+    __m256 const den = _mm256_set1_ps(255 * 255);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i p1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in1 + i));
+        __m256i p2 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in2 + i));
+
+        __m256i ao = clamp_avx2(arithmetic_avx2(_mm256_srli_epi32(p1, 24), _mm256_srli_epi32(p2, 24), vk1, vk2, vk3, vk4),
+                                zero, _mm256_set1_epi32(255 * 255 * 255));
+        __m256i ro = clamp_avx2(arithmetic_avx2(channel_avx2(p1, 16), channel_avx2(p2, 16), vk1, vk2, vk3, vk4), zero, ao);
+        __m256i go = clamp_avx2(arithmetic_avx2(channel_avx2(p1, 8), channel_avx2(p2, 8), vk1, vk2, vk3, vk4), zero, ao);
+        __m256i bo = clamp_avx2(arithmetic_avx2(channel_avx2(p1, 0), channel_avx2(p2, 0), vk1, vk2, vk3, vk4), zero, ao);
+
+        ro = div_avx2(_mm256_add_epi32(ro, half), den);
+        go = div_avx2(_mm256_add_epi32(go, half), den);
+        bo = div_avx2(_mm256_add_epi32(bo, half), den);
+        ao = div_avx2(_mm256_add_epi32(ao, half), den);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), assemble_avx2(ao, ro, go, bo));
+    }
+    return i;
+}
+
+INK_TARGET_AVX2 static int color_matrix_avx2(guint32 const *in, guint32 *out, int n, gint32 const *v)
+{
+    __m256i vv[20];
+    for (int j = 0; j < 20; ++j) {
+        vv[j] = _mm256_set1_epi32(v[j]);
+    }
+    __m256i const zero = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i));
+        __m256i a = _mm256_srli_epi32(px, 24);
+        __m256i r = channel_avx2(px, 16);
+        __m256i g = channel_avx2(px, 8);
+        __m256i b = channel_avx2(px, 0);
+
+        __m256i transparent = _mm256_cmpeq_epi32(a, zero);
+        __m256i half_a = _mm256_srli_epi32(a, 1);
+        __m256 af = _mm256_cvtepi32_ps(a);
+        r = select_avx2(transparent, r, unpremul_avx2(r, half_a, af));
+        g = select_avx2(transparent, g, unpremul_avx2(g, half_a, af));
+        b = select_avx2(transparent, b, unpremul_avx2(b, half_a, af));
+
+        __m256i ro = matrix_row_avx2(r, g, b, a, vv);
+        __m256i go = matrix_row_avx2(r, g, b, a, vv + 5);
+        __m256i bo = matrix_row_avx2(r, g, b, a, vv + 10);
+        __m256i ao = matrix_row_avx2(r, g, b, a, vv + 15);
+
+        ro = premul_avx2(ro, ao);
+        go = premul_avx2(go, ao);
+        bo = premul_avx2(bo, ao);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), assemble_avx2(ao, ro, go, bo));
+    }
+    return i;
+}
+
+#endif // INK_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+SimdLevel simd_supported_level()
+{
+#ifdef INK_SIMD_X86
+    static SimdLevel const supported = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return SimdLevel::SSE2;
+        }
+        return SimdLevel::NONE;
+    }();
+    return supported;
+#else
+    return SimdLevel::NONE;
+#endif
+}
+
+static SimdLevel &current_level()
+{
+    static SimdLevel level = simd_supported_level();
+    return level;
+}
+
+SimdLevel simd_level()
+{
+    return current_level();
+}
+
+void simd_set_level(SimdLevel level)
+{
+    current_level() = std::min(level, simd_supported_level());
+}
+
+int simd_premultiply(guint32 const *in, guint32 *out, int n)
+{
+    switch (simd_level()) {
+#ifdef INK_SIMD_X86
+        case SimdLevel::AVX2:
+            return premultiply_avx2(in, out, n);
+        case SimdLevel::SSE2:
+            return premultiply_sse2(in, out, n);
+#endif
+        default:
+            return 0;
+    }
+}
+
+int simd_unpremultiply(guint32 const *in, guint32 *out, int n)
+{
+    switch (simd_level()) {
+#ifdef INK_SIMD_X86
+        case SimdLevel::AVX2:
+            return unpremultiply_avx2(in, out, n);
+        case SimdLevel::SSE2:
+            return unpremultiply_sse2(in, out, n);
+#endif
+        default:
+            return 0;
+    }
+}
+
+int simd_composite_arithmetic(guint32 const *in1, guint32 const *in2, guint32 *out, int n,
+                              gint32 k1, gint32 k2, gint32 k3, gint32 k4)
+{
+    switch (simd_level()) {
+#ifdef INK_SIMD_X86
+        case SimdLevel::AVX2:
+            return composite_arithmetic_avx2(in1, in2, out, n, k1, k2, k3, k4);
+        case SimdLevel::SSE2:
+            return composite_arithmetic_sse2(in1, in2, out, n, k1, k2, k3, k4);
+#endif
+        default:
+            return 0;
+    }
+}
+
+int simd_color_matrix(guint32 const *in, guint32 *out, int n, gint32 const *v)
+{
+    switch (simd_level()) {
+#ifdef INK_SIMD_X86
+        case SimdLevel::AVX2:
+            return color_matrix_avx2(in, out, n, v);
+        case SimdLevel::SSE2:
+            return color_matrix_sse2(in, out, n, v);
+#endif
+        default:
+            return 0;
+    }
+}
+
+} // namespace Display
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#ifndef SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+#define SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+
+/** @file
+ * SIMD versions of per-pixel filter functors.
+ *//*
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <glib.h>
+
+namespace Inkscape {
+namespace Display {
+
+/**
+ * Instruction sets the span kernels below can use. The best one supported by the CPU
+ * is picked at run time.
+ */
+enum class SimdLevel {
+    NONE,
+    SSE2,
+    AVX2
+};
+
+/// Instruction set used by the span kernels.
+SimdLevel simd_level();
+
+/// Best instruction set supported by this CPU and build.
+SimdLevel simd_supported_level();
+
+/// Use at most the given instruction set; intended for benchmarks and tests.
+void simd_set_level(SimdLevel level);
+
+/*
+ * The kernels below process ARGB32 pixels in blocks of 4 or 8 and return the number of
+ * pixels processed, which is a multiple of the block size and may be 0. The remaining
+ * pixels have to be processed by the scalar functor. Their results are identical to the
+ * scalar versions. Input and output may be the same buffer.
+ */
+
+/// Premultiply color by alpha, like FilterComponentTransfer::MultiplyAlpha.
+int simd_premultiply(guint32 const *in, guint32 *out, int n);
+
+/// Unpremultiply color by alpha, like FilterComponentTransfer::UnmultiplyAlpha.
+int simd_unpremultiply(guint32 const *in, guint32 *out, int n);
+
+/// Arithmetic compositing with fixed point coefficients, like FilterComposite::ComposeArithmetic.
+int simd_composite_arithmetic(guint32 const *in1, guint32 const *in2, guint32 *out, int n,
+                              gint32 k1, gint32 k2, gint32 k3, gint32 k4);
+
+/// 5x4 color matrix with fixed point coefficients, like FilterColorMatrix::ColorMatrixMatrix.
+int simd_color_matrix(guint32 const *in, guint32 *out, int n, gint32 const *v);
+
+} // namespace Display
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -29,9 +29,59 @@ static const int OPENMP_THRESHOLD = 2048;
 #include <algorithm>
 #include <cairo.h>
 #include <cmath>
+#include <type_traits>
 #include "display/nr-3dutils.h"
 #include "display/cairo-utils.h"
 
+/*
+ * Besides operator(), filter and blend functors may provide a method processing a span of
+ * consecutive ARGB32 pixels at once, typically with SIMD (see display/cairo-simd.h):
+ *
+ *   int filterSpan(guint32 const *in, guint32 *out, int n);
+ *   int blendSpan(guint32 const *in1, guint32 const *in2, guint32 *out, int n);
+ *
+ * They return the number of leading pixels they processed; operator() is called for the rest.
+ * Span methods are only used where both input and output are ARGB32.
+ */
+template <typename Filter, typename = void>
+struct ink_has_filter_span : std::false_type {};
+template <typename Filter>
+struct ink_has_filter_span<Filter, std::void_t<decltype(std::declval<Filter &>().filterSpan(
+    std::declval<guint32 const *>(), std::declval<guint32 *>(), 0))>> : std::true_type {};
+
+template <typename Blend, typename = void>
+struct ink_has_blend_span : std::false_type {};
+template <typename Blend>
+struct ink_has_blend_span<Blend, std::void_t<decltype(std::declval<Blend &>().blendSpan(
+    std::declval<guint32 const *>(), std::declval<guint32 const *>(), std::declval<guint32 *>(), 0))>> : std::true_type {};
+
+// number of pixels handed to a span method at once in the fast paths
+static const int INK_SPAN_LENGTH = 1024;
+
+template <typename Filter>
+inline void ink_filter_span(Filter &filter, guint32 const *in, guint32 *out, int n)
+{
+    int i = 0;
+    if constexpr (ink_has_filter_span<Filter>::value) {
+        i = filter.filterSpan(in, out, n);
+    }
+    for (; i < n; ++i) {
+        out[i] = filter(in[i]);
+    }
+}
+
+template <typename Blend>
+inline void ink_blend_span(Blend &blend, guint32 const *in1, guint32 const *in2, guint32 *out, int n)
+{
+    int i = 0;
+    if constexpr (ink_has_blend_span<Blend>::value) {
+        i = blend.blendSpan(in1, in2, out, n);
+    }
+    for (; i < n; ++i) {
+        out[i] = blend(in1[i], in2[i]);
+    }
+}
+
 /**
  * Blend two surfaces using the supplied functor.
  * This template blends two Cairo image surfaces using a blending functor that takes
@@ -88,8 +138,8 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                 #if HAVE_OPENMP
                 #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
                 #endif
-                for (int i = 0; i < limit; ++i) {
-                    *(out_data + i) = blend(*(in1_data + i), *(in2_data + i));
+                for (int i = 0; i < limit; i += INK_SPAN_LENGTH) {
+                    ink_blend_span(blend, in1_data + i, in2_data + i, out_data + i, std::min(INK_SPAN_LENGTH, limit - i));
                 }
             } else {
                 #if HAVE_OPENMP
@@ -99,10 +149,7 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                     guint32 *in1_p = in1_data + i * stride1/4;
                     guint32 *in2_p = in2_data + i * stride2/4;
                     guint32 *out_p = out_data + i * strideout/4;
-                    for (int j = 0; j < w; ++j) {
-                        *out_p = blend(*in1_p, *in2_p);
-                        ++in1_p; ++in2_p; ++out_p;
-                    }
+                    ink_blend_span(blend, in1_p, in2_p, out_p, w);
                 }
             }
         } else {
@@ -215,8 +262,8 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
             #if HAVE_OPENMP
             #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
             #endif
-            for (int i = 0; i < limit; ++i) {
-                *(in_data + i) = filter(*(in_data + i));
+            for (int i = 0; i < limit; i += INK_SPAN_LENGTH) {
+                ink_filter_span(filter, in_data + i, in_data + i, std::min(INK_SPAN_LENGTH, limit - i));
             }
         } else {
             #if HAVE_OPENMP
@@ -240,8 +287,8 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
                 #if HAVE_OPENMP
                 #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
                 #endif
-                for (int i = 0; i < limit; ++i) {
-                    *(out_data + i) = filter(*(in_data + i));
+                for (int i = 0; i < limit; i += INK_SPAN_LENGTH) {
+                    ink_filter_span(filter, in_data + i, out_data + i, std::min(INK_SPAN_LENGTH, limit - i));
                 }
             } else {
                 #if HAVE_OPENMP
@@ -250,10 +297,7 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
                 for (int i = 0; i < h; ++i) {
                     guint32 *in_p = in_data + i * stridein/4;
                     guint32 *out_p = out_data + i * strideout/4;
-                    for (int j = 0; j < w; ++j) {
-                        *out_p = filter(*in_p);
-                        ++in_p; ++out_p;
-                    }
+                    ink_filter_span(filter, in_p, out_p, w);
                 }
             }
         } else {
@@ -23,6 +23,8 @@
 
 namespace Inkscape {
 
+class DrawingSurface;
+
 /**
  * Class used when rendering canvas items.
  */
@@ -43,6 +45,8 @@ public:
     unsigned char *buf = nullptr;
     int buf_rowstride  = 0;
     bool is_empty      = true;
+
+    DrawingSurface *drawing_tile = nullptr; // Drawing already rendered for rect by a worker thread.
 };
 
 } // Namespace Inkscape
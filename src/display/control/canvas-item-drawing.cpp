@@ -190,6 +190,15 @@ void CanvasItemDrawing::render(Inkscape::CanvasItemBuffer *buf)
     }
 
     Inkscape::DrawingContext dc(buf->cr->cobj(), buf->rect.min());
+
+    if (buf->drawing_tile) {
+        // See Canvas::paint_rect_threaded().
+        dc.setSource(buf->drawing_tile);
+        dc.paint();
+        dc.setSource(0, 0, 0, 0);
+        return;
+    }
+
     _drawing->update();
     _drawing->render(dc, buf->rect);
 }
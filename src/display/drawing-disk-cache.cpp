@@ -0,0 +1,598 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Persistent cache of rendered filtered items.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <tuple>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "display/drawing-context.h"
+#include "display/drawing-disk-cache.h"
+#include "display/drawing-surface.h"
+#include "document.h"
+#include "inkscape-version.h"
+#include "io/resource.h"
+#include "libnrtype/FontFactory.h"
+#include "libnrtype/font-instance.h"
+#include "object/sp-object.h"
+#include "preferences.h"
+#include "style.h"
+#include "xml/node.h"
+
+namespace Inkscape {
+
+namespace {
+
+/// Memory used for tiles kept in memory.
+size_t const RECENT_LIMIT = 64 * 1024 * 1024;
+
+/// Memory used for tiles waiting to be written. Tiles beyond it are not stored.
+size_t const PENDING_LIMIT = 64 * 1024 * 1024;
+
+/// Start of every tile file, followed by width, height and device scale as 32 bit integers
+/// and the ARGB32 pixels without padding.
+char const MAGIC[8] = {'I', 'N', 'K', 'R', 'C', '0', '0', '2'};
+size_t const HEADER_SIZE = sizeof(MAGIC) + 3 * sizeof(gint32);
+
+void hash_string(GChecksum *sum, char const *s)
+{
+    // include the terminating zero so that consecutive strings cannot run together
+    g_checksum_update(sum, reinterpret_cast<guchar const *>(s), std::strlen(s) + 1);
+}
+
+template <typename T>
+void hash_value(GChecksum *sum, T value)
+{
+    g_checksum_update(sum, reinterpret_cast<guchar const *>(&value), sizeof(value));
+}
+
+/// Hashes the modification time and size of a file.
+void hash_file_stat(GChecksum *sum, std::string const &path)
+{
+    GStatBuf st;
+    if (!path.empty() && g_stat(path.c_str(), &st) == 0) {
+        hash_value(sum, static_cast<gint64>(st.st_mtime));
+        hash_value(sum, static_cast<gint64>(st.st_size));
+    }
+}
+
+void hash_object(GChecksum *sum, SPObject *object, std::set<SPObject *> &seen);
+
+/// Hashes the objects referred to as url(#id) or #id in value.
+void hash_references(GChecksum *sum, SPDocument *document, char const *value, std::set<SPObject *> &seen)
+{
+    for (char const *p = std::strchr(value, '#'); p; p = std::strchr(p, '#')) {
+        ++p;
+        size_t len = std::strcspn(p, ") \"';,");
+        if (SPObject *ref = document->getObjectById(std::string(p, len))) {
+            hash_object(sum, ref, seen);
+        }
+        p += len;
+    }
+}
+
+/// Hashes a linked file.
+void hash_file(GChecksum *sum, SPDocument *document, char const *href)
+{
+    if (href[0] == '#' || g_str_has_prefix(href, "data:")) {
+        return;
+    }
+    std::string path;
+    if (g_str_has_prefix(href, "file:")) {
+        if (gchar *filename = g_filename_from_uri(href, nullptr, nullptr)) {
+            path = filename;
+            g_free(filename);
+        }
+    } else if (g_path_is_absolute(href) || !document->getDocumentBase()) {
+        path = href;
+    } else {
+        gchar *filename = g_build_filename(document->getDocumentBase(), href, nullptr);
+        path = filename;
+        g_free(filename);
+    }
+    hash_file_stat(sum, path);
+}
+
+/// Hashes the font text is set in, since the same style may select another font file later.
+void hash_font(GChecksum *sum, SPStyle const *style)
+{
+    font_instance *font = font_factory::Default()->FaceFromStyle(style);
+    if (!font) {
+        return;
+    }
+    std::string face = font->GlyphCacheFaceKey();
+    hash_string(sum, face.c_str());
+    // the key starts with the file of the font, followed by the index of the face in it
+    auto end = face.rfind(" #");
+    if (end != std::string::npos) {
+        hash_file_stat(sum, face.substr(0, end));
+    }
+    font->Unref();
+}
+
+void hash_object(GChecksum *sum, SPObject *object, std::set<SPObject *> &seen)
+{
+    if (!seen.insert(object).second) {
+        return;
+    }
+    Inkscape::XML::Node *repr = object->getRepr();
+    if (!repr) {
+        return;
+    }
+
+    hash_string(sum, repr->name());
+    if (repr->content()) {
+        hash_string(sum, repr->content());
+        if (object->parent && object->parent->style) {
+            hash_font(sum, object->parent->style);
+        }
+    }
+    for (auto const &attr : repr->attributeList()) {
+        char const *name = g_quark_to_string(attr.key);
+        hash_string(sum, name);
+        hash_string(sum, attr.value);
+        hash_references(sum, object->document, attr.value, seen);
+        if (!std::strcmp(name, "xlink:href") || !std::strcmp(name, "href")) {
+            hash_file(sum, object->document, attr.value);
+        }
+    }
+    // The computed style covers inherited properties and style sheets.
+    if (object->style) {
+        Glib::ustring style = object->style->write(SP_STYLE_FLAG_ALWAYS);
+        hash_string(sum, style.c_str());
+        hash_references(sum, object->document, style.c_str(), seen);
+    }
+
+    for (auto &child : object->children) {
+        hash_object(sum, &child, seen);
+    }
+}
+
+/// The stored tiles of a key and device scale are named after this, followed by their area.
+std::string tile_prefix(std::string const &key, int device_scale)
+{
+    return key + "@" + std::to_string(device_scale);
+}
+
+std::string tile_name(std::string const &prefix, Geom::IntRect const &area)
+{
+    return prefix + "_" + std::to_string(area.left()) + "_" + std::to_string(area.top()) + "_" +
+           std::to_string(area.width()) + "_" + std::to_string(area.height());
+}
+
+/// Splits a tile name into its prefix and area.
+bool parse_tile_name(std::string const &name, std::string &prefix, Geom::IntRect &area)
+{
+    auto at = name.find('@');
+    auto start = name.find('_', at);
+    if (at == std::string::npos || start == std::string::npos) {
+        return false;
+    }
+    int x, y, w, h;
+    char rest;
+    if (std::sscanf(name.c_str() + start, "_%d_%d_%d_%d%c", &x, &y, &w, &h, &rest) != 4 || w <= 0 || h <= 0) {
+        return false;
+    }
+    prefix = name.substr(0, start);
+    area = Geom::IntRect::from_xywh(x, y, w, h);
+    return true;
+}
+
+Geom::IntRect translated(Geom::IntRect const &area, Geom::IntPoint const &offset)
+{
+    return Geom::IntRect(area.min() + offset, area.max() + offset);
+}
+
+} // namespace
+
+DrawingDiskCache *DrawingDiskCache::get()
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    if (!prefs->getBool("/options/renderingcache/disk", false)) {
+        return nullptr;
+    }
+    static DrawingDiskCache cache;
+    return &cache;
+}
+
+DrawingDiskCache::DrawingDiskCache()
+    : _dir(IO::Resource::get_path_string(IO::Resource::CACHE, IO::Resource::NONE, "render"))
+    , _limit(Inkscape::Preferences::get()->getIntLimited("/options/renderingcache/disksize", 256, 1, 65536) *
+             size_t(1024 * 1024))
+    , _disk_size(0)
+    , _recent_size(0)
+    , _pending_size(0)
+    , _quit(false)
+{
+    g_mkdir_with_parents(_dir.c_str(), 0700);
+    _writer = std::thread(&DrawingDiskCache::_write, this);
+}
+
+DrawingDiskCache::~DrawingDiskCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _pending_changed.notify_all();
+    _writer.join();
+
+    for (auto &recent : _recent) {
+        cairo_surface_destroy(recent.second);
+    }
+}
+
+/**
+ * Computes the key for the rendering of an object.
+ * @param object The object that is rendered, usually a filtered group.
+ * @param ctm Transform from the object to display coordinates.
+ */
+std::string DrawingDiskCache::key(SPObject *object, Geom::Affine const &ctm, int blur_quality,
+                                  int filter_quality, int antialias)
+{
+    GChecksum *sum = g_checksum_new(G_CHECKSUM_SHA256);
+
+    // rendering may change between versions
+    hash_string(sum, Inkscape::version_string);
+
+    std::set<SPObject *> seen;
+    hash_object(sum, object, seen);
+
+    for (int i = 0; i < 4; ++i) {
+        hash_value(sum, ctm[i]);
+    }
+    // Only the position within a pixel, in steps small enough not to show.
+    Geom::IntPoint whole = origin(ctm);
+    hash_value(sum, static_cast<gint32>(std::round((ctm[4] - whole[Geom::X]) * 256)));
+    hash_value(sum, static_cast<gint32>(std::round((ctm[5] - whole[Geom::Y]) * 256)));
+    hash_value(sum, blur_quality);
+    hash_value(sum, filter_quality);
+    hash_value(sum, antialias);
+
+    std::string result = g_checksum_get_string(sum);
+    g_checksum_free(sum);
+    return result;
+}
+
+Geom::IntPoint DrawingDiskCache::origin(Geom::Affine const &ctm)
+{
+    return Geom::IntPoint(std::floor(ctm[4]), std::floor(ctm[5]));
+}
+
+bool DrawingDiskCache::load(std::string const &key, Geom::IntPoint const &origin, int device_scale,
+                            Geom::IntRect const &area, DrawingContext &dc)
+{
+    std::string prefix = tile_prefix(key, device_scale);
+    Geom::IntRect relative = translated(area, -origin);
+
+    std::vector<Geom::IntRect> tiles;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto stored = _areas.find(prefix);
+        if (stored == _areas.end()) {
+            return false;
+        }
+        cairo_region_t *covered = cairo_region_create();
+        for (auto const &tile : stored->second) {
+            if (tile.interiorIntersects(relative)) {
+                cairo_rectangle_int_t r = {tile.left(), tile.top(), tile.width(), tile.height()};
+                cairo_region_union_rectangle(covered, &r);
+                tiles.push_back(tile);
+            }
+        }
+        cairo_rectangle_int_t r = {relative.left(), relative.top(), relative.width(), relative.height()};
+        bool complete = cairo_region_contains_rectangle(covered, &r) == CAIRO_REGION_OVERLAP_IN;
+        cairo_region_destroy(covered);
+        if (!complete) {
+            return false;
+        }
+    }
+
+    std::vector<cairo_surface_t *> surfaces;
+    for (auto const &tile : tiles) {
+        cairo_surface_t *surface = _read(tile_name(prefix, tile), device_scale);
+        if (!surface) {
+            // removed in the meantime
+            for (auto s : surfaces) {
+                cairo_surface_destroy(s);
+            }
+            return false;
+        }
+        surfaces.push_back(surface);
+    }
+
+    dc.setOperator(CAIRO_OPERATOR_SOURCE);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        Geom::IntRect tile = translated(tiles[i], origin);
+        DrawingSurface stored(surfaces[i], tile.min());
+        cairo_surface_destroy(surfaces[i]);
+        dc.rectangle(*(tile & area));
+        dc.setSource(&stored);
+        dc.fill();
+    }
+    dc.setSource(0, 0, 0, 0);
+    return true;
+}
+
+void DrawingDiskCache::store(std::string const &key, Geom::IntPoint const &origin, DrawingSurface &rendering,
+                             Geom::IntRect const &area)
+{
+    int device_scale = rendering.device_scale();
+    size_t bytes = static_cast<size_t>(area.width()) * area.height() * device_scale * device_scale * 4;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_pending_size + bytes > PENDING_LIMIT) {
+            return; // the disk can't keep up
+        }
+        _pending_size += bytes;
+    }
+
+    DrawingSurface tile(area, device_scale);
+    {
+        DrawingContext tc(tile);
+        tc.rectangle(area);
+        tc.setOperator(CAIRO_OPERATOR_SOURCE);
+        tc.setSource(&rendering);
+        tc.fill();
+    }
+    Tile pending = {tile_name(tile_prefix(key, device_scale), translated(area, -origin)),
+                    translated(area, -origin), cairo_surface_reference(tile.raw())};
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.push_back(pending);
+    }
+    _pending_changed.notify_one();
+}
+
+std::string DrawingDiskCache::_path(std::string const &name) const
+{
+    gchar *filename = g_build_filename(_dir.c_str(), name.c_str(), nullptr);
+    std::string result = filename;
+    g_free(filename);
+    return result;
+}
+
+/// Returns a new reference to a stored tile, or null.
+cairo_surface_t *DrawingDiskCache::_read(std::string const &name, int device_scale)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto it = _recent.begin(); it != _recent.end(); ++it) {
+            if (it->first == name) {
+                _recent.splice(_recent.begin(), _recent, it);
+                return cairo_surface_reference(it->second);
+            }
+        }
+    }
+
+    std::string path = _path(name);
+    gchar *data = nullptr;
+    gsize length = 0;
+    if (!g_file_get_contents(path.c_str(), &data, &length, nullptr)) {
+        return nullptr;
+    }
+
+    cairo_surface_t *surface = nullptr;
+    gint32 size[3] = {0, 0, 0};
+    if (length >= HEADER_SIZE && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0) {
+        std::memcpy(size, data + sizeof(MAGIC), sizeof(size));
+    }
+    int width = size[0], height = size[1], scale = size[2];
+    if (width > 0 && height > 0 && scale == device_scale &&
+        length == HEADER_SIZE + static_cast<gsize>(width) * height * 4)
+    {
+        surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        unsigned char *px = cairo_image_surface_get_data(surface);
+        int stride = cairo_image_surface_get_stride(surface);
+        for (int y = 0; y < height; ++y) {
+            std::memcpy(px + y * stride, data + HEADER_SIZE + y * width * 4, width * 4);
+        }
+        cairo_surface_mark_dirty(surface);
+        cairo_surface_set_device_scale(surface, device_scale, device_scale);
+    } else {
+        g_warning("DrawingDiskCache: ignoring invalid file %s", path.c_str());
+    }
+    g_free(data);
+
+    if (!surface) {
+        return nullptr;
+    }
+    // the modification time orders the tiles for _trim()
+    g_utime(path.c_str(), nullptr);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _remember(name, cairo_surface_reference(surface));
+    return surface;
+}
+
+/// Keeps a reference to a surface in memory, taking ownership of it. Called with _mutex held.
+void DrawingDiskCache::_remember(std::string const &name, cairo_surface_t *surface)
+{
+    _recent.emplace_front(name, surface);
+    _recent_size += cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+    while (_recent_size > RECENT_LIMIT && _recent.size() > 1) {
+        cairo_surface_t *old = _recent.back().second;
+        _recent_size -= cairo_image_surface_get_stride(old) * cairo_image_surface_get_height(old);
+        cairo_surface_destroy(old);
+        _recent.pop_back();
+    }
+}
+
+/// Records a stored tile, replacing an earlier one of the same name. Called with _mutex held.
+bool DrawingDiskCache::_index(std::string const &name, size_t size)
+{
+    std::string prefix;
+    Geom::IntRect area;
+    if (!parse_tile_name(name, prefix, area)) {
+        return false;
+    }
+    auto old = _sizes.find(name);
+    if (old != _sizes.end()) {
+        _disk_size -= old->second;
+        old->second = size;
+    } else {
+        _sizes.emplace(name, size);
+        _areas[prefix].push_back(area);
+    }
+    _disk_size += size;
+    return true;
+}
+
+/// Drops a tile that was removed from disk. Called with _mutex held.
+void DrawingDiskCache::_forget(std::string const &name)
+{
+    auto old = _sizes.find(name);
+    if (old == _sizes.end()) {
+        return;
+    }
+    _disk_size -= old->second;
+    _sizes.erase(old);
+
+    std::string prefix;
+    Geom::IntRect area;
+    parse_tile_name(name, prefix, area);
+    auto &areas = _areas[prefix];
+    areas.erase(std::remove(areas.begin(), areas.end(), area), areas.end());
+    if (areas.empty()) {
+        _areas.erase(prefix);
+    }
+
+    for (auto it = _recent.begin(); it != _recent.end(); ++it) {
+        if (it->first == name) {
+            _recent_size -= cairo_image_surface_get_stride(it->second) * cairo_image_surface_get_height(it->second);
+            cairo_surface_destroy(it->second);
+            _recent.erase(it);
+            break;
+        }
+    }
+}
+
+/// Runs on _writer: finds the tiles of earlier sessions, then writes queued tiles.
+void DrawingDiskCache::_write()
+{
+    if (GDir *dir = g_dir_open(_dir.c_str(), 0, nullptr)) {
+        std::vector<std::pair<std::string, size_t>> found;
+        while (char const *base = g_dir_read_name(dir)) {
+            std::string path = _path(base);
+            GStatBuf st;
+            if (g_file_test(path.c_str(), G_FILE_TEST_IS_REGULAR) && g_stat(path.c_str(), &st) == 0) {
+                found.emplace_back(base, st.st_size);
+            }
+        }
+        g_dir_close(dir);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto const &file : found) {
+            if (!_index(file.first, file.second)) {
+                g_unlink(_path(file.first).c_str()); // left by an older version
+            }
+        }
+    }
+    _trim(_limit);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _pending_changed.wait(lock, [this] { return _quit || !_pending.empty(); });
+        if (_pending.empty()) {
+            break;
+        }
+        Tile tile = _pending.front();
+        _pending.pop_front();
+        lock.unlock();
+
+        cairo_surface_flush(tile.surface);
+        gint32 size[3] = {cairo_image_surface_get_width(tile.surface), cairo_image_surface_get_height(tile.surface), 0};
+        double scale = 1;
+        cairo_surface_get_device_scale(tile.surface, &scale, nullptr);
+        size[2] = scale;
+        int stride = cairo_image_surface_get_stride(tile.surface);
+        unsigned char const *px = cairo_image_surface_get_data(tile.surface);
+
+        std::string contents(HEADER_SIZE + static_cast<size_t>(size[0]) * size[1] * 4, '\0');
+        std::memcpy(&contents[0], MAGIC, sizeof(MAGIC));
+        std::memcpy(&contents[sizeof(MAGIC)], size, sizeof(size));
+        for (int y = 0; y < size[1]; ++y) {
+            std::memcpy(&contents[HEADER_SIZE + y * size[0] * 4], px + y * stride, size[0] * 4);
+        }
+
+        GError *error = nullptr;
+        bool written = g_file_set_contents(_path(tile.name).c_str(), contents.data(), contents.size(), &error);
+        if (!written) {
+            g_warning("DrawingDiskCache: %s", error->message);
+            g_error_free(error);
+        }
+
+        lock.lock();
+        _pending_size -= static_cast<size_t>(stride) * size[1];
+        if (written) {
+            _index(tile.name, contents.size());
+            _remember(tile.name, tile.surface);
+        } else {
+            cairo_surface_destroy(tile.surface);
+        }
+        if (_disk_size > _limit) {
+            lock.unlock();
+            _trim(_limit * 3 / 4);
+            lock.lock();
+        }
+    }
+}
+
+/// Removes the least recently used tiles until at most limit bytes are used.
+void DrawingDiskCache::_trim(size_t limit)
+{
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_disk_size <= limit) {
+            return;
+        }
+        for (auto const &tile : _sizes) {
+            names.push_back(tile.first);
+        }
+    }
+
+    std::vector<std::tuple<gint64, std::string>> files;
+    for (auto const &name : names) {
+        GStatBuf st;
+        if (g_stat(_path(name).c_str(), &st) == 0) {
+            files.emplace_back(st.st_mtime, name);
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto const &file : files) {
+        if (_disk_size <= limit) {
+            break;
+        }
+        g_unlink(_path(std::get<1>(file)).c_str());
+        _forget(std::get<1>(file));
+    }
+}
+
+} // end namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Persistent cache of rendered filtered items.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_DISK_CACHE_H
+#define SEEN_INKSCAPE_DISPLAY_DRAWING_DISK_CACHE_H
+
+#include <cairo.h>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <2geom/affine.h>
+#include <2geom/int-rect.h>
+
+class SPObject;
+
+namespace Inkscape {
+
+class DrawingContext;
+class DrawingSurface;
+
+/**
+ * Stores renderings of filtered items in the user's cache directory, so that they can be
+ * reused after the document is closed and reopened, across exports and while panning.
+ *
+ * Entries are addressed by a hash of everything that determines the rendering: the XML
+ * subtree of the item, the computed style of each object in it, the resources and font
+ * files it refers to, the rendering quality and the transform to display coordinates
+ * without its whole-pixel translation. Stored areas are relative to that translation, see
+ * origin(), so an item that moved by whole pixels finds its rendering again. Entries are
+ * never invalidated; a changed item simply gets a new key.
+ *
+ * Only the areas that were painted are stored, as separate tiles, and a rendering is found
+ * if the tiles of its key cover the requested area. Tiles are written by a background
+ * thread. The least recently used tiles are removed when the cache grows over its size
+ * limit. All methods may be called from several threads at once.
+ */
+class DrawingDiskCache
+{
+public:
+    /// Returns the cache, or null if it is disabled in the preferences.
+    static DrawingDiskCache *get();
+
+    ~DrawingDiskCache();
+
+    std::string key(SPObject *object, Geom::Affine const &ctm, int blur_quality, int filter_quality,
+                    int antialias);
+    /// The whole-pixel translation of ctm, which stored areas are relative to.
+    static Geom::IntPoint origin(Geom::Affine const &ctm);
+
+    /**
+     * Paints the stored rendering of area, in display coordinates, onto dc.
+     * Returns false without painting anything if not all of area is stored.
+     */
+    bool load(std::string const &key, Geom::IntPoint const &origin, int device_scale,
+              Geom::IntRect const &area, DrawingContext &dc);
+    /// Queues the part of rendering within area for storing.
+    void store(std::string const &key, Geom::IntPoint const &origin, DrawingSurface &rendering,
+               Geom::IntRect const &area);
+
+private:
+    DrawingDiskCache();
+
+    struct Tile
+    {
+        std::string name;
+        Geom::IntRect area; ///< Relative to the origin of the key
+        cairo_surface_t *surface;
+    };
+
+    std::string _path(std::string const &name) const;
+    cairo_surface_t *_read(std::string const &name, int device_scale);
+    void _remember(std::string const &name, cairo_surface_t *surface);
+    bool _index(std::string const &name, size_t size);
+    void _forget(std::string const &name);
+    void _write();
+    void _trim(size_t limit);
+
+    std::mutex _mutex;
+    std::string _dir;
+    size_t _limit;     ///< Bytes the tiles may use on disk
+    size_t _disk_size; ///< Bytes of the stored tiles
+    std::map<std::string, size_t> _sizes; ///< Size of each stored tile
+    std::map<std::string, std::vector<Geom::IntRect>> _areas; ///< Stored tiles of each key and scale
+    std::list<std::pair<std::string, cairo_surface_t *>> _recent; ///< Most recently used first
+    size_t _recent_size;
+
+    // Tiles are written by _writer, so that rendering doesn't wait for the disk.
+    std::thread _writer;
+    std::condition_variable _pending_changed;
+    std::deque<Tile> _pending;
+    size_t _pending_size;
+    bool _quit;
+};
+
+} // end namespace Inkscape
+
+#endif // !SEEN_INKSCAPE_DISPLAY_DRAWING_DISK_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
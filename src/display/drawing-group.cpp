@@ -78,7 +78,7 @@ DrawingGroup::_updateItem(Geom::IntRect const &area, UpdateContext const &ctx, u
         child_ctx.ctm = *_child_transform * ctx.ctm;
     }
     for (auto & i : _children) {
-        i.update(area, child_ctx, flags, reset);
+        i.update(area, child_ctx, flags, _inheritAntialiasing(i, reset));
     }
     if (beststate & STATE_BBOX) {
         _bbox = Geom::OptIntRect();
@@ -97,7 +97,6 @@ DrawingGroup::_renderItem(DrawingContext &dc, Geom::IntRect const &area, unsigne
     if (stop_at == nullptr) {
         // normal rendering
         for (auto &i : _children) {
-            i.setAntialiasing(_antialias);
             i.render(dc, area, flags, stop_at);
         }
     } else {
@@ -107,11 +106,9 @@ DrawingGroup::_renderItem(DrawingContext &dc, Geom::IntRect const &area, unsigne
                 return RENDER_OK; // do not render the stop_at item at all
             if (i.isAncestorOf(stop_at)) {
                 // render its ancestors without masks, opacity or filters
-                i.setAntialiasing(_antialias);
                 i.render(dc, area, flags | RENDER_FILTER_BACKGROUND, stop_at);
                 return RENDER_OK;
             } else {
-                i.setAntialiasing(_antialias);
                 i.render(dc, area, flags, stop_at);
             }
         }
@@ -123,7 +120,6 @@ void
 DrawingGroup::_clipItem(DrawingContext &dc, Geom::IntRect const &area)
 {
     for (auto & i : _children) {
-        i.setAntialiasing(_antialias);
         i.clip(dc, area);
     }
 }
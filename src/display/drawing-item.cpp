@@ -13,6 +13,7 @@
 #include <climits>
 
 #include "display/drawing-context.h"
+#include "display/drawing-disk-cache.h"
 #include "display/drawing-group.h"
 #include "display/drawing-item.h"
 #include "display/drawing-pattern.h"
@@ -24,6 +25,7 @@
 #include "display/cairo-templates.h"
 
 #include "display/control/canvas-item-drawing.h"
+#include "debug/trace.h"
 #include "ui/widget/canvas.h" // Mark area for redrawing.
 
 #include "nr-filter.h"
@@ -84,6 +86,7 @@ DrawingItem::DrawingItem(Drawing &drawing)
     , _pick_children(0)
     , _antialias(2)
     , _prev_nir(false)
+    , _disk_cache(nullptr)
     , _isolation(SP_CSS_ISOLATION_AUTO)
     , _mix_blend_mode(SP_CSS_BLEND_NORMAL)
 {}
@@ -251,7 +254,8 @@ DrawingItem::setAntialiasing(unsigned a)
 {
     if (_antialias != a) {
         _antialias = a;
-        _markForRendering();
+        // children, clipping paths and masks take it over in update()
+        _markForUpdate(STATE_RENDER, true);
     }
 }
 
@@ -287,6 +291,21 @@ DrawingItem::setSensitive(bool s)
     _sensitive = s;
 }
 
+/**
+ * Passes the antialias setting on to a child, clipping path or mask which is about to be
+ * updated, so that rendering does not have to. Returns the reset flags for its update.
+ */
+unsigned
+DrawingItem::_inheritAntialiasing(DrawingItem &child, unsigned reset) const
+{
+    if (child._antialias != _antialias) {
+        child._antialias = _antialias;
+        // its own children have to take it over as well
+        reset |= STATE_RENDER;
+    }
+    return reset;
+}
+
 /**
  * Enable / disable storing the rendering in memory.
  * Calling setCached(false, true) will also remove the persistent status
@@ -559,6 +578,10 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
     // update _bbox and call this function for children
     _state = _updateItem(area, child_ctx, flags, reset);
 
+    // Clipping paths and masks are rendered with the antialias setting of this item.
+    unsigned clip_reset = _clip ? _inheritAntialiasing(*_clip, reset) : reset;
+    unsigned mask_reset = _mask ? _inheritAntialiasing(*_mask, reset) : reset;
+
     if (to_update & STATE_BBOX) {
         // compute drawbox
         if (_filter && render_filters) {
@@ -575,7 +598,7 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
 
         // Clipping
         if (_clip) {
-            _clip->update(area, child_ctx, flags, reset);
+            _clip->update(area, child_ctx, flags, clip_reset);
             if (outline) {
                 _bbox.unionWith(_clip->_bbox);
             } else {
@@ -584,7 +607,7 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
         }
         // Masking
         if (_mask) {
-            _mask->update(area, child_ctx, flags, reset);
+            _mask->update(area, child_ctx, flags, mask_reset);
             if (outline) {
                 _bbox.unionWith(_mask->_bbox);
             } else {
@@ -592,6 +615,13 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
                 _drawbox.intersectWith(_mask->_drawbox);
             }
         }
+    } else {
+        if (_clip && clip_reset != reset) {
+            _clip->update(area, child_ctx, flags, clip_reset);
+        }
+        if (_mask && mask_reset != reset) {
+            _mask->update(area, child_ctx, flags, mask_reset);
+        }
     }
     if (to_update & STATE_CACHE) {
         // Update cache score for this item
@@ -632,6 +662,12 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
                 setCached(false, true);
             }
         }
+
+        // Filtered items on the canvas are always cached. render() decides this again, except
+        // when it runs concurrently with RENDER_READONLY, which relies on this decision.
+        if (_visible && _filter && render_filters) {
+            setCached(bool(_cacheRect()), true);
+        }
     }
 
     if (to_update & STATE_RENDER) {
@@ -647,6 +683,9 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
             _markForRendering();
         }
     }
+    if (to_update & (STATE_BBOX | STATE_RENDER)) {
+        _updateDiskCacheKey();
+    }
 }
 
 struct MaskLuminanceToAlpha {
@@ -674,8 +713,13 @@ struct MaskLuminanceToAlpha {
 unsigned
 DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at)
 {
+    Debug::TraceScope trace("DrawingItem::render", Debug::Event::RENDERING);
+
     bool outline = _drawing.outline();
     bool render_filters = _drawing.renderFilters();
+    // Several threads may render the same tree at once, see Canvas::paint_rect_threaded().
+    // They share the item caches, which are then only used with Drawing::_cache_mutex held.
+    bool readonly = flags & RENDER_READONLY;
     // stop_at is handled in DrawingGroup, but this check is required to handle the case
     // where a filtered item with background-accessing filter has enable-background: new
     if (this == stop_at) {
@@ -717,8 +761,10 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
             iarea = carea;
             _filter->area_enlarge(*iarea, this);
             iarea.intersectWith(_drawbox);
-            setCached(false, true);
-        } else {
+            if (!readonly) {
+                setCached(false, true);
+            }
+        } else if (!readonly) {
             setCached(true, true);
         }
     }
@@ -734,7 +780,13 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
 
     // Render from cache if possible
     // Bypass in case of pattern, see below.
+    bool to_cache = false;
     if (_cached && !(flags & RENDER_BYPASS_CACHE)) {
+        std::unique_lock<std::mutex> lock(_drawing._cache_mutex, std::defer_lock);
+        if (readonly) {
+            lock.lock();
+        }
+
         if (_cache && _cache->device_scale() != device_scale) {
             delete _cache;
             _cache = nullptr;
@@ -756,11 +808,30 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
                 _cache = new DrawingCache(*iarea, device_scale);
             }
         }
+        to_cache = _cache != nullptr;
     } else {
         // if our caching was turned off after the last update, it was already
         // deleted in setCached()
     }
 
+    // Filtered items may have been rendered before, maybe in an earlier session.
+    DrawingDiskCache *disk_cache = nullptr;
+    if (render_filters && !(flags & RENDER_FILTER_BACKGROUND)) {
+        disk_cache = _disk_cache;
+    }
+    if (disk_cache) {
+        DrawingSurface stored(*carea, device_scale);
+        bool loaded;
+        {
+            DrawingContext sct(stored);
+            loaded = disk_cache->load(_disk_cache_key, _disk_cache_origin, device_scale, *carea, sct);
+        }
+        if (loaded) {
+            _paintRendering(dc, stored, *carea, *carea, readonly);
+            return RENDER_OK;
+        }
+    }
+
     // determine whether this shape needs intermediate rendering.
     bool needs_intermediate_rendering = false;
     bool &nir = needs_intermediate_rendering;
@@ -774,11 +845,13 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
     nir |= (_mix_blend_mode != SP_CSS_BLEND_NORMAL); // 5. it has blend mode           
     nir |= (_isolation == SP_CSS_ISOLATION_ISOLATE); // 6. it is isolated    
     nir |= !parent();                                // 7. is root, need isolation from background
-    if (_prev_nir && !needs_intermediate_rendering) {
-        setCached(false, true);
+    if (!readonly) {
+        if (_prev_nir && !needs_intermediate_rendering) {
+            setCached(false, true);
+        }
+        _prev_nir = needs_intermediate_rendering;
     }
-    _prev_nir = needs_intermediate_rendering;
-    nir |= (_cache != nullptr);                      // 5. it is to be cached
+    nir |= to_cache;                                 // 5. it is to be cached
 
     /* How the rendering is done.
      *
@@ -827,7 +900,6 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
     ict.paint();
     if (_clip) {
         ict.pushGroup();
-        _clip->setAntialiasing(_antialias); // propagate antialias setting
         _clip->clip(ict, *carea);
         ict.popGroupToSource();
         ict.setOperator(CAIRO_OPERATOR_IN);
@@ -838,7 +910,6 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
     // 2. Render the mask if present and compose it with the clipping path + opacity.
     if (_mask) {
         ict.pushGroup();
-        _mask->setAntialiasing(_antialias); // propagate antialias setting
         _mask->render(ict, *carea, flags);
 
         cairo_surface_t *mask_s = ict.rawTarget();
@@ -883,23 +954,47 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
     ict.setOperator(CAIRO_OPERATOR_IN);
     ict.paint();
 
+    // 6. and 7.
+    _paintRendering(dc, intermediate, *iarea, *carea, readonly);
+    if (disk_cache && render_result == RENDER_OK) {
+        // Only store pixels whose whole filter input was rendered, which the in-memory cache
+        // does not require near the edge of the canvas.
+        Geom::OptIntRect needed = carea;
+        _filter->area_enlarge(*needed, this);
+        needed.intersectWith(_drawbox);
+        if (needed && iarea->contains(*needed)) {
+            disk_cache->store(_disk_cache_key, _disk_cache_origin, intermediate, *carea);
+        }
+    }
+
+    return render_result;
+}
+
+/**
+ * Paints the completed rendering of this item onto the base context (and into cache).
+ * @param iarea Area covered by the rendering
+ * @param carea Area to paint
+ */
+void
+DrawingItem::_paintRendering(DrawingContext &dc, DrawingSurface &rendering, Geom::IntRect const &iarea,
+                             Geom::IntRect const &carea, bool readonly)
+{
     // 6. Paint the completed rendering onto the base context (or into cache)
+    std::unique_lock<std::mutex> lock(_drawing._cache_mutex, std::defer_lock);
+    if (readonly && _cached) {
+        lock.lock();
+    }
     if (_cached && _cache) {
         DrawingContext cachect(*_cache);
-        cachect.rectangle(*iarea);
+        cachect.rectangle(iarea);
         cachect.setOperator(CAIRO_OPERATOR_SOURCE);
-        cachect.setSource(&intermediate);
+        cachect.setSource(&rendering);
         cachect.fill();
-        Geom::OptIntRect cl = _cacheRect();
-        if (_filter && render_filters && cl) {
-            _cache->markClean(*cl);
-        } else {
-            _cache->markClean(*iarea);
-        }
+        _cache->markClean(iarea);
     }
 
-    dc.rectangle(*carea);
-    dc.setSource(&intermediate);
+    dc.rectangle(carea);
+    dc.setSource(&rendering);
     // 7. Render blend mode
     dc.setOperator(ink_css_blend_to_cairo_operator(_mix_blend_mode));
     dc.fill();
@@ -908,8 +1003,6 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
 
 
     // the call above is to clear a ref on the intermediate surface held by dc
-
-    return render_result;
 }
 
 void
@@ -1242,6 +1335,24 @@ Geom::OptIntRect DrawingItem::_cacheRect()
     return r;
 }
 
+/**
+ * Recomputes the key of this item's rendering in DrawingDiskCache.
+ * Only filtered items are stored, except those with filters that access the background.
+ */
+void DrawingItem::_updateDiskCacheKey()
+{
+    _disk_cache = DrawingDiskCache::get();
+    if (!_disk_cache || !_filter || !_item || !_drawbox || !_drawing.renderFilters() || _drawing.outline() ||
+        _filter->uses_background())
+    {
+        _disk_cache = nullptr;
+        _disk_cache_key.clear();
+        return;
+    }
+    _disk_cache_key = _disk_cache->key(_item, _ctm, _drawing.blurQuality(), _drawing.filterQuality(), _antialias);
+    _disk_cache_origin = DrawingDiskCache::origin(_ctm);
+}
+
 // apply antialias setting to cairo
 void DrawingItem::_applyAntialias(DrawingContext &dc, unsigned _antialias)
 {
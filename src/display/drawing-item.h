@@ -20,6 +20,7 @@
 #include <boost/intrusive/list.hpp>
 #include <exception>
 #include <list>
+#include <string>
 
 #include "style-enums.h"
 
@@ -35,8 +36,10 @@ namespace Inkscape {
 class Drawing;
 class DrawingCache;
 class DrawingContext;
+class DrawingDiskCache;
 class DrawingItem;
 class DrawingPattern;
+class DrawingSurface;
 
 namespace Filters {
 
@@ -76,7 +79,8 @@ public:
         RENDER_DEFAULT = 0,
         RENDER_CACHE_ONLY = 1,
         RENDER_BYPASS_CACHE = 2,
-        RENDER_FILTER_BACKGROUND = 4
+        RENDER_FILTER_BACKGROUND = 4,
+        RENDER_READONLY = 8 // do not touch item state other than existing caches, for concurrent renders
     };
     enum StateFlags {
         STATE_NONE = 0,
@@ -162,9 +166,13 @@ protected:
     void _renderOutline(DrawingContext &dc, Geom::IntRect const &area, unsigned flags);
     void _markForUpdate(unsigned state, bool propagate);
     void _markForRendering();
+    unsigned _inheritAntialiasing(DrawingItem &child, unsigned reset) const;
     void _invalidateFilterBackground(Geom::IntRect const &area);
     double _cacheScore();
     Geom::OptIntRect _cacheRect();
+    void _updateDiskCacheKey();
+    void _paintRendering(DrawingContext &dc, DrawingSurface &rendering, Geom::IntRect const &iarea,
+                         Geom::IntRect const &carea, bool readonly);
     virtual unsigned _updateItem(Geom::IntRect const &/*area*/, UpdateContext const &/*ctx*/,
                                  unsigned /*flags*/, unsigned /*reset*/) { return 0; }
     virtual unsigned _renderItem(DrawingContext &/*dc*/, Geom::IntRect const &/*area*/, unsigned /*flags*/,
@@ -214,6 +222,9 @@ protected:
     SPItem *_item; ///< Used to associate DrawingItems with SPItems that created them
     DrawingCache *_cache;
     bool _prev_nir;
+    DrawingDiskCache *_disk_cache; ///< Set if the rendering of this item is stored on disk
+    std::string _disk_cache_key;
+    Geom::IntPoint _disk_cache_origin; ///< Origin of the stored areas, see DrawingDiskCache::origin()
 
     CacheList::iterator _cache_iterator;
 
@@ -123,7 +123,7 @@ unsigned DrawingGlyphs::_updateItem(Geom::IntRect const &/*area*/, UpdateContext
 
     Geom::OptRect pb;
     if (_drawable) {
-        Geom::PathVector *glyphv = _font->PathVector(_glyph);
+        auto glyphv = _font->PathVector(_glyph);
         if (glyphv && !glyphv->empty()) {
             pb = bounds_exact_transformed(*glyphv, ctx.ctm);
         }
@@ -603,7 +603,12 @@ unsigned DrawingText::_renderItem(DrawingContext &dc, Geom::IntRect const &/*are
             dc.transform(g->_ctm);
             if (g->_drawable) {
                 if (g->_font->FontHasSVG()) {
-                    Inkscape::Pixbuf* pixbuf = g->_font->PixBuf(g->_glyph);
+                    Inkscape::Pixbuf* pixbuf = nullptr;
+                    {
+                        // SVG glyphs are rasterized on first use.
+                        std::lock_guard<std::recursive_mutex> lock(Drawing::lazyStateMutex());
+                        pixbuf = g->_font->PixBuf(g->_glyph);
+                    }
                     if (pixbuf) {
                         // Geom::OptRect box = bounds_exact(*g->_font->PathVector(g->_glyph));
                         // if (box) {
@@ -36,6 +36,14 @@ Drawing::Drawing(Inkscape::CanvasItemDrawing *canvas_item_drawing)
     , _grayscale_colormatrix(std::vector<gdouble>(grayscale_value_matrix, grayscale_value_matrix + 20))
 {
     // _canvas_item_drawing can be null. Used this way by Eraser tool.
+
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    _blur_quality = prefs->getInt("/options/blurquality/value", 0);
+    _filter_quality = prefs->getInt("/options/filterquality/value", 0);
+    _blur_quality_observer = prefs->createObserver("/options/blurquality/value",
+        [=](Preferences::Entry const &entry) { setBlurQuality(entry.getInt(0)); });
+    _filter_quality_observer = prefs->createObserver("/options/filterquality/value",
+        [=](Preferences::Entry const &entry) { setFilterQuality(entry.getInt(0)); });
 }
 
 Drawing::~Drawing()
@@ -174,14 +182,10 @@ Drawing::update(Geom::IntRect const &area, unsigned flags, unsigned reset)
 }
 
 void
-Drawing::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags, int antialiasing)
+Drawing::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags)
 {
     if (_root) {
-        int prev_a = _root->_antialias;
-        if(antialiasing >= 0)
-            _root->setAntialiasing(antialiasing);
         _root->render(dc, area, flags);
-        _root->setAntialiasing(prev_a);
     }
 
     if (colorMode() == ColorMode::GRAYSCALE) {
@@ -250,6 +254,14 @@ Drawing::average_color(Geom::IntRect const &area, double &R, double &G, double &
     ink_cairo_surface_average_color_premul(surface->cobj(), R, G, B, A);
 }
 
+std::recursive_mutex &
+Drawing::lazyStateMutex()
+{
+    // Recursive, since pattern tiles are rendered while it is held.
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
 
 } // end namespace Inkscape
 
@@ -16,11 +16,13 @@
 #include <2geom/rect.h>
 #include <boost/operators.hpp>
 #include <boost/utility.hpp>
+#include <mutex>
 #include <set>
 #include <sigc++/sigc++.h>
 
 #include "display/drawing-item.h"
 #include "display/rendermode.h"
+#include "preferences.h"
 #include "nr-filter-gaussian.h" // BLUR_QUALITY_BEST
 #include "nr-filter-colormatrix.h"
 
@@ -77,11 +79,16 @@ public:
     void update(Geom::IntRect const &area = Geom::IntRect::infinite(), unsigned flags = DrawingItem::STATE_ALL,
                 unsigned reset = 0);
 
-    void render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags = 0, int antialiasing = -1);
+    void render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags = 0);
     DrawingItem *pick(Geom::Point const &p, double delta, unsigned flags);
 
     void average_color(Geom::IntRect const &area, double &R, double &G, double &B, double &A);
 
+    /// Held while rendering sets up state lazily, e.g. fill and stroke patterns, SVG glyph pixbufs
+    /// or feImage items.
+    /// Such state is shared between threads rendering with DrawingItem::RENDER_READONLY.
+    static std::recursive_mutex &lazyStateMutex();
+
     sigc::signal<void, DrawingItem *> signal_request_update;
     sigc::signal<void, Geom::IntRect const &> signal_request_render;
     sigc::signal<void, DrawingItem *> signal_item_deleted;
@@ -94,6 +101,7 @@ private:
     DrawingItem *_root = nullptr;
     std::set<DrawingItem *> _cached_items; // modified by DrawingItem::setCached()
     CandidateList _candidate_items;        // keep this list always sorted with std::greater
+    std::mutex _cache_mutex; // held by renders with DrawingItem::RENDER_READONLY while using item caches
 
 public:
     // TODO: remove these temporarily public members
@@ -115,6 +123,10 @@ private:
     Filters::FilterColorMatrix::ColorMatrixMatrix _grayscale_colormatrix;
     Inkscape::CanvasItemDrawing *_canvas_item_drawing = nullptr;
 
+    // Keep the quality settings up to date here rather than reading them while rendering.
+    PrefObserver _blur_quality_observer;
+    PrefObserver _filter_quality_observer;
+
     friend class DrawingItem;
 };
 
@@ -13,6 +13,7 @@
 
 #include <cmath>
 #include <algorithm>
+#include "display/cairo-simd.h"
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-colormatrix.h"
@@ -46,6 +47,10 @@ FilterColorMatrix::ColorMatrixMatrix::ColorMatrixMatrix(std::vector<double> cons
     }
 }
 
+int FilterColorMatrix::ColorMatrixMatrix::filterSpan(guint32 const *in, guint32 *out, int n) {
+    return Inkscape::Display::simd_color_matrix(in, out, n, _v);
+}
+
 guint32 FilterColorMatrix::ColorMatrixMatrix::operator()(guint32 in) {
     EXTRACT_ARGB32(in, a, r, g, b)
     // we need to un-premultiply alpha values for this type of matrix
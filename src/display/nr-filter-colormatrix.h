@@ -52,6 +52,7 @@ public:
 public:
     struct ColorMatrixMatrix {
         ColorMatrixMatrix(std::vector<double> const &values);
+        int filterSpan(guint32 const *in, guint32 *out, int n);
         guint32 operator()(guint32 in);
     private:
         gint32 _v[20];
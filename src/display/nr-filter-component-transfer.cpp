@@ -12,6 +12,7 @@
  */
 
 #include <cmath>
+#include "display/cairo-simd.h"
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-component-transfer.h"
@@ -30,31 +31,35 @@ FilterPrimitive * FilterComponentTransfer::create() {
 FilterComponentTransfer::~FilterComponentTransfer()
 = default;
 
-struct UnmultiplyAlpha {
-    guint32 operator()(guint32 in) {
-        EXTRACT_ARGB32(in, a, r, g, b);
-        if (a == 0 )
-            return in;
-        r = unpremul_alpha(r, a);
-        g = unpremul_alpha(g, a);
-        b = unpremul_alpha(b, a);
-        ASSEMBLE_ARGB32(out, a, r, g, b);
-        return out;
-    }
-};
+int FilterComponentTransfer::UnmultiplyAlpha::filterSpan(guint32 const *in, guint32 *out, int n) {
+    return Inkscape::Display::simd_unpremultiply(in, out, n);
+}
 
-struct MultiplyAlpha {
-    guint32 operator()(guint32 in) {
-        EXTRACT_ARGB32(in, a, r, g, b);
-        if (a == 0 )
-            return in;
-        r = premul_alpha(r, a);
-        g = premul_alpha(g, a);
-        b = premul_alpha(b, a);
-        ASSEMBLE_ARGB32(out, a, r, g, b);
-        return out;
-    }
-};
+guint32 FilterComponentTransfer::UnmultiplyAlpha::operator()(guint32 in) {
+    EXTRACT_ARGB32(in, a, r, g, b);
+    if (a == 0 )
+        return in;
+    r = unpremul_alpha(r, a);
+    g = unpremul_alpha(g, a);
+    b = unpremul_alpha(b, a);
+    ASSEMBLE_ARGB32(out, a, r, g, b);
+    return out;
+}
+
+int FilterComponentTransfer::MultiplyAlpha::filterSpan(guint32 const *in, guint32 *out, int n) {
+    return Inkscape::Display::simd_premultiply(in, out, n);
+}
+
+guint32 FilterComponentTransfer::MultiplyAlpha::operator()(guint32 in) {
+    EXTRACT_ARGB32(in, a, r, g, b);
+    if (a == 0 )
+        return in;
+    r = premul_alpha(r, a);
+    g = premul_alpha(g, a);
+    b = premul_alpha(b, a);
+    ASSEMBLE_ARGB32(out, a, r, g, b);
+    return out;
+}
 
 struct ComponentTransfer {
     ComponentTransfer(guint32 color)
@@ -49,6 +49,16 @@ public:
     double offset[4];
 
     Glib::ustring name() override { return Glib::ustring("Component Transfer"); }
+
+    struct UnmultiplyAlpha {
+        int filterSpan(guint32 const *in, guint32 *out, int n);
+        guint32 operator()(guint32 in);
+    };
+
+    struct MultiplyAlpha {
+        int filterSpan(guint32 const *in, guint32 *out, int n);
+        guint32 operator()(guint32 in);
+    };
 };
 
 } /* namespace Filters */
@@ -33,12 +33,21 @@ public:
 
     void set_input(int input) override;
     void set_input(int input, int slot) override;
+    void get_inputs(std::vector<int> &inputs) const override { inputs.push_back(_input); inputs.push_back(_input2); }
 
     void set_operator(FeCompositeOperator op);
     void set_arithmetic(double k1, double k2, double k3, double k4);
 
     Glib::ustring name() override { return Glib::ustring("Composite"); }
 
+    struct ComposeArithmetic {
+        ComposeArithmetic(double k1, double k2, double k3, double k4);
+        int blendSpan(guint32 const *in1, guint32 const *in2, guint32 *out, int n);
+        guint32 operator()(guint32 in1, guint32 in2);
+    private:
+        gint32 _k1, _k2, _k3, _k4;
+    };
+
 private:
     FeCompositeOperator op;
     double k1, k2, k3, k4;
@@ -33,6 +33,7 @@ public:
 
     void set_input(int slot) override;
     void set_input(int input, int slot) override;
+    void get_inputs(std::vector<int> &inputs) const override { inputs.push_back(_input); inputs.push_back(_input2); }
     virtual void set_scale(double s);
     virtual void set_channel_selector(int s, FilterDisplacementMapChannelSelector channel);
 
@@ -31,6 +31,7 @@ public:
     bool can_handle_affine(Geom::Affine const &) override;
     double complexity(Geom::Affine const &ctm) override;
     bool uses_background() override { return false; }
+    void get_inputs(std::vector<int> &) const override {}
     
     virtual void set_opacity(double o);
     virtual void set_color(guint32 c);
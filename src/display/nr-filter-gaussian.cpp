@@ -272,8 +272,8 @@ static void calcTriggsSdikaM(double const b[N], double M[N*N]) {
     for(unsigned int i=0; i<9; i++) M[i] *= Mscale;
 }
 
-template<unsigned int SIZE>
-static void calcTriggsSdikaInitialization(double const M[N*N], IIRValue const uold[N][SIZE], IIRValue const uplus[SIZE], IIRValue const vplus[SIZE], IIRValue const alpha, IIRValue vold[N][SIZE]) {
+template<unsigned int SIZE, typename T>
+static void calcTriggsSdikaInitialization(double const M[N*N], T const uold[N][SIZE], T const uplus[SIZE], T const vplus[SIZE], double const alpha, T vold[N][SIZE]) {
     for(unsigned int c=0; c<SIZE; c++) {
         double uminp[N];
         for(unsigned int i=0; i<N; i++) uminp[i] = uold[i][c] - uplus[c];
@@ -291,16 +291,30 @@ static void calcTriggsSdikaInitialization(double const M[N*N], IIRValue const uo
     }
 }
 
-// Filters over 1st dimension
-template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA>
-static void
-filter2D_IIR(PT *const dest, int const dstr1, int const dstr2,
-             PT const *const src, int const sstr1, int const sstr2,
-             int const n1, int const n2, IIRValue const b[N+1], double const M[N*N],
-             IIRValue *const tmpdata[], int const num_threads)
+// Number of values filtered together by filter2D_IIR: the channels of 16 ARGB32
+// or 64 A8 pixels taken from adjacent lines. In the vertical pass these pixels are adjacent in
+// memory and fill one cache line, so the surface is traversed row by row instead of one column
+// at a time. In both passes the inner loops run over all values of a block at once, which lets
+// the compiler use SIMD instructions for the recursion.
+static int const BLOCK_VALUES = 64;
+
+// Largest deviation for which the IIR filter state is kept in single precision. The filter gain
+// for rounding errors grows quickly with the deviation, so larger blurs run in double precision.
+static double const IIR_FLOAT_MAX_DEVIATION = 32;
+
+// Reads pixel c1 of each line in a block into buf (lines*PC values).
+template<typename PT, unsigned int PC, typename FT>
+static inline void load_block(FT *const buf, PT const *const src, int const sstr2, int const lines)
 {
-    assert(src && dest);
+    for (int l = 0; l < lines; l++) {
+        for (unsigned int c = 0; c < PC; c++) buf[l*PC+c] = src[l*sstr2+c];
+    }
+}
 
+// Writes pixel c1 of each line in a block, clamping colors to alpha if premultiplied.
+template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA, typename FT>
+static inline void store_block(PT *const dst, int const dstr2, FT const *const buf, int const lines)
+{
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
     static unsigned int const alpha_PC = PC-1;
     #define PREMUL_ALPHA_LOOP for(unsigned int c=0; c<PC-1; ++c)
@@ -309,61 +323,93 @@ filter2D_IIR(PT *const dest, int const dstr1, int const dstr2,
     #define PREMUL_ALPHA_LOOP for(unsigned int c=1; c<PC; ++c)
 #endif
 
+    for (int l = 0; l < lines; l++) {
+        PT *const px = dst + l*dstr2;
+        FT const *const v = buf + l*PC;
+        if ( PREMULTIPLIED_ALPHA ) {
+            px[alpha_PC] = clip_round_cast<PT>(v[alpha_PC]);
+            PREMUL_ALPHA_LOOP px[c] = clip_round_cast_varmax<PT>(v[c], px[alpha_PC]);
+        } else {
+            for(unsigned int c=0; c<PC; c++) px[c] = clip_round_cast<PT>(v[c]);
+        }
+    }
+
+#undef PREMUL_ALPHA_LOOP
+}
+
+// Filters over 1st dimension
+// FT is the type of the filter state: float is precise enough for small deviations, large
+// deviations need double (see IIR_FLOAT_MAX_DEVIATION).
+// Each thread needs (n1+2*N)*BLOCK_VALUES values of temporary storage.
+template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA, typename FT>
+static void
+filter2D_IIR(PT *const dest, int const dstr1, int const dstr2,
+             PT const *const src, int const sstr1, int const sstr2,
+             int const n1, int const n2, IIRValue const b[N+1], double const M[N*N],
+             void *const tmpdata[], int const num_threads)
+{
+    assert(src && dest);
+
+    static int const LINES = BLOCK_VALUES / PC;
+    static int const V = LINES * PC;
+    int const blocks = (n2 + LINES - 1) / LINES;
+
+    FT bf[N+1];
+    for(unsigned int i=0; i<N+1; i++) bf[i] = b[i];
+
 INK_UNUSED(num_threads); // to suppress unused argument compiler warning
 #if HAVE_OPENMP
 #pragma omp parallel for num_threads(num_threads)
 #endif // HAVE_OPENMP
-    for ( int c2 = 0 ; c2 < n2 ; c2++ ) {
+    for ( int blk = 0 ; blk < blocks ; blk++ ) {
 #if HAVE_OPENMP
         unsigned int tid = omp_get_thread_num();
 #else
         unsigned int tid = 0;
 #endif // HAVE_OPENMP
-        // corresponding line in the source and output buffer
+        int const c2 = blk * LINES;
+        int const lines = std::min(LINES, n2 - c2);
+        // corresponding lines in the source and output buffer
         PT const * srcimg = src  + c2*sstr2;
-        PT       * dstimg = dest + c2*dstr2 + n1*dstr1;
-        // Border constants
-        IIRValue imin[PC];  copy_n(srcimg + (0)*sstr1, PC, imin);
-        IIRValue iplus[PC]; copy_n(srcimg + (n1-1)*sstr1, PC, iplus);
-        // Forward pass
-        IIRValue u[N+1][PC];
-        for(unsigned int i=0; i<N; i++) copy_n(imin, PC, u[i]);
+        PT       * dstimg = dest + c2*dstr2;
+
+        // Filter state for every position of the block: N rows of left border,
+        // then the n1 filtered rows, then N-1 rows of right border.
+        FT *const tmp = static_cast<FT *>(tmpdata[tid]);
+        FT *const u = tmp + N*V;
+        FT in[V];
+        if (lines < LINES) {
+            // unused lanes of the last block are filtered as zeros
+            std::fill_n(in, V, FT(0));
+        }
+
+        // Forward pass; the left border repeats the first pixel
+        load_block<PT,PC>(in, srcimg, sstr2, lines);
+        for(unsigned int i=1; i<=N; i++) std::copy_n(in, V, u - i*V);
         for ( int c1 = 0 ; c1 < n1 ; c1++ ) {
-            for(unsigned int i=N; i>0; i--) copy_n(u[i-1], PC, u[i]);
-            copy_n(srcimg, PC, u[0]);
-            srcimg += sstr1;
-            for(unsigned int c=0; c<PC; c++) u[0][c] *= b[0];
-            for(unsigned int i=1; i<N+1; i++) {
-                for(unsigned int c=0; c<PC; c++) u[0][c] += u[i][c]*b[i];
+            load_block<PT,PC>(in, srcimg + c1*sstr1, sstr2, lines);
+            FT *const u0 = u + c1*V;
+            for ( int k = 0 ; k < V ; k++ ) {
+                u0[k] = bf[0]*in[k] + bf[1]*u0[k-V] + bf[2]*u0[k-2*V] + bf[3]*u0[k-3*V];
             }
-            copy_n(u[0], PC, tmpdata[tid]+c1*PC);
         }
-        // Backward pass
-        IIRValue v[N+1][PC];
-        calcTriggsSdikaInitialization<PC>(M, u, iplus, iplus, b[0], v);
-        dstimg -= dstr1;
-        if ( PREMULTIPLIED_ALPHA ) {
-            dstimg[alpha_PC] = clip_round_cast<PT>(v[0][alpha_PC]);
-            PREMUL_ALPHA_LOOP dstimg[c] = clip_round_cast_varmax<PT>(v[0][c], dstimg[alpha_PC]);
-        } else {
-            for(unsigned int c=0; c<PC; c++) dstimg[c] = clip_round_cast<PT>(v[0][c]);
-        }
-        int c1=n1-1;
-        while(c1-->0) {
-            for(unsigned int i=N; i>0; i--) copy_n(v[i-1], PC, v[i]);
-            copy_n(tmpdata[tid]+c1*PC, PC, v[0]);
-            for(unsigned int c=0; c<PC; c++) v[0][c] *= b[0];
-            for(unsigned int i=1; i<N+1; i++) {
-                for(unsigned int c=0; c<PC; c++) v[0][c] += v[i][c]*b[i];
-            }
-            dstimg -= dstr1;
-            if ( PREMULTIPLIED_ALPHA ) {
-                dstimg[alpha_PC] = clip_round_cast<PT>(v[0][alpha_PC]);
-                PREMUL_ALPHA_LOOP dstimg[c] = clip_round_cast_varmax<PT>(v[0][c], dstimg[alpha_PC]);
-            } else {
-                for(unsigned int c=0; c<PC; c++) dstimg[c] = clip_round_cast<PT>(v[0][c]);
+
+        // Backward pass; in still holds the last pixel (iplus)
+        FT uold[N][V];
+        FT vold[N][V];
+        for(unsigned int i=0; i<N; i++) std::copy_n(u + (n1-1-i)*V, V, uold[i]);
+        calcTriggsSdikaInitialization<V>(M, uold, in, in, b[0], vold);
+        for(unsigned int i=0; i<N; i++) std::copy_n(vold[i], V, u + (n1-1+i)*V);
+        for ( int c1 = n1-2 ; c1 >= 0 ; c1-- ) {
+            FT *const v0 = u + c1*V;
+            for ( int k = 0 ; k < V ; k++ ) {
+                v0[k] = bf[0]*v0[k] + bf[1]*v0[k+V] + bf[2]*v0[k+2*V] + bf[3]*v0[k+3*V];
             }
         }
+
+        for ( int c1 = 0 ; c1 < n1 ; c1++ ) {
+            store_block<PT,PC,PREMULTIPLIED_ALPHA>(dstimg + c1*dstr1, dstr2, u + c1*V, lines);
+        }
     }
 }
 
@@ -477,7 +523,7 @@ INK_UNUSED(num_threads); // suppresses unused argument compiler warning
 
 static void
 gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_surface_t *dest,
-    IIRValue **tmpdata, int num_threads)
+    void **tmpdata, int num_threads)
 {
     // Filter variables
     IIRValue b[N+1];  // scaling coefficient + filter coefficients (can be 10.21 fixed point)
@@ -501,16 +547,18 @@ gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_su
     int h = cairo_image_surface_get_height(src);
     if (d != Geom::X) std::swap(w, h);
 
+    bool use_float = deviation <= IIR_FLOAT_MAX_DEVIATION;
+
     // Filter
     switch (cairo_image_surface_get_format(src)) {
     case CAIRO_FORMAT_A8:        ///< Grayscale
-        filter2D_IIR<unsigned char,1,false>(
+        (use_float ? filter2D_IIR<unsigned char,1,false,float> : filter2D_IIR<unsigned char,1,false,double>)(
             cairo_image_surface_get_data(dest), d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
             cairo_image_surface_get_data(src),  d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
             w, h, b, M, tmpdata, num_threads);
         break;
     case CAIRO_FORMAT_ARGB32: ///< Premultiplied 8 bit RGBA
-        filter2D_IIR<unsigned char,4,true>(
+        (use_float ? filter2D_IIR<unsigned char,4,true,float> : filter2D_IIR<unsigned char,4,true,double>)(
             cairo_image_surface_get_data(dest), d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
             cairo_image_surface_get_data(src),  d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
             w, h, b, M, tmpdata, num_threads);
@@ -598,16 +646,6 @@ void FilterGaussian::render_cairo(FilterSlot &slot)
     deviation_x_orig *= device_scale;
     deviation_y_orig *= device_scale;
 
-    cairo_format_t fmt = cairo_image_surface_get_format(in);
-    int bytes_per_pixel = 0;
-    switch (fmt) {
-        case CAIRO_FORMAT_A8:
-            bytes_per_pixel = 1; break;
-        case CAIRO_FORMAT_ARGB32:
-        default:
-            bytes_per_pixel = 4; break;
-    }
-
 #if HAVE_OPENMP
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     int threads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
@@ -638,11 +676,12 @@ void FilterGaussian::render_cairo(FilterSlot &slot)
 
     // Temporary storage for IIR filter
     // NOTE: This can be eliminated, but it reduces the precision a bit
-    IIRValue * tmpdata[threads];
-    std::fill_n(tmpdata, threads, (IIRValue*)0);
+    void * tmpdata[threads];
+    std::fill_n(tmpdata, threads, nullptr);
     if ( use_IIR_x || use_IIR_y ) {
+        size_t size = (std::max(w_downsampled,h_downsampled) + 2*N) * BLOCK_VALUES * sizeof(double);
         for(int i = 0; i < threads; ++i) {
-            tmpdata[i] = new IIRValue[std::max(w_downsampled,h_downsampled)*bytes_per_pixel];
+            tmpdata[i] = g_malloc(size);
         }
     }
 
@@ -681,7 +720,7 @@ void FilterGaussian::render_cairo(FilterSlot &slot)
     // free the temporary data
     if ( use_IIR_x || use_IIR_y ) {
         for(int i = 0; i < threads; ++i) {
-            delete[] tmpdata[i];
+            g_free(tmpdata[i]);
         }
     }
 
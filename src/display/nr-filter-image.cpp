@@ -52,6 +52,9 @@ void FilterImage::render_cairo(FilterSlot &slot)
     if (!feImageHref)
         return;
 
+    // Showing the referenced element and loading the image modify the document and this primitive.
+    std::lock_guard<std::recursive_mutex> lock(Inkscape::Drawing::lazyStateMutex());
+
     //cairo_surface_t *input = slot.getcairo(_input);
 
     // Viewport is filter primitive area (in user coordinates).
@@ -32,6 +32,7 @@ public:
 
     void set_input(int input) override;
     void set_input(int input, int slot) override;
+    void get_inputs(std::vector<int> &inputs) const override { inputs.insert(inputs.end(), _input_image.begin(), _input_image.end()); }
 
     Glib::ustring name() override { return Glib::ustring("Merge"); }
 
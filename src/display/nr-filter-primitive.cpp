@@ -11,6 +11,8 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <functional>
+
 #include "display/nr-filter-primitive.h"
 #include "display/nr-filter-slot.h"
 #include "display/nr-filter-types.h"
@@ -48,6 +50,7 @@ FilterPrimitive::FilterPrimitive()
     _subregion_height.unset(SVGLength::PERCENT, 1, 0);
 
     _style = nullptr;
+    _cache_hash = 0;
 }
 
 FilterPrimitive::~FilterPrimitive()
@@ -80,6 +83,12 @@ void FilterPrimitive::set_output(int slot) {
     if (slot >= 0) _output = slot;
 }
 
+void FilterPrimitive::set_cache_key(std::string const &key)
+{
+    _cache_key = key;
+    _cache_hash = std::hash<std::string>()(key);
+}
+
 // We need to copy reference even if unset as we need to know if
 // someone has unset a value.
 void FilterPrimitive::set_x(SVGLength const &length)
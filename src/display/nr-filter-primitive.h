@@ -12,6 +12,9 @@
 #ifndef SEEN_NR_FILTER_PRIMITIVE_H
 #define SEEN_NR_FILTER_PRIMITIVE_H
 
+#include <cstdint>
+#include <string>
+#include <vector>
 #include <2geom/forward.h>
 #include <2geom/rect.h>
 
@@ -69,6 +72,22 @@ public:
      */
     virtual void set_output(int slot);
 
+    /**
+     * Appends the slots read by render_cairo() to inputs. Primitives which only
+     * use their input for the size of the output, like feFlood, append nothing.
+     */
+    virtual void get_inputs(std::vector<int> &inputs) const { inputs.push_back(_input); }
+
+    /**
+     * Sets a description of everything, apart from the inputs, that the output
+     * of this primitive depends on. Results of primitives with the same
+     * description and the same inputs are reused. Passing an empty string
+     * disables the reuse.
+     */
+    void set_cache_key(std::string const &key);
+    std::string const &get_cache_key() const { return _cache_key; }
+    std::uint64_t get_cache_hash() const { return _cache_hash; }
+
     // returns cache score factor, reflecting the cost of rendering this filter
     // this should return how many times slower this primitive is that normal rendering
     virtual double complexity(Geom::Affine const &/*ctm*/) { return 1.0; }
@@ -138,6 +157,10 @@ protected:
     SVGLength _subregion_height;
 
     SPStyle *_style;
+
+private:
+    std::string _cache_key;
+    std::uint64_t _cache_hash;
 };
 
 
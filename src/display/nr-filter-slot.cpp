@@ -220,6 +220,7 @@ void FilterSlot::_set_internal(int slot_nr, cairo_surface_t *surface)
     }
 
     _slots[slot_nr] = surface;
+    _hashes.erase(slot_nr);
 }
 
 void FilterSlot::set(int slot_nr, cairo_surface_t *surface)
@@ -286,6 +287,61 @@ Geom::Rect FilterSlot::get_slot_area() const {
     return r;
 }
 
+std::uint64_t FilterSlot::get_hash(int slot_nr)
+{
+    if (slot_nr == NR_FILTER_SLOT_NOT_SET)
+        slot_nr = _last_out;
+
+    auto h = _hashes.find(slot_nr);
+    if (h != _hashes.end()) {
+        return h->second;
+    }
+
+    cairo_surface_t *surface = getcairo(slot_nr);
+    cairo_surface_flush(surface);
+    int width = cairo_image_surface_get_width(surface);
+    int height = cairo_image_surface_get_height(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    int rowbytes = cairo_image_surface_get_format(surface) == CAIRO_FORMAT_A8 ? width : width * 4;
+    unsigned char const *data = cairo_image_surface_get_data(surface);
+
+    std::uint64_t hash = filter_hash(0, cairo_image_surface_get_format(surface));
+    hash = filter_hash(hash, width);
+    hash = filter_hash(hash, height);
+    hash = filter_hash(hash, get_cairo_surface_ci(surface));
+    for (int y = 0; y < height; ++y) {
+        unsigned char const *row = data + y * stride;
+        int x = 0;
+        for (; x + 8 <= rowbytes; x += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, row + x, sizeof(word));
+            hash = filter_hash(hash, word);
+        }
+        for (; x < rowbytes; ++x) {
+            hash = filter_hash(hash, row[x]);
+        }
+    }
+
+    _hashes[slot_nr] = hash;
+    return hash;
+}
+
+void FilterSlot::set_hash(int slot_nr, std::uint64_t hash)
+{
+    if (slot_nr == NR_FILTER_SLOT_NOT_SET)
+        slot_nr = _last_out;
+
+    _hashes[slot_nr] = hash;
+}
+
+void FilterSlot::forget_hash(int slot_nr)
+{
+    if (slot_nr == NR_FILTER_SLOT_NOT_SET)
+        slot_nr = _last_out;
+
+    _hashes.erase(slot_nr);
+}
+
 } /* namespace Filters */
 } /* namespace Inkscape */
 
@@ -15,6 +15,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cstdint>
 #include <map>
 #include "display/nr-filter-types.h"
 #include "display/nr-filter-units.h"
@@ -82,6 +83,20 @@ public:
     FilterUnits const &get_units() const { return _units; }
     Geom::Rect get_slot_area() const;
 
+    /** Returns the slot written last, which is used for unset inputs. */
+    int get_last_out() const { return _last_out; }
+
+    /** Returns a hash of the contents of the given slot. Unless the hash was set
+     * with set_hash(), it is computed from the pixels. */
+    std::uint64_t get_hash(int slot);
+
+    /** Sets the hash of the contents of a slot, when it is known without looking
+     * at the pixels. It is reset when the slot is set again. */
+    void set_hash(int slot, std::uint64_t hash);
+
+    /** Forgets the hash of a slot, because its contents might have been modified. */
+    void forget_hash(int slot);
+
 private:
     typedef std::map<int, cairo_surface_t *> SlotMap;
     SlotMap _slots;
@@ -90,6 +105,9 @@ private:
     typedef std::map<int, Geom::Rect> PrimitiveAreaMap;
     PrimitiveAreaMap _primitiveAreas;
 
+    // Known content hashes, for caching primitive results
+    std::map<int, std::uint64_t> _hashes;
+
     DrawingItem *_item;
 
     //Geom::Rect _source_bbox; ///< bounding box of source graphic surface
@@ -115,6 +133,13 @@ private:
     void _set_internal(int slot, cairo_surface_t *s);
 };
 
+/** Mixes value into a hash used for caching filter results. */
+inline std::uint64_t filter_hash(std::uint64_t seed, std::uint64_t value)
+{
+    seed = (seed ^ value) * 0x100000001b3ULL;
+    return seed ^ (seed >> 29);
+}
+
 } /* namespace Filters */
 } /* namespace Inkscape */
 
@@ -20,6 +20,7 @@
 
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
+#include "display/drawing.h"
 #include "display/nr-filter.h"
 #include "display/nr-filter-turbulence.h"
 #include "display/nr-filter-units.h"
@@ -397,12 +398,15 @@ void FilterTurbulence::render_cairo(FilterSlot &slot)
         set_cairo_surface_ci(out, (SPColorInterpolation)_style->color_interpolation_filters.computed );
     }
 
-    if (!gen->ready()) {
-        Geom::Point ta(fTileX, fTileY);
-        Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
-        gen->init(seed, Geom::Rect(ta, tb),
-            Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
-            type == TURBULENCE_FRACTALNOISE, numOctaves);
+    {
+        std::lock_guard<std::recursive_mutex> lock(Inkscape::Drawing::lazyStateMutex());
+        if (!gen->ready()) {
+            Geom::Point ta(fTileX, fTileY);
+            Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
+            gen->init(seed, Geom::Rect(ta, tb),
+                Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
+                type == TURBULENCE_FRACTALNOISE, numOctaves);
+        }
     }
 
     Geom::Affine unit_trans = slot.get_units().get_matrix_primitiveunits2pb().inverse();
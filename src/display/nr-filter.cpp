@@ -13,7 +13,12 @@
 #include <glib.h>
 #include <cmath>
 #include <cstring>
+#include <iterator>
+#include <list>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <cairo.h>
 
 #include "display/nr-filter.h"
@@ -47,6 +52,7 @@
 #include <2geom/affine.h>
 #include <2geom/rect.h>
 #include "svg/svg-length.h"
+#include "debug/trace.h"
 //#include "sp-filter-units.h"
 #include "preferences.h"
 
@@ -56,6 +62,269 @@ namespace Filters {
 using Geom::X;
 using Geom::Y;
 
+namespace {
+
+/// Primitives cheaper than this are always rendered, see FilterPrimitive::complexity().
+double const CACHE_MIN_COMPLEXITY = 3.0;
+
+std::uint64_t hash_double(std::uint64_t seed, double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return filter_hash(seed, bits);
+}
+
+/**
+ * Returns whether b has the same format and color interpolation as a, and the same pixels as
+ * the part of a whose top left pixel is (x, y).
+ */
+bool same_pixels(cairo_surface_t *a, cairo_surface_t *b, int x, int y)
+{
+    cairo_surface_flush(a);
+    cairo_surface_flush(b);
+    int width = cairo_image_surface_get_width(b);
+    int height = cairo_image_surface_get_height(b);
+    if (cairo_image_surface_get_format(a) != cairo_image_surface_get_format(b) ||
+        get_cairo_surface_ci(a) != get_cairo_surface_ci(b) || x < 0 || y < 0 ||
+        x + width > cairo_image_surface_get_width(a) || y + height > cairo_image_surface_get_height(a)) {
+        return false;
+    }
+    int bpp = cairo_image_surface_get_format(a) == CAIRO_FORMAT_A8 ? 1 : 4;
+    int stride_a = cairo_image_surface_get_stride(a);
+    int stride_b = cairo_image_surface_get_stride(b);
+    unsigned char const *data_a = cairo_image_surface_get_data(a) + y * stride_a + x * bpp;
+    unsigned char const *data_b = cairo_image_surface_get_data(b);
+    for (int row = 0; row < height; ++row) {
+        if (std::memcmp(data_a + row * stride_a, data_b + row * stride_b, width * bpp) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Finds the pixel (x, y) of a surface covering stored where a surface covering area starts.
+ * Returns false unless area lies within stored and starts on a whole pixel of it.
+ */
+bool pixel_offset(Geom::Rect const &stored, Geom::Rect const &area, int device_scale, int &x, int &y)
+{
+    if (!stored.contains(area)) {
+        return false;
+    }
+    Geom::Point offset = (area.min() - stored.min()) * device_scale;
+    x = std::round(offset[X]);
+    y = std::round(offset[Y]);
+    return Geom::are_near(offset, Geom::Point(x, y), 1e-6);
+}
+
+/**
+ * Everything the result of a filter primitive depends on. The hash only finds the
+ * entry; a result is reused only if the rest of the key is equal as well.
+ */
+struct FilterResultKey
+{
+    std::uint64_t hash = 0;
+    std::string primitive;       ///< Description of the primitive, see FilterPrimitive::set_cache_key()
+    std::vector<double> values;  ///< Geometry and quality of the rendering, slots and areas of the inputs
+    std::vector<int> inputs;     ///< Slots whose contents are compared with the kept copies
+
+    void add(double value)
+    {
+        values.push_back(value);
+        hash = hash_double(hash, value);
+    }
+
+    void add(Geom::OptRect const &rect)
+    {
+        add(rect ? 1.0 : 0.0);
+        if (rect) {
+            for (auto coord : {rect->left(), rect->top(), rect->right(), rect->bottom()}) {
+                add(coord);
+            }
+        }
+    }
+
+    void add(Geom::Affine const &affine)
+    {
+        for (int i = 0; i < 6; ++i) {
+            add(affine[i]);
+        }
+    }
+};
+
+/**
+ * Results of expensive filter primitives, kept between renderings.
+ *
+ * An entry is addressed by its owner and a FilterResultKey, which holds everything
+ * the result depends on: the parameters of the primitive, copies of its inputs and
+ * the geometry and quality of the rendering. The key does not contain the rendered
+ * area, so that an entry rendered for a larger area, e.g. before the canvas was
+ * scrolled, serves every part of it. Entries are never invalidated; they are removed
+ * when their owner is destroyed or when the cache grows over its size limit, least
+ * recently used first. All methods may be called from several threads at once.
+ */
+class FilterResultCache
+{
+public:
+    /// Returns the cache, or null if it is disabled in the preferences.
+    static FilterResultCache *get()
+    {
+        FilterResultCache &cache = instance();
+        return cache._limit ? &cache : nullptr;
+    }
+
+    static FilterResultCache &instance()
+    {
+        static FilterResultCache cache;
+        return cache;
+    }
+
+    /// Puts a copy of the cached result into the slot and returns true, if there is one.
+    bool load(Filter const *owner, FilterResultKey const &key, FilterSlot &slot)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _entries.find(key.hash);
+        if (found == _entries.end()) {
+            return false;
+        }
+        Entry const &entry = *found->second;
+        if (entry.owner != owner || entry.key.primitive != key.primitive || entry.key.values != key.values) {
+            return false;
+        }
+        Geom::Rect slot_area = slot.get_slot_area();
+        int x, y;
+        if (!pixel_offset(entry.slot_area, slot_area, slot.get_device_scale(), x, y)) {
+            return false;
+        }
+        for (size_t i = 0; i < key.inputs.size(); ++i) {
+            if (!same_pixels(entry.inputs[i], slot.getcairo(key.inputs[i]), x, y)) {
+                return false;
+            }
+        }
+        _lru.splice(_lru.begin(), _lru, found->second);
+
+        // Copy the part within the slot area. The copy is needed anyway, since downstream
+        // primitives may modify their inputs, e.g. to change color interpolation.
+        cairo_surface_t *copy = cairo_surface_create_similar(entry.surface, cairo_surface_get_content(entry.surface),
+                                                             slot_area.width(), slot_area.height());
+        cairo_t *ct = cairo_create(copy);
+        Geom::Point origin = entry.slot_area.min() - slot_area.min();
+        cairo_set_source_surface(ct, entry.surface, origin[X], origin[Y]);
+        cairo_set_operator(ct, CAIRO_OPERATOR_SOURCE);
+        cairo_paint(ct);
+        cairo_destroy(ct);
+        copy_cairo_surface_ci(entry.surface, copy);
+        slot.set(entry.slot, copy);
+        slot.set_hash(entry.slot, key.hash);
+        Geom::Rect area = entry.area;
+        slot.set_primitive_area(entry.slot, area);
+        cairo_surface_destroy(copy);
+        return true;
+    }
+
+    /// Copies the inputs of a primitive before it is rendered, which may modify them.
+    std::vector<cairo_surface_t *> copy_inputs(FilterResultKey const &key, FilterSlot &slot)
+    {
+        std::vector<cairo_surface_t *> copies;
+        for (auto input : key.inputs) {
+            cairo_surface_t *surface = slot.getcairo(input);
+            cairo_surface_t *copy = ink_cairo_surface_copy(surface);
+            copy_cairo_surface_ci(surface, copy);
+            copies.push_back(copy);
+        }
+        return copies;
+    }
+
+    /// Keeps the result of a primitive, taking ownership of the copies of its inputs.
+    void store(Filter const *owner, FilterResultKey const &key, std::vector<cairo_surface_t *> inputs,
+               FilterSlot &slot, int slot_nr)
+    {
+        cairo_surface_t *result = slot.getcairo(slot_nr);
+        slot.set_hash(slot_nr, key.hash);
+        size_t bytes = surface_bytes(result);
+        for (auto input : inputs) {
+            bytes += surface_bytes(input);
+        }
+        if (bytes > _limit / 4) {
+            for (auto input : inputs) {
+                cairo_surface_destroy(input);
+            }
+            return;
+        }
+        cairo_surface_t *copy = ink_cairo_surface_copy(result);
+        copy_cairo_surface_ci(result, copy);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _entries.find(key.hash);
+        if (found != _entries.end()) {
+            _remove(found->second);
+        }
+        _lru.push_front(Entry{owner, key, copy, std::move(inputs), slot_nr, slot.get_primitive_area(slot_nr),
+                              slot.get_slot_area(), bytes});
+        _entries[key.hash] = _lru.begin();
+        _size += bytes;
+        while (_size > _limit) {
+            _remove(std::prev(_lru.end()));
+        }
+    }
+
+    /// Removes the results of a filter which is destroyed.
+    void forget(Filter const *owner)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto it = _lru.begin(); it != _lru.end();) {
+            auto next = std::next(it);
+            if (it->owner == owner) {
+                _remove(it);
+            }
+            it = next;
+        }
+    }
+
+private:
+    struct Entry {
+        Filter const *owner;
+        FilterResultKey key;
+        cairo_surface_t *surface;
+        std::vector<cairo_surface_t *> inputs;
+        int slot;
+        Geom::Rect area;
+        Geom::Rect slot_area; ///< Area of the surfaces in the coordinates of the filter slot
+        size_t bytes;
+    };
+    typedef std::list<Entry> EntryList;
+
+    FilterResultCache()
+        : _size(0)
+        , _limit(Inkscape::Preferences::get()->getIntLimited("/options/renderingcache/filterresults", 0, 0, 4096) *
+                 size_t(1024 * 1024))
+    {}
+
+    static size_t surface_bytes(cairo_surface_t *surface)
+    {
+        return cairo_image_surface_get_stride(surface) * size_t(cairo_image_surface_get_height(surface));
+    }
+
+    void _remove(EntryList::iterator it)
+    {
+        _size -= it->bytes;
+        cairo_surface_destroy(it->surface);
+        for (auto input : it->inputs) {
+            cairo_surface_destroy(input);
+        }
+        _entries.erase(it->key.hash);
+        _lru.erase(it);
+    }
+
+    std::mutex _mutex;
+    EntryList _lru; ///< Most recently used first
+    std::unordered_map<std::uint64_t, EntryList::iterator> _entries;
+    size_t _size;
+    size_t const _limit; ///< Bytes the entries may use; read once, since the cache is shared by all drawings
+};
+
+} // namespace
+
 Filter::Filter()
 {
     _common_init();
@@ -92,11 +361,14 @@ void Filter::_common_init() {
 Filter::~Filter()
 {
     clear_primitives();
+    FilterResultCache::instance().forget(this);
 }
 
 
 int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, DrawingContext *bgdc)
 {
+    Inkscape::Debug::TraceScope trace("Filter::render", Inkscape::Debug::Event::RENDERING);
+
     // std::cout << "Filter::render() for: " << const_cast<Inkscape::DrawingItem *>(item)->name() << std::endl;
     // std::cout << "  graphic drawing_scale: " << graphic.surface()->device_scale() << std::endl;
 
@@ -108,9 +380,6 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
         graphic.setOperator(CAIRO_OPERATOR_OVER);
         return 1;
     }
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    item->drawing().setFilterQuality(prefs->getInt("/options/filterquality/value", 0));
-    item->drawing().setBlurQuality(prefs->getInt("/options/blurquality/value", 0));
     FilterQuality const filterquality = (FilterQuality)item->drawing().filterQuality();
     int const blurquality = item->drawing().blurQuality();
 
@@ -157,8 +426,63 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
     slot.set_blurquality(blurquality);
     slot.set_device_scale(graphic.surface()->device_scale());
 
+    FilterResultCache *cache = FilterResultCache::get();
+    FilterResultKey geometry;
+    if (cache) {
+        // everything except the primitives themselves that determines their results,
+        // see FilterResultCache::load() for the rendered area
+        geometry.add(units.get_matrix_display2pb());
+        geometry.add(units.get_matrix_user2pb());
+        geometry.add(units.get_item_bbox());
+        geometry.add(units.get_filter_area());
+        geometry.add(_filter_units);
+        geometry.add(_primitive_units);
+        geometry.add(filterquality);
+        geometry.add(blurquality);
+        geometry.add(graphic.surface()->device_scale());
+    }
+
+    std::vector<int> inputs;
     for (auto & i : _primitive) {
+        inputs.clear();
+        i->get_inputs(inputs);
+        for (auto &input : inputs) {
+            if (input == NR_FILTER_SLOT_NOT_SET) {
+                input = slot.get_last_out();
+            }
+        }
+
+        bool cached = cache && !i->get_cache_key().empty() && i->complexity(trans) >= CACHE_MIN_COMPLEXITY;
+        FilterResultKey key;
+        std::vector<cairo_surface_t *> input_copies;
+        if (cached) {
+            // unset inputs refer to the previous result, so its slot matters too
+            key = geometry;
+            key.primitive = i->get_cache_key();
+            key.hash = filter_hash(key.hash, i->get_cache_hash());
+            key.add(i->filter_primitive_area(units));
+            key.add(slot.get_last_out());
+            for (auto input : inputs) {
+                key.add(input);
+                key.add(slot.get_primitive_area(input));
+                key.hash = filter_hash(key.hash, slot.get_hash(input));
+                key.inputs.push_back(input);
+            }
+            if (cache->load(this, key, slot)) {
+                continue;
+            }
+            input_copies = cache->copy_inputs(key, slot);
+        }
+
         i->render_cairo(slot);
+
+        // primitives may convert their inputs to another color space in place
+        for (auto input : inputs) {
+            slot.forget_hash(input);
+        }
+        if (cached) {
+            cache->store(this, key, std::move(input_copies), slot, slot.get_last_out());
+        }
     }
 
     Geom::Point origin = graphic.targetLogicalBounds().min();
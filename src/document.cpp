@@ -37,6 +37,8 @@
 #define noSP_DOCUMENT_DEBUG_IDLE
 #define noSP_DOCUMENT_DEBUG_UNDO
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -58,6 +60,8 @@
 #include "actions/actions-undo-document.h"
 #include "actions/actions-pages.h"
 
+#include "debug/trace.h"
+
 #include "display/drawing.h"
 
 #include "3rdparty/adaptagrams/libavoid/router.h"
@@ -70,6 +74,7 @@
 #include "layer-manager.h"
 #include "page-manager.h"
 #include "live_effects/lpeobject.h"
+#include "object/item-index.h"
 #include "object/persp3d.h"
 #include "object/sp-defs.h"
 #include "object/sp-factory.h"
@@ -121,7 +126,7 @@ SPDocument::SPDocument() :
     current_persp3d(nullptr),
     current_persp3d_impl(nullptr),
     _parent_document(nullptr),
-    _node_cache_valid(false),
+    _item_index(new Inkscape::ItemIndex()),
     _activexmltree(nullptr)
 {
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
@@ -149,7 +154,6 @@ SPDocument::SPDocument() :
 
     // XXX only for testing!
     undoStackObservers.add(console_output_undo_observer);
-    _node_cache = std::deque<SPItem*>();
 
     // Actions
     action_group = Gio::SimpleActionGroup::create();
@@ -1336,6 +1340,8 @@ SPDocument::_updateDocument(int update_flags)
  */
 gint SPDocument::ensureUpToDate()
 {
+    Inkscape::Debug::TraceScope trace("SPDocument::ensureUpToDate", Inkscape::Debug::Event::DOCUMENT);
+
     // Bring the document up-to-date, specifically via the following:
     //   1a) Process all document updates.
     //   1b) When completed, process connector routing changes.
@@ -1413,44 +1419,95 @@ static bool overlaps(Geom::Rect const &area, Geom::Rect const &box)
 }
 
 /**
- * @param area Area in document coordinates
+ * Returns the positions of object and its ancestors among their siblings, from the
+ * root down.
  */
-static std::vector<SPItem*> &find_items_in_area(std::vector<SPItem*> &s,
-                                                SPGroup *group, unsigned int dkey,
-                                                Geom::Rect const &area,
-                                                bool (*test)(Geom::Rect const &, Geom::Rect const &),
-                                                bool take_hidden = false,
-                                                bool take_insensitive = false,
-                                                bool take_groups = true,
-                                                bool enter_groups = false)
+static std::vector<unsigned> document_position(SPObject const *object)
 {
-    g_return_val_if_fail(SP_IS_GROUP(group), s);
+    std::vector<unsigned> position;
+    for (; object->parent; object = object->parent) {
+        position.push_back(object->getRepr()->position());
+    }
+    std::reverse(position.begin(), position.end());
+    return position;
+}
 
-    for (auto& o: group->children) {
-        if (SPItem *item = dynamic_cast<SPItem *>(&o)) {
-            if (!take_insensitive && item->isLocked()) {
-                continue;
-            }
+/**
+ * Sorts items in document order, except that groups come after their descendants,
+ * like a depth first search which appends groups after visiting their children.
+ */
+static void sort_in_document_order(std::vector<SPItem*> &items)
+{
+    std::vector<std::pair<std::vector<unsigned>, SPItem*>> keyed;
+    keyed.reserve(items.size());
+    for (auto item : items) {
+        keyed.emplace_back(document_position(item), item);
+    }
+    std::sort(keyed.begin(), keyed.end(), [](auto const &a, auto const &b) {
+        auto diff = std::mismatch(a.first.begin(), a.first.end(), b.first.begin(), b.first.end());
+        if (diff.first == a.first.end() || diff.second == b.first.end()) {
+            return a.first.size() > b.first.size();
+        }
+        return *diff.first < *diff.second;
+    });
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i] = keyed[i].second;
+    }
+}
 
-            if (!take_hidden && item->isHidden()) {
-                continue;
-            }
+/**
+ * Returns whether item is found when descending from the root into layers and, if
+ * enter_groups is set, into other groups. Hidden and locked items are skipped together
+ * with their descendants, unless take_hidden or take_insensitive is set.
+ */
+static bool is_found_in_area(SPItem *item, unsigned int dkey,
+                             bool take_hidden, bool take_insensitive, bool take_groups, bool enter_groups)
+{
+    if (!take_insensitive && item->isLocked()) {
+        return false;
+    }
+    if (SPGroup *group = dynamic_cast<SPGroup *>(item)) {
+        if (!take_groups || group->effectiveLayerMode(dkey) == SPGroup::LAYER) {
+            return false;
+        }
+    }
+    for (SPObject *o = item; o->parent; o = o->parent) {
+        if (!take_hidden && static_cast<SPItem *>(o)->isHidden()) {
+            return false;
+        }
+        SPGroup *parent = dynamic_cast<SPGroup *>(o->parent);
+        if (!parent) {
+            return false;
+        }
+        if (parent->parent && !enter_groups && parent->effectiveLayerMode(dkey) != SPGroup::LAYER) {
+            return false;
+        }
+    }
+    return true;
+}
 
-            if (SPGroup * childgroup = dynamic_cast<SPGroup *>(item)) {
-                bool is_layer = childgroup->effectiveLayerMode(dkey) == SPGroup::LAYER;
-                if (is_layer || (enter_groups)) {
-                    s = find_items_in_area(s, childgroup, dkey, area, test, take_hidden, take_insensitive, take_groups, enter_groups);
-                }
-                if (!take_groups || is_layer) {
-                    continue;
-                }
-            }
-            Geom::OptRect box = item->documentVisualBounds();
-            if (box && test(area, *box)) {
-                s.push_back(item);
-            }
+/**
+ * @param area Area in document coordinates
+ */
+static std::vector<SPItem*> find_items_in_area(Inkscape::ItemIndex &index, unsigned int dkey,
+                                               Geom::Rect const &area,
+                                               bool (*test)(Geom::Rect const &, Geom::Rect const &),
+                                               bool take_hidden = false,
+                                               bool take_insensitive = false,
+                                               bool take_groups = true,
+                                               bool enter_groups = false)
+{
+    std::vector<SPItem*> s;
+    for (auto item : index.query(area)) {
+        if (!is_found_in_area(item, dkey, take_hidden, take_insensitive, take_groups, enter_groups)) {
+            continue;
+        }
+        Geom::OptRect box = item->documentVisualBounds();
+        if (box && test(area, *box)) {
+            s.push_back(item);
         }
     }
+    sort_in_document_order(s);
     return s;
 }
 
@@ -1491,53 +1548,77 @@ SPItem *SPDocument::getItemFromListAtPointBottom(unsigned int dkey, SPGroup *gro
 }
 
 /**
-Turn the SVG DOM into a flat list of nodes that can be searched from top-down.
-The list can be persisted, which improves "find at multiple points" speed.
-*/
-// TODO: study add `gboolean with_groups = false` as parameter.
-void SPDocument::build_flat_item_list(unsigned int dkey, SPGroup *group, gboolean into_groups) const
+Returns whether item can be picked: whether it is visible and unlocked, and found when
+descending from the root into layers and, if into_groups is set, into other groups.
+ */
+static bool is_pickable(SPItem *item, unsigned int dkey, bool into_groups)
 {
-    for (auto& o: group->children) {
-        if (!SP_IS_ITEM(&o)) {
-            continue;
+    if (SPGroup *group = dynamic_cast<SPGroup *>(item)) {
+        if (into_groups || group->effectiveLayerMode(dkey) == SPGroup::LAYER) {
+            return false;
         }
-
-        if (SP_IS_GROUP(&o) && (SP_GROUP(&o)->effectiveLayerMode(dkey) == SPGroup::LAYER || into_groups)) {
-            build_flat_item_list(dkey, SP_GROUP(&o), into_groups);
-        } else {
-            SPItem *child = SP_ITEM(&o);
-            if (child->isVisibleAndUnlocked(dkey)) {
-                _node_cache.push_front(child);
-            }
+    }
+    for (SPObject *o = item; o->parent; o = o->parent) {
+        SPGroup *parent = dynamic_cast<SPGroup *>(o->parent);
+        if (!parent) {
+            return false;
+        }
+        if (parent->parent && !into_groups && parent->effectiveLayerMode(dkey) != SPGroup::LAYER) {
+            return false;
         }
     }
+    return item->isVisibleAndUnlocked(dkey);
 }
 
 /**
-Returns the items from the descendants of group (recursively) which are at the
-point p, or NULL if none. Honors into_groups on whether to recurse into non-layer
-groups or not. Honors take_insensitive on whether to return insensitive items.
-If upto != NULL, then if item upto is encountered (at any level), stops searching
-upwards in z-order and returns what it has found so far (i.e. the found items are
-guaranteed to be lower than upto). Requires a list of nodes built by build_flat_item_list.
+Returns the pickable items (see is_pickable) which are at the point p, topmost first.
+The point is in drawing coordinates of the display key.
+If upto != NULL, then only items below upto in z-order are returned; if upto itself
+cannot be picked, nothing is returned.
 If items_count > 0, it'll return the topmost (in z-order) items_count items.
  */
-static std::vector<SPItem*> find_items_at_point(std::deque<SPItem*> *nodes, unsigned int dkey,
-                                                 Geom::Point const &p, int items_count=0, SPItem* upto=nullptr)
+static std::vector<SPItem*> find_items_at_point(Inkscape::ItemIndex &index, SPRoot *root, unsigned int dkey,
+                                                Geom::Point const &p, bool into_groups,
+                                                int items_count=0, SPItem* upto=nullptr)
 {
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     gdouble delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
 
-    SPItem *child;
     std::vector<SPItem*> result;
-    bool seen_upto = (!upto);
-    for (auto node : *nodes) {
-        child = node;
-        if (!seen_upto){
-            if(child == upto)
-                seen_upto = true;
-            continue;
+    Inkscape::DrawingItem *root_item = root->get_arenaitem(dkey);
+    if (!root_item || (upto && !is_pickable(upto, dkey, into_groups))) {
+        return result;
+    }
+
+    // Look for candidates in document coordinates, leaving room for the pick tolerance
+    // and for the rounding of drawing boxes.
+    root_item->drawing().update();
+    Geom::Affine doc2drawing = root_item->ctm();
+    if (!doc2drawing.isInvertible()) {
+        return result;
+    }
+    Geom::Affine drawing2doc = doc2drawing.inverse();
+    double slack = delta + 2;
+    Geom::Point radius(slack * std::hypot(drawing2doc[0], drawing2doc[2]),
+                       slack * std::hypot(drawing2doc[1], drawing2doc[3]));
+    Geom::Point center = p * drawing2doc;
+
+    std::vector<SPItem*> candidates;
+    for (auto item : index.query(Geom::Rect(center - radius, center + radius))) {
+        if (item != upto && is_pickable(item, dkey, into_groups)) {
+            candidates.push_back(item);
         }
+    }
+    if (upto) {
+        candidates.push_back(upto);
+    }
+    sort_in_document_order(candidates);
+    std::reverse(candidates.begin(), candidates.end());
+    if (upto) {
+        candidates.erase(candidates.begin(), std::find(candidates.begin(), candidates.end(), upto) + 1);
+    }
+
+    for (auto child : candidates) {
         Inkscape::DrawingItem *arenaitem = child->get_arenaitem(dkey);
         if (arenaitem) {
             arenaitem->drawing().update();
@@ -1553,15 +1634,6 @@ static std::vector<SPItem*> find_items_at_point(std::deque<SPItem*> *nodes, unsi
     return result;
 }
 
-static SPItem *find_item_at_point(std::deque<SPItem*> *nodes, unsigned int dkey, Geom::Point const &p, SPItem* upto=nullptr)
-{
-    auto items = find_items_at_point(nodes, dkey, p, 1, upto);
-    if (items.empty()) {
-        return nullptr;
-    }
-    return items.back();
-}
-
 /**
 Returns the topmost non-layer group from the descendants of group which is at point
 p, or NULL if none. Recurses into layers but not into groups.
@@ -1607,8 +1679,7 @@ static SPItem *find_group_at_point(unsigned int dkey, SPGroup *group, Geom::Poin
 
 std::vector<SPItem*> SPDocument::getItemsInBox(unsigned int dkey, Geom::Rect const &box, bool take_hidden, bool take_insensitive, bool take_groups, bool enter_groups) const
 {
-    std::vector<SPItem*> x;
-    return find_items_in_area(x, this->root, dkey, box, is_within, take_hidden, take_insensitive, take_groups, enter_groups);
+    return find_items_in_area(*_item_index, dkey, box, is_within, take_hidden, take_insensitive, take_groups, enter_groups);
 }
 
 /**
@@ -1624,8 +1695,7 @@ std::vector<SPItem*> SPDocument::getItemsInBox(unsigned int dkey, Geom::Rect con
 
 std::vector<SPItem*> SPDocument::getItemsPartiallyInBox(unsigned int dkey, Geom::Rect const &box, bool take_hidden, bool take_insensitive, bool take_groups, bool enter_groups) const
 {
-    std::vector<SPItem*> x;
-    return find_items_in_area(x, this->root, dkey, box, overlaps, take_hidden, take_insensitive, take_groups, enter_groups);
+    return find_items_in_area(*_item_index, dkey, box, overlaps, take_hidden, take_insensitive, take_groups, enter_groups);
 }
 
 std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vector<Geom::Point> points, bool all_layers, bool topmost_only, size_t limit) const
@@ -1639,12 +1709,6 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
     gdouble saved_delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
     prefs->setDouble("/options/cursortolerance/value", 0.25);
 
-    // Cache a flattened SVG DOM to speed up selection.
-    if(!_node_cache_valid){
-        _node_cache.clear();
-        build_flat_item_list(key, this->root, true);
-        _node_cache_valid=true;
-    }
     SPObject *current_layer = nullptr;
     SPDesktop *desktop = SP_ACTIVE_DESKTOP;
     if(desktop){
@@ -1652,7 +1716,7 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
     }
     size_t item_counter = 0;
     for(int i = points.size()-1;i>=0; i--) {
-        std::vector<SPItem*> items = find_items_at_point(&_node_cache, key, points[i], topmost_only);
+        std::vector<SPItem*> items = find_items_at_point(*_item_index, root, key, points[i], true, topmost_only);
         for (SPItem *item : items) {
             if (item && result.end()==find(result.begin(), result.end(), item))
                 if(all_layers || (desktop && desktop->layerManager().layerForObject(item) == current_layer)){
@@ -1676,22 +1740,11 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
 SPItem *SPDocument::getItemAtPoint( unsigned const key, Geom::Point const &p,
                                     bool const into_groups, SPItem *upto) const
 {
-    // Build a flattened SVG DOM for find_item_at_point.
-    std::deque<SPItem*> bak(_node_cache);
-    if(!into_groups){
-        _node_cache.clear();
-        build_flat_item_list(key, this->root, into_groups);
-    }
-    if(!_node_cache_valid && into_groups){
-        _node_cache.clear();
-        build_flat_item_list(key, this->root, true);
-        _node_cache_valid=true;
+    auto items = find_items_at_point(*_item_index, root, key, p, into_groups, 1, upto);
+    if (items.empty()) {
+        return nullptr;
     }
-
-    SPItem *res = find_item_at_point(&_node_cache, key, p, upto);
-    if(!into_groups)
-        _node_cache = bak;
-    return res;
+    return items.back();
 }
 
 SPItem *SPDocument::getGroupAtPoint(unsigned int key, Geom::Point const &p) const
@@ -2124,7 +2177,6 @@ void SPDocument::_emitModified() {
     static guint const flags = SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG | SP_OBJECT_PARENT_MODIFIED_FLAG;
     root->emitModified(0);
     modified_signal.emit(flags);
-    _node_cache_valid=false;
 }
 
 void
@@ -76,6 +76,7 @@ class SPRoot;
 class SPNamedView;
 
 namespace Inkscape {
+    class ItemIndex;
     class Selection; 
     class UndoStackObserver;
     class EventLog;
@@ -145,6 +146,7 @@ public:
     bool isModifiedSinceAutoSave() const { return modified_since_autosave; }
     void setModifiedSinceSave(bool const modified = true);
     void setModifiedSinceAutoSaveFalse() { modified_since_autosave = false; };
+    void setModifiedSinceAutoSave() { modified_since_autosave = true; };
 
     bool idle_handler();
     bool rerouting_handler();
@@ -261,7 +263,7 @@ private:
 
 
     // Find items by geometry --------------------
-    void build_flat_item_list(unsigned int dkey, SPGroup *group, gboolean into_groups) const;
+    Inkscape::ItemIndex &getItemIndex() const { return *_item_index; }
 
     std::vector<SPItem*> getItemsInBox         (unsigned int dkey, Geom::Rect const &box, bool take_hidden = false, bool take_insensitive = false, bool take_groups = true, bool enter_groups = false) const;
     std::vector<SPItem*> getItemsPartiallyInBox(unsigned int dkey, Geom::Rect const &box, bool take_hidden = false, bool take_insensitive = false, bool take_groups = true, bool enter_groups = false) const;
@@ -352,8 +354,7 @@ private:
     std::map<Inkscape::XML::Node *, SPObject *> reprdef;
 
     // Find items by geometry --------------------
-    mutable std::deque<SPItem*> _node_cache; // Used to speed up search.
-    mutable bool _node_cache_valid;
+    std::unique_ptr<Inkscape::ItemIndex> _item_index;
 
     // Box tool ----------------------------
     Persp3D *current_persp3d; /**< Currently 'active' perspective (to which, e.g., newly created boxes are attached) */
@@ -24,6 +24,10 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
 #include "odf.h"
 
 //# System includes
@@ -70,7 +74,12 @@
 #include "io/stream/stringstream.h"
 #include "io/sys.h"
 #include <util/ziptool.h>
+#include "preferences.h"
 #include <iomanip>
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 namespace Inkscape
 {
 namespace Extension
@@ -2046,6 +2055,10 @@ void OdfOutput::save(Inkscape::Extension::Output */*mod*/, SPDocument *doc, gcha
     docBaseUri = Inkscape::URI::from_dirname(doc->getDocumentBase()).str();
 
     ZipFile zf;
+#ifdef HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    zf.setThreads(prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256));
+#endif
     preprocess(zf, doc->getReprRoot());
 
     if (!writeManifest(zf))
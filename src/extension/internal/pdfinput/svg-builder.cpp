@@ -120,10 +120,8 @@ void SvgBuilder::_init() {
     _height = 0;
 
     // Fill _availableFontNames (Bug LP #179589) (code cfr. FontLister)
-    std::vector<PangoFontFamily *> families;
-    font_factory::Default()->GetUIFamilies(families);
-    for (auto & familie : families) {
-        _availableFontNames.emplace_back(pango_font_family_get_name(familie));
+    for (auto const &family : font_factory::Default()->GetUIFamilyNames()) {
+        _availableFontNames.emplace_back(family.raw());
     }
 
     _transp_group_stack = nullptr;
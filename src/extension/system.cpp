@@ -35,6 +35,7 @@
 #include "inkscape.h"
 #include "document-undo.h"
 #include "loader.h"
+#include "debug/trace.h"
 
 #include <glibmm/miscutils.h>
 
@@ -66,6 +67,8 @@ static void save_internal(Inkscape::Extension::Extension *in_plug, gpointer in_d
  */
 SPDocument *open(Extension *key, gchar const *filename)
 {
+    Inkscape::Debug::TraceScope trace("Extension::open", Inkscape::Debug::Event::EXTENSION);
+
     Input *imod = nullptr;
 
     if (key == nullptr) {
@@ -220,6 +223,8 @@ void
 save(Extension *key, SPDocument *doc, gchar const *filename, bool check_overwrite, bool official,
     Inkscape::Extension::FileSaveMethod save_method)
 {
+    Inkscape::Debug::TraceScope trace("Extension::save", Inkscape::Debug::Event::EXTENSION);
+
     Output *omod;
     if (key == nullptr) {
         gpointer parray[2];
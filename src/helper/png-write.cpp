@@ -15,11 +15,19 @@
  */
 
 
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
 #include <2geom/rect.h>
 #include <2geom/transforms.h>
 
 #include <png.h>
 
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #include "document.h"
 #include "inkscape.h"
 #include "png-write.h"
@@ -58,6 +66,7 @@ struct SPEBP {
     guchar *px;
     unsigned (*status)(float, void *);
     void *data;
+    int threads; // number of strips rendered concurrently, 1 renders on the calling thread only
 };
 
 /* write a png file */
@@ -123,6 +132,77 @@ void PngTextList::add(gchar const* key, gchar const* text)
     }
 }
 
+/**
+ * Hand rows to libpng with a local error handler, so that a libpng error raised
+ * inside a parallel region does not jump out of it.
+ */
+static bool
+sp_png_write_rows_guarded(png_structp png_ptr, png_bytepp rows, png_uint_32 num_rows)
+{
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        return false;
+    }
+    png_write_rows(png_ptr, rows, num_rows);
+    return true;
+}
+
+/**
+ * Render strips of ebp->sheight rows on ebp->threads threads and stream them into libpng
+ * in order. A strip is written as soon as all strips above it have been written, so only
+ * about one strip per thread is held in memory at a time. The status callback is only
+ * called from the calling thread.
+ */
+static bool
+sp_png_write_rows_threaded(png_structp png_ptr, unsigned long int height,
+                           int (* get_rows)(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int antialias),
+                           struct SPEBP *ebp, int color_type, int bit_depth, int antialiasing)
+{
+    int const strips = (height + ebp->sheight - 1) / ebp->sheight;
+    std::atomic<bool> aborted(false);
+    bool ok = true;
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for ordered schedule(dynamic, 1) num_threads(ebp->threads)
+#endif
+    for (int i = 0; i < strips; ++i) {
+        int const row = i * ebp->sheight;
+        std::vector<guchar const *> rows(ebp->sheight);
+        void *to_free = nullptr;
+        int n = 0;
+
+        if (!aborted) {
+            n = get_rows(rows.data(), &to_free, row, height - row, ebp, color_type, bit_depth, antialiasing);
+        }
+
+#ifdef HAVE_OPENMP
+#pragma omp ordered
+#endif
+        {
+            if (n && !aborted) {
+                if (!sp_png_write_rows_guarded(png_ptr, (png_bytepp) rows.data(), n)) {
+                    aborted = true;
+                    ok = false;
+                }
+            }
+#ifdef HAVE_OPENMP
+            bool const main_thread = omp_get_thread_num() == 0;
+#else
+            bool const main_thread = true;
+#endif
+            if (ebp->status && main_thread && !aborted) {
+                if (!ebp->status((float) (row + n) / ebp->height, ebp->data)) {
+                    aborted = true;
+                    ok = false;
+                }
+            }
+        }
+
+        g_free(to_free);
+    }
+
+    return ok;
+}
+
 static bool
 sp_png_write_rgba_striped(SPDocument *doc,
                           gchar const *filename, unsigned long int width, unsigned long int height, double xdpi, double ydpi,
@@ -286,6 +366,12 @@ sp_png_write_rgba_striped(SPDocument *doc,
     int number_of_passes = interlace ? png_set_interlace_handling(png_ptr) : 1;
 
     for(int i=0;i<number_of_passes; ++i){
+        if (ebp->threads > 1) {
+            if (!sp_png_write_rows_threaded(png_ptr, height, get_rows, ebp, color_type, bit_depth, antialiasing)) {
+                break;
+            }
+            continue;
+        }
         r = 0;
         while (r < static_cast<png_uint_32>(height)) {
             void *to_free;
@@ -299,6 +385,13 @@ sp_png_write_rgba_striped(SPDocument *doc,
 
     delete[] row_pointers;
 
+    // sp_png_write_rows_guarded() installs its own error handler, restore ours
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        fclose(fp);
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        return false;
+    }
+
     /* You can write optional chunks like tEXt, zTXt, and tIME at the end
      * as well.
      */
@@ -323,11 +416,14 @@ sp_png_write_rgba_striped(SPDocument *doc,
  *
  */
 static int
-sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int antialiasing)
+sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int /*antialiasing*/)
 {
     struct SPEBP *ebp = (struct SPEBP *) data;
+    // Concurrent strips share one drawing, which has been updated beforehand and must not be
+    // modified while rendering. Progress is reported by sp_png_write_rows_threaded() instead.
+    bool const concurrent = ebp->threads > 1;
 
-    if (ebp->status) {
+    if (ebp->status && !concurrent) {
         if (!ebp->status((float) row / ebp->height, ebp->data)) return 0;
     }
 
@@ -341,7 +437,9 @@ sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, v
     Geom::IntRect bbox = Geom::IntRect::from_xywh(0, row, ebp->width, num_rows);
 
     /* Update to renderable state */
-    ebp->drawing->update(bbox);
+    if (!concurrent) {
+        ebp->drawing->update(bbox);
+    }
 
     int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
     unsigned char *px = g_new(guchar, num_rows * stride);
@@ -355,7 +453,7 @@ sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, v
     dc.setOperator(CAIRO_OPERATOR_OVER);
 
     /* Render */
-    ebp->drawing->render(dc, bbox, 0, antialiasing);
+    ebp->drawing->render(dc, bbox, concurrent ? Inkscape::DrawingItem::RENDER_READONLY : 0);
     cairo_surface_destroy(s);
 
     // PNG stores data as unpremultiplied big-endian RGBA, which means
@@ -399,16 +497,19 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 unsigned long bgcolor,
                                 unsigned int (*status) (float, void *),
                                 void *data, bool force_overwrite,
-                                const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing)
+                                const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing,
+                                int threads)
 {
     return sp_export_png_file(doc, filename, Geom::Rect(Geom::Point(x0,y0),Geom::Point(x1,y1)),
-                              width, height, xdpi, ydpi, bgcolor, status, data, force_overwrite, items_only, interlace, color_type, bit_depth, zlib, antialiasing);
+                              width, height, xdpi, ydpi, bgcolor, status, data, force_overwrite, items_only, interlace, color_type, bit_depth, zlib, antialiasing,
+                              threads);
 }
 
 /**
  * Export an area to a PNG file
  *
  * @param area Area in document coordinates
+ * @param threads Number of strips rendered concurrently, 0 uses all processors
  */
 ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 Geom::Rect const &area,
@@ -416,7 +517,8 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 unsigned long bgcolor,
                                 unsigned (*status)(float, void *),
                                 void *data, bool force_overwrite,
-                                const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing)
+                                const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing,
+                                int threads)
 {
     g_return_val_if_fail(doc != nullptr, EXPORT_ERROR);
     g_return_val_if_fail(filename != nullptr, EXPORT_ERROR);
@@ -467,6 +569,10 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     // Create ArenaItems and set transform
     drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
     drawing.root()->setTransform(affine);
+    // passed on to all items when the drawing is updated
+    if (antialiasing >= 0) {
+        drawing.root()->setAntialiasing(antialiasing);
+    }
     ebp.drawing = &drawing;
 
     // We show all and then hide all items we don't want, instead of showing only requested items,
@@ -481,6 +587,19 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     bool write_status = false;;
 
     ebp.sheight = 64;
+
+#ifdef HAVE_OPENMP
+    ebp.threads = threads > 0 ? threads : omp_get_num_procs();
+#else
+    ebp.threads = 1;
+#endif
+    ebp.threads = std::min<int>(ebp.threads, (height + ebp.sheight - 1) / ebp.sheight);
+    if (ebp.threads > 1) {
+        // Strips are rendered concurrently from a read-only drawing, so bring all of it
+        // up to date here instead of strip by strip in sp_export_get_rows().
+        drawing.update(Geom::IntRect::from_xywh(0, 0, width, height));
+    }
+
     ebp.px = g_try_new(guchar, 4 * ebp.sheight * width);
 
     if (ebp.px) {
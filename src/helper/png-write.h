@@ -32,6 +32,9 @@ enum ExportResult {
 /**
  * Export the given document as a Portable Network Graphics (PNG) file.
  *
+ * Rows are rendered in strips; with threads > 1 (or 0 for all processors) several strips are
+ * rendered concurrently and written to the file in order.
+ *
  * @return EXPORT_OK if succeeded, EXPORT_ABORTED if no action was taken, EXPORT_ERROR (false) if an error occurred.
  */
 ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
@@ -39,13 +42,15 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 				unsigned long int width, unsigned long int height, double xdpi, double ydpi,
 				unsigned long bgcolor,
 				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, const std::vector<SPItem*> &items_only = std::vector<SPItem*>(), 
-                                bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2);
+                                bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2,
+                                int threads = 1);
 
 ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 				Geom::Rect const &area,
 				unsigned long int width, unsigned long int height, double xdpi, double ydpi,
 				unsigned long bgcolor,
 				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, const std::vector<SPItem*> &items_only = std::vector<SPItem*>(), 
-                                bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2);
+                                bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2,
+                                int threads = 1);
 
 #endif // SEEN_SP_PNG_WRITE_H
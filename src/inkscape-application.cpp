@@ -11,9 +11,19 @@
 #include <iostream>
 #include <iomanip>
 #include <cerrno>  // History file
+#include <fstream> // Batch export manifest
 #include <regex>
 #include <numeric>
 
+#ifndef _WIN32
+#include <algorithm> // Batch export workers
+#include <csignal>
+#include <deque>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include <glibmm/i18n.h>  // Internationalization
 
 #ifdef HAVE_CONFIG_H
@@ -37,6 +47,8 @@
 #include "io/resource.h"            // TEMPLATE
 #include "io/fix-broken-links.h"    // Fix up references.
 
+#include "libnrtype/FontFactory.h"  // Warm up fonts for batch export.
+
 #include "object/sp-root.h"         // Inkscape version.
 
 #include "ui/interface.h"                 // sp_ui_error_dialog
@@ -98,6 +110,7 @@ InkscapeApplication::document_add(SPDocument* document)
         auto it = _documents.find(document);
         if (it == _documents.end()) {
             _documents[document] = std::vector<InkscapeWindow*>();
+            Inkscape::AutoSave::getInstance().journal_start(document);
         } else {
             // Should never happen.
             std::cerr << "InkscapeApplication::add_document: Document already opened!" << std::endl;
@@ -300,6 +313,7 @@ InkscapeApplication::document_close(SPDocument* document)
             std::cerr << "InkscapeApplication::close_document: Document not registered with application." << std::endl;
         }
 
+        Inkscape::AutoSave::getInstance().journal_stop(document);
         delete document;
 
     } else {
@@ -679,6 +693,7 @@ InkscapeApplication::InkscapeApplication()
     // FIXME: Opacity should really be a DOUBLE, but an upstream bug means 0.0 is detected as NULL
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "export-background-opacity", 'y', N_("Background opacity for exported bitmaps (0.0 to 1.0, or 1 to 255)"), N_("VALUE")); // Bxx
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "export-png-color-mode", '\0', N_("Color mode (bit depth and color type) for exported bitmaps (Gray_1/Gray_2/Gray_4/Gray_8/Gray_16/RGB_8/RGB_16/GrayAlpha_8/GrayAlpha_16/RGBA_8/RGBA_16)"), N_("COLOR-MODE")); // Bxx
+    gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "export-png-threads",    '\0', N_("Number of threads rendering exported bitmaps (0 for all processors); default is 1"), N_("THREADS")); // Bxx
 
     // Query - Geometry
     _start_main_option_section(_("Query object/document geometry"));
@@ -710,6 +725,8 @@ InkscapeApplication::InkscapeApplication()
     gapp->add_main_option_entry(T::OPTION_TYPE_BOOL,     "batch-process",         '\0', N_("Close GUI after executing all actions/verbs"),"");
     _start_main_option_section();
     gapp->add_main_option_entry(T::OPTION_TYPE_BOOL,     "shell",                 '\0', N_("Start Inkscape in interactive shell mode"),                                 "");
+    gapp->add_main_option_entry(T::OPTION_TYPE_FILENAME, "batch-export",          '\0', N_("Export the documents listed in a manifest, one 'FILE[;ACTION(:ARG)]*' job per line ('-' reads jobs from stdin)"), N_("MANIFEST"));
+    gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "batch-jobs",            '\0', N_("Number of batch export jobs to run at the same time; default is 1"),      N_("JOBS"));
 
 #ifdef WITH_DBUS
     _start_main_option_section(_("D-Bus"));
@@ -992,6 +1009,11 @@ InkscapeApplication::on_activate()
 {
     on_startup2();
 
+    if (!_batch_export.empty()) {
+        batch_export();
+        return;
+    }
+
     std::string output;
 
     // Create new document, either from pipe or from template.
@@ -1296,6 +1318,376 @@ InkscapeApplication::shell()
 }
 
 
+/** Run export jobs read from a manifest file, or from stdin if the manifest is "-".
+ *
+ * Each non-empty line not starting with '#' is one job: an input file followed by
+ * optional actions, e.g. "drawing.svg; export-filename:drawing.png; export-dpi:300".
+ * Export options and actions given on the command line apply to every job.
+ *
+ * Extensions, preferences and fonts are only loaded once. Each job has its own document,
+ * which is closed before the next job starts, and a failing job doesn't stop the batch.
+ * With --batch-jobs, this runs in each worker process, see batch_export_workers().
+ */
+void
+InkscapeApplication::batch_export()
+{
+    std::ifstream manifest_file;
+    std::istream *manifest = &std::cin;
+    if (_batch_export != "-") {
+        manifest_file.open(_batch_export);
+        if (!manifest_file) {
+            std::cerr << "InkscapeApplication::batch_export: Failed to open manifest: " << _batch_export << std::endl;
+            return;
+        }
+        manifest = &manifest_file;
+    }
+
+    // Load the font map up front, not with the first job that has text.
+    font_factory::Default();
+
+    const InkFileExportCmd defaults = _file_export;
+    int jobs = 0;
+    int failed = 0;
+
+    std::string line;
+    while (std::getline(*manifest, line)) {
+        line = std::regex_replace(line, std::regex("^\\s+|\\s+$"), "");
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        ++jobs;
+
+        bool ok = batch_export_job(line, defaults);
+#ifndef _WIN32
+        if (_batch_status_fd >= 0) {
+            // The dispatching process reports failures and counts the jobs.
+            std::cout.flush();
+            std::cerr.flush();
+            char result = ok ? '0' : '1';
+            while (write(_batch_status_fd, &result, 1) < 0 && errno == EINTR) {};
+            continue;
+        }
+#endif
+        if (!ok) {
+            std::cerr << "InkscapeApplication::batch_export: Job failed: " << line << std::endl;
+            ++failed;
+        }
+    }
+
+#ifndef _WIN32
+    if (_batch_status_fd >= 0) {
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(EXIT_SUCCESS); // Don't run exit handlers (e.g. saving preferences) in every worker.
+    }
+#endif
+
+    std::cerr << "Batch export: " << jobs - failed << " of " << jobs << " jobs succeeded." << std::endl;
+}
+
+int InkscapeApplication::_batch_status_fd = -1;
+
+#ifndef _WIN32
+/** Remove an option from the arguments and return its value, or nullptr if it isn't given.
+ */
+static char const *
+take_option(std::vector<char *> &args, char const *name)
+{
+    std::string const option = std::string("--") + name;
+    std::string const prefix = option + "=";
+    for (auto it = args.begin() + 1; it != args.end() && !g_str_equal(*it, "--"); ++it) {
+        if (option == *it && it + 1 != args.end()) {
+            char const *value = *(it + 1);
+            args.erase(it, it + 2);
+            return value;
+        }
+        if (g_str_has_prefix(*it, prefix.c_str())) {
+            char const *value = *it + prefix.size();
+            args.erase(it);
+            return value;
+        }
+    }
+    return nullptr;
+}
+#endif
+
+/** Start --batch-jobs worker processes for --batch-export and hand the jobs out to them.
+ *
+ * This must run before the singleton exists: once GTK is initialized, GApplication has
+ * registered on D-Bus and GLib runs its own threads, none of which survive fork(). Each
+ * worker then starts like a normal instance, loads extensions, preferences and fonts once,
+ * and runs the jobs it reads from its stdin in batch_export(), reporting each result on a
+ * status pipe. Jobs go to the least busy worker, so long jobs don't hold up the rest.
+ *
+ * Returns false in the workers, with argc and argv changed to read jobs from stdin, and
+ * without --batch-jobs or if no worker could be started. Otherwise this is the dispatching
+ * process, which should exit with exit_status. Not available on Windows, where jobs run
+ * one after another.
+ */
+bool
+InkscapeApplication::batch_export_workers(int &argc, char **&argv, int &exit_status)
+{
+#ifdef _WIN32
+    return false;
+#else
+    static std::vector<char *> args;
+    args.assign(argv, argv + argc);
+    char const *manifest_name = take_option(args, "batch-export");
+    char const *jobs_value = take_option(args, "batch-jobs");
+    int const job_count = jobs_value ? g_ascii_strtoll(jobs_value, nullptr, 10) : 1;
+    if (!manifest_name || job_count < 2) {
+        return false;
+    }
+
+    std::ifstream manifest_file;
+    std::istream *manifest = &std::cin;
+    if (!g_str_equal(manifest_name, "-")) {
+        manifest_file.open(manifest_name);
+        if (!manifest_file) {
+            std::cerr << "InkscapeApplication::batch_export: Failed to open manifest: " << manifest_name << std::endl;
+            exit_status = EXIT_FAILURE;
+            return true;
+        }
+        manifest = &manifest_file;
+    }
+
+    struct Worker
+    {
+        pid_t pid;
+        int jobs_fd;   // Writing end of the worker's stdin.
+        int status_fd; // Reading end of the pipe the worker reports finished jobs on.
+        std::deque<std::string> running;
+    };
+    std::vector<Worker> workers;
+
+    args.push_back(const_cast<char *>("--batch-export=-"));
+    args.push_back(nullptr);
+
+    std::cout.flush();
+    std::cerr.flush();
+    for (int i = 0; i < job_count; ++i) {
+        int jobs_pipe[2];
+        int status_pipe[2];
+        if (pipe(jobs_pipe) != 0) {
+            break;
+        }
+        if (pipe(status_pipe) != 0) {
+            close(jobs_pipe[0]);
+            close(jobs_pipe[1]);
+            break;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Workers must not hold on to each other's pipes, or they would never see EOF.
+            for (auto &worker : workers) {
+                close(worker.jobs_fd);
+                close(worker.status_fd);
+            }
+            dup2(jobs_pipe[0], STDIN_FILENO);
+            close(jobs_pipe[0]);
+            close(jobs_pipe[1]);
+            close(status_pipe[0]);
+            _batch_status_fd = status_pipe[1];
+            argc = args.size() - 1;
+            argv = args.data();
+            return false;
+        }
+        close(jobs_pipe[0]);
+        close(status_pipe[1]);
+        if (pid < 0) {
+            close(jobs_pipe[1]);
+            close(status_pipe[0]);
+            break;
+        }
+        workers.push_back({pid, jobs_pipe[1], status_pipe[0], {}});
+    }
+
+    if (workers.empty()) {
+        std::cerr << "InkscapeApplication::batch_export: fork() failed, running jobs in this process." << std::endl;
+        return false;
+    }
+
+    // A worker that is gone must not take the dispatching process with it.
+    signal(SIGPIPE, SIG_IGN);
+
+    int jobs = 0;
+    int failed = 0;
+    auto job_failed = [&](std::string const &job) {
+        std::cerr << "InkscapeApplication::batch_export: Job failed: " << job << std::endl;
+        ++failed;
+    };
+
+    // Wait for reports of finished jobs. Returns false once all workers are gone.
+    auto wait_for_jobs = [&]() {
+        std::vector<pollfd> fds;
+        for (auto &worker : workers) {
+            fds.push_back({worker.status_fd, POLLIN, 0}); // Negative fds are ignored.
+        }
+        if (std::none_of(workers.begin(), workers.end(), [](Worker &w) { return w.status_fd >= 0; })) {
+            return false;
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            return errno == EINTR;
+        }
+        for (std::size_t i = 0; i < workers.size(); ++i) {
+            auto &worker = workers[i];
+            if (!fds[i].revents) {
+                continue;
+            }
+            char results[64];
+            ssize_t count = read(worker.status_fd, results, sizeof(results));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                // The worker has finished, or crashed in which case its unfinished jobs failed.
+                for (auto &job : worker.running) {
+                    job_failed(job);
+                }
+                worker.running.clear();
+                close(worker.status_fd);
+                worker.status_fd = -1;
+                if (worker.jobs_fd >= 0) {
+                    close(worker.jobs_fd);
+                    worker.jobs_fd = -1;
+                }
+                continue;
+            }
+            for (ssize_t j = 0; j < count && !worker.running.empty(); ++j) {
+                if (results[j] != '0') {
+                    job_failed(worker.running.front());
+                }
+                worker.running.pop_front();
+            }
+        }
+        return true;
+    };
+
+    // Queue a second job for each worker, so that it can go on while this process waits.
+    std::size_t const max_running = 2;
+
+    std::string line;
+    while (std::getline(*manifest, line)) {
+        line = std::regex_replace(line, std::regex("^\\s+|\\s+$"), "");
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        ++jobs;
+
+        Worker *idle = nullptr;
+        do {
+            idle = nullptr;
+            for (auto &worker : workers) {
+                if (worker.jobs_fd >= 0 && worker.running.size() < max_running &&
+                    (!idle || worker.running.size() < idle->running.size())) {
+                    idle = &worker;
+                }
+            }
+        } while (!idle && wait_for_jobs());
+        if (!idle) {
+            job_failed(line); // All workers are gone.
+            continue;
+        }
+
+        std::string const message = line + "\n";
+        std::size_t written = 0;
+        while (written < message.size()) {
+            ssize_t count = write(idle->jobs_fd, message.data() + written, message.size() - written);
+            if (count < 0 && errno != EINTR) {
+                break;
+            }
+            written += std::max<ssize_t>(count, 0);
+        }
+        if (written < message.size()) {
+            close(idle->jobs_fd);
+            idle->jobs_fd = -1;
+            job_failed(line);
+            continue;
+        }
+        idle->running.push_back(line);
+    }
+
+    // Let the workers finish their jobs and exit.
+    for (auto &worker : workers) {
+        if (worker.jobs_fd >= 0) {
+            close(worker.jobs_fd);
+            worker.jobs_fd = -1;
+        }
+    }
+    while (wait_for_jobs()) {};
+    for (auto &worker : workers) {
+        waitpid(worker.pid, nullptr, 0);
+    }
+
+    std::cerr << "Batch export: " << jobs - failed << " of " << jobs << " jobs succeeded." << std::endl;
+    exit_status = failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    return true;
+#endif
+}
+
+/** Open, process and export a single batch export job, then close its document.
+ */
+bool
+InkscapeApplication::batch_export_job(const std::string& job, const InkFileExportCmd& defaults)
+{
+    auto pos = job.find(';');
+    std::string filename = std::regex_replace(job.substr(0, pos), std::regex("\\s+$"), "");
+
+    Glib::RefPtr<Gio::File> file = Gio::File::create_for_path(filename);
+    if (!file->query_exists()) {
+        std::cerr << "InkscapeApplication::batch_export_job: File '" << filename << "' does not exist." << std::endl;
+        return false;
+    }
+
+    SPDocument *document = document_open(file);
+    if (!document) {
+        return false;
+    }
+    INKSCAPE.add_document(document);
+
+    Inkscape::ActionContext context = INKSCAPE.action_context_for_document(document);
+    _active_document  = document;
+    _active_selection = context.getSelection();
+    _active_view      = context.getView();
+
+    document->ensureUpToDate(); // Or queries don't work!
+
+    // Every job starts from the command line export options.
+    _file_export = defaults;
+
+    action_vector_t actions = _command_line_actions;
+    if (pos != std::string::npos) {
+        parse_actions(job.substr(pos + 1), actions);
+    }
+    for (auto action : actions) {
+        if (!_gio_application->has_action(action.first)) {
+            std::cerr << "InkscapeApplication::batch_export_job: Unknown action name: " << action.first << std::endl;
+        }
+        _gio_application->activate_action(action.first, action.second);
+    }
+
+    // Actions may have closed the document already (file-close).
+    bool ok = _documents.find(document) != _documents.end();
+    if (ok) {
+        // Export as configured unless an action (export-do) did already.
+        if (_file_export.exports_done == 0) {
+            ok = _file_export.do_export(document, file->get_path());
+        } else {
+            ok = !_file_export.exports_failed;
+        }
+
+        INKSCAPE.remove_document(document);
+        document_close(document);
+    }
+
+    _active_document  = nullptr;
+    _active_selection = nullptr;
+    _active_view      = nullptr;
+
+    return ok;
+}
+
+
 // ========================= Callbacks ==========================
 
 /*
@@ -1382,6 +1774,7 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         options->contains("export-use-hints")      ||
         options->contains("export-background")     ||
         options->contains("export-background-opacity") ||
+        options->contains("export-png-threads")    ||
         options->contains("export-text-to_path")   ||
 
         options->contains("query-id")              ||
@@ -1395,7 +1788,8 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         options->contains("select")                ||
         options->contains("actions")               ||
         options->contains("verb")                  ||
-        options->contains("shell")
+        options->contains("shell")                 ||
+        options->contains("batch-export")
         ) {
         _with_gui = false;
     }
@@ -1410,6 +1804,10 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
     if (options->contains("shell"))          _use_shell = true;
     if (options->contains("pipe"))           _use_pipe  = true;
 
+    if (options->contains("batch-export")) {
+        options->lookup_value("batch-export", _batch_export);
+    }
+
 
     // Enable auto-export
     if (options->contains("export-filename")  ||
@@ -1575,6 +1973,10 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         options->lookup_value("export-png-color-mode", _file_export.export_png_color_mode);
     }
 
+    if (options->contains("export-png-threads")) {
+        options->lookup_value("export-png-threads", _file_export.export_png_threads);
+    }
+
 
     // ==================== D-BUS ======================
 
@@ -46,6 +46,8 @@ public:
     static InkscapeApplication &singleton();
     /// Singleton instance, if it exists (will not create it)
     static InkscapeApplication *instance();
+    /// Runs --batch-export with --batch-jobs worker processes, before the singleton exists
+    static bool batch_export_workers(int &argc, char **&argv, int &exit_status);
 
     /// The Gtk application instance, or NULL if running headless without display
     Gtk::Application *gtk_app() { return dynamic_cast<Gtk::Application *>(_gio_application.get()); }
@@ -135,6 +137,8 @@ protected:
     bool _use_shell   = false;
     bool _use_pipe    = false;
     bool _auto_export = false;
+    std::string _batch_export;    // Manifest of export jobs, "-" for stdin.
+    static int _batch_status_fd;  // Pipe to report finished jobs on in a batch export worker.
     int _pdf_page     = 1;
     int _pdf_poppler  = false;
     bool _use_command_line_argument = false;
@@ -170,6 +174,8 @@ protected:
 
     void on_about();
     void shell();
+    void batch_export();
+    bool batch_export_job(const std::string& job, const InkFileExportCmd& defaults);
 
     void _start_main_option_section(const Glib::ustring& section_name = "");
 };
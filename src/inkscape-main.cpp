@@ -256,6 +256,12 @@ int main(int argc, char *argv[])
     set_themes_env();
     set_extensions_env();
 
+    // Before the application starts any threads, see InkscapeApplication::batch_export_workers().
+    int batch_status = EXIT_SUCCESS;
+    if (InkscapeApplication::batch_export_workers(argc, argv, batch_status)) {
+        return batch_status;
+    }
+
     auto ret = InkscapeApplication::singleton().gio_app()->run(argc, argv);
 
 #ifdef _WIN32
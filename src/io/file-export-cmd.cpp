@@ -47,7 +47,9 @@
 namespace filesystem = boost::filesystem;
 
 InkFileExportCmd::InkFileExportCmd()
-    : export_overwrite(false)
+    : exports_done(0)
+    , exports_failed(false)
+    , export_overwrite(false)
     , export_area_drawing(false)
     , export_area_page(false)
     , export_margin(0)
@@ -63,12 +65,28 @@ InkFileExportCmd::InkFileExportCmd()
     , export_latex(false)
     , export_id_only(false)
     , export_background_opacity(-1) // default is unset != actively set to 0
+    , export_png_threads(1)
     , export_plain_svg(false)
 {
 }
 
-void
+/**
+ * Exports the document to all requested types.
+ * Returns false if any of the exports failed, which is also recorded in exports_failed.
+ */
+bool
 InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
+{
+    exports_done++;
+    bool ok = do_export_types(doc, filename_in);
+    if (!ok) {
+        exports_failed = true;
+    }
+    return ok;
+}
+
+bool
+InkFileExportCmd::do_export_types(SPDocument* doc, std::string filename_in)
 {
     std::string export_type_filename;
     std::vector<Glib::ustring> export_type_list;
@@ -81,7 +99,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 std::cerr << "InkFileExportCmd::do_export: No export type specified. "
                           << "Append a supported file extension to filename provided with --export-filename or "
                           << "provide one or more extensions separately using --export-type" << std::endl;
-                return;
+                return false;
             } else {
                 // no extension is fine if --export-type is given
                 // explicitly stated extensions are handled later
@@ -105,7 +123,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         if (export_id.empty() && !export_area_drawing) {
             std::cerr << "InkFileExportCmd::do_export: "
                       << "--export-use-hints can only be used with --export-id or --export-area-drawing." << std::endl;
-            return;
+            return false;
         }
         if (export_type_list.size() > 1 || (export_type_list.size() == 1 && export_type_list[0] != "png")) {
             std::cerr << "InkFileExportCmd::do_export: --export-use-hints can only be used with PNG export! "
@@ -129,7 +147,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 std::cerr << "InkFileExportCmd::do_export: "
                           << "The supplied --export-extension was not found. Specify a file extension "
                           << "to get a list of available extensions for this file type.";
-                return;
+                return false;
             }
         } else {
             export_type_list.emplace_back("svg"); // fall-back to SVG by default
@@ -139,8 +157,9 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
     if (!export_extension.empty() && export_type_list.size() != 1) {
         std::cerr
             << "InkFileExportCmd::do_export: You may only specify one export type if --export-extension is supplied";
-        return;
+        return false;
     }
+    bool ok = true;
     Inkscape::Extension::DB::OutputList extension_list;
     Inkscape::Extension::db.get_output_list(extension_list);
 
@@ -161,10 +180,11 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         // For PNG export, there is no extension, so the method below can not be used.
         if (type == "png") {
             if (!export_extension_forced) {
-                do_export_png(doc, filename_in);
+                ok = do_export_png(doc, filename_in) == 0 && ok;
             } else {
                 std::cerr << "InkFileExportCmd::do_export: "
                           << "The parameter --export-extension is invalid for PNG export" << std::endl;
+                ok = false;
             }
             continue;
         }
@@ -172,7 +192,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         // an extension ID was explicitly given. This makes handling of --export-plain-svg easier (which
         // should also work when multiple file types are given, unlike --export-extension)
         if (type == "svg" && !export_extension_forced) {
-            do_export_svg(doc, filename_in);
+            ok = do_export_svg(doc, filename_in) == 0 && ok;
             continue;
         }
 
@@ -193,23 +213,26 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 exts_for_fn.emplace_back(oext->get_id());
                 if (!export_extension_forced ||
                     (export_extension == Glib::ustring(oext->get_id()).lowercase())) {
+                    int result;
                     if (type == "svg") {
-                        do_export_svg(doc, filename_in, *oext);
+                        result = do_export_svg(doc, filename_in, *oext);
                     } else if (type == "ps") {
-                        do_export_ps_pdf(doc, filename_in, "image/x-postscript", *oext);
+                        result = do_export_ps_pdf(doc, filename_in, "image/x-postscript", *oext);
                     } else if (type == "eps") {
-                        do_export_ps_pdf(doc, filename_in, "image/x-e-postscript", *oext);
+                        result = do_export_ps_pdf(doc, filename_in, "image/x-e-postscript", *oext);
                     } else if (type == "pdf") {
-                        do_export_ps_pdf(doc, filename_in, "application/pdf", *oext);
+                        result = do_export_ps_pdf(doc, filename_in, "application/pdf", *oext);
                     } else {
-                        do_export_extension(doc, filename_in, oext);
+                        result = do_export_extension(doc, filename_in, oext);
                     }
+                    ok = result == 0 && ok;
                     exported = true;
                     break;
                 }
             }
         }
         if (!exported) {
+            ok = false;
             if (export_extension_forced && extension_for_fn_exists) {
                 // the located extension for this file type did not match the provided --export-extension parameter
                 std::cerr << "InkFileExportCmd::do_export: "
@@ -228,6 +251,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
             }
         }
     }
+    return ok;
 }
 
 // File names use std::string. HTML5 and presumably SVG 2 allows UTF-8 characters. Do we need to convert "object_id" here?
@@ -462,6 +486,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
         objects.emplace_back(); // So we do loop at least once for root.
     }
 
+    bool failed = false;
     for (auto object_id : objects) {
 
         std::string filename_out = get_filename_out(filename_in, Glib::filename_from_utf8(object_id));
@@ -478,6 +503,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             std::cerr << "InkFileExport::do_export_png: "
                       << "Object with id=\"" << object_id
                       << "\" was not found in the document. Skipping." << std::endl;
+            failed = true;
             continue;
         }
 
@@ -485,6 +511,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             std::cerr << "InkFileExportCmd::do_export_png: "
                       << "Object with id=\"" << object_id
                       << "\" is not a visible item. Skipping." << std::endl;
+            failed = true;
             continue;
         }
 
@@ -506,6 +533,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             } else {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Export filename hint not found for object " << object_id << ". Skipping." << std::endl;
+                failed = true;
                 continue;
             }
 
@@ -532,6 +560,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
         if (filename_out.empty()) {
             std::cerr << "InkFileExport::do_export_png: "
                       << "No valid export filename given and no filename hint. Skipping." << std::endl;
+            failed = true;
             continue;
         }
 
@@ -549,6 +578,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
         std::string directory = Glib::path_get_dirname(filename_out);
         if (!Glib::file_test(directory, Glib::FILE_TEST_IS_DIR)) {
             std::cerr << "File path " << filename_out << " includes directory that doesn't exist. Skipping." << std::endl;
+            failed = true;
             continue;
         }
 
@@ -560,6 +590,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
                 std::cerr << "InkFileExport::do_export_png: "
                           << "DPI value " << export_dpi
                           << " out of range [0.1 - 10000.0]. Skipping.";
+                failed = true;
                 continue;
             }
         }
@@ -602,6 +633,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             } else {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Unable to determine a valid bounding box. Skipping." << std::endl;
+                failed = true;
                 continue;
             }
         }
@@ -623,6 +655,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             if ((height < 1) || (height > PNG_UINT_31_MAX)) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Export height " << height << " out of range (1 to " << PNG_UINT_31_MAX << ")" << std::endl;
+                failed = true;
                 continue;
             }
             ydpi = Inkscape::Util::Quantity::convert(height, "in", "px") / area.height();
@@ -635,6 +668,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             if ((width < 1) || (width > PNG_UINT_31_MAX)) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Export width " << width << " out of range (1 to " << PNG_UINT_31_MAX << ")." << std::endl;
+                failed = true;
                 continue;
             }
             xdpi = Inkscape::Util::Quantity::convert(width, "in", "px") / area.width();
@@ -652,6 +686,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
 
         if ((width < 1) || (height < 1) || (width > PNG_UINT_31_MAX) || (height > PNG_UINT_31_MAX)) {
             std::cerr << "InkFileExport::do_export_png: Dimensions " << width << "x" << height << " are out of range (1 to " << PNG_UINT_31_MAX << ")." << std::endl;
+            failed = true;
             continue;
         }
 
@@ -679,6 +714,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             if (it == color_modes.end()) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Color mode " << export_png_color_mode << " is invalid. It must be one of Gray_1/Gray_2/Gray_4/Gray_8/Gray_16/RGB_8/RGB_16/GrayAlpha_8/GrayAlpha_16/RGBA_8/RGBA_16." << std::endl;
+                failed = true;
                 continue;
             } else {
                 std::tie(color_type, bit_depth) = it->second;
@@ -698,14 +734,15 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
 
         if( sp_export_png_file(doc, filename_out.c_str(), area, width, height, xdpi, ydpi,
                                bgcolor, nullptr, nullptr, true, export_id_only ? items : std::vector<SPItem*>(),
-                               false, color_type, bit_depth) == 1 ) {
+                               false, color_type, bit_depth, 6, 2, export_png_threads) == 1 ) {
         } else {
             std::cerr << "InkFileExport::do_export_png: Failed to export to " << filename_out << std::endl;
+            failed = true;
             continue;
         }
 
     } // End loop over objects.
-    return 0;
+    return failed ? 1 : 0;
 }
 
 
@@ -894,7 +931,12 @@ int InkFileExportCmd::do_export_extension(SPDocument *doc, std::string const &fi
     std::string filename_out = get_filename_out(filename_in);
     if (extension) {
         extension->set_state(Inkscape::Extension::Extension::STATE_LOADED);
-        extension->save(doc, filename_out.c_str());
+        try {
+            extension->save(doc, filename_out.c_str());
+        } catch (...) {
+            std::cerr << "InkFileExportCmd::do_export_extension: Failed to save to: " << filename_out << std::endl;
+            return 1;
+        }
     }
     return 0;
 }
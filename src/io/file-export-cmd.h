@@ -27,9 +27,14 @@ class InkFileExportCmd {
 public:
     InkFileExportCmd();
 
-    void do_export(SPDocument* doc, std::string filename_in="");
+    bool do_export(SPDocument* doc, std::string filename_in="");
+
+    // Outcome of the do_export() calls since construction, e.g. by export-do actions.
+    int  exports_done;
+    bool exports_failed;
 
 private:
+    bool do_export_types(SPDocument* doc, std::string filename_in);
     guint32 get_bgcolor(SPDocument *doc);
     std::string get_filename_out(std::string filename_in = "", std::string object_id = "");
     int do_export_svg(SPDocument *doc, std::string const &filename_in);
@@ -71,6 +76,7 @@ public:
     Glib::ustring export_background;
     double        export_background_opacity;
     Glib::ustring export_png_color_mode;
+    int           export_png_threads;
     bool          export_plain_svg;
 };
 
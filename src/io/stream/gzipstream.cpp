@@ -17,6 +17,7 @@
  */
 
 #include "gzipstream.h"
+#include "util/block-deflater.h"
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -32,6 +33,7 @@ namespace IO
 //#########################################################################
 
 #define OUT_SIZE 4000
+#define SRC_SIZE 16384
 
 /**
  *
@@ -39,12 +41,8 @@ namespace IO
 GzipInputStream::GzipInputStream(InputStream &sourceStream)
                     : BasicInputStream(sourceStream),
                       loaded(false),
-                      outputBuf(nullptr),
-                      srcBuf(nullptr),
-                      crc(0),
-                      srcCrc(0),
-                      srcSiz(0),
-                      srcLen(0),
+                      inflating(false),
+                      ended(false),
                       outputBufPos(0),
                       outputBufLen(0)
 {
@@ -57,14 +55,6 @@ GzipInputStream::GzipInputStream(InputStream &sourceStream)
 GzipInputStream::~GzipInputStream()
 {
     close();
-    if ( srcBuf ) {
-      delete[] srcBuf;
-      srcBuf = nullptr;
-    }
-    if ( outputBuf ) {
-        delete[] outputBuf;
-        outputBuf = nullptr;
-    }
 }
 
 /**
@@ -74,7 +64,7 @@ GzipInputStream::~GzipInputStream()
  */ 
 int GzipInputStream::available()
 {
-    if (closed || !outputBuf)
+    if (closed || outputBuf.empty())
         return 0;
     return outputBufLen - outputBufPos;
 }
@@ -89,19 +79,16 @@ void GzipInputStream::close()
     if (closed)
         return;
 
-    int zerr = inflateEnd(&d_stream);
-    if (zerr != Z_OK) {
-        printf("inflateEnd: Some kind of problem: %d\n", zerr);
+    if (inflating) {
+        int zerr = inflateEnd(&d_stream);
+        if (zerr != Z_OK) {
+            printf("inflateEnd: Some kind of problem: %d\n", zerr);
+        }
+        inflating = false;
     }
 
-    if ( srcBuf ) {
-      delete[] srcBuf;
-      srcBuf = nullptr;
-    }
-    if ( outputBuf ) {
-        delete[] outputBuf;
-        outputBuf = nullptr;
-    }
+    srcBuf = std::vector<unsigned char>();
+    outputBuf = std::vector<unsigned char>();
     closed = true;
 }
     
@@ -132,151 +119,86 @@ int GzipInputStream::get()
     return ch;
 }
 
-#define FTEXT 0x01
-#define FHCRC 0x02
-#define FEXTRA 0x04
-#define FNAME 0x08
-#define FCOMMENT 0x10
-
+/**
+ * Starts inflating. zlib reads the gzip header and checks the
+ * CRC and length in the trailer itself.
+ */
 bool GzipInputStream::load()
 {
-    crc = crc32(0L, Z_NULL, 0);
-    
-    std::vector<Byte> inputBuf;
-    while (true)
-        {
-        int ch = source.get();
-        if (ch<0)
-            break;
-        inputBuf.push_back(static_cast<Byte>(ch & 0xff));
-        }
-    long inputBufLen = inputBuf.size();
-    
-    if (inputBufLen < 19) //header + tail + 1
-        {
-        return false;
-        }
-
-    srcLen = inputBuf.size();
-    srcBuf = new (std::nothrow) Byte [srcLen];
-    if (!srcBuf) {
-        return false;
-    }
-
-    outputBuf = new (std::nothrow) unsigned char [OUT_SIZE];
-    if ( !outputBuf ) {
-        delete[] srcBuf;
-        srcBuf = nullptr;
-        return false;
-    }
+    srcBuf.resize(SRC_SIZE);
+    outputBuf.resize(OUT_SIZE);
     outputBufLen = 0; // Not filled in yet
 
-    std::vector<unsigned char>::iterator iter;
-    Bytef *p = srcBuf;
-    for (iter=inputBuf.begin() ; iter != inputBuf.end() ; ++iter)
-	{
-        *p++ = *iter;
-	}
-
-    int headerLen = 10;
-
-    //Magic
-    //int val = (int)srcBuf[0];
-    ////printf("val:%x\n", val);
-    //val = (int)srcBuf[1];
-    ////printf("val:%x\n", val);
-
-    ////Method
-    //val = (int)srcBuf[2];
-    ////printf("val:%x\n", val);
-
-    //flags
-    int flags = static_cast<int>(srcBuf[3]);
-
-    ////time
-    //val = (int)srcBuf[4];
-    //val = (int)srcBuf[5];
-    //val = (int)srcBuf[6];
-    //val = (int)srcBuf[7];
-
-    ////xflags
-    //val = (int)srcBuf[8];
-    ////OS
-    //val = (int)srcBuf[9];
-
-//     if ( flags & FEXTRA ) {
-//         headerLen += 2;
-//         int xlen = 
-//         TODO deal with optional header parts
-//     }
-    if ( flags & FNAME ) {
-        int cur = 10;
-        while ( srcBuf[cur] )
-        {
-            cur++;
-            headerLen++;
-        }
-        headerLen++;
+    if (!fetchSource()) {
+        return false;
     }
 
-
-    srcCrc = ((0x0ff & srcBuf[srcLen - 5]) << 24)
-           | ((0x0ff & srcBuf[srcLen - 6]) << 16)
-           | ((0x0ff & srcBuf[srcLen - 7]) <<  8)
-           | ((0x0ff & srcBuf[srcLen - 8]) <<  0);
-    //printf("srcCrc:%lx\n", srcCrc);
-    
-    srcSiz = ((0x0ff & srcBuf[srcLen - 1]) << 24)
-           | ((0x0ff & srcBuf[srcLen - 2]) << 16)
-           | ((0x0ff & srcBuf[srcLen - 3]) <<  8)
-           | ((0x0ff & srcBuf[srcLen - 4]) <<  0);
-    //printf("srcSiz:%lx/%ld\n", srcSiz, srcSiz);
-    
-    //outputBufLen = srcSiz + srcSiz/100 + 14;
-    
-    unsigned char *data = srcBuf + headerLen;
-    unsigned long dataLen = srcLen - (headerLen + 8);
-    //printf("%x %x\n", data[0], data[dataLen-1]);
-    
     d_stream.zalloc    = (alloc_func)nullptr;
     d_stream.zfree     = (free_func)nullptr;
     d_stream.opaque    = (voidpf)nullptr;
-    d_stream.next_in   = data;
-    d_stream.avail_in  = dataLen;
-    d_stream.next_out  = outputBuf;
-    d_stream.avail_out = OUT_SIZE;
-    
-    int zerr = inflateInit2(&d_stream, -MAX_WBITS);
-    if ( zerr == Z_OK )
-    {
-        zerr = fetchMore();
-    } else {
+
+    int zerr = inflateInit2(&d_stream, 16 + MAX_WBITS);
+    if ( zerr != Z_OK ) {
         printf("inflateInit2: Some kind of problem: %d\n", zerr);
+        return false;
     }
+    inflating = true;
 
-        
+    zerr = fetchMore();
     return (zerr == Z_OK) || (zerr == Z_STREAM_END);
 }
 
+/**
+ * Reads the next chunk of compressed data from the source.
+ * Returns false at the end of the source.
+ */
+bool GzipInputStream::fetchSource()
+{
+    size_t len = 0;
+    while (len < srcBuf.size()) {
+        int ch = source.get();
+        if (ch < 0)
+            break;
+        srcBuf[len++] = static_cast<unsigned char>(ch & 0xff);
+    }
+    d_stream.next_in  = srcBuf.data();
+    d_stream.avail_in = len;
+    return len > 0;
+}
 
 int GzipInputStream::fetchMore()
 {
     // TODO assumes we aren't called till the buffer is empty
-    d_stream.next_out  = outputBuf;
-    d_stream.avail_out = OUT_SIZE;
     outputBufLen = 0;
     outputBufPos = 0;
 
-    int zerr = inflate( &d_stream, Z_SYNC_FLUSH );
-    if ( zerr == Z_OK || zerr == Z_STREAM_END ) {
+    int zerr = Z_OK;
+    while (outputBufLen == 0 && !ended) {
+        if (d_stream.avail_in == 0 && !fetchSource()) {
+            // truncated: keep what could be read
+            ended = true;
+            break;
+        }
+
+        d_stream.next_out  = outputBuf.data();
+        d_stream.avail_out = OUT_SIZE;
+        zerr = inflate( &d_stream, Z_NO_FLUSH );
         outputBufLen = OUT_SIZE - d_stream.avail_out;
-        if ( outputBufLen ) {
-            crc = crc32(crc, const_cast<const Bytef *>(outputBuf), outputBufLen);
+
+        if ( zerr == Z_STREAM_END ) {
+            // Concatenated gzip files are one file, so another member may follow.
+            if (d_stream.avail_in == 0 && !fetchSource()) {
+                ended = true;
+            } else if (d_stream.next_in[0] != 0x1f) {
+                // trailing padding
+                ended = true;
+            } else {
+                inflateReset(&d_stream);
+            }
+        } else if ( zerr != Z_OK && zerr != Z_BUF_ERROR ) {
+            printf("inflate: Some kind of problem: %d\n", zerr);
+            ended = true;
         }
-        //printf("crc:%lx\n", crc);
-//     } else if ( zerr != Z_STREAM_END ) {
-//         // TODO check to be sure this won't happen for partial end reads
-//         printf("inflate: Some kind of problem: %d\n", zerr);
     }
 
     return zerr;
@@ -289,13 +211,17 @@ int GzipInputStream::fetchMore()
 /**
  *
  */ 
-GzipOutputStream::GzipOutputStream(OutputStream &destinationStream)
+GzipOutputStream::GzipOutputStream(OutputStream &destinationStream, int threads)
                      : BasicOutputStream(destinationStream)
 {
-
-    totalIn         = 0;
-    totalOut        = 0;
-    crc             = crc32(0L, Z_NULL, 0);
+    deflater = std::make_unique<Inkscape::Util::BlockDeflater>(
+        [this](unsigned char const *data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                destination.put(static_cast<char>(data[i]));
+            }
+        },
+        threads);
+    inputBuf.reserve(Inkscape::Util::BlockDeflater::BLOCK_SIZE);
 
     //Gzip header
     destination.put(0x1f);
@@ -341,16 +267,19 @@ void GzipOutputStream::close()
         return;
 
     flush();
+    if (!deflater->finish()) {
+        printf("Some kind of problem\n");
+    }
 
     //# Send the CRC
-    uLong outlong = crc;
+    uLong outlong = deflater->crc();
     for (int n = 0; n < 4; n++)
         {
         destination.put(static_cast<char>(outlong & 0xff));
         outlong >>= 8;
         }
     //# send the file length
-    outlong = totalIn & 0xffffffffL;
+    outlong = deflater->size() & 0xffffffffL;
     for (int n = 0; n < 4; n++)
         {
         destination.put(static_cast<char>(outlong & 0xff));
@@ -364,54 +293,24 @@ void GzipOutputStream::close()
 /**
  *  Flushes this output stream and forces any buffered output
  *  bytes to be written out.
+ *
+ *  Data is only compressed in whole blocks until the stream
+ *  is closed, so part of it may still be held by the deflater.
  */ 
 void GzipOutputStream::flush()
 {
-    if (closed || inputBuf.empty())
-	{
-        return;
-    }
-	
-    uLong srclen = inputBuf.size();
-    Bytef *srcbuf = new (std::nothrow) Bytef [srclen];
-    if (!srcbuf)
-        {
-        return;
-        }
-        
-    uLong destlen = srclen;
-    Bytef *destbuf = new (std::nothrow) Bytef [(destlen + (srclen/100) + 13)];
-    if (!destbuf)
+    if (closed)
         {
-        delete[] srcbuf;
         return;
         }
-        
-    std::vector<unsigned char>::iterator iter;
-    Bytef *p = srcbuf;
-    for (iter=inputBuf.begin() ; iter != inputBuf.end() ; ++iter)
-        *p++ = *iter;
-        
-    crc = crc32(crc, const_cast<const Bytef *>(srcbuf), srclen);
-    
-    int zerr = compress(destbuf, static_cast<uLongf *>(&destlen), srcbuf, srclen);
-    if (zerr != Z_OK)
-        {
-        printf("Some kind of problem\n");
-        }
 
-    totalOut += destlen;
-    //skip the redundant zlib header and checksum
-    for (uLong i=2; i<destlen-4 ; i++)
+    if (!inputBuf.empty())
         {
-        destination.put((int)destbuf[i]);
+        deflater->write(inputBuf.data(), inputBuf.size());
+        inputBuf.clear();
         }
-        
-    destination.flush();
 
-    inputBuf.clear();
-    delete[] srcbuf;
-    delete[] destbuf;
+    destination.flush();
 }
 
 
@@ -430,7 +329,11 @@ int GzipOutputStream::put(char ch)
 
     //Add char to buffer
     inputBuf.push_back(ch);
-    totalIn++;
+    if (inputBuf.size() >= Inkscape::Util::BlockDeflater::BLOCK_SIZE)
+        {
+        deflater->write(inputBuf.data(), inputBuf.size());
+        inputBuf.clear();
+        }
     return 1;
 }
 
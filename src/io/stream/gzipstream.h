@@ -18,10 +18,17 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <memory>
 #include <vector>
 #include "inkscapestream.h"
 #include <zlib.h>
 
+namespace Inkscape {
+namespace Util {
+class BlockDeflater;
+}
+}
+
 namespace Inkscape
 {
 namespace IO
@@ -34,6 +41,8 @@ namespace IO
 /**
  * This class is for deflating a gzip-compressed InputStream source
  *
+ * The source is read and inflated a chunk at a time, so the compressed
+ * file is never held in memory as a whole.
  */
 class GzipInputStream : public BasicInputStream
 {
@@ -54,16 +63,15 @@ private:
 
     bool load();
     int fetchMore();
+    bool fetchSource();
 
     bool loaded;
-    
-    unsigned char *outputBuf;
-    unsigned char *srcBuf;
+    bool inflating;
+    bool ended;
+
+    std::vector<unsigned char> outputBuf;
+    std::vector<unsigned char> srcBuf;
 
-    unsigned long crc;
-    unsigned long srcCrc;
-    unsigned long srcSiz;
-    unsigned long srcLen;
     long outputBufPos;
     long outputBufLen;
 
@@ -81,13 +89,15 @@ private:
  * This class is for gzip-compressing data going to the
  * destination OutputStream
  *
+ * Blocks of data are compressed on the given number of threads
+ * as they fill up, see Inkscape::Util::BlockDeflater.
  */
 class GzipOutputStream : public BasicOutputStream
 {
 
 public:
 
-    GzipOutputStream(OutputStream &destinationStream);
+    GzipOutputStream(OutputStream &destinationStream, int threads = 1);
     
     ~GzipOutputStream() override;
     
@@ -101,9 +111,7 @@ private:
 
     std::vector<unsigned char> inputBuf;
 
-    long totalIn;
-    long totalOut;
-    unsigned long crc;
+    std::unique_ptr<Inkscape::Util::BlockDeflater> deflater;
 
 }; // class GzipOutputStream
 
@@ -20,6 +20,7 @@
 
 #include <unordered_map>
 
+#include <glib/gstdio.h>
 #include <glibmm/i18n.h>
 
 #include <fontconfig/fontconfig.h>
@@ -32,6 +33,8 @@
 #include "io/resource.h"
 
 #include "libnrtype/FontFactory.h"
+#include "libnrtype/Layout-TNG.h"
+#include "libnrtype/font-catalog.h"
 #include "libnrtype/font-instance.h"
 #include "libnrtype/OpenTypeUtil.h"
 
@@ -565,6 +568,143 @@ GList* font_factory::GetUIStyles(PangoFontFamily * in)
     return ret;
 }
 
+static std::string catalog_filename()
+{
+    using namespace Inkscape::IO::Resource;
+    return get_path_string(CACHE, NONE, "font-catalog");
+}
+
+std::vector<Glib::ustring> const &font_factory::GetUIFamilyNames()
+{
+    ensureCatalog();
+    return catalog->families();
+}
+
+GList* font_factory::GetUIStyles(Glib::ustring const &family)
+{
+    ensureCatalog();
+    auto styles = catalog->styles(family);
+    if (!styles) {
+        if (pangoFamilies.empty()) {
+            PangoFontFamily** families = nullptr;
+            int numFamilies = 0;
+            pango_font_map_list_families(fontServer, &families, &numFamilies);
+            for (int i = 0; i < numFamilies; ++i) {
+                pangoFamilies.emplace(pango_font_family_get_name(families[i]), families[i]);
+            }
+            g_free(families);
+        }
+        auto it = pangoFamilies.find(family.raw());
+        if (it == pangoFamilies.end()) {
+            return nullptr;
+        }
+
+        std::vector<StyleNames> found;
+        GList *list = GetUIStyles(it->second);
+        for (GList *l = list; l; l = l->next) {
+            found.push_back(*(StyleNames *)l->data);
+            delete (StyleNames *)l->data;
+        }
+        g_list_free(list);
+
+        catalog->setStyles(family, std::move(found));
+        styles = catalog->styles(family);
+        if (!catalogSaveScheduled) {
+            catalogSaveScheduled = true;
+            g_idle_add(&font_factory::saveCatalog, this);
+        }
+    }
+
+    GList* ret = nullptr;
+    for (auto const &style : *styles) {
+        ret = g_list_append(ret, new StyleNames(style));
+    }
+    return ret;
+}
+
+void font_factory::ensureCatalog()
+{
+    if (catalog) {
+        return;
+    }
+    auto start = g_get_monotonic_time();
+    catalog = std::make_unique<FontCatalog>();
+
+    std::string stamp = catalogStamp();
+    std::string filename = catalog_filename();
+    if (catalog->load(filename, stamp)) {
+        g_debug("Read %zu font families from the font catalog in %.1f ms", catalog->families().size(),
+                (g_get_monotonic_time() - start) / 1000.0);
+        return;
+    }
+
+    std::vector<PangoFontFamily *> families;
+    GetUIFamilies(families);
+    std::vector<Glib::ustring> names;
+    names.reserve(families.size());
+    for (auto family : families) {
+        names.emplace_back(pango_font_family_get_name(family));
+    }
+    catalog->reset(stamp, std::move(names));
+    if (!catalog->save(filename)) {
+        g_info("Could not write the font catalog '%s'.", filename.c_str());
+    }
+    g_debug("Listed %zu font families in %.1f ms", catalog->families().size(),
+            (g_get_monotonic_time() - start) / 1000.0);
+}
+
+std::string font_factory::catalogStamp()
+{
+    std::string files = pango_version_string();
+    files += '\n';
+    auto add = [&](char const *path) {
+        GStatBuf info;
+        files += path;
+        if (g_stat(path, &info) == 0) {
+            files += ' ';
+            files += std::to_string(info.st_mtime);
+        }
+        files += '\n';
+    };
+
+#ifndef USE_PANGO_WIN32
+    FcConfig *conf = nullptr;
+# if PANGO_VERSION_CHECK(1,38,0)
+    conf = pango_fc_font_map_get_config(PANGO_FC_FONT_MAP(fontServer));
+# endif
+    // fontconfig lists the subdirectories it found too, and adding or removing a font changes
+    // the mtime of its directory
+    FcStrList *dirs = FcConfigGetFontDirs(conf);
+    while (FcChar8 *dir = FcStrListNext(dirs)) {
+        add((char const *)dir);
+    }
+    FcStrListDone(dirs);
+    FcStrList *configs = FcConfigGetConfigFiles(conf);
+    while (FcChar8 *config = FcStrListNext(configs)) {
+        add((char const *)config);
+    }
+    FcStrListDone(configs);
+#endif
+    for (auto const &file : addedFontFiles) {
+        add(file.c_str());
+    }
+
+    gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, files.c_str(), files.size());
+    std::string stamp = checksum;
+    g_free(checksum);
+    return stamp;
+}
+
+gboolean font_factory::saveCatalog(gpointer data)
+{
+    auto factory = static_cast<font_factory *>(data);
+    factory->catalogSaveScheduled = false;
+    if (factory->catalog) {
+        factory->catalog->save(catalog_filename());
+    }
+    return FALSE;
+}
+
 
 font_instance* font_factory::FaceFromStyle(SPStyle const *style)
 {
@@ -831,7 +971,10 @@ void font_factory::AddFontsDir(char const *utf8dir)
         g_info("Fonts dir '%s' added successfully.", utf8dir);
 # if PANGO_VERSION_CHECK(1,38,0)
         pango_fc_font_map_config_changed(PANGO_FC_FONT_MAP(fontServer));
+        Inkscape::Text::Layout::clearShapingCache();
 # endif
+        catalog.reset();
+        pangoFamilies.clear();
     } else {
         g_warning("Could not add fonts dir '%s'.", utf8dir);
     }
@@ -866,7 +1009,11 @@ void font_factory::AddFontFile(char const *utf8file)
         g_info("Font file '%s' added successfully.", utf8file);
 # if PANGO_VERSION_CHECK(1,38,0)
         pango_fc_font_map_config_changed(PANGO_FC_FONT_MAP(fontServer));
+        Inkscape::Text::Layout::clearShapingCache();
 # endif
+        addedFontFiles.emplace_back(file);
+        catalog.reset();
+        pangoFamilies.clear();
     } else {
         g_warning("Could not add font file '%s'.", utf8file);
     }
@@ -18,7 +18,11 @@
 
 #include <functional>
 #include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #ifdef _WIN32
 //#define USE_PANGO_WIN32 // disable for Bug 165665
@@ -38,6 +42,7 @@
 
 
 class font_instance;
+class FontCatalog;
 
 namespace Glib
 {
@@ -125,6 +130,11 @@ public:
     // Retrieves style information about a family in a newly allocated GList.
     GList*                GetUIStyles(PangoFontFamily * in);
 
+    /// The Pango names of the families GetUIFamilies() lists, from the font catalog while it is up to date.
+    std::vector<Glib::ustring> const &GetUIFamilyNames();
+    /// Like GetUIStyles() for the family of that Pango name, from the font catalog if it knows them.
+    GList*                GetUIStyles(Glib::ustring const &family);
+
     /// Retrieve a font_instance from a style object, first trying to use the font-specification, the CSS information
     font_instance*        FaceFromStyle(SPStyle const *style);
 
@@ -158,6 +168,19 @@ public:
 private:
     void*                 loadedPtr;
 
+    /// Reads the font catalog, or lists the fonts and writes it if the fonts have changed.
+    void                  ensureCatalog();
+    /// A checksum of the fontconfig configuration and the mtimes of the font directories.
+    std::string           catalogStamp();
+    static gboolean       saveCatalog(gpointer data);
+
+    std::unique_ptr<FontCatalog> catalog;       ///< Loaded on first use.
+    bool                  catalogSaveScheduled = false;
+    /// The families Pango lists, by name, only filled when a family is not in the catalog.
+    std::unordered_map<std::string, PangoFontFamily *> pangoFamilies;
+    /// Font files added with AddFontFile(), which are not in any font directory.
+    std::vector<std::string> addedFontFiles;
+
 
     // The following two commented out maps were an attempt to allow Inkscape to use font faces
     // that could not be distinguished by CSS values alone. In practice, they never were that
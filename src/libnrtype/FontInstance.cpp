@@ -30,6 +30,16 @@
 #include <harfbuzz/hb.h>
 #include <harfbuzz/hb-ft.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
 #include <glibmm/regex.h>
 
 #include <2geom/pathvector.h>
@@ -39,6 +49,135 @@
 
 #include "display/cairo-utils.h"  // Inkscape::Pixbuf
 
+namespace {
+
+/**
+ * Glyph outlines and metrics of all fonts in the process.
+ *
+ * Glyphs are keyed by their face and glyph id, so font_instances of the same face share them.
+ * Once added, a glyph is never changed, and may be read from any thread; whoever holds one keeps
+ * it alive. The glyphs are spread over shards with a lock each, so that threads looking up
+ * glyphs rarely wait for each other, and not at all while only reading.
+ *
+ * A shard that grows past its share of MAX_GLYPHS drops the quarter of its glyphs that were
+ * used least recently. Each glyph records when it was last used by the count of glyphs the
+ * shard had added at the time, which lookups can write under the shared lock.
+ */
+class GlyphCache
+{
+public:
+    static GlyphCache &get()
+    {
+        static GlyphCache *cache = new GlyphCache();
+        return *cache;
+    }
+
+    /// A number identifying the face with the given key.
+    int faceId(std::string const &key)
+    {
+        std::lock_guard<std::mutex> lock(_faces_mutex);
+        return _faces.emplace(key, _faces.size()).first->second;
+    }
+
+    std::shared_ptr<font_glyph const> find(int face, int glyph_id)
+    {
+        auto const k = key(face, glyph_id);
+        Shard &s = shard(k);
+        std::shared_lock<std::shared_mutex> lock(s.mutex);
+        auto it = s.glyphs.find(k);
+        if (it == s.glyphs.end()) {
+            return nullptr;
+        }
+        Entry &entry = it->second;
+        auto const now = s.clock.load(std::memory_order_relaxed);
+        if (entry.used.load(std::memory_order_relaxed) != now) {
+            entry.used.store(now, std::memory_order_relaxed);
+        }
+        return entry.glyph;
+    }
+
+    /// Adds the glyph, unless there is one already, and returns the glyph in the cache.
+    std::shared_ptr<font_glyph const> insert(int face, int glyph_id, std::shared_ptr<font_glyph const> glyph)
+    {
+        auto const k = key(face, glyph_id);
+        Shard &s = shard(k);
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        auto const now = s.clock.load(std::memory_order_relaxed) + 1;
+        s.clock.store(now, std::memory_order_relaxed);
+        auto result = s.glyphs.emplace(std::piecewise_construct, std::forward_as_tuple(k),
+                                       std::forward_as_tuple(std::move(glyph), now));
+        if (!result.second) {
+            return result.first->second.glyph;
+        }
+        auto inserted = result.first->second.glyph;
+        if (s.glyphs.size() > MAX_GLYPHS / SHARDS) {
+            evict(s);
+        }
+        return inserted;
+    }
+
+    /// Held while loading glyphs, since a FreeType face must not be used by several threads.
+    std::mutex &loadMutex() { return _load_mutex; }
+
+private:
+    static int const SHARDS = 16;
+    static std::size_t const MAX_GLYPHS = 32768;
+
+    struct Entry
+    {
+        Entry(std::shared_ptr<font_glyph const> glyph, uint64_t used)
+            : glyph(std::move(glyph))
+            , used(used)
+        {}
+
+        std::shared_ptr<font_glyph const> glyph;
+        std::atomic<uint64_t> used;
+    };
+
+    struct Shard
+    {
+        std::shared_mutex mutex;
+        std::atomic<uint64_t> clock{0}; ///< Glyphs added so far
+        std::unordered_map<uint64_t, Entry> glyphs;
+    };
+
+    static uint64_t key(int face, int glyph_id) { return uint64_t(uint32_t(face)) << 32 | uint32_t(glyph_id); }
+    Shard &shard(uint64_t key) { return _shards[(key ^ (key >> 32)) % SHARDS]; }
+
+    /// Drops the least recently used quarter of the shard's glyphs; the shard must be locked.
+    static void evict(Shard &s)
+    {
+        std::vector<uint64_t> used;
+        used.reserve(s.glyphs.size());
+        for (auto const &glyph : s.glyphs) {
+            used.push_back(glyph.second.used.load(std::memory_order_relaxed));
+        }
+        std::size_t const count = used.size() / 4;
+        auto const nth = used.begin() + count;
+        std::nth_element(used.begin(), nth, used.end());
+        uint64_t const threshold = *nth;
+        // those used before the threshold, then as many used at it as it takes
+        std::size_t const older = std::count_if(used.begin(), nth, [=](uint64_t u) { return u < threshold; });
+        std::size_t at_threshold = count - older;
+        for (auto it = s.glyphs.begin(); it != s.glyphs.end();) {
+            uint64_t const u = it->second.used.load(std::memory_order_relaxed);
+            if (u < threshold || (u == threshold && at_threshold > 0)) {
+                at_threshold -= u == threshold;
+                it = s.glyphs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    Shard _shards[SHARDS];
+    std::mutex _faces_mutex;
+    std::unordered_map<std::string, int> _faces;
+    std::mutex _load_mutex;
+};
+
+} // namespace
+
 #ifndef USE_PANGO_WIN32
 /*
  * Outline extraction
@@ -146,18 +285,6 @@ font_instance::~font_instance()
 
     //    if ( theFace ) FT_Done_Face(theFace); // owned by pFont. don't touch
     theFace = nullptr;
-
-    for (int i=0;i<nbGlyph;i++) {
-        if ( glyphs[i].pathvector ) {
-            delete glyphs[i].pathvector;
-        }
-    }
-    if ( glyphs ) {
-        free(glyphs);
-        glyphs = nullptr;
-    }
-    nbGlyph = 0;
-    maxGlyph = 0;
 }
 
 void font_instance::Ref()
@@ -395,32 +522,73 @@ static inline Geom::Point pointfx_to_nrpoint(const POINTFX &p, double scale)
 }
 #endif
 
-void font_instance::LoadGlyph(int glyph_id)
+std::string font_instance::GlyphCacheFaceKey()
 {
+    std::string key;
+#ifndef USE_PANGO_WIN32
+    // The file and the index of the face in it, since several installed fonts, or fonts added
+    // with AddFontFile(), may have the same description.
+    FcPattern *pattern = PANGO_FC_FONT(pFont)->font_pattern;
+    FcChar8 *file = nullptr;
+    int index = 0;
+    if (pattern && FcPatternGetString(pattern, FC_FILE, 0, &file) == FcResultMatch) {
+        FcPatternGetInteger(pattern, FC_INDEX, 0, &index);
+        key = reinterpret_cast<char const *>(file);
+        key += " #" + std::to_string(index);
+    }
+#endif
+    if (key.empty()) {
+        PangoFontDescription *face_descr = pango_font_describe(pFont);
+        pango_font_description_unset_fields(face_descr, PANGO_FONT_MASK_SIZE);
+        char *str = pango_font_description_to_string(face_descr);
+        key = str;
+        g_free(str);
+        pango_font_description_free(face_descr);
+    }
+
+#if PANGO_VERSION_CHECK(1,41,1)
+    // the variations InitTheFace() set on the face
+    if (char const *variations = pango_font_description_get_variations(descr)) {
+        key += " @";
+        key += variations;
+    }
+#endif
+    return key;
+}
+
+std::shared_ptr<font_glyph const> font_instance::LoadGlyph(int glyph_id)
+{
+    GlyphCache &cache = GlyphCache::get();
+    if (_glyph_cache_face >= 0) {
+        if (auto glyph = cache.find(_glyph_cache_face, glyph_id)) {
+            return glyph;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cache.loadMutex());
     if ( pFont == nullptr ) {
-        return;
+        return nullptr;
     }
     InitTheFace();
 #ifndef USE_PANGO_WIN32
     if ( !FT_IS_SCALABLE(theFace) ) {
-        return; // bitmap font
+        return nullptr; // bitmap font
     }
 #endif
 
-    if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
+    if (_glyph_cache_face < 0) {
+        _glyph_cache_face = cache.faceId(GlyphCacheFaceKey());
+    }
+    // loaded by another thread or another font_instance of the face
+    if (auto glyph = cache.find(_glyph_cache_face, glyph_id)) {
+        return glyph;
+    }
+
+    {
         Geom::PathBuilder path_builder;
 
-        if ( nbGlyph >= maxGlyph ) {
-            maxGlyph=2*nbGlyph+1;
-            glyphs=(font_glyph*)realloc(glyphs,maxGlyph*sizeof(font_glyph));
-        }
-        font_glyph  n_g;
-        n_g.pathvector=nullptr;
-        n_g.bbox[0]=n_g.bbox[1]=n_g.bbox[2]=n_g.bbox[3]=0;
-        n_g.h_advance = 0;
-        n_g.v_advance = 0;
-        n_g.h_width = 0;
-        n_g.v_width = 0;
+        auto glyph = std::make_shared<font_glyph>();
+        font_glyph &n_g = *glyph;
         bool   doAdd=false;
 
 #ifdef USE_PANGO_WIN32
@@ -551,21 +719,19 @@ void font_instance::LoadGlyph(int glyph_id)
                 i.close();
             }
             if ( !pv.empty() ) {
-                n_g.pathvector = new Geom::PathVector(pv);
-                Geom::OptRect bounds = bounds_exact(*n_g.pathvector);
+                Geom::OptRect bounds = bounds_exact(pv);
                 if (bounds) {
                     n_g.bbox[0] = bounds->left();
                     n_g.bbox[1] = bounds->top();
                     n_g.bbox[2] = bounds->right();
                     n_g.bbox[3] = bounds->bottom();
                 }
+                n_g.pathvector = std::make_unique<Geom::PathVector const>(std::move(pv));
             }
-            glyphs[nbGlyph]=n_g;
-            id_to_no[glyph_id]=nbGlyph;
-            nbGlyph++;
+            return cache.insert(_glyph_cache_face, glyph_id, std::move(glyph));
         }
-    } else {
     }
+    return nullptr;
 }
 
 bool font_instance::FontMetrics(double &ascent,double &descent,double &xheight)
@@ -654,41 +820,22 @@ bool font_instance::FontSlope(double &run, double &rise)
 
 Geom::OptRect font_instance::BBox(int glyph_id)
 {
-    int no = -1;
-    if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-        LoadGlyph(glyph_id);
-        if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-            // didn't load
-        } else {
-            no = id_to_no[glyph_id];
-        }
-    } else {
-        no = id_to_no[glyph_id];
-    }
-    if ( no < 0 ) {
+    auto glyph = LoadGlyph(glyph_id);
+    if ( glyph == nullptr ) {
         return Geom::OptRect();
     } else {
-        Geom::Point rmin(glyphs[no].bbox[0],glyphs[no].bbox[1]);
-        Geom::Point rmax(glyphs[no].bbox[2],glyphs[no].bbox[3]);
+        Geom::Point rmin(glyph->bbox[0],glyph->bbox[1]);
+        Geom::Point rmax(glyph->bbox[2],glyph->bbox[3]);
         return Geom::Rect(rmin, rmax);
     }
 }
 
-Geom::PathVector* font_instance::PathVector(int glyph_id)
+std::shared_ptr<Geom::PathVector const> font_instance::PathVector(int glyph_id)
 {
-    int no = -1;
-    if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-        LoadGlyph(glyph_id);
-        if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-            // didn't load
-        } else {
-            no = id_to_no[glyph_id];
-        }
-    } else {
-        no = id_to_no[glyph_id];
-    }
-    if ( no < 0 ) return nullptr;
-    return glyphs[no].pathvector;
+    auto glyph = LoadGlyph(glyph_id);
+    if ( glyph == nullptr || !glyph->pathvector ) return nullptr;
+    // shares the ownership of the glyph
+    return std::shared_ptr<Geom::PathVector const>(glyph, glyph->pathvector.get());
 }
 
 Inkscape::Pixbuf* font_instance::PixBuf(int glyph_id)
@@ -808,22 +955,12 @@ Inkscape::Pixbuf* font_instance::PixBuf(int glyph_id)
 
 double font_instance::Advance(int glyph_id, bool vertical)
 {
-    int no = -1;
-    if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-        LoadGlyph(glyph_id);
-        if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-            // didn't load
-        } else {
-            no=id_to_no[glyph_id];
-        }
-    } else {
-        no = id_to_no[glyph_id];
-    }
-    if ( no >= 0 ) {
+    auto glyph = LoadGlyph(glyph_id);
+    if ( glyph != nullptr ) {
         if ( vertical ) {
-            return glyphs[no].v_advance;
+            return glyph->v_advance;
         } else {
-            return glyphs[no].h_advance;
+            return glyph->h_advance;
         }
     }
     return 0;
@@ -11,6 +11,10 @@
  */
 
 #include <iomanip>
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
 
 #include "Layout-TNG.h"
 #include "style.h"
@@ -32,6 +36,98 @@ namespace Text {
 
 #define TRACE(_args) IFTRACE(g_print _args)
 
+/**
+ * Itemization and shaping results of paragraphs, kept between layouts so that paragraphs
+ * whose text and text attributes did not change are not itemized and shaped again.
+ *
+ * Entries are keyed by the text of the paragraph, the font, font features and language of
+ * each of its runs, its base direction and the gravity settings of the Pango context. The
+ * least recently used entries are dropped when there are too many.
+ */
+class ShapingCache
+{
+public:
+    /// The results for one paragraph.
+    struct Entry
+    {
+        std::vector<PangoItem *> items;
+        std::vector<font_instance *> fonts;        ///< The font of each of the items.
+        std::vector<PangoLogAttr> char_attributes;
+        /// The glyphs of the spans shaped so far, by byte offset and length in the paragraph.
+        std::map<std::pair<unsigned, unsigned>, PangoGlyphString *> glyphs;
+
+        Entry() = default;
+        Entry(Entry const &) = delete;
+        Entry &operator=(Entry const &) = delete;
+        ~Entry()
+        {
+            for (auto item : items) {
+                pango_item_free(item);
+            }
+            for (auto font : fonts) {
+                if (font) {
+                    font->Unref();
+                }
+            }
+            for (auto &glyph_string : glyphs) {
+                pango_glyph_string_free(glyph_string.second);
+            }
+        }
+    };
+
+    static ShapingCache &get()
+    {
+        // never destroyed, since the fonts of the entries may not outlive the font factory
+        static ShapingCache *cache = new ShapingCache();
+        return *cache;
+    }
+
+    std::shared_ptr<Entry> find(std::string const &key)
+    {
+        auto it = _index.find(key);
+        if (it == _index.end()) {
+            return nullptr;
+        }
+        _entries.splice(_entries.begin(), _entries, it->second);
+        return it->second->second;
+    }
+
+    void insert(std::string const &key, std::shared_ptr<Entry> entry)
+    {
+        _entries.emplace_front(key, std::move(entry));
+        _index[key] = _entries.begin();
+        while (_entries.size() > MAX_ENTRIES) {
+            _index.erase(_entries.back().first);
+            _entries.pop_back();
+        }
+    }
+
+    void clear()
+    {
+        _index.clear();
+        _entries.clear();
+    }
+
+    Layout::ShapingCacheStats stats;
+
+private:
+    static size_t const MAX_ENTRIES = 2000;
+
+    /// Most recently used first.
+    std::list<std::pair<std::string, std::shared_ptr<Entry>>> _entries;
+    std::unordered_map<std::string, decltype(_entries)::iterator> _index;
+};
+
+Layout::ShapingCacheStats const &Layout::shapingCacheStats()
+{
+    return ShapingCache::get().stats;
+}
+
+void Layout::clearShapingCache()
+{
+    ShapingCache::get().clear();
+}
+
 /** \brief private to Layout. Does the real work of text flowing.
 
 This class does a standard greedy paragraph wrapping algorithm.
@@ -180,6 +276,7 @@ class Layout::Calculator
         std::vector<PangoItemInfo> pango_items;
         std::vector<PangoLogAttr> char_attributes;    ///< For every character in the paragraph.
         std::vector<UnbrokenSpan> unbroken_spans;
+        std::shared_ptr<ShapingCache::Entry> shaped;  ///< The cached itemization and glyphs of the paragraph.
 
         template<typename T> static void free_sequence(T &seq)
         {
@@ -195,6 +292,7 @@ class Layout::Calculator
             free_sequence(input_items);
             free_sequence(pango_items);
             free_sequence(unbroken_spans);
+            shaped.reset();
         }
     };
 
@@ -1348,6 +1446,7 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
 
     TRACE(("itemizing para, first input %d\n", para->first_input_index));
 
+    std::string key; // the attributes of the runs, then the base direction, gravity and text
     PangoAttrList *attributes_list = pango_attr_list_new();
     for (unsigned input_index = para->first_input_index ; input_index < _flow._input_stream.size() ; input_index++) {
         if (_flow._input_stream[input_index]->Type() == CONTROL_CODE) {
@@ -1368,11 +1467,16 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
             PangoAttribute *attribute_font_description = pango_attr_font_desc_new(font->descr);
             attribute_font_description->start_index = para->text.bytes();
 
+            std::string const font_features = text_source->style->getFontFeatureString();
 #if PANGO_VERSION_CHECK(1,37,1)
             PangoAttribute *attribute_font_features =
-                pango_attr_font_features_new( text_source->style->getFontFeatureString().c_str());
+                pango_attr_font_features_new(font_features.c_str());
             attribute_font_features->start_index = para->text.bytes();
 #endif
+
+            char *font_description = pango_font_description_to_string(font->descr);
+            key += std::to_string(para->text.bytes()) + ' ' + font_description + '\n' + font_features + '\n';
+            g_free(font_description);
             para->text.append(&*text_source->text_begin.base(), text_source->text_length);     // build the combined text
 
             attribute_font_description->end_index = para->text.bytes();
@@ -1390,6 +1494,7 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
                 PangoAttribute *attribute_language = pango_attr_language_new( language );
                 pango_attr_list_insert(attributes_list, attribute_language);
             }
+            key += object->lang + '\n';
 
             // ownership of attribute is assumed by the list
             font->Unref();
@@ -1399,14 +1504,45 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
     TRACE(("whole para: \"%s\"\n", para->text.data()));
 //    TRACE(("%d input sources used\n", input_index - para->first_input_index));
 
-    // Pango Itemize
-    GList *pango_items_glist = nullptr;
     para->direction = LEFT_TO_RIGHT; // CSS default
-    if (_flow._input_stream[para->first_input_index]->Type() == TEXT_SOURCE) {
+    bool const has_base_direction = _flow._input_stream[para->first_input_index]->Type() == TEXT_SOURCE;
+    if (has_base_direction) {
         Layout::InputStreamTextSource const *text_source = static_cast<Layout::InputStreamTextSource *>(_flow._input_stream[para->first_input_index]);
+        para->direction = (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? LEFT_TO_RIGHT : RIGHT_TO_LEFT;
+    }
+
+    key += std::to_string(has_base_direction ? para->direction : -1) + ' '
+         + std::to_string(pango_context_get_base_gravity(_pango_context)) + ' '
+         + std::to_string(pango_context_get_gravity_hint(_pango_context)) + '\n';
+    key += para->text.raw();
+
+    ShapingCache &cache = ShapingCache::get();
+    para->shaped = cache.find(key);
+    if (para->shaped) {
+        cache.stats.paragraph_hits++;
+        pango_attr_list_unref(attributes_list);
+
+        para->pango_items.reserve(para->shaped->items.size());
+        for (unsigned i = 0 ; i < para->shaped->items.size() ; i++) {
+            PangoItemInfo new_item;
+            new_item.item = pango_item_copy(para->shaped->items[i]);
+            new_item.font = para->shaped->fonts[i];
+            if (new_item.font) {
+                new_item.font->Ref();
+            }
+            para->pango_items.push_back(new_item);
+        }
+        para->char_attributes = para->shaped->char_attributes;
 
-        para->direction =                (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? LEFT_TO_RIGHT : RIGHT_TO_LEFT;
-        PangoDirection pango_direction = (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? PANGO_DIRECTION_LTR : PANGO_DIRECTION_RTL;
+        TRACE(("end para itemize from cache, direction = %d\n", para->direction));
+        return;
+    }
+    cache.stats.paragraph_misses++;
+
+    // Pango Itemize
+    GList *pango_items_glist = nullptr;
+    if (has_base_direction) {
+        PangoDirection pango_direction = para->direction == LEFT_TO_RIGHT ? PANGO_DIRECTION_LTR : PANGO_DIRECTION_RTL;
         pango_items_glist = pango_itemize_with_base_dir(_pango_context, pango_direction, para->text.data(), 0, para->text.bytes(), attributes_list, nullptr);
     }
 
@@ -1438,6 +1574,17 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
     // This breaks Inkscape's multiline text (i.e. sodipodi:role line).
     para->char_attributes[para->text.length()].is_mandatory_break = 0;
 
+    para->shaped = std::make_shared<ShapingCache::Entry>();
+    for (auto const &pango_item : para->pango_items) {
+        para->shaped->items.push_back(pango_item_copy(pango_item.item));
+        para->shaped->fonts.push_back(pango_item.font);
+        if (pango_item.font) {
+            pango_item.font->Ref();
+        }
+    }
+    para->shaped->char_attributes = para->char_attributes;
+    cache.insert(key, para->shaped);
+
     TRACE(("end para itemize, direction = %d\n", para->direction));
 }
 
@@ -1606,133 +1753,142 @@ unsigned Layout::Calculator::_buildSpansForPara(ParagraphInfo *para) const
                 // now we know the length, do some final calculations and add the UnbrokenSpan to the list
                 new_span.font_size = text_source->style->font_size.computed * _flow.getTextLengthMultiplierDue();
                 if (new_span.text_bytes) {
-                    new_span.glyph_string = pango_glyph_string_new();
-                    /* Some assertions intended to help diagnose bug #1277746. */
-                    g_assert( 0 < new_span.text_bytes );
-                    g_assert( span_start_byte_in_source < text_source->text->bytes() );
-                    g_assert( span_start_byte_in_source + new_span.text_bytes <= text_source->text->bytes() );
-                    g_assert( memchr(text_source->text->data() + span_start_byte_in_source, '\0', static_cast<size_t>(new_span.text_bytes))
-                              == nullptr );
-
-                    /* Notes as of 4/29/13.  Pango_shape is not generating English language ligatures, but it is generating
-                    them for Hebrew (and probably other similar languages).  In the case observed 3 unicode characters (a base
-                    and 2 Mark, nonspacings) are merged into two glyphs (the base + first Mn, the 2nd Mn).  All of these map
-                    from glyph to first character of the log_cluster range.  This destroys the 1:1 correspondence between
-                    characters and glyphs.  A big chunk of the conditional code which immediately follows this call
-                    is there to clean up the resulting mess.
-                    */
-
-                    // Assumption: old and new arguments are the same.
-                    auto gold = std::string_view(text_source->text->data() + span_start_byte_in_source, new_span.text_bytes);
-                    auto gnew = std::string_view(para->text.data()         + para_text_index,           new_span.text_bytes);
-                    assert (gold == gnew);
-
-                    // Convert characters to glyphs
-                    pango_shape_full(para->text.data() + para_text_index,
-                                     new_span.text_bytes,
-                                     para->text.data(),
-                                     -1,
-                                     &para->pango_items[pango_item_index].item->analysis,
-                                     new_span.glyph_string);
-
-                    if (para->pango_items[pango_item_index].item->analysis.level & 1) {
-                        // Right to left text (Arabic, Hebrew, etc.)
-
-                        // pango_shape() will reorder glyphs in rtl sections into visual order
-                        // (start offsets in accending order) which messes us up because the svg
-                        // spec requires us to draw glyphs in logical order so let's reverse the
-                        // glyphstring.
-
-                        const unsigned nglyphs = new_span.glyph_string->num_glyphs;
-                        std::vector<PangoGlyphInfo> infos(nglyphs);
-                        std::vector<gint>           clusters(nglyphs);
-
-                        for (int i = 0; i < nglyphs; ++i) {
-                            std::copy(&new_span.glyph_string->glyphs[i],       &new_span.glyph_string->glyphs[i+1],       infos.end() - i - 1);
-                            std::copy(&new_span.glyph_string->log_clusters[i], &new_span.glyph_string->log_clusters[i+1], clusters.end() - i - 1);
-                        }
+                    PangoGlyphString *&shaped_glyphs = para->shaped->glyphs[{para_text_index, new_span.text_bytes}];
+                    if (shaped_glyphs) {
+                        ShapingCache::get().stats.span_hits++;
+                        new_span.glyph_string = pango_glyph_string_copy(shaped_glyphs);
+                    } else {
+                        ShapingCache::get().stats.span_misses++;
+                        new_span.glyph_string = pango_glyph_string_new();
+                        /* Some assertions intended to help diagnose bug #1277746. */
+                        g_assert( 0 < new_span.text_bytes );
+                        g_assert( span_start_byte_in_source < text_source->text->bytes() );
+                        g_assert( span_start_byte_in_source + new_span.text_bytes <= text_source->text->bytes() );
+                        g_assert( memchr(text_source->text->data() + span_start_byte_in_source, '\0', static_cast<size_t>(new_span.text_bytes))
+                                  == nullptr );
+
+                        /* Notes as of 4/29/13.  Pango_shape is not generating English language ligatures, but it is generating
+                        them for Hebrew (and probably other similar languages).  In the case observed 3 unicode characters (a base
+                        and 2 Mark, nonspacings) are merged into two glyphs (the base + first Mn, the 2nd Mn).  All of these map
+                        from glyph to first character of the log_cluster range.  This destroys the 1:1 correspondence between
+                        characters and glyphs.  A big chunk of the conditional code which immediately follows this call
+                        is there to clean up the resulting mess.
+                        */
 
-                        std::copy(infos.begin(), infos.end(), new_span.glyph_string->glyphs);
-                        std::copy(clusters.begin(), clusters.end(), new_span.glyph_string->log_clusters);
+                        // Assumption: old and new arguments are the same.
+                        auto gold = std::string_view(text_source->text->data() + span_start_byte_in_source, new_span.text_bytes);
+                        auto gnew = std::string_view(para->text.data()         + para_text_index,           new_span.text_bytes);
+                        assert (gold == gnew);
+
+                        // Convert characters to glyphs
+                        pango_shape_full(para->text.data() + para_text_index,
+                                         new_span.text_bytes,
+                                         para->text.data(),
+                                         -1,
+                                         &para->pango_items[pango_item_index].item->analysis,
+                                         new_span.glyph_string);
+
+                        if (para->pango_items[pango_item_index].item->analysis.level & 1) {
+                            // Right to left text (Arabic, Hebrew, etc.)
+
+                            // pango_shape() will reorder glyphs in rtl sections into visual order
+                            // (start offsets in accending order) which messes us up because the svg
+                            // spec requires us to draw glyphs in logical order so let's reverse the
+                            // glyphstring.
+
+                            const unsigned nglyphs = new_span.glyph_string->num_glyphs;
+                            std::vector<PangoGlyphInfo> infos(nglyphs);
+                            std::vector<gint>           clusters(nglyphs);
+
+                            for (int i = 0; i < nglyphs; ++i) {
+                                std::copy(&new_span.glyph_string->glyphs[i],       &new_span.glyph_string->glyphs[i+1],       infos.end() - i - 1);
+                                std::copy(&new_span.glyph_string->log_clusters[i], &new_span.glyph_string->log_clusters[i+1], clusters.end() - i - 1);
+                            }
 
-                        // We've messed up the flag that tells a glyph it is first in a cluster.
-                        for (int i = 0; i < nglyphs; ++i) {
+                            std::copy(infos.begin(), infos.end(), new_span.glyph_string->glyphs);
+                            std::copy(clusters.begin(), clusters.end(), new_span.glyph_string->log_clusters);
 
-                            // Set flag for start of cluster, we skip all other glyphs in cluster below.
-                            new_span.glyph_string->glyphs[i].attr.is_cluster_start = 1;
+                            // We've messed up the flag that tells a glyph it is first in a cluster.
+                            for (int i = 0; i < nglyphs; ++i) {
 
-                            // Find index of first glyph in next cluster
-                            int j = i + 1;
-                            while( (j < nglyphs) &&
-                                   (new_span.glyph_string->log_clusters[j] == new_span.glyph_string->log_clusters[i])
-                                ) {
-                                new_span.glyph_string->glyphs[j].attr.is_cluster_start = 0; // Zero
-                                j++;
+                                // Set flag for start of cluster, we skip all other glyphs in cluster below.
+                                new_span.glyph_string->glyphs[i].attr.is_cluster_start = 1;
+
+                                // Find index of first glyph in next cluster
+                                int j = i + 1;
+                                while( (j < nglyphs) &&
+                                       (new_span.glyph_string->log_clusters[j] == new_span.glyph_string->log_clusters[i])
+                                    ) {
+                                    new_span.glyph_string->glyphs[j].attr.is_cluster_start = 0; // Zero
+                                    j++;
+                                }
+
+                                // Move on to next cluster.
+                                i = j;
                             }
 
-                            // Move on to next cluster.
-                            i = j;
-                        }
+                        } // End right to left text.
+
+                        //  The following sorting doesn't seem to be necessary, and causes
+                        //  https://gitlab.com/inkscape/inkscape/-/issues/394 ...
+
+                        /*
+                            CAREFUL, within a log_cluster the order of glyphs may not map 1:1, or
+                            even in the same order, to the original unicode characters!!!  Among
+                            other things, diacritical mark glyphs can end up sequentially in front of the base
+                            character glyph.  That makes determining kerning, even approximately, difficult
+                            later on.
+
+                            To resolve this to the extent possible sort the glyphs within the same
+                            log_cluster into descending order by width in a special manner before copying.  Diacritical marks
+                            and similar have zero width and the glyph they modify has nonzero width.  The order
+                            of the zero width ones does not matter.  A logical cluster is sorted into sequential order
+                               [base] [zw_modifier1] [zw_modifier2]
+                            where all the modifiers have zero width and the base does not. This works for languages like Hebrew.
+
+                            Pango also creates log clusters for languages like Telugu having many glyphs with nonzero widths.
+                            Since these are nonzero, their order is not modified.
+
+                            If some language mixes these modes, having a log cluster having something like
+                               [base1] [zw_modifier1] [base2] [zw_modifier2]
+                            the result will be incorrect:
+                               base1] [base2] [zw_modifier1] [zw_modifier2]
+
+                               If ligatures other than with Mark, nonspacing are ever implemented in Pango this will screw up, for instance
+                            changing "fi" to "if".
+                        */
+
+                        // If it is necessary to move zero width glyphs.. then it applies to both right-to-left and left-to-right text.
+                        // const unsigned nglyphs = new_span.glyph_string->num_glyphs;
+                        // for (int i = 0; i < nglyphs; ++i) {
 
-                    } // End right to left text.
-
-                    //  The following sorting doesn't seem to be necessary, and causes
-                    //  https://gitlab.com/inkscape/inkscape/-/issues/394 ...
-
-                    /*
-                        CAREFUL, within a log_cluster the order of glyphs may not map 1:1, or
-                        even in the same order, to the original unicode characters!!!  Among
-                        other things, diacritical mark glyphs can end up sequentially in front of the base
-                        character glyph.  That makes determining kerning, even approximately, difficult
-                        later on.
-
-                        To resolve this to the extent possible sort the glyphs within the same
-                        log_cluster into descending order by width in a special manner before copying.  Diacritical marks
-                        and similar have zero width and the glyph they modify has nonzero width.  The order
-                        of the zero width ones does not matter.  A logical cluster is sorted into sequential order
-                           [base] [zw_modifier1] [zw_modifier2]
-                        where all the modifiers have zero width and the base does not. This works for languages like Hebrew.
-
-                        Pango also creates log clusters for languages like Telugu having many glyphs with nonzero widths.
-                        Since these are nonzero, their order is not modified.
-
-                        If some language mixes these modes, having a log cluster having something like
-                           [base1] [zw_modifier1] [base2] [zw_modifier2]
-                        the result will be incorrect:
-                           base1] [base2] [zw_modifier1] [zw_modifier2]
-
-                           If ligatures other than with Mark, nonspacing are ever implemented in Pango this will screw up, for instance
-                        changing "fi" to "if".
-                    */
-
-                    // If it is necessary to move zero width glyphs.. then it applies to both right-to-left and left-to-right text.
-                    // const unsigned nglyphs = new_span.glyph_string->num_glyphs;
-                    // for (int i = 0; i < nglyphs; ++i) {
-
-                    //     // Zero flag for start of cluster, we zero the rest below, and then reset it after sorting.
-                    //     new_span.glyph_string->glyphs[i].attr.is_cluster_start = 0;
-
-                    //     // Find index of first glyph in next cluster
-                    //     int j = i + 1;
-                    //     while( (j < nglyphs) &&
-                    //            (new_span.glyph_string->log_clusters[j] == new_span.glyph_string->log_clusters[i])
-                    //         ) {
-                    //         new_span.glyph_string->glyphs[j].attr.is_cluster_start = 0; // Zero
-                    //         j++;
-                    //     }
-
-                    //     if (j - i) {
-                    //         // More than one glyph in cluster -> sort.
-                    //         std::sort(&(new_span.glyph_string->glyphs[i]), &(new_span.glyph_string->glyphs[j]), compareGlyphWidth);
-                    //     }
-
-                    //     // Now we're sorted, set flag for start of cluster.
-                    //     new_span.glyph_string->glyphs[i].attr.is_cluster_start = 1;
-
-                    //     // Move on to next cluster.
-                    //     i = j;
-                    // }
-                    /* glyphs[].x_offset values are probably out of order within any log_clusters, apparently harmless */
+                        //     // Zero flag for start of cluster, we zero the rest below, and then reset it after sorting.
+                        //     new_span.glyph_string->glyphs[i].attr.is_cluster_start = 0;
+
+                        //     // Find index of first glyph in next cluster
+                        //     int j = i + 1;
+                        //     while( (j < nglyphs) &&
+                        //            (new_span.glyph_string->log_clusters[j] == new_span.glyph_string->log_clusters[i])
+                        //         ) {
+                        //         new_span.glyph_string->glyphs[j].attr.is_cluster_start = 0; // Zero
+                        //         j++;
+                        //     }
+
+                        //     if (j - i) {
+                        //         // More than one glyph in cluster -> sort.
+                        //         std::sort(&(new_span.glyph_string->glyphs[i]), &(new_span.glyph_string->glyphs[j]), compareGlyphWidth);
+                        //     }
+
+                        //     // Now we're sorted, set flag for start of cluster.
+                        //     new_span.glyph_string->glyphs[i].attr.is_cluster_start = 1;
+
+                        //     // Move on to next cluster.
+                        //     i = j;
+                        // }
+                        /* glyphs[].x_offset values are probably out of order within any log_clusters, apparently harmless */
+
+                        shaped_glyphs = pango_glyph_string_copy(new_span.glyph_string);
+                    }
 
 
                     new_span.pango_item_index = pango_item_index;
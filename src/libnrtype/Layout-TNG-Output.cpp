@@ -263,7 +263,7 @@ Geom::Affine glyph_matrix;
         for (unsigned glyph_index = 0 ; glyph_index < _glyphs.size() ; glyph_index++) {
             if (_characters[_glyphs[glyph_index].in_character].in_glyph == -1)continue; //invisible glyphs
             Span const &span = _spans[_characters[_glyphs[glyph_index].in_character].in_span];
-            Geom::PathVector const * pv = span.font->PathVector(_glyphs[glyph_index].glyph);
+            auto pv = span.font->PathVector(_glyphs[glyph_index].glyph);
             InputStreamTextSource const *text_source = static_cast<InputStreamTextSource const *>(_input_stream[span.in_input_stream_item]);
             if (pv) {
                 _getGlyphTransformMatrix(glyph_index, &glyph_matrix);
@@ -441,7 +441,7 @@ void Layout::showGlyphs(CairoRenderContext *ctx) const
         Geom::Affine glyph_matrix;
         _getGlyphTransformMatrix(glyph_index, &glyph_matrix);
         if (clip_mode) {
-            Geom::PathVector const *pathv = span.font->PathVector(_glyphs[glyph_index].glyph);
+            auto pathv = span.font->PathVector(_glyphs[glyph_index].glyph);
             if (pathv) {
                 Geom::PathVector pathv_trans = (*pathv) * glyph_matrix;
                 SPStyle const *style = text_source->style;
@@ -826,7 +826,7 @@ std::unique_ptr<SPCurve> Layout::convertToCurves(iterator const &from_glyph, ite
         Span const &span = _glyphs[glyph_index].span(this);
         _getGlyphTransformMatrix(glyph_index, &glyph_matrix);
 
-        Geom::PathVector const * pathv = span.font->PathVector(_glyphs[glyph_index].glyph);
+        auto pathv = span.font->PathVector(_glyphs[glyph_index].glyph);
         if (pathv) {
             Geom::PathVector pathv_trans = (*pathv) * glyph_matrix;
             curve->append(SPCurve(std::move(pathv_trans)));
@@ -349,6 +349,22 @@ public:
     */
     bool calculateFlow();
 
+    /** How often calculateFlow() found the itemization of a paragraph, and
+    the glyphs of a span, in the cache of shaping results shared by all
+    layouts, and how often it had to call Pango instead. */
+    struct ShapingCacheStats {
+        unsigned long paragraph_hits = 0;
+        unsigned long paragraph_misses = 0;
+        unsigned long span_hits = 0;
+        unsigned long span_misses = 0;
+    };
+
+    /** Returns the counters of the shaping cache. */
+    static ShapingCacheStats const &shapingCacheStats();
+
+    /** Empties the shaping cache, for when the available fonts change. */
+    static void clearShapingCache();
+
     //@}
 
     // ************************** operating on the output glyphs *************************
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Catalog of the installed font families and their styles, kept on disk between sessions
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "libnrtype/font-catalog.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+namespace {
+
+/*
+ * The file is a list of lines:
+ *
+ *   inkscape-font-catalog 1
+ *   <stamp>
+ *   f <family>                    a family whose styles are not known
+ *   F <family>                    a family whose styles follow
+ *   s <CSS name> <display name>   a style of the last family
+ *
+ * with the fields separated by tabs. Change the first line whenever the format or the way
+ * font_factory names families and styles changes, so that older catalogs are rebuilt.
+ */
+char const *const HEADER = "inkscape-font-catalog 1";
+
+/// Escapes tabs, line breaks and backslashes, but leaves UTF-8 alone.
+std::string escape(Glib::ustring const &text)
+{
+    static std::string const non_ascii = []() {
+        std::string bytes;
+        for (int c = 0x80; c <= 0xff; c++) {
+            bytes += char(c);
+        }
+        return bytes;
+    }();
+    gchar *escaped = g_strescape(text.c_str(), non_ascii.c_str());
+    std::string result = escaped;
+    g_free(escaped);
+    return result;
+}
+
+Glib::ustring unescape(std::string const &text)
+{
+    gchar *unescaped = g_strcompress(text.c_str());
+    Glib::ustring result = unescaped;
+    g_free(unescaped);
+    return result;
+}
+
+std::vector<std::string> split(std::string const &line)
+{
+    std::vector<std::string> fields;
+    std::string::size_type start = 0;
+    while (true) {
+        auto end = line.find('\t', start);
+        fields.emplace_back(line, start, end == std::string::npos ? end : end - start);
+        if (end == std::string::npos) {
+            return fields;
+        }
+        start = end + 1;
+    }
+}
+
+} // namespace
+
+void FontCatalog::reset(std::string stamp, std::vector<Glib::ustring> families)
+{
+    _stamp = std::move(stamp);
+    _families = std::move(families);
+    _styles.clear();
+}
+
+bool FontCatalog::load(std::string const &filename, std::string const &stamp)
+{
+    reset("", {});
+
+    gchar *contents = nullptr;
+    gsize length = 0;
+    if (!g_file_get_contents(filename.c_str(), &contents, &length, nullptr)) {
+        return false;
+    }
+    std::string text(contents, length);
+    g_free(contents);
+
+    std::vector<Glib::ustring> families;
+    std::unordered_map<std::string, std::vector<StyleNames>> styles;
+    std::vector<StyleNames> *current = nullptr;
+
+    std::string::size_type start = 0;
+    int line_number = 0;
+    while (start < text.size()) {
+        auto end = text.find('\n', start);
+        if (end == std::string::npos) {
+            // truncated
+            return false;
+        }
+        std::string line(text, start, end - start);
+        start = end + 1;
+
+        switch (line_number++) {
+            case 0:
+                if (line != HEADER) {
+                    return false;
+                }
+                continue;
+            case 1:
+                if (line != stamp) {
+                    return false;
+                }
+                continue;
+        }
+
+        auto fields = split(line);
+        if (fields.size() == 2 && (fields[0] == "f" || fields[0] == "F")) {
+            families.emplace_back(unescape(fields[1]));
+            current = fields[0] == "F" ? &styles[families.back().raw()] : nullptr;
+        } else if (fields.size() == 3 && fields[0] == "s" && current) {
+            current->emplace_back(unescape(fields[1]), unescape(fields[2]));
+        } else {
+            g_warning("Ignoring broken font catalog '%s'.", filename.c_str());
+            return false;
+        }
+    }
+    if (line_number < 2) {
+        return false;
+    }
+
+    _stamp = stamp;
+    _families = std::move(families);
+    _styles = std::move(styles);
+    return true;
+}
+
+bool FontCatalog::save(std::string const &filename) const
+{
+    std::string text = HEADER;
+    text += '\n';
+    text += _stamp;
+    text += '\n';
+    for (auto const &family : _families) {
+        auto styles = this->styles(family);
+        text += styles ? "F\t" : "f\t";
+        text += escape(family);
+        text += '\n';
+        if (styles) {
+            for (auto const &style : *styles) {
+                text += "s\t";
+                text += escape(style.CssName);
+                text += '\t';
+                text += escape(style.DisplayName);
+                text += '\n';
+            }
+        }
+    }
+
+    gchar *dir = g_path_get_dirname(filename.c_str());
+    g_mkdir_with_parents(dir, 0755);
+    g_free(dir);
+
+    // written to a temporary file and renamed, so that other instances never see half a catalog
+    return g_file_set_contents(filename.c_str(), text.data(), text.size(), nullptr);
+}
+
+std::vector<StyleNames> const *FontCatalog::styles(Glib::ustring const &family) const
+{
+    auto it = _styles.find(family.raw());
+    return it == _styles.end() ? nullptr : &it->second;
+}
+
+void FontCatalog::setStyles(Glib::ustring const &family, std::vector<StyleNames> styles)
+{
+    _styles[family.raw()] = std::move(styles);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
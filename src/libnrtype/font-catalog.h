@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Catalog of the installed font families and their styles, kept on disk between sessions
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef INKSCAPE_LIBNRTYPE_FONT_CATALOG_H
+#define INKSCAPE_LIBNRTYPE_FONT_CATALOG_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glibmm/ustring.h>
+
+#include "libnrtype/FontFactory.h"
+
+/**
+ * The font families Pango lists, sorted as font_factory::GetUIFamilies() sorts them, and the
+ * styles of those families that have been asked for.
+ *
+ * Listing the families and their faces makes fontconfig go through every installed font, which
+ * takes seconds on systems with thousands of fonts. The catalog is written to the cache
+ * directory together with a stamp of the font configuration, and read back as long as the stamp
+ * is the same, so that Pango only has to list the fonts when they have changed.
+ */
+class FontCatalog
+{
+public:
+    /// Starts a catalog for the given stamp with the given families, none of whose styles are known.
+    void reset(std::string stamp, std::vector<Glib::ustring> families);
+
+    /**
+     * Reads a catalog written by save().
+     * @return false, leaving the catalog empty, if the file cannot be read or was written for
+     *         another stamp.
+     */
+    bool load(std::string const &filename, std::string const &stamp);
+
+    /// Writes the catalog to a file, creating its directory if needed.
+    bool save(std::string const &filename) const;
+
+    std::string const &stamp() const { return _stamp; }
+    std::vector<Glib::ustring> const &families() const { return _families; }
+
+    /// The styles of a family, or null if they are not known yet or the family is not in the catalog.
+    std::vector<StyleNames> const *styles(Glib::ustring const &family) const;
+    /// Remembers the styles of a family of the catalog.
+    void setStyles(Glib::ustring const &family, std::vector<StyleNames> styles);
+
+private:
+    std::string _stamp;
+    std::vector<Glib::ustring> _families;
+    std::unordered_map<std::string, std::vector<StyleNames>> _styles;
+};
+
+#endif // INKSCAPE_LIBNRTYPE_FONT_CATALOG_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -10,15 +10,17 @@
 #ifndef SEEN_LIBNRTYPE_FONT_GLYPH_H
 #define SEEN_LIBNRTYPE_FONT_GLYPH_H
 
+#include <memory>
 #include <2geom/forward.h>
 
 // the info for a glyph in a font. it's totally resolution- and fontsize-independent
+// once loaded, it is shared by all font_instances of the face and never changes
 struct font_glyph {
-    double         h_advance, h_width; // width != advance because of kerning adjustements
-    double         v_advance, v_width;
-    double         bbox[4];            // bbox of the path (and the artbpath), not the bbox of the glyph
+    double         h_advance = 0, h_width = 0; // width != advance because of kerning adjustements
+    double         v_advance = 0, v_width = 0;
+    double         bbox[4] = {0, 0, 0, 0};     // bbox of the path (and the artbpath), not the bbox of the glyph
 																			 // as the fonts sometimes contain
-    Geom::PathVector* pathvector;      // outline as 2geom pathvector, for text->curve stuff (should be unified with livarot)
+    std::unique_ptr<Geom::PathVector const> pathvector; // outline as 2geom pathvector, for text->curve stuff (should be unified with livarot)
 };
 
 
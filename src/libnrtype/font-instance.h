@@ -10,7 +10,9 @@
 #ifndef SEEN_LIBNRTYPE_FONT_INSTANCE_H
 #define SEEN_LIBNRTYPE_FONT_INSTANCE_H
 
+#include <atomic>
 #include <map>
+#include <memory>
 
 #include <pango/pango-types.h>
 #include <pango/pango-font.h>
@@ -44,13 +46,6 @@ public:
     // font_factory owning this font_instance
     font_factory*         parent = nullptr;
 
-    // common glyph definitions for all the rasterfonts
-    std::map<int, int>    id_to_no;
-    int                   nbGlyph = 0;
-    int                   maxGlyph = 0;
-
-    font_glyph*           glyphs = nullptr;
-
     // font is loaded with GSUB in 2 pass
     bool    fulloaded = false;
 
@@ -79,14 +74,16 @@ public:
     void                 InitTheFace(bool loadgsub = false);
 
     int                  MapUnicodeChar(gunichar c); // calls the relevant unicode->glyph index function
-    void                 LoadGlyph(int glyph_id);    // the main backend-dependent function
-    // loads the given glyph's info
+    std::shared_ptr<font_glyph const> LoadGlyph(int glyph_id); // the main backend-dependent function
+    // loads the given glyph's info, or finds it in the glyph cache shared by all font_instances
+    // of the face; safe to call from several threads. returns nullptr if the glyph can't be loaded
 
     // nota: all coordinates returned by these functions are on a [0..1] scale; you need to multiply
     // by the fontsize to get the real sizes
 
-    // Return 2geom pathvector for glyph. Deallocated when font instance dies.
-    Geom::PathVector*    PathVector(int glyph_id);
+    // Return 2geom pathvector for glyph. The glyph cache may drop glyphs that have not been used
+    // for a while, so hold on to the pointer rather than to the pathvector.
+    std::shared_ptr<Geom::PathVector const> PathVector(int glyph_id);
 
     // Return font has SVG OpenType enties.
     bool                 FontHasSVG() { return fontHasSVG; };
@@ -117,6 +114,8 @@ private:
     void                 FreeTheFace();
     // Find ascent, descent, x-height, and baselines.
     void                 FindFontMetrics();
+    // Identify the face in the glyph cache: the file of the loaded font, with its variations.
+    std::string          GlyphCacheFaceKey();
 
     // Temp: make public
 public:
@@ -139,6 +138,9 @@ private:
 
     // Baselines
     double _baselines[SP_CSS_BASELINE_SIZE];
+
+    // Id of the face in the glyph cache, -1 until the first glyph is loaded
+    std::atomic<int> _glyph_cache_face{-1};
 };
 
 
@@ -49,9 +49,8 @@ bool familyNamesAreEqual(const Glib::ustring &a, const Glib::ustring &b)
     return (a.casefold().compare(b.casefold()) == 0);
 }
 
-static const char* sp_font_family_get_name(PangoFontFamily* family)
+static const char* sp_font_family_get_name(const char* name)
 {
-    const char* name = pango_font_family_get_name(family);
     if (strncmp(name, "Sans", 4) == 0 && strlen(name) == 4)
         return "sans-serif";
     if (strncmp(name, "Serif", 5) == 0 && strlen(name) == 5)
@@ -78,13 +77,12 @@ FontLister::FontLister()
     default_styles = g_list_append(default_styles, new StyleNames("Bold"));
     default_styles = g_list_append(default_styles, new StyleNames("Bold Italic"));
 
-    // Get sorted font families from Pango
-    std::vector<PangoFontFamily *> familyVector;
-    font_factory::Default()->GetUIFamilies(familyVector);
+    // Get sorted font families, from the font catalog unless the installed fonts have changed
+    auto const &familyVector = font_factory::Default()->GetUIFamilyNames();
 
     // Traverse through the family names and set up the list store
     for (auto & i : familyVector) {
-        const char* displayName = sp_font_family_get_name(i);
+        const char* displayName = sp_font_family_get_name(i.c_str());
         
         if (displayName == nullptr || *displayName == '\0') {
             continue;
@@ -98,7 +96,7 @@ FontLister::FontLister()
             // we don't set this now (too slow) but the style will be cached if the user 
             // ever decides to use this font
             (*treeModelIter)[FontList.styles] = NULL;
-            // store the pango representation for generating the style
+            // store the pango name for generating the style
             (*treeModelIter)[FontList.pango_family] = i;
             (*treeModelIter)[FontList.onSystem] = true;
         }
@@ -150,7 +148,7 @@ void FontLister::ensureRowStyles(Glib::RefPtr<Gtk::TreeModel> model, Gtk::TreeMo
 {
     Gtk::TreeModel::Row row = *iter;
     if (!row[FontList.styles]) {
-        if (row[FontList.pango_family]) {
+        if (row[FontList.onSystem]) {
             row[FontList.styles] = font_factory::Default()->GetUIStyles(row[FontList.pango_family]);
         } else {
             row[FontList.styles] = default_styles;
@@ -263,7 +261,7 @@ void FontLister::insert_font_family(Glib::ustring new_family)
     (*treeModelIter)[FontList.family] = new_family;
     (*treeModelIter)[FontList.styles] = styles;
     (*treeModelIter)[FontList.onSystem] = false;
-    (*treeModelIter)[FontList.pango_family] = NULL;
+    (*treeModelIter)[FontList.pango_family] = "";
 
     current_family = new_family;
     current_family_row = 0;
@@ -363,7 +361,7 @@ void FontLister::update_font_list(SPDocument *document)
         (*treeModelIter)[FontList.family] = reinterpret_cast<const char *>(g_strdup((i.first).c_str()));
         (*treeModelIter)[FontList.styles] = styles;
         (*treeModelIter)[FontList.onSystem] = false;    // false if document font
-        (*treeModelIter)[FontList.pango_family] = NULL; // CHECK ME (set to pango_family if on system?)
+        (*treeModelIter)[FontList.pango_family] = ""; // CHECK ME (set to pango_family if on system?)
 
     }
 
@@ -102,11 +102,11 @@ public:
         /**
          * Not actually a column.
          * Necessary for quick initialization of FontLister,
-         * we initially store the pango family and if the
-         * font style is actually used we'll cache it in
-         * %styles.
+         * we initially store the name Pango gives the family
+         * and if the font style is actually used we'll cache
+         * it in %styles.
          */
-        Gtk::TreeModelColumn<PangoFontFamily *> pango_family;
+        Gtk::TreeModelColumn<Glib::ustring> pango_family;
         
         FontListClass()
         {
@@ -12,6 +12,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
 #include <glib.h>
 #include "Shape.h"
 #include "livarot/sweep-event-queue.h"
@@ -57,6 +58,133 @@ Shape::~Shape ()
   maxPt = 0;
   maxAr = 0;
   free(qrsData);
+  if (Scratch *s = scratch()) {
+      s->give(_pts);
+      s->give(_aretes);
+      s->give(pData);
+  }
+}
+
+/**
+ * Memory of the temporary arrays of finished sweeps and of the point and edge arrays of deleted
+ * shapes, kept for the next ones on the same thread. Only the largest array of each kind is kept.
+ */
+struct Shape::Scratch
+{
+    int scopes = 0;
+    std::vector<edge_data> eData;
+    std::vector<sweep_src_data> swsData;
+    std::vector<sweep_dest_data> swdData;
+    std::vector<raster_data> swrData;
+    std::vector<dg_point> pts;
+    std::vector<dg_arete> aretes;
+    std::vector<point_data> pData;
+    std::unique_ptr<SweepTreeList> sTree;
+    std::unique_ptr<SweepEventQueue> sEvts;
+
+    std::vector<edge_data> &spare(std::vector<edge_data> const &) { return eData; }
+    std::vector<sweep_src_data> &spare(std::vector<sweep_src_data> const &) { return swsData; }
+    std::vector<sweep_dest_data> &spare(std::vector<sweep_dest_data> const &) { return swdData; }
+    std::vector<raster_data> &spare(std::vector<raster_data> const &) { return swrData; }
+    std::vector<dg_point> &spare(std::vector<dg_point> const &) { return pts; }
+    std::vector<dg_arete> &spare(std::vector<dg_arete> const &) { return aretes; }
+    std::vector<point_data> &spare(std::vector<point_data> const &) { return pData; }
+
+    /// Gives the kept memory to data, which is empty, if it is larger than what data has.
+    template <typename T>
+    void take(std::vector<T> &data)
+    {
+        auto &kept = spare(data);
+        if (data.empty() && kept.capacity() > data.capacity()) {
+            data.swap(kept);
+        }
+    }
+
+    /// Keeps the memory of data, which is then cleared, if it is larger than what is kept.
+    template <typename T>
+    void give(std::vector<T> &data)
+    {
+        auto &kept = spare(data);
+        if (data.capacity() > kept.capacity()) {
+            data.swap(kept);
+            kept.clear();
+        }
+        data.clear();
+    }
+
+    void clear()
+    {
+        eData = {};
+        swsData = {};
+        swdData = {};
+        swrData = {};
+        pts = {};
+        aretes = {};
+        pData = {};
+        sTree.reset();
+        sEvts.reset();
+    }
+};
+
+thread_local Shape::Scratch Shape::_scratch;
+
+Shape::Scratch *Shape::scratch()
+{
+    return _scratch.scopes > 0 ? &_scratch : nullptr;
+}
+
+Shape::ScratchScope::ScratchScope()
+{
+    ++_scratch.scopes;
+}
+
+Shape::ScratchScope::~ScratchScope()
+{
+    if (--_scratch.scopes == 0) {
+        _scratch.clear();
+    }
+}
+
+/**
+ * Allocates the sweepline and event queue of a sweep over size edges, reusing the ones of an
+ * earlier sweep if they are large enough.
+ */
+void Shape::MakeSweepStructures(int size)
+{
+    Scratch *s = scratch();
+    if (sTree == nullptr) {
+        if (s && s->sTree && s->sTree->maxTree >= size) {
+            sTree = s->sTree.release();
+            sTree->clear();
+        } else {
+            sTree = new SweepTreeList(size);
+        }
+    }
+    if (sEvts == nullptr) {
+        if (s && s->sEvts && s->sEvts->capacity() >= size) {
+            sEvts = s->sEvts.release();
+            sEvts->clear();
+        } else {
+            sEvts = new SweepEventQueue(size);
+        }
+    }
+}
+
+void Shape::FreeSweepStructures()
+{
+    Scratch *s = scratch();
+    if (s && sTree && (!s->sTree || sTree->maxTree > s->sTree->maxTree)) {
+        s->sTree.reset(sTree);
+    } else {
+        delete sTree;
+    }
+    sTree = nullptr;
+    if (s && sEvts && (!s->sEvts || sEvts->capacity() > s->sEvts->capacity())) {
+        s->sEvts.reset(sEvts);
+    } else {
+        delete sEvts;
+    }
+    sEvts = nullptr;
 }
 
 void Shape::Affiche()
@@ -84,6 +212,9 @@ Shape::MakePointData (bool nVal)
           _has_points_data = true;
           _point_data_initialised = false;
           _bbox_up_to_date = false;
+          if (Scratch *s = scratch()) {
+              s->take(pData);
+          }
           pData.resize(maxPt);
         }
     }
@@ -98,6 +229,9 @@ Shape::MakeEdgeData (bool nVal)
       if (_has_edges_data == false)
         {
           _has_edges_data = true;
+          if (Scratch *s = scratch()) {
+              s->take(eData);
+          }
           eData.resize(maxAr);
         }
     }
@@ -106,7 +240,11 @@ Shape::MakeEdgeData (bool nVal)
       if (_has_edges_data)
         {
           _has_edges_data = false;
-          eData.clear();
+          if (Scratch *s = scratch()) {
+              s->give(eData);
+          } else {
+              eData.clear();
+          }
         }
     }
 }
@@ -119,6 +257,9 @@ Shape::MakeRasterData (bool nVal)
       if (_has_raster_data == false)
         {
           _has_raster_data = true;
+          if (Scratch *s = scratch()) {
+              s->take(swrData);
+          }
           swrData.resize(maxAr);
         }
     }
@@ -127,7 +268,11 @@ Shape::MakeRasterData (bool nVal)
       if (_has_raster_data)
         {
           _has_raster_data = false;
-          swrData.clear();
+          if (Scratch *s = scratch()) {
+              s->give(swrData);
+          } else {
+              swrData.clear();
+          }
         }
     }
 }
@@ -163,6 +308,9 @@ Shape::MakeSweepSrcData (bool nVal)
       if (_has_sweep_src_data == false)
         {
           _has_sweep_src_data = true;
+          if (Scratch *s = scratch()) {
+              s->take(swsData);
+          }
           swsData.resize(maxAr);
         }
     }
@@ -171,7 +319,11 @@ Shape::MakeSweepSrcData (bool nVal)
       if (_has_sweep_src_data)
         {
           _has_sweep_src_data = false;
-          swsData.clear();
+          if (Scratch *s = scratch()) {
+              s->give(swsData);
+          } else {
+              swsData.clear();
+          }
         }
     }
 }
@@ -183,6 +335,9 @@ Shape::MakeSweepDestData (bool nVal)
       if (_has_sweep_dest_data == false)
         {
           _has_sweep_dest_data = true;
+          if (Scratch *s = scratch()) {
+              s->take(swdData);
+          }
           swdData.resize(maxAr);
         }
     }
@@ -191,7 +346,11 @@ Shape::MakeSweepDestData (bool nVal)
       if (_has_sweep_dest_data)
         {
           _has_sweep_dest_data = false;
-          swdData.clear();
+          if (Scratch *s = scratch()) {
+              s->give(swdData);
+          } else {
+              swdData.clear();
+          }
         }
     }
 }
@@ -259,10 +418,7 @@ Shape::Copy (Shape * who)
   MakeQuickRasterData (false);
   MakeBackData (false);
 
-  delete sTree;
-  sTree = nullptr;
-  delete sEvts;
-  sEvts = nullptr;
+  FreeSweepStructures();
 
   Reset (who->numberOfPoints(), who->numberOfEdges());
   type = who->type;
@@ -291,6 +447,10 @@ Shape::Reset (int pointCount, int edgeCount)
 {
   _pts.clear();
   _aretes.clear();
+  if (Scratch *s = scratch()) {
+      s->take(_pts);
+      s->take(_aretes);
+  }
   
   type = shape_polygon;
   if (pointCount > maxPt)
@@ -118,6 +118,22 @@ public:
     Shape();
     virtual ~Shape();
 
+    /**
+     * While a ScratchScope lives, the sweeps and rasterizations of its thread hand the memory
+     * of their temporary arrays, sweepline and event queue to the next ones instead of freeing
+     * it, and deleted shapes hand over their point and edge arrays, so that a series of
+     * ConvertToShape(), Booleen() or MakeOffset() calls allocates them only once. The memory is
+     * freed when the outermost ScratchScope of the thread goes away.
+     */
+    class ScratchScope
+    {
+    public:
+        ScratchScope();
+        ~ScratchScope();
+        ScratchScope(ScratchScope const &) = delete;
+        ScratchScope &operator=(ScratchScope const &) = delete;
+    };
+
     void MakeBackData(bool nVal);
     void MakeVoronoiData(bool nVal);
 
@@ -469,6 +485,14 @@ private:
     void MakeSweepDestData(bool nVal);
     void MakeRasterData(bool nVal);
     void MakeQuickRasterData(bool nVal);
+    // the sweepline and event queue, taken from the scratch of the thread if there is one
+    void MakeSweepStructures(int size);
+    void FreeSweepStructures();
+
+    struct Scratch;
+    static thread_local Scratch _scratch;
+    /// The scratch of the thread, if a ScratchScope is open on it
+    static Scratch *scratch();
 
     void SortPoints(int s, int e);
     void SortPointsByOldInd(int s, int e);
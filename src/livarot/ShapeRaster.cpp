@@ -43,12 +43,7 @@ void Shape::BeginRaster(float &pos, int &curPt)
     MakePointData(true);
     MakeEdgeData(true);
 
-    if (sTree == nullptr) {
-        sTree = new SweepTreeList(numberOfEdges());
-    }
-    if (sEvts == nullptr) {
-        sEvts = new SweepEventQueue(numberOfEdges());
-    }
+    MakeSweepStructures(numberOfEdges());
 
     SortPoints();
 
@@ -72,10 +67,7 @@ void Shape::BeginRaster(float &pos, int &curPt)
 
 void Shape::EndRaster()
 {
-    delete sTree;
-    sTree = nullptr;
-    delete sEvts;
-    sEvts = nullptr;
+    FreeSweepStructures();
     
     MakePointData(false);
     MakeEdgeData(false);
@@ -183,12 +183,7 @@ Shape::ConvertToShape (Shape * a, FillRule directed, bool invert)
   
     a->ResetSweep();
 
-    if (sTree == nullptr) {
-	sTree = new SweepTreeList(a->numberOfEdges());
-    }
-    if (sEvts == nullptr) {
-	sEvts = new SweepEventQueue(a->numberOfEdges());
-    }
+    MakeSweepStructures(a->numberOfEdges());
   
     MakePointData(true);
     MakeEdgeData(true);
@@ -821,10 +816,7 @@ Shape::ConvertToShape (Shape * a, FillRule directed, bool invert)
   
 //      Plot(200.0,200.0,2.0,400.0,400.0,true,true,true,true);
 
-  delete sTree;
-  sTree = nullptr;
-  delete sEvts;
-  sEvts = nullptr;
+  FreeSweepStructures();
 
   MakePointData (false);
   MakeEdgeData (false);
@@ -860,12 +852,7 @@ Shape::Booleen (Shape * a, Shape * b, BooleanOp mod,int cutPathID)
   a->ResetSweep ();
   b->ResetSweep ();
 
-  if (sTree == nullptr) {
-      sTree = new SweepTreeList(a->numberOfEdges() + b->numberOfEdges());
-  }
-  if (sEvts == nullptr) {
-      sEvts = new SweepEventQueue(a->numberOfEdges() + b->numberOfEdges());
-  }
+  MakeSweepStructures(a->numberOfEdges() + b->numberOfEdges());
   
   MakePointData (true);
   MakeEdgeData (true);
@@ -1627,10 +1614,7 @@ Shape::Booleen (Shape * a, Shape * b, BooleanOp mod,int cutPathID)
     }
   }
   
-  delete sTree;
-  sTree = nullptr;
-  delete sEvts;
-  sEvts = nullptr;
+  FreeSweepStructures();
   
   if ( mod == bool_op_cut ) {
     // on garde le askForWinding
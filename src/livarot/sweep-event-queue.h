@@ -28,6 +28,9 @@ public:
     virtual ~SweepEventQueue();
 
     int size() const { return nbEvt; }
+    int capacity() const { return maxEvt; }
+    /// Forget all events, keeping the memory for the next sweep
+    void clear() { nbEvt = 0; }
 
     /// Look for the topmost intersection in the heap
     bool peek(SweepTree * &iLeft, SweepTree * &iRight, Geom::Point &oPt, double &itl, double &itr);
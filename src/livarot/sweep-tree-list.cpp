@@ -7,16 +7,31 @@
  * Copyright (C) 2018 Authors
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <glib.h>
 #include "livarot/sweep-tree.h"
 #include "livarot/sweep-tree-list.h"
 
+static SweepTreeList::Storage storage_from_environment()
+{
+    char const *storage = std::getenv("_INKSCAPE_SWEEPLINE");
+    if (storage && !std::strcmp(storage, "blocks")) {
+        return SweepTreeList::BLOCK_ARRAY;
+    }
+    return SweepTreeList::AVL_TREE;
+}
+
+SweepTreeList::Storage SweepTreeList::defaultStorage = storage_from_environment();
+
 
 SweepTreeList::SweepTreeList(int s) :
     nbTree(0),
     maxTree(s),
     trees((SweepTree *) g_malloc(s * sizeof(SweepTree))),
-    racine(nullptr)
+    racine(nullptr),
+    storage(defaultStorage)
 {
     /* FIXME: Use new[] for trees initializer above, but watch out for bad things happening when
      * SweepTree::~SweepTree is called.
@@ -28,6 +43,12 @@ SweepTreeList::~SweepTreeList()
 {
     g_free(trees);
     trees = nullptr;
+    for (auto block : blocks) {
+        delete block;
+    }
+    for (auto block : spareBlocks) {
+        delete block;
+    }
 }
 
 
@@ -44,6 +65,194 @@ SweepTree *SweepTreeList::add(Shape *iSrc, int iBord, int iWeight, int iStartPoi
 }
 
 
+void SweepTreeList::clear()
+{
+    nbTree = 0;
+    racine = nullptr;
+    storage = defaultStorage;
+    spareBlocks.insert(spareBlocks.end(), blocks.begin(), blocks.end());
+    blocks.clear();
+}
+
+
+/**
+ * Finds where newOne, whose upper endpoint is iPt, goes in the sweepline, like SweepTree::Find
+ * does in the tree: first the block in which it goes by the first node of the blocks, then
+ * the position in that block.
+ */
+int SweepTreeList::find(Geom::Point const &iPt, SweepTree *newOne, SweepTree *&insertL,
+                        SweepTree *&insertR, bool sweepSens)
+{
+    auto found = [&](SweepTree *node) {
+        insertL = node;
+        insertR = static_cast<SweepTree *>(node->elem[RIGHT]);
+        return found_exact;
+    };
+
+    // the first block which starts to the right of iPt
+    size_t lo = 0;
+    size_t hi = blocks.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        SweepTree *node = blocks[mid]->nodes[0];
+        int side = node->Compare(iPt, newOne, sweepSens);
+        if (side == 0) {
+            return found(node);
+        }
+        if (side < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    if (lo == 0) {
+        insertL = nullptr;
+        insertR = racine;
+        return found_on_left;
+    }
+
+    // iPt is right of the first node of the block before it
+    Block *block = blocks[lo - 1];
+    int l = 1;
+    int h = block->size;
+    while (l < h) {
+        int mid = (l + h) / 2;
+        SweepTree *node = block->nodes[mid];
+        int side = node->Compare(iPt, newOne, sweepSens);
+        if (side == 0) {
+            return found(node);
+        }
+        if (side < 0) {
+            h = mid;
+        } else {
+            l = mid + 1;
+        }
+    }
+    insertL = block->nodes[l - 1];
+    insertR = static_cast<SweepTree *>(insertL->elem[RIGHT]);
+    return insertR ? found_between : found_on_right;
+}
+
+
+/// Inserts node right of insertL, or as the leftmost node if insertL is null.
+void SweepTreeList::link(SweepTree *node, SweepTree *insertL)
+{
+    SweepTree *insertR = insertL ? static_cast<SweepTree *>(insertL->elem[RIGHT]) : racine;
+
+    Block *block;
+    int pos;
+    if (insertL) {
+        block = insertL->block;
+        pos = std::find(block->nodes, block->nodes + block->size, insertL) - block->nodes + 1;
+    } else if (!blocks.empty()) {
+        block = blocks.front();
+        pos = 0;
+    } else {
+        block = newBlock();
+        blocks.push_back(block);
+        pos = 0;
+    }
+
+    if (block->size == Block::SIZE) {
+        // move the upper half to a new block
+        Block *upper = newBlock();
+        int const half = Block::SIZE / 2;
+        std::copy(block->nodes + half, block->nodes + Block::SIZE, upper->nodes);
+        upper->size = Block::SIZE - half;
+        block->size = half;
+        for (int i = 0; i < upper->size; i++) {
+            upper->nodes[i]->block = upper;
+        }
+        blocks.insert(std::find(blocks.begin(), blocks.end(), block) + 1, upper);
+        if (pos > half) {
+            block = upper;
+            pos -= half;
+        }
+    }
+
+    std::copy_backward(block->nodes + pos, block->nodes + block->size, block->nodes + block->size + 1);
+    block->nodes[pos] = node;
+    block->size++;
+    node->block = block;
+
+    node->elem[LEFT] = insertL;
+    node->elem[RIGHT] = insertR;
+    if (insertL) {
+        insertL->elem[RIGHT] = node;
+    }
+    if (insertR) {
+        insertR->elem[LEFT] = node;
+    }
+    racine = blocks.front()->nodes[0];
+}
+
+
+/// Takes node out of the sweepline.
+void SweepTreeList::unlink(SweepTree *node)
+{
+    if (node->elem[LEFT]) {
+        node->elem[LEFT]->elem[RIGHT] = node->elem[RIGHT];
+    }
+    if (node->elem[RIGHT]) {
+        node->elem[RIGHT]->elem[LEFT] = node->elem[LEFT];
+    }
+    node->elem[LEFT] = node->elem[RIGHT] = nullptr;
+
+    Block *block = node->block;
+    SweepTree **end = std::remove(block->nodes, block->nodes + block->size, node);
+    block->size = end - block->nodes;
+    node->block = nullptr;
+
+    if (block->size == 0) {
+        removeBlock(block);
+    } else if (block->size <= Block::SIZE / 4) {
+        // merge small blocks, so that there are not many more blocks than needed
+        auto next = std::find(blocks.begin(), blocks.end(), block) + 1;
+        if (next != blocks.end() && block->size + (*next)->size <= Block::SIZE / 2) {
+            Block *other = *next;
+            for (int i = 0; i < other->size; i++) {
+                other->nodes[i]->block = block;
+                block->nodes[block->size++] = other->nodes[i];
+            }
+            removeBlock(other);
+        }
+    }
+    racine = blocks.empty() ? nullptr : blocks.front()->nodes[0];
+}
+
+
+/// Replaces from by to, where SweepTree::Relocate() moves the node.
+void SweepTreeList::relocate(SweepTree *from, SweepTree *to)
+{
+    Block *block = from->block;
+    if (block) {
+        std::replace(block->nodes, block->nodes + block->size, from, to);
+    }
+    to->block = block;
+}
+
+
+SweepTreeList::Block *SweepTreeList::newBlock()
+{
+    Block *block;
+    if (spareBlocks.empty()) {
+        block = new Block;
+    } else {
+        block = spareBlocks.back();
+        spareBlocks.pop_back();
+    }
+    block->size = 0;
+    return block;
+}
+
+
+void SweepTreeList::removeBlock(Block *block)
+{
+    blocks.erase(std::find(blocks.begin(), blocks.end(), block));
+    spareBlocks.push_back(block);
+}
+
+
 /*
   Local Variables:
   mode:c++
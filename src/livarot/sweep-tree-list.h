@@ -14,24 +14,64 @@
 #ifndef INKSCAPE_LIVAROT_SWEEP_TREE_LIST_H
 #define INKSCAPE_LIVAROT_SWEEP_TREE_LIST_H
 
+#include <vector>
+#include <2geom/forward.h>
+
 class Shape;
 class SweepTree;
 
 /**
  * The sweepline: a set of edges intersecting the current sweepline
  * stored as an AVL tree.
+ *
+ * Alternatively, the nodes can be kept in order in a list of arrays of at most Block::SIZE
+ * nodes, which is searched by bisection. It compares about as many edges as the tree does,
+ * but mostly reads consecutive pointers instead of following the links between the nodes.
  */
 class SweepTreeList {
 public:
+    /// How the nodes are kept in order.
+    enum Storage {
+        AVL_TREE,
+        BLOCK_ARRAY
+    };
+
+    struct Block
+    {
+        static int const SIZE = 64;
+        int size;
+        SweepTree *nodes[SIZE];
+    };
+
     int nbTree;   ///< Number of nodes in the tree.
     int const maxTree;   ///< Max number of nodes in the tree.
     SweepTree *trees;    ///< The array of nodes.
-    SweepTree *racine;   ///< Root of the tree.
+    SweepTree *racine;   ///< Root of the tree, or leftmost node with BLOCK_ARRAY storage.
+    Storage storage;
+
+    /// Storage of new sweeplines: AVL_TREE, unless the environment has _INKSCAPE_SWEEPLINE=blocks.
+    static Storage defaultStorage;
 
     SweepTreeList(int s);
     virtual ~SweepTreeList();
 
     SweepTree *add(Shape *iSrc, int iBord, int iWeight, int iStartPoint, Shape *iDst);
+    /// Removes all nodes, keeping the memory for the next sweep.
+    void clear();
+
+    // with BLOCK_ARRAY storage, what AVLTree does for the tree
+    int find(Geom::Point const &iPt, SweepTree *newOne, SweepTree *&insertL, SweepTree *&insertR,
+             bool sweepSens);
+    void link(SweepTree *node, SweepTree *insertL);
+    void unlink(SweepTree *node);
+    void relocate(SweepTree *from, SweepTree *to);
+
+private:
+    std::vector<Block *> blocks;
+    std::vector<Block *> spareBlocks;
+
+    Block *newBlock();
+    void removeBlock(Block *block);
 };
 
 
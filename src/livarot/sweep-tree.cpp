@@ -27,6 +27,7 @@ SweepTree::SweepTree()
     src = nullptr;
     bord = -1;
     startPoint = -1;
+    block = nullptr;
     evt[LEFT] = evt[RIGHT] = nullptr;
     sens = true;
     //invDirLength=1;
@@ -41,6 +42,7 @@ void
 SweepTree::MakeNew(Shape *iSrc, int iBord, int iWeight, int iStartPoint)
 {
     AVLTree::MakeNew();
+    block = nullptr;
     ConvertTo(iSrc, iBord, iWeight, iStartPoint);
 }
 
@@ -80,13 +82,12 @@ void SweepTree::MakeDelete()
 }
 
 
-// find the position at which node "newOne" should be inserted in the subtree rooted here
+// on which side of this node's edge does px lie?
 // we want to order with respect to the order of intersections with the sweepline, currently 
 // lying at y=px[1].
 // px is the upper endpoint of newOne
 int
-SweepTree::Find(Geom::Point const &px, SweepTree *newOne, SweepTree *&insertL,
-                SweepTree *&insertR, bool sweepSens)
+SweepTree::Compare(Geom::Point const &px, SweepTree *newOne, bool sweepSens)
 {
     // get the edge associated with this node: one point+one direction
     // since we're dealing with line, the direction (bNorm) is taken downwards
@@ -133,12 +134,24 @@ SweepTree::Find(Geom::Point const &px, SweepTree *newOne, SweepTree *&insertL,
         if (y == 0) {
             y = dot(bNorm, nNorm);
             if (y == 0) {
-                insertL = this;
-                insertR = static_cast<SweepTree *>(elem[RIGHT]);
-                return found_exact;
+                return 0;
             }
         }
     }
+    return y < 0 ? -1 : 1;
+}
+
+// find the position at which node "newOne" should be inserted in the subtree rooted here
+int
+SweepTree::Find(Geom::Point const &px, SweepTree *newOne, SweepTree *&insertL,
+                SweepTree *&insertR, bool sweepSens)
+{
+    int y = Compare(px, newOne, sweepSens);
+    if (y == 0) {
+        insertL = this;
+        insertR = static_cast<SweepTree *>(elem[RIGHT]);
+        return found_exact;
+    }
     if (y < 0) {
         if (child[LEFT]) {
             return (static_cast<SweepTree *>(child[LEFT]))->Find(px, newOne,
@@ -261,9 +274,17 @@ SweepTree::Remove(SweepTreeList &list, SweepEventQueue &queue,
                   bool rebalance)
 {
   RemoveEvents(queue);
-  AVLTree *tempR = static_cast<AVLTree *>(list.racine);
-  int err = AVLTree::Remove(tempR, rebalance);
-  list.racine = static_cast<SweepTree *>(tempR);
+  int err = avl_no_err;
+  if (list.storage == SweepTreeList::BLOCK_ARRAY)
+    {
+      list.unlink(this);
+    }
+  else
+    {
+      AVLTree *tempR = static_cast<AVLTree *>(list.racine);
+      err = AVLTree::Remove(tempR, rebalance);
+      list.racine = static_cast<SweepTree *>(tempR);
+    }
   MakeDelete();
   if (list.nbTree <= 1)
     {
@@ -272,9 +293,13 @@ SweepTree::Remove(SweepTreeList &list, SweepEventQueue &queue,
     }
   else
     {
-      if (list.racine == list.trees + (list.nbTree - 1))
+      SweepTree *last = list.trees + (list.nbTree - 1);
+      if (list.racine == last)
 	list.racine = this;
-      list.trees[--list.nbTree].Relocate(this);
+      if (list.storage == SweepTreeList::BLOCK_ARRAY && last != this)
+	list.relocate(last, this);
+      list.nbTree--;
+      last->Relocate(this);
     }
   return err;
 }
@@ -285,14 +310,21 @@ SweepTree::Insert(SweepTreeList &list, SweepEventQueue &queue,
 {
   if (list.racine == nullptr)
     {
-      list.racine = this;
-      return avl_no_err;
+      return Link(list, not_found, nullptr, nullptr, rebalance);
     }
   SweepTree *insertL = nullptr;
   SweepTree *insertR = nullptr;
-  int insertion =
-    list.racine->Find(iDst->getPoint(iAtPoint).x, this,
-		       insertL, insertR, sweepSens);
+  int insertion;
+  if (list.storage == SweepTreeList::BLOCK_ARRAY)
+    {
+      insertion = list.find(iDst->getPoint(iAtPoint).x, this,
+			    insertL, insertR, sweepSens);
+    }
+  else
+    {
+      insertion = list.racine->Find(iDst->getPoint(iAtPoint).x, this,
+				    insertL, insertR, sweepSens);
+    }
   
     if (insertion == found_exact) {
 	if (insertR) {
@@ -307,12 +339,7 @@ SweepTree::Insert(SweepTreeList &list, SweepEventQueue &queue,
       insertL->RemoveEvent(queue, RIGHT);
     }
 
-  AVLTree *tempR = static_cast<AVLTree *>(list.racine);
-  int err =
-    AVLTree::Insert(tempR, insertion, static_cast<AVLTree *>(insertL),
-		     static_cast<AVLTree *>(insertR), rebalance);
-  list.racine = static_cast<SweepTree *>(tempR);
-  return err;
+  return Link(list, insertion, insertL, insertR, rebalance);
 }
 
 // insertAt() is a speedup on the regular sweepline: if the polygon contains a point of high degree, you
@@ -327,8 +354,7 @@ SweepTree::InsertAt(SweepTreeList &list, SweepEventQueue &queue,
 {
   if (list.racine == nullptr)
     {
-      list.racine = this;
-      return avl_no_err;
+      return Link(list, not_found, nullptr, nullptr, rebalance);
     }
 
   Geom::Point fromP;
@@ -467,6 +493,24 @@ SweepTree::InsertAt(SweepTreeList &list, SweepEventQueue &queue,
       insertL->RemoveEvent(queue, RIGHT);
   }
 
+  return Link(list, insertion, insertL, insertR, rebalance);
+}
+
+// puts the node in the sweepline at the position found by Find() or InsertAt()
+int
+SweepTree::Link(SweepTreeList &list, int insertion, SweepTree *insertL,
+                SweepTree *insertR, bool rebalance)
+{
+  if (list.storage == SweepTreeList::BLOCK_ARRAY)
+    {
+      list.link(this, insertL);
+      return avl_no_err;
+    }
+  if (list.racine == nullptr)
+    {
+      list.racine = this;
+      return avl_no_err;
+    }
   AVLTree *tempR = static_cast<AVLTree *>(list.racine);
   int err =
     AVLTree::Insert(tempR, insertion, static_cast<AVLTree *>(insertL),
@@ -11,12 +11,12 @@
 #define INKSCAPE_LIVAROT_SWEEP_TREE_H
 
 #include "livarot/AVL.h"
+#include "livarot/sweep-tree-list.h"
 #include <2geom/point.h>
 
 class Shape;
 class SweepEvent;
 class SweepEventQueue;
-class SweepTreeList;
 
 
 /**
@@ -34,6 +34,7 @@ public:
     int bord;     ///< Edge index in the Shape.
     bool sens;    ///< true= top->bottom; false= bottom->top.
     int startPoint;   ///< point index in the result Shape associated with the upper end of the edge
+    SweepTreeList::Block *block;   ///< Block holding the node, with SweepTreeList::BLOCK_ARRAY storage.
 
     SweepTree();
     ~SweepTree() override;
@@ -49,6 +50,10 @@ public:
 
     // utilites
 
+    /// Side of this edge on which px, the upper endpoint of newOne, lies: -1 for the left
+    /// side, 1 for the right side and 0 if newOne runs along this edge.
+    int Compare(Geom::Point const &px, SweepTree *newOne, bool sweepSens = true);
+
     // the find function that was missing in the AVLTrree class
     // the return values are defined in LivarotDefs.h
     int Find(Geom::Point const &iPt, SweepTree *newOne, SweepTree *&insertL,
@@ -74,6 +79,9 @@ public:
     void Avance(Shape *dst, int nPt, Shape *a, Shape *b);
 
     void Relocate(SweepTree *to);
+
+private:
+    int Link(SweepTreeList &list, int insertion, SweepTree *insertL, SweepTree *insertR, bool rebalance);
 };
 
 
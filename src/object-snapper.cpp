@@ -17,6 +17,7 @@
 #include <2geom/line.h>
 #include <2geom/path-intersection.h>
 #include <2geom/path-sink.h>
+#include <algorithm>
 #include <memory>
 
 #include "desktop.h"
@@ -44,6 +45,26 @@
 #include "text-editing.h"
 #include "page-manager.h"
 
+namespace {
+
+/// The snap targets which the snap points of items depend on, see SPItem::getSnappoints().
+Inkscape::SnapTargetType const item_point_targets[] = {
+    Inkscape::SNAPTARGET_NODE_SMOOTH,
+    Inkscape::SNAPTARGET_NODE_CUSP,
+    Inkscape::SNAPTARGET_LINE_MIDPOINT,
+    Inkscape::SNAPTARGET_PATH,
+    Inkscape::SNAPTARGET_PATH_INTERSECTION,
+    Inkscape::SNAPTARGET_ELLIPSE_QUADRANT_POINT,
+    Inkscape::SNAPTARGET_RECT_CORNER,
+    Inkscape::SNAPTARGET_OBJECT_MIDPOINT,
+    Inkscape::SNAPTARGET_IMG_CORNER,
+    Inkscape::SNAPTARGET_ROTATION_CENTER,
+    Inkscape::SNAPTARGET_TEXT_ANCHOR,
+    Inkscape::SNAPTARGET_TEXT_BASELINE,
+};
+
+} // namespace
+
 Inkscape::ObjectSnapper::ObjectSnapper(SnapManager *sm, Geom::Coord const d)
     : Snapper(sm, d)
 {
@@ -55,6 +76,167 @@ Inkscape::ObjectSnapper::~ObjectSnapper()
 {
     _points_to_snap_to->clear();
     _clear_paths();
+    for (auto &entry : _item_targets) {
+        entry.second.modified_connection.disconnect();
+        entry.second.release_connection.disconnect();
+    }
+}
+
+bool Inkscape::ObjectSnapper::PathSegment::operator<(PathSegment const &other) const
+{
+    if (candidate != other.candidate) {
+        return candidate < other.candidate;
+    }
+    if (path != other.path) {
+        return path < other.path;
+    }
+    return curve < other.curve;
+}
+
+/**
+ * Forgets the cached snap targets of all items if the snap preferences they depend on, or the
+ * desktop transform, have changed since they were collected.
+ */
+void Inkscape::ObjectSnapper::_checkItemTargets() const
+{
+    std::vector<bool> prefs;
+    for (auto target : item_point_targets) {
+        prefs.push_back(_snapmanager->snapprefs.isTargetSnappable(target));
+    }
+    prefs.push_back(_snapmanager->snapprefs.isSourceSnappable(SNAPSOURCE_PATH_INTERSECTION));
+    // The bounding box targets decide which bounding box is snapped to, and which of its points
+    for (auto target : {SNAPTARGET_BBOX_CORNER, SNAPTARGET_BBOX_EDGE_MIDPOINT, SNAPTARGET_BBOX_MIDPOINT, SNAPTARGET_BBOX_EDGE}) {
+        prefs.push_back(_snapmanager->snapprefs.isTargetSnappable(target));
+    }
+    prefs.push_back(Preferences::get()->getBool("/tools/bounding_box", false));
+
+    SPDesktop const *dt = _snapmanager->getDesktop();
+    Geom::Affine doc2dt = dt ? dt->doc2dt() : Geom::identity();
+
+    if (prefs != _item_targets_prefs || doc2dt != _item_targets_doc2dt) {
+        for (auto &entry : _item_targets) {
+            _invalidateItemTargets(entry.second);
+        }
+        _item_targets_prefs = std::move(prefs);
+        _item_targets_doc2dt = doc2dt;
+    }
+}
+
+/**
+ * Returns the cache of the snap targets of an item, which is invalidated when the item
+ * is modified and dropped when it is released.
+ */
+Inkscape::ObjectSnapper::ItemTargets &Inkscape::ObjectSnapper::_getItemTargets(SPItem const *item) const
+{
+    auto found = _item_targets.find(item);
+    if (found != _item_targets.end()) {
+        return found->second;
+    }
+
+    ItemTargets &targets = _item_targets[item];
+    SPItem *object = const_cast<SPItem *>(item);
+    targets.modified_connection = object->connectModified([this, &targets](SPObject *, unsigned int) {
+        _invalidateItemTargets(targets);
+    });
+    targets.release_connection = object->connectRelease([this, item](SPObject *) {
+        _forgetItemTargets(item);
+    });
+    return targets;
+}
+
+/// Marks the snap targets of an item as out of date, and takes them out of the trees.
+void Inkscape::ObjectSnapper::_invalidateItemTargets(ItemTargets &targets) const
+{
+    for (auto id : targets.point_ids) {
+        _points_tree.remove(id);
+    }
+    for (auto id : targets.segment_ids) {
+        _segments_tree.remove(id);
+    }
+    targets.point_ids.clear();
+    targets.segment_ids.clear();
+    targets.nodes.clear();
+    targets.bbox_points.clear();
+    targets.nodes_valid = false;
+    targets.bbox_points_valid = false;
+    targets.path_valid = false;
+    targets.bbox_path_valid = false;
+}
+
+void Inkscape::ObjectSnapper::_forgetItemTargets(SPItem const *item) const
+{
+    auto found = _item_targets.find(item);
+    if (found != _item_targets.end()) {
+        _invalidateItemTargets(found->second);
+        found->second.modified_connection.disconnect();
+        found->second.release_connection.disconnect();
+        _item_targets.erase(found);
+    }
+}
+
+/// Adds the points from begin to end to the tree of points, and their ids to ids.
+void Inkscape::ObjectSnapper::_indexPoints(std::vector<SnapCandidatePoint> const &points, size_t begin, size_t end,
+                                           TargetPoint target, std::vector<size_t> &ids) const
+{
+    for (size_t i = begin; i < end; ++i) {
+        Geom::Point const pt = points[i].getPoint();
+        if (pt.isFinite()) {
+            target.index = i;
+            ids.push_back(_points_tree.insert(Geom::Rect(pt, pt), target));
+        }
+    }
+}
+
+/// Adds the segments of a path vector to the tree of segments, and their ids to ids.
+void Inkscape::ObjectSnapper::_indexPath(Geom::PathVector const &path_vector, TargetSegment target,
+                                         std::vector<size_t> &ids) const
+{
+    for (size_t j = 0; j < path_vector.size(); ++j) {
+        Geom::Path const &path = path_vector[j];
+        for (size_t k = 0; k < path.size_default(); ++k) {
+            Geom::Rect const box = path[k].boundsFast();
+            if (box.min().isFinite() && box.max().isFinite()) {
+                target.path = j;
+                target.curve = k;
+                ids.push_back(_segments_tree.insert(box, target));
+            }
+        }
+    }
+}
+
+/**
+ * Returns the point of the tree of points, and the group it was collected in, or null if it
+ * was not collected for the current snap.
+ */
+Inkscape::SnapCandidatePoint const *Inkscape::ObjectSnapper::_findPoint(TargetPoint const &target, size_t &group) const
+{
+    if (!target.item) {
+        group = target.group;
+        return &(*_points_to_snap_to)[target.index];
+    }
+    auto found = _item_point_groups.find(std::make_pair(target.item, target.bbox));
+    if (found == _item_point_groups.end()) {
+        return nullptr;
+    }
+    group = found->second;
+    // the targets of an item are in the tree only while it has them
+    ItemTargets const &targets = _item_targets.find(target.item)->second;
+    return &(target.bbox ? targets.bbox_points : targets.nodes)[target.index];
+}
+
+/// Finds a segment of the tree of segments among the paths collected for the current snap.
+bool Inkscape::ObjectSnapper::_findSegment(TargetSegment const &target, PathSegment &segment) const
+{
+    size_t candidate = target.candidate;
+    if (target.item) {
+        auto found = _item_paths.find(std::make_pair(target.item, target.bbox));
+        if (found == _item_paths.end()) {
+            return false;
+        }
+        candidate = found->second;
+    }
+    segment = PathSegment{candidate, target.path, target.curve, _first_num_paths[candidate] + int(target.path)};
+    return true;
 }
 
 Geom::Coord Inkscape::ObjectSnapper::getSnapperTolerance() const
@@ -70,13 +252,30 @@ bool Inkscape::ObjectSnapper::getSnapperAlwaysSnap() const
 }
 
 void Inkscape::ObjectSnapper::_collectNodes(SnapSourceType const &t,
-                                            bool const &first_point) const
+                                            bool const &first_point,
+                                            std::vector<SnapCandidatePoint> const *unselected_nodes) const
 {
     // Now, let's first collect all points to snap to. If we have a whole bunch of points to snap,
     // e.g. when translating an item using the selector tool, then we will only do this for the
     // first point and store the collection for later use. This significantly improves the performance
     if (first_point) {
         _points_to_snap_to->clear();
+        _point_groups.clear();
+        _item_point_groups.clear();
+        _checkItemTargets();
+
+        // Groups the points added to _points_to_snap_to since begin
+        size_t begin = 0;
+        auto add_uncached = [this, &begin]() {
+            if (_points_to_snap_to->size() > begin) {
+                _point_groups.push_back(PointGroup{nullptr, false, begin, _points_to_snap_to->size()});
+                begin = _points_to_snap_to->size();
+            }
+        };
+        auto add_cached = [this](SPItem const *item, bool bbox, std::vector<SnapCandidatePoint> const &points) {
+            _item_point_groups[std::make_pair(item, bbox)] = _point_groups.size();
+            _point_groups.push_back(PointGroup{item, bbox, 0, points.size()});
+        };
 
          // Determine the type of bounding box we should snap to
         SPItem::BBoxType bbox_type = SPItem::GEOMETRIC_BBOX;
@@ -118,6 +317,7 @@ void Inkscape::ObjectSnapper::_collectNodes(SnapSourceType const &t,
                     SNAPSOURCE_UNDEFINED, SNAPTARGET_UNDEFINED);
             }
         }
+        add_uncached();
 
         for (const auto & _candidate : *_snapmanager->obj_snapper_candidates) {
             //Geom::Affine i2doc(Geom::identity());
@@ -161,18 +361,33 @@ void Inkscape::ObjectSnapper::_collectNodes(SnapSourceType const &t,
                 // We should not snap a transformation center to any of the centers of the items in the
                 // current selection (see the comment in SelTrans::centerRequest())
                 bool old_pref2 = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_ROTATION_CENTER);
+                bool own_center = false;
                 if (old_pref2) {
                 	std::vector<SPItem*> rotationSource=_snapmanager->getRotationCenterSource();
                     for (auto itemlist : rotationSource) {
                         if (_candidate.item == itemlist) {
                             // don't snap to this item's rotation center
                             _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_ROTATION_CENTER, false);
+                            own_center = true;
                             break;
                         }
                     }
                 }
 
-                root_item->getSnappoints(*_points_to_snap_to, &_snapmanager->snapprefs);
+                // The points of clips and masks are included in those of the item they apply to,
+                // so the item is not told when they change
+                if (own_center || root_item->getClipObject() || root_item->getMaskObject()) {
+                    root_item->getSnappoints(*_points_to_snap_to, &_snapmanager->snapprefs);
+                    add_uncached();
+                } else {
+                    ItemTargets &targets = _getItemTargets(root_item);
+                    if (!targets.nodes_valid) {
+                        root_item->getSnappoints(targets.nodes, &_snapmanager->snapprefs);
+                        targets.nodes_valid = true;
+                        _indexPoints(targets.nodes, 0, targets.nodes.size(), TargetPoint{root_item, false, 0, 0}, targets.point_ids);
+                    }
+                    add_cached(root_item, false, targets.nodes);
+                }
 
                 // restore the original snap preferences
                 _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_PATH_INTERSECTION, old_pref);
@@ -184,14 +399,45 @@ void Inkscape::ObjectSnapper::_collectNodes(SnapSourceType const &t,
                 // Discard the bbox of a clipped path / mask, because we don't want to snap to both the bbox
                 // of the item AND the bbox of the clipping path at the same time
                 if (!_candidate.clip_or_mask) {
-                    Geom::OptRect b = root_item->desktopBounds(bbox_type);
-                    getBBoxPoints(b, _points_to_snap_to.get(), true,
-                            _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_CORNER),
-                            _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_EDGE_MIDPOINT),
-                            _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_MIDPOINT));
+                    // The bounding box of a clipped or masked item depends on the clip or mask
+                    bool const cached = !root_item->getClipObject() && !root_item->getMaskObject();
+                    ItemTargets *targets = cached ? &_getItemTargets(root_item) : nullptr;
+                    if (!targets || !targets->bbox_points_valid) {
+                        Geom::OptRect b = root_item->desktopBounds(bbox_type);
+                        getBBoxPoints(b, targets ? &targets->bbox_points : _points_to_snap_to.get(), true,
+                                _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_CORNER),
+                                _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_EDGE_MIDPOINT),
+                                _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_MIDPOINT));
+                    }
+                    if (targets) {
+                        if (!targets->bbox_points_valid) {
+                            targets->bbox_points_valid = true;
+                            _indexPoints(targets->bbox_points, 0, targets->bbox_points.size(), TargetPoint{root_item, true, 0, 0}, targets->point_ids);
+                        }
+                        add_cached(root_item, true, targets->bbox_points);
+                    } else {
+                        add_uncached();
+                    }
                 }
             }
         }
+
+        if (unselected_nodes != nullptr) {
+            _points_to_snap_to->insert(_points_to_snap_to->end(), unselected_nodes->begin(), unselected_nodes->end());
+            add_uncached();
+        }
+
+        // Replace the uncached points of the previous snap in the tree
+        for (auto id : _uncached_point_ids) {
+            _points_tree.remove(id);
+        }
+        _uncached_point_ids.clear();
+        for (size_t i = 0; i < _point_groups.size(); ++i) {
+            PointGroup const &group = _point_groups[i];
+            if (!group.item) {
+                _indexPoints(*_points_to_snap_to, group.begin, group.end, TargetPoint{nullptr, false, i, 0}, _uncached_point_ids);
+            }
+        }
     }
 }
 
@@ -201,20 +447,29 @@ void Inkscape::ObjectSnapper::_snapNodes(IntermSnapResults &isr,
                                          SnapConstraint const &c,
                                          Geom::Point const &p_proj_on_constraint) const
 {
-    // Iterate through all nodes, find out which one is the closest to p, and snap to it!
-
-    _collectNodes(p.getSourceType(), p.getSourceNum() <= 0);
+    // Find the nodes within snapping range of p, find out which one is the closest to p, and snap to it!
 
-    if (unselected_nodes != nullptr && unselected_nodes->size() > 0) {
-        g_assert(_points_to_snap_to != nullptr);
-        _points_to_snap_to->insert(_points_to_snap_to->end(), unselected_nodes->begin(), unselected_nodes->end());
-    }
+    _collectNodes(p.getSourceType(), p.getSourceNum() <= 0, unselected_nodes);
 
     SnappedPoint s;
     bool success = false;
     bool strict_snapping = _snapmanager->snapprefs.getStrictSnapping();
 
-    for (const auto & k : *_points_to_snap_to) {
+    // Only nodes within the tolerance of p, or of its projection on the constraint, can be snapped to
+    Geom::Point const center = c.isUndefined() ? p.getPoint() : p_proj_on_constraint;
+    Geom::Point const range(getSnapperTolerance(), getSnapperTolerance());
+    std::vector<std::pair<std::pair<size_t, size_t>, SnapCandidatePoint const *>> nearby;
+    _points_tree.query(Geom::Rect(center - range, center + range), [this, &nearby](TargetPoint const &target) {
+        size_t group;
+        if (auto point = _findPoint(target, group)) {
+            nearby.emplace_back(std::make_pair(group, target.index), point);
+        }
+    });
+    // Of nodes at the same distance, the first one collected wins
+    std::sort(nearby.begin(), nearby.end(), [](auto const &a, auto const &b) { return a.first < b.first; });
+
+    for (auto const &found : nearby) {
+        SnapCandidatePoint const &k = *found.second;
         if (_allowSourceToSnapToTarget(p.getSourceType(), k.getTargetType(), strict_snapping)) {
             Geom::Point target_pt = k.getPoint();
             Geom::Coord dist = Geom::L2(target_pt - p.getPoint()); // Default: free (unconstrained) snapping
@@ -257,15 +512,30 @@ void Inkscape::ObjectSnapper::_snapTranslatingGuide(IntermSnapResults &isr,
 
     Geom::Coord tol = getSnapperTolerance();
 
-    for (const auto & k : *_points_to_snap_to) {
-        Geom::Point target_pt = k.getPoint();
-        // Project each node (*k) on the guide line (running through point p)
-        Geom::Point p_proj = Geom::projection(target_pt, Geom::Line(p, p + Geom::rot90(guide_normal)));
-        Geom::Coord dist = Geom::L2(target_pt - p_proj); // distance from node to the guide
-        Geom::Coord dist2 = Geom::L2(p - p_proj); // distance from projection of node on the guide, to the mouse location
-        if ((dist < tol && dist2 < tol) || getSnapperAlwaysSnap()) {
-            s = SnappedPoint(target_pt, SNAPSOURCE_GUIDE, 0, k.getTargetType(), dist, tol, getSnapperAlwaysSnap(), false, true, k.getTargetBBox());
-            isr.points.push_back(s);
+    for (auto const &group : _point_groups) {
+        std::vector<SnapCandidatePoint> const *points = _points_to_snap_to.get();
+        size_t begin = group.begin;
+        size_t end = group.end;
+        if (group.item) {
+            auto found = _item_targets.find(group.item);
+            if (found == _item_targets.end()) {
+                continue;
+            }
+            points = group.bbox ? &found->second.bbox_points : &found->second.nodes;
+            begin = 0;
+            end = points->size();
+        }
+        for (size_t i = begin; i < end; ++i) {
+            SnapCandidatePoint const &k = (*points)[i];
+            Geom::Point target_pt = k.getPoint();
+            // Project each node (*k) on the guide line (running through point p)
+            Geom::Point p_proj = Geom::projection(target_pt, Geom::Line(p, p + Geom::rot90(guide_normal)));
+            Geom::Coord dist = Geom::L2(target_pt - p_proj); // distance from node to the guide
+            Geom::Coord dist2 = Geom::L2(p - p_proj); // distance from projection of node on the guide, to the mouse location
+            if ((dist < tol && dist2 < tol) || getSnapperAlwaysSnap()) {
+                s = SnappedPoint(target_pt, SNAPSOURCE_GUIDE, 0, k.getTargetType(), dist, tol, getSnapperAlwaysSnap(), false, true, k.getTargetBBox());
+                isr.points.push_back(s);
+            }
         }
     }
 }
@@ -274,13 +544,15 @@ void Inkscape::ObjectSnapper::_snapTranslatingGuide(IntermSnapResults &isr,
 /// @todo investigate why Geom::Point p is passed in but ignored.
 void Inkscape::ObjectSnapper::_collectPaths(Geom::Point /*p*/,
                                          SnapSourceType const source_type,
-                                         bool const &first_point) const
+                                         bool const &first_point,
+                                         SPPath const *selected_path) const
 {
     // Now, let's first collect all paths to snap to. If we have a whole bunch of points to snap,
     // e.g. when translating an item using the selector tool, then we will only do this for the
     // first point and store the collection for later use. This significantly improves the performance
     if (first_point) {
         _clear_paths();
+        _checkItemTargets();
 
         // Determine the type of bounding box we should snap to
         SPItem::BBoxType bbox_type = SPItem::GEOMETRIC_BBOX;
@@ -296,11 +568,23 @@ void Inkscape::ObjectSnapper::_collectPaths(Geom::Point /*p*/,
                 SPItem::VISUAL_BBOX : SPItem::GEOMETRIC_BBOX;
         }
 
+        // Paths of items are cached, and those of the candidates are put in the tree of segments
+        // only if they aren't there already
+        std::vector<size_t> uncached;
+        auto add_path = [this, &uncached](SnapCandidatePath const &path, SPItem const *item, bool bbox) {
+            if (item) {
+                _item_paths[std::make_pair(item, bbox)] = _paths_to_snap_to->size();
+            } else {
+                uncached.push_back(_paths_to_snap_to->size());
+            }
+            _paths_to_snap_to->push_back(path);
+        };
+
         // Consider the page border for snapping
         if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PAGE_BORDER) && _snapmanager->snapprefs.isAnyCategorySnappable()) {
-            Geom::PathVector *border_path = _getBorderPathv();
-            if (border_path != nullptr) {
-                _paths_to_snap_to->push_back(SnapCandidatePath(border_path, SNAPTARGET_PAGE_BORDER, Geom::OptRect()));
+            auto border_path = _getBorderPathv();
+            if (border_path) {
+                add_path(SnapCandidatePath(border_path, SNAPTARGET_PAGE_BORDER, Geom::OptRect()), nullptr, false);
             }
         }
 
@@ -325,42 +609,53 @@ void Inkscape::ObjectSnapper::_collectPaths(Geom::Point /*p*/,
             //Add the item's path to snap to
             if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION, SNAPTARGET_TEXT_BASELINE)) {
                 if (p_is_other || p_is_a_node || (!_snapmanager->snapprefs.getStrictSnapping() && p_is_a_bbox)) {
-                    if (dynamic_cast<SPText *>(root_item) || dynamic_cast<SPFlowtext *>(root_item)) {
-                        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_TEXT_BASELINE)) {
+                    bool const text = dynamic_cast<SPText *>(root_item) || dynamic_cast<SPFlowtext *>(root_item);
+                    SPShape *shape = dynamic_cast<SPShape *>(root_item);
+
+                    // Snapping for example to a traced bitmap is very stressing for
+                    // the CPU, so we'll only snap to paths having no more than 500 nodes
+                    // This also leads to a lag of approx. 500 msec (in my lousy test set-up).
+                    bool very_complex_path = false;
+                    SPPath *path = dynamic_cast<SPPath *>(root_item);
+                    if (path) {
+                        very_complex_path = path->nodesInPath() > 500;
+                    }
+
+                    bool const wanted = text ? _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_TEXT_BASELINE)
+                                             : !very_complex_path && _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION);
+                    if (wanted) {
+                        // The outline of a clip or mask also depends on the item it applies to,
+                        // which does not tell the clip or mask when it moves
+                        ItemTargets *targets = ((text || shape) && !_candidate.clip_or_mask) ? &_getItemTargets(root_item) : nullptr;
+                        std::shared_ptr<Geom::PathVector const> pv;
+                        SnapTargetType type = text ? SNAPTARGET_TEXT_BASELINE : SNAPTARGET_PATH;
+                        if (targets && targets->path_valid) {
+                            pv = targets->path;
+                        } else if (text) {
                             // Snap to the text baseline
                             Text::Layout const *layout = te_get_layout(static_cast<SPItem *>(root_item));
                             if (layout != nullptr && layout->outputExists()) {
-                                Geom::PathVector *pv = new Geom::PathVector();
-                                pv->push_back(layout->baseline() * root_item->i2dt_affine() * _candidate.additional_affine * _snapmanager->getDesktop()->doc2dt());
-                                _paths_to_snap_to->push_back(SnapCandidatePath(pv, SNAPTARGET_TEXT_BASELINE, Geom::OptRect()));
+                                auto baseline = std::make_shared<Geom::PathVector>();
+                                baseline->push_back(layout->baseline() * root_item->i2dt_affine() * _candidate.additional_affine * _snapmanager->getDesktop()->doc2dt());
+                                pv = baseline;
                             }
-                        }
-                    } else {
-                        // Snapping for example to a traced bitmap is very stressing for
-                        // the CPU, so we'll only snap to paths having no more than 500 nodes
-                        // This also leads to a lag of approx. 500 msec (in my lousy test set-up).
-                        bool very_complex_path = false;
-                        SPPath *path = dynamic_cast<SPPath *>(root_item);
-                        if (path) {
-                            very_complex_path = path->nodesInPath() > 500;
-                        }
-
-                        if (!very_complex_path && root_item && _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION)) {
-                            std::unique_ptr<SPCurve> curve;
-                            SPShape *shape = dynamic_cast<SPShape *>(root_item);
-                            if (shape) {
-                                curve = SPCurve::copy(shape->curve());
-                            }/* else if (dynamic_cast<SPText *>(root_item) || dynamic_cast<SPFlowtext *>(root_item)) {
-                               curve = te_get_layout(root_item)->convertToCurves();
-                            }*/
-                            if (curve) {
-                                // We will get our own copy of the pathvector, which must be freed at some point
-                                Geom::PathVector *pv = new Geom::PathVector(curve->get_pathvector());
-                                (*pv) *= root_item->i2dt_affine() * _candidate.additional_affine * _snapmanager->getDesktop()->doc2dt(); // (_edit_transform * _i2d_transform);
-
-                                _paths_to_snap_to->push_back(SnapCandidatePath(pv, SNAPTARGET_PATH, Geom::OptRect())); // Perhaps for speed, get a reference to the Geom::pathvector, and store the transformation besides it.
+                        } else if (shape && shape->curve()) {
+                            auto transformed = std::make_shared<Geom::PathVector>(shape->curve()->get_pathvector());
+                            *transformed *= root_item->i2dt_affine() * _candidate.additional_affine * _snapmanager->getDesktop()->doc2dt(); // (_edit_transform * _i2d_transform);
+                            pv = transformed;
+                        }/* else if (dynamic_cast<SPText *>(root_item) || dynamic_cast<SPFlowtext *>(root_item)) {
+                           curve = te_get_layout(root_item)->convertToCurves();
+                        }*/
+                        if (targets && !targets->path_valid) {
+                            targets->path = pv;
+                            targets->path_valid = true;
+                            if (pv) {
+                                _indexPath(*pv, TargetSegment{root_item, false, 0, 0, 0}, targets->segment_ids);
                             }
                         }
+                        if (pv) {
+                            add_path(SnapCandidatePath(pv, type, Geom::OptRect()), targets ? root_item : nullptr, false);
+                        }
                     }
                 }
             }
@@ -371,123 +666,158 @@ void Inkscape::ObjectSnapper::_collectPaths(Geom::Point /*p*/,
                     // Discard the bbox of a clipped path / mask, because we don't want to snap to both the bbox
                     // of the item AND the bbox of the clipping path at the same time
                     if (!_candidate.clip_or_mask) {
-                        Geom::OptRect rect = root_item->bounds(bbox_type, i2doc);
-                        if (rect) {
-                            Geom::PathVector *path = _getPathvFromRect(*rect);
-                            rect = root_item->desktopBounds(bbox_type);
-                            _paths_to_snap_to->push_back(SnapCandidatePath(path, SNAPTARGET_BBOX_EDGE, rect));
+                        // The bounding box of a clipped or masked item depends on the clip or mask
+                        bool const cached = !root_item->getClipObject() && !root_item->getMaskObject();
+                        ItemTargets *targets = cached ? &_getItemTargets(root_item) : nullptr;
+                        std::shared_ptr<Geom::PathVector const> path;
+                        Geom::OptRect rect;
+                        if (targets && targets->bbox_path_valid) {
+                            path = targets->bbox_path;
+                            rect = targets->bbox;
+                        } else {
+                            rect = root_item->bounds(bbox_type, i2doc);
+                            if (rect) {
+                                path = _getPathvFromRect(*rect);
+                                rect = root_item->desktopBounds(bbox_type);
+                            }
+                        }
+                        if (targets && !targets->bbox_path_valid) {
+                            targets->bbox_path = path;
+                            targets->bbox = rect;
+                            targets->bbox_path_valid = true;
+                            if (path) {
+                                _indexPath(*path, TargetSegment{root_item, true, 0, 0, 0}, targets->segment_ids);
+                            }
+                        }
+                        if (path) {
+                            add_path(SnapCandidatePath(path, SNAPTARGET_BBOX_EDGE, rect), targets ? root_item : nullptr, true);
                         }
                     }
                 }
             }
         }
-    }
-}
-
-void Inkscape::ObjectSnapper::_snapPaths(IntermSnapResults &isr,
-                                     SnapCandidatePoint const &p,
-                                     std::vector<SnapCandidatePoint> *unselected_nodes,
-                                     SPPath const *selected_path) const
-{
-    _collectPaths(p.getPoint(), p.getSourceType(), p.getSourceNum() <= 0);
-    // Now we can finally do the real snapping, using the paths collected above
-
-    SPDesktop const *dt = _snapmanager->getDesktop();
-    g_assert(dt != nullptr);
-    Geom::Point const p_doc = dt->dt2doc(p.getPoint());
 
-    bool const node_tool_active = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION) && selected_path != nullptr;
-
-    if (p.getSourceNum() <= 0) {
         /* findCandidates() is used for snapping to both paths and nodes. It ignores the path that is
          * currently being edited, because that path requires special care: when snapping to nodes
          * only the unselected nodes of that path should be considered, and these will be passed on separately.
          * This path must not be ignored however when snapping to the paths, so we add it here
          * manually when applicable.
          * */
-        if (node_tool_active) {
+        if (selected_path) {
             // TODO fix the function to be const correct:
             auto curve = curve_for_item(const_cast<SPPath *>(selected_path));
             if (curve) {
-                Geom::PathVector *pathv = new Geom::PathVector(curve->get_pathvector()); // Must be freed.
+                auto pathv = std::make_shared<Geom::PathVector>(curve->get_pathvector());
                 *pathv *= selected_path->i2doc_affine();
-                _paths_to_snap_to->push_back(SnapCandidatePath(pathv, SNAPTARGET_PATH, Geom::OptRect(), true));
+                add_path(SnapCandidatePath(pathv, SNAPTARGET_PATH, Geom::OptRect(), true), nullptr, false);
             }
         }
+
+        int num_path = 0; // _paths_to_snap_to contains multiple path_vectors, each containing multiple paths.
+                          // num_path will count the paths, and will not be zeroed for each path_vector. It will
+                          // continue counting
+        for (auto const &candidate : *_paths_to_snap_to) {
+            _first_num_paths.push_back(num_path);
+            num_path += candidate.path_vector->size();
+        }
+
+        // Replace the uncached paths of the previous snap in the tree
+        for (auto id : _uncached_segment_ids) {
+            _segments_tree.remove(id);
+        }
+        _uncached_segment_ids.clear();
+        for (auto i : uncached) {
+            _indexPath(*(*_paths_to_snap_to)[i].path_vector, TargetSegment{nullptr, false, i, 0, 0}, _uncached_segment_ids);
+        }
     }
+}
 
-    int num_path = 0; // _paths_to_snap_to contains multiple path_vectors, each containing multiple paths.
-                      // num_path will count the paths, and will not be zeroed for each path_vector. It will
-                      // continue counting
+void Inkscape::ObjectSnapper::_snapPaths(IntermSnapResults &isr,
+                                     SnapCandidatePoint const &p,
+                                     std::vector<SnapCandidatePoint> *unselected_nodes,
+                                     SPPath const *selected_path) const
+{
+    bool const node_tool_active = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION) && selected_path != nullptr;
+
+    _collectPaths(p.getPoint(), p.getSourceType(), p.getSourceNum() <= 0, node_tool_active ? selected_path : nullptr);
+    // Now we can finally do the real snapping, using the paths collected above
+
+    SPDesktop const *dt = _snapmanager->getDesktop();
+    g_assert(dt != nullptr);
+    Geom::Point const p_doc = dt->dt2doc(p.getPoint());
 
     bool strict_snapping = _snapmanager->snapprefs.getStrictSnapping();
     bool snap_perp = _snapmanager->snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_PERPENDICULAR);
     bool snap_tang = _snapmanager->snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_TANGENTIAL);
 
+    // Only the segments whose bounding box comes within the tolerance of p can be snapped to
+    Geom::Point const range(getSnapperTolerance(), getSnapperTolerance());
+    std::vector<PathSegment> nearby;
+    _segments_tree.query(Geom::Rect(p_doc - range, p_doc + range), [this, &nearby](TargetSegment const &target) {
+        PathSegment segment;
+        if (_findSegment(target, segment)) {
+            nearby.push_back(segment);
+        }
+    });
+    // Report the snapped curves in the order in which the paths were collected
+    std::sort(nearby.begin(), nearby.end());
+
     //dt->snapindicator->remove_debugging_points();
-    for (const auto & it_p : *_paths_to_snap_to) {
-        if (_allowSourceToSnapToTarget(p.getSourceType(), it_p.target_type, strict_snapping)) {
-            bool const being_edited = node_tool_active && it_p.currently_being_edited;
-            //if true then this pathvector it_pv is currently being edited in the node tool
-
-            for(Geom::PathVector::iterator it_pv = (it_p.path_vector)->begin(); it_pv != (it_p.path_vector)->end(); ++it_pv) {
-                // Find a nearest point for each curve within this path
-                // n curves will return n time values with 0 <= t <= 1
-                std::vector<double> anp = (*it_pv).nearestTimePerCurve(p_doc);
-
-                //std::cout << "#nearest points = " << anp.size() << " | p = " << p.getPoint() << std::endl;
-                // Now we will examine each of the nearest points, and determine whether it's within snapping range and if we should snap to it
-                std::vector<double>::const_iterator np = anp.begin();
-                unsigned int index = 0;
-                for (; np != anp.end(); ++np, index++) {
-                    Geom::Curve const *curve = &(it_pv->at(index));
-                    Geom::Point const sp_doc = curve->pointAt(*np);
-                    //dt->snapindicator->set_new_debugging_point(sp_doc*dt->doc2dt());
-                    bool c1 = true;
-                    bool c2 = true;
-                    if (being_edited) {
-                        /* If the path is being edited, then we should only snap though to stationary pieces of the path
-                         * and not to the pieces that are being dragged around. This way we avoid
-                         * self-snapping. For this we check whether the nodes at both ends of the current
-                         * piece are unselected; if they are then this piece must be stationary
-                         */
-                        g_assert(unselected_nodes != nullptr);
-                        Geom::Point start_pt = dt->doc2dt(curve->pointAt(0));
-                        Geom::Point end_pt = dt->doc2dt(curve->pointAt(1));
-                        c1 = isUnselectedNode(start_pt, unselected_nodes);
-                        c2 = isUnselectedNode(end_pt, unselected_nodes);
-                        /* Unfortunately, this might yield false positives for coincident nodes. Inkscape might therefore mistakenly
-                         * snap to path segments that are not stationary. There are at least two possible ways to overcome this:
-                         * - Linking the individual nodes of the SPPath we have here, to the nodes of the NodePath::SubPath class as being
-                         *   used in sp_nodepath_selected_nodes_move. This class has a member variable called "selected". For this the nodes
-                         *   should be in the exact same order for both classes, so we can index them
-                         * - Replacing the SPPath being used here by the NodePath::SubPath class; but how?
-                         */
-                    }
+    for (auto const &segment : nearby) {
+        SnapCandidatePath const &it_p = (*_paths_to_snap_to)[segment.candidate];
+        if (!_allowSourceToSnapToTarget(p.getSourceType(), it_p.target_type, strict_snapping)) {
+            continue;
+        }
+        bool const being_edited = node_tool_active && it_p.currently_being_edited;
+        //if true then this pathvector it_pv is currently being edited in the node tool
+
+        // Find the nearest point on the curve, and determine whether it's within snapping range and if we should snap to it
+        unsigned int const index = segment.curve;
+        Geom::Curve const *curve = &(*it_p.path_vector)[segment.path].at(index);
+        double const np = curve->nearestTime(p_doc);
+        Geom::Point const sp_doc = curve->pointAt(np);
+        //dt->snapindicator->set_new_debugging_point(sp_doc*dt->doc2dt());
+        bool c1 = true;
+        bool c2 = true;
+        if (being_edited) {
+            /* If the path is being edited, then we should only snap though to stationary pieces of the path
+             * and not to the pieces that are being dragged around. This way we avoid
+             * self-snapping. For this we check whether the nodes at both ends of the current
+             * piece are unselected; if they are then this piece must be stationary
+             */
+            g_assert(unselected_nodes != nullptr);
+            Geom::Point start_pt = dt->doc2dt(curve->pointAt(0));
+            Geom::Point end_pt = dt->doc2dt(curve->pointAt(1));
+            c1 = isUnselectedNode(start_pt, unselected_nodes);
+            c2 = isUnselectedNode(end_pt, unselected_nodes);
+            /* Unfortunately, this might yield false positives for coincident nodes. Inkscape might therefore mistakenly
+             * snap to path segments that are not stationary. There are at least two possible ways to overcome this:
+             * - Linking the individual nodes of the SPPath we have here, to the nodes of the NodePath::SubPath class as being
+             *   used in sp_nodepath_selected_nodes_move. This class has a member variable called "selected". For this the nodes
+             *   should be in the exact same order for both classes, so we can index them
+             * - Replacing the SPPath being used here by the NodePath::SubPath class; but how?
+             */
+        }
 
-                    Geom::Point const sp_dt = dt->doc2dt(sp_doc);
-                    if (!being_edited || (c1 && c2)) {
-                        Geom::Coord dist = Geom::distance(sp_doc, p_doc);
-                        // std::cout << "  dist -> " << dist << std::endl;
-                        if (dist < getSnapperTolerance()) {
-                            // Add the curve we have snapped to
-                            Geom::Point sp_tangent_dt = Geom::Point(0,0);
-                            if (p.getSourceType() == Inkscape::SNAPSOURCE_GUIDE_ORIGIN) {
-                                // We currently only use the tangent when snapping guides, so only in this case we will
-                                // actually calculate the tangent to avoid wasting CPU cycles
-                                Geom::Point sp_tangent_doc = curve->unitTangentAt(*np);
-                                sp_tangent_dt = dt->doc2dt(sp_tangent_doc) - dt->doc2dt(Geom::Point(0,0));
-                            }
-                            isr.curves.emplace_back(sp_dt, sp_tangent_dt, num_path, index, dist, getSnapperTolerance(), getSnapperAlwaysSnap(), false, curve, p.getSourceType(), p.getSourceNum(), it_p.target_type, it_p.target_bbox);
-                            if (snap_tang || snap_perp) {
-                                // For each curve that's within snapping range, we will now also search for tangential and perpendicular snaps
-                                _snapPathsTangPerp(snap_tang, snap_perp, isr, p, curve, dt);
-                            }
-                        }
-                    }
+        Geom::Point const sp_dt = dt->doc2dt(sp_doc);
+        if (!being_edited || (c1 && c2)) {
+            Geom::Coord dist = Geom::distance(sp_doc, p_doc);
+            // std::cout << "  dist -> " << dist << std::endl;
+            if (dist < getSnapperTolerance()) {
+                // Add the curve we have snapped to
+                Geom::Point sp_tangent_dt = Geom::Point(0,0);
+                if (p.getSourceType() == Inkscape::SNAPSOURCE_GUIDE_ORIGIN) {
+                    // We currently only use the tangent when snapping guides, so only in this case we will
+                    // actually calculate the tangent to avoid wasting CPU cycles
+                    Geom::Point sp_tangent_doc = curve->unitTangentAt(np);
+                    sp_tangent_dt = dt->doc2dt(sp_tangent_doc) - dt->doc2dt(Geom::Point(0,0));
                 }
-                num_path++;
-            } // End of: for (Geom::PathVector::iterator ....)
+                isr.curves.emplace_back(sp_dt, sp_tangent_dt, segment.num_path, index, dist, getSnapperTolerance(), getSnapperAlwaysSnap(), false, curve, p.getSourceType(), p.getSourceNum(), it_p.target_type, it_p.target_bbox);
+                if (snap_tang || snap_perp) {
+                    // For each curve that's within snapping range, we will now also search for tangential and perpendicular snaps
+                    _snapPathsTangPerp(snap_tang, snap_perp, isr, p, curve, dt);
+                }
+            }
         }
     }
 }
@@ -555,9 +885,22 @@ void Inkscape::ObjectSnapper::_snapPathsConstrained(IntermSnapResults &isr,
 
     bool strict_snapping = _snapmanager->snapprefs.getStrictSnapping();
 
+    // Only the paths with a segment whose bounding box meets the constraint can intersect it
+    std::vector<bool> nearby(_paths_to_snap_to->size(), false);
+    if (Geom::OptRect constraint_bounds = constraint_path.boundsFast()) {
+        constraint_bounds->expandBy(Geom::EPSILON);
+        _segments_tree.query(*constraint_bounds, [this, &nearby](TargetSegment const &target) {
+            PathSegment segment;
+            if (_findSegment(target, segment)) {
+                nearby[segment.candidate] = true;
+            }
+        });
+    }
+
     // Find all intersections of the constrained path with the snap target candidates
-    for (const auto & k : *_paths_to_snap_to) {
-        if (k.path_vector && _allowSourceToSnapToTarget(p.getSourceType(), k.target_type, strict_snapping)) {
+    for (size_t i = 0; i < _paths_to_snap_to->size(); ++i) {
+        SnapCandidatePath const &k = (*_paths_to_snap_to)[i];
+        if (nearby[i] && k.path_vector && _allowSourceToSnapToTarget(p.getSourceType(), k.target_type, strict_snapping)) {
             // Do the intersection math
             std::vector<Geom::PVIntersection> inters = constraint_path.intersect(*(k.path_vector));
 
@@ -645,24 +988,22 @@ bool Inkscape::ObjectSnapper::ThisSnapperMightSnap() const
 
 void Inkscape::ObjectSnapper::_clear_paths() const
 {
-    for (const auto & k : *_paths_to_snap_to) {
-        delete k.path_vector;
-    }
     _paths_to_snap_to->clear();
+    _item_paths.clear();
+    _first_num_paths.clear();
 }
 
-Geom::PathVector* Inkscape::ObjectSnapper::_getBorderPathv() const
+std::shared_ptr<Geom::PathVector const> Inkscape::ObjectSnapper::_getBorderPathv() const
 {
     Geom::Rect const border_rect = Geom::Rect(Geom::Point(0,0), Geom::Point((_snapmanager->getDocument())->getWidth().value("px"),(_snapmanager->getDocument())->getHeight().value("px")));
     return _getPathvFromRect(border_rect);
 }
 
-Geom::PathVector* Inkscape::ObjectSnapper::_getPathvFromRect(Geom::Rect const rect) const
+std::shared_ptr<Geom::PathVector const> Inkscape::ObjectSnapper::_getPathvFromRect(Geom::Rect const rect) const
 {
     auto const border_curve = SPCurve::new_from_rect(rect, true);
     if (border_curve) {
-        Geom::PathVector *dummy = new Geom::PathVector(border_curve->get_pathvector());
-        return dummy;
+        return std::make_shared<Geom::PathVector>(border_curve->get_pathvector());
     } else {
         return nullptr;
     }
@@ -11,11 +11,19 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <map>
 #include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <2geom/affine.h>
+#include <sigc++/connection.h>
 #include "snapper.h"
 #include "snap-candidate.h"
+#include "snap-target-tree.h"
 
 class SPDesktop;
+class SPItem;
 class SPNamedView;
 class SPObject;
 class SPPath;
@@ -60,9 +68,95 @@ public:
                   std::vector<SnapCandidatePoint> *unselected_nodes) const override;
 
 private:
-    std::unique_ptr<std::vector<SnapCandidatePoint>> _points_to_snap_to;
+    /// A segment of one of the paths to snap to
+    struct PathSegment {
+        size_t candidate; ///< Index in _paths_to_snap_to
+        size_t path;      ///< Index of the path in the path vector of the candidate
+        size_t curve;     ///< Index of the curve in the path
+        int num_path;     ///< Number of the path among all paths to snap to
+
+        bool operator<(PathSegment const &other) const;
+    };
+
+    /// A point in _points_tree
+    struct TargetPoint {
+        SPItem const *item; ///< Item whose cached targets hold the point, or null for a point of _points_to_snap_to
+        bool bbox;          ///< Whether the point is one of the bounding box points of the item rather than a node
+        size_t group;       ///< Index in _point_groups of a point of _points_to_snap_to
+        size_t index;       ///< Index among the nodes or bounding box points of the item, or in _points_to_snap_to
+    };
+
+    /// A segment in _segments_tree
+    struct TargetSegment {
+        SPItem const *item; ///< Item whose cached targets hold the path, or null for a path only in _paths_to_snap_to
+        bool bbox;          ///< Whether the path is the bounding box of the item rather than its outline
+        size_t candidate;   ///< Index in _paths_to_snap_to of a path which isn't cached
+        size_t path;        ///< Index of the path in the path vector
+        size_t curve;       ///< Index of the curve in the path
+    };
+
+    /**
+     * Points collected for one snap: the cached nodes or bounding box points of an item, or a
+     * range of _points_to_snap_to. Of points at the same distance, the one in the first group wins.
+     */
+    struct PointGroup {
+        SPItem const *item;
+        bool bbox;
+        size_t begin; ///< Range in _points_to_snap_to, if item is null
+        size_t end;
+    };
+
+    /**
+     * Snap targets of an item, kept from one snap to the next until the item is modified or
+     * released, or until a change of the snap preferences or of the desktop transform affects
+     * them all. While valid, they are in the trees of targets.
+     */
+    struct ItemTargets {
+        std::vector<SnapCandidatePoint> nodes;  ///< From SPItem::getSnappoints(), in desktop coordinates
+        bool nodes_valid = false;
+        std::vector<SnapCandidatePoint> bbox_points; ///< In desktop coordinates
+        bool bbox_points_valid = false;
+        std::shared_ptr<Geom::PathVector const> path; ///< Outline of a shape or baseline of a text, in document coordinates
+        bool path_valid = false;
+        std::shared_ptr<Geom::PathVector const> bbox_path; ///< In document coordinates
+        Geom::OptRect bbox;                                ///< In desktop coordinates
+        bool bbox_path_valid = false;
+        std::vector<size_t> point_ids;   ///< Of the points in _points_tree
+        std::vector<size_t> segment_ids; ///< Of the segments in _segments_tree
+        sigc::connection modified_connection;
+        sigc::connection release_connection;
+    };
+
+    std::unique_ptr<std::vector<SnapCandidatePoint>> _points_to_snap_to; ///< Points collected for one snap which aren't cached
     std::unique_ptr<std::vector<SnapCandidatePath >> _paths_to_snap_to;
 
+    // Trees of the cached targets of items, kept across snaps, and of the targets collected for
+    // the current snap which aren't cached
+    mutable SnapTargetTree<TargetPoint> _points_tree;
+    mutable SnapTargetTree<TargetSegment> _segments_tree;
+    mutable std::vector<size_t> _uncached_point_ids;
+    mutable std::vector<size_t> _uncached_segment_ids;
+
+    // What was collected for the current snap
+    mutable std::vector<PointGroup> _point_groups;
+    mutable std::map<std::pair<SPItem const *, bool>, size_t> _item_point_groups; ///< Index in _point_groups of the points of an item
+    mutable std::map<std::pair<SPItem const *, bool>, size_t> _item_paths;        ///< Index in _paths_to_snap_to of the path of an item
+    mutable std::vector<int> _first_num_paths; ///< Number of the first path of each of _paths_to_snap_to
+
+    mutable std::unordered_map<SPItem const *, ItemTargets> _item_targets;
+    mutable std::vector<bool> _item_targets_prefs;  ///< Snap preferences the cached targets were collected with
+    mutable Geom::Affine _item_targets_doc2dt;
+
+    void _checkItemTargets() const;
+    ItemTargets &_getItemTargets(SPItem const *item) const;
+    void _invalidateItemTargets(ItemTargets &targets) const;
+    void _forgetItemTargets(SPItem const *item) const;
+    void _indexPoints(std::vector<SnapCandidatePoint> const &points, size_t begin, size_t end, TargetPoint target,
+                      std::vector<size_t> &ids) const;
+    void _indexPath(Geom::PathVector const &path_vector, TargetSegment target, std::vector<size_t> &ids) const;
+    SnapCandidatePoint const *_findPoint(TargetPoint const &target, size_t &group) const;
+    bool _findSegment(TargetSegment const &target, PathSegment &segment) const;
+
     void _snapNodes(IntermSnapResults &isr,
                       Inkscape::SnapCandidatePoint const &p, // in desktop coordinates
                       std::vector<SnapCandidatePoint> *unselected_nodes,
@@ -74,7 +168,8 @@ private:
                      Geom::Point const &guide_normal) const;
 
     void _collectNodes(Inkscape::SnapSourceType const &t,
-                  bool const &first_point) const;
+                  bool const &first_point,
+                  std::vector<SnapCandidatePoint> const *unselected_nodes = nullptr) const;
 
     void _snapPaths(IntermSnapResults &isr,
                       Inkscape::SnapCandidatePoint const &p, // in desktop coordinates
@@ -100,11 +195,12 @@ private:
      */
     void _collectPaths(Geom::Point p,
                       Inkscape::SnapSourceType const source_type,
-                      bool const &first_point) const;
+                      bool const &first_point,
+                      SPPath const *selected_path = nullptr) const;
 
     void _clear_paths() const;
-    Geom::PathVector* _getBorderPathv() const;
-    Geom::PathVector* _getPathvFromRect(Geom::Rect const rect) const;
+    std::shared_ptr<Geom::PathVector const> _getBorderPathv() const;
+    std::shared_ptr<Geom::PathVector const> _getPathvFromRect(Geom::Rect const rect) const;
     bool _allowSourceToSnapToTarget(SnapSourceType source, SnapTargetType target, bool strict_snapping) const;
 
 }; // end of ObjectSnapper class
@@ -23,6 +23,7 @@
 #include "display/nr-filter-primitive.h"
 
 #include "style.h"
+#include "xml/node.h"
 
 
 // CPPIFY: Make pure virtual.
@@ -242,6 +243,24 @@ int SPFilterPrimitive::name_previous_out() {
     return Inkscape::Filters::NR_FILTER_SOURCEGRAPHIC;
 }
 
+/* Appends the attributes of repr and its children, such as light sources and
+ * transfer functions, to key. */
+static void append_cache_key(std::string &key, Inkscape::XML::Node const *repr)
+{
+    key += repr->name();
+    key += '\n';
+    for (auto const &attr : repr->attributeList()) {
+        key += g_quark_to_string(attr.key);
+        key += '=';
+        key += attr.value.pointer();
+        key += '\n';
+    }
+    for (auto child = repr->firstChild(); child; child = child->next()) {
+        append_cache_key(key, child);
+    }
+    key += '\n';
+}
+
 /* Common initialization for filter primitives */
 void SPFilterPrimitive::renderer_common(Inkscape::Filters::FilterPrimitive *nr_prim)
 {
@@ -257,6 +276,14 @@ void SPFilterPrimitive::renderer_common(Inkscape::Filters::FilterPrimitive *nr_p
 
     // Give renderer access to filter properties
     nr_prim->setStyle( this->style );
+
+    // Allow reuse of results as long as the attributes and the computed style stay the same
+    std::string key;
+    append_cache_key(key, getRepr());
+    if (this->style) {
+        key += this->style->write(SP_STYLE_FLAG_ALWAYS).raw();
+    }
+    nr_prim->set_cache_key(key);
 }
 
 /* Calculate the region taken up by this filter, given the previous region.
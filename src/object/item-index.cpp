@@ -0,0 +1,377 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Spatial index of the items of a document
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "object/item-index.h"
+#include "object/sp-flowtext.h"
+#include "object/sp-item-group.h"
+#include "object/sp-text.h"
+#include "style.h"
+
+namespace Inkscape {
+
+namespace {
+
+size_t const MAX_ENTRIES = 16;
+size_t const MIN_ENTRIES = 6;
+
+/// Bounding box under which an item is indexed, if it is indexed at all.
+Geom::OptRect index_bounds(SPItem *item)
+{
+    if (item->cloned || !dynamic_cast<SPGroup *>(item->parent)) {
+        return Geom::OptRect();
+    }
+    Geom::OptRect box = item->documentVisualBounds();
+    if (box && item->style && (dynamic_cast<SPText *>(item) || dynamic_cast<SPFlowtext *>(item))) {
+        box->expandBy(item->style->font_size.computed * item->i2doc_affine().descrim());
+    }
+    return box;
+}
+
+/**
+ * Moves the upper half of elements to other, splitting them along the axis in which
+ * the centers of their boxes are spread the most.
+ */
+template <typename T, typename GetBox>
+void split_elements(std::vector<T> &elements, std::vector<T> &other, GetBox get_box)
+{
+    Geom::OptRect centers;
+    for (auto const &element : elements) {
+        Geom::Point center = get_box(element).midpoint();
+        centers.unionWith(Geom::Rect(center, center));
+    }
+    Geom::Dim2 d = centers->width() >= centers->height() ? Geom::X : Geom::Y;
+
+    auto middle = elements.begin() + elements.size() / 2;
+    std::nth_element(elements.begin(), middle, elements.end(), [&](T const &a, T const &b) {
+        return get_box(a).midpoint()[d] < get_box(b).midpoint()[d];
+    });
+    other.assign(middle, elements.end());
+    elements.erase(middle, elements.end());
+}
+
+/**
+ * Sort-tile-recursive packing: groups elements into nodes of MAX_ENTRIES neighbours
+ * by sorting them into vertical slices and each slice from top to bottom.
+ */
+template <typename T, typename GetBox>
+std::vector<std::vector<T>> pack_elements(std::vector<T> &elements, GetBox get_box)
+{
+    auto by = [&](Geom::Dim2 d) {
+        return [&get_box, d](T const &a, T const &b) {
+            return get_box(a).midpoint()[d] < get_box(b).midpoint()[d];
+        };
+    };
+
+    size_t n = elements.size();
+    size_t nodes = (n + MAX_ENTRIES - 1) / MAX_ENTRIES;
+    size_t slice_size = static_cast<size_t>(std::ceil(std::sqrt(double(nodes)))) * MAX_ENTRIES;
+
+    std::vector<std::vector<T>> result;
+    std::sort(elements.begin(), elements.end(), by(Geom::X));
+    for (size_t slice = 0; slice < n; slice += slice_size) {
+        size_t slice_end = std::min(slice + slice_size, n);
+        std::sort(elements.begin() + slice, elements.begin() + slice_end, by(Geom::Y));
+        for (size_t i = slice; i < slice_end; i += MAX_ENTRIES) {
+            result.emplace_back(elements.begin() + i, elements.begin() + std::min(i + MAX_ENTRIES, slice_end));
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+struct ItemIndex::Node
+{
+    Node *parent = nullptr;
+    bool leaf = true;
+    Geom::OptRect box;
+    std::vector<Node *> children; ///< Only used by inner nodes
+    std::vector<Entry> items;     ///< Only used by leaves
+
+    ~Node()
+    {
+        for (auto child : children) {
+            delete child;
+        }
+    }
+
+    size_t size() const { return leaf ? items.size() : children.size(); }
+
+    void updateBox()
+    {
+        box = Geom::OptRect();
+        for (auto child : children) {
+            box.unionWith(child->box);
+        }
+        for (auto const &item : items) {
+            box.unionWith(item.first);
+        }
+    }
+};
+
+ItemIndex::ItemIndex()
+    : _root(new Node())
+{}
+
+ItemIndex::~ItemIndex()
+{
+    delete _root;
+}
+
+void ItemIndex::invalidate(SPItem *item)
+{
+    _dirty.insert(item);
+}
+
+void ItemIndex::remove(SPItem *item)
+{
+    _dirty.erase(item);
+    _erase(item);
+}
+
+std::vector<SPItem *> ItemIndex::query(Geom::Rect const &area)
+{
+    _refresh();
+
+    std::vector<SPItem *> result;
+    std::vector<Node const *> stack;
+    if (_root->box && _root->box->intersects(area)) {
+        stack.push_back(_root);
+    }
+    while (!stack.empty()) {
+        Node const *node = stack.back();
+        stack.pop_back();
+        for (auto const &item : node->items) {
+            if (item.first.intersects(area)) {
+                result.push_back(item.second);
+            }
+        }
+        for (auto child : node->children) {
+            if (child->box->intersects(area)) {
+                stack.push_back(child);
+            }
+        }
+    }
+    return result;
+}
+
+size_t ItemIndex::size()
+{
+    _refresh();
+    return _leaves.size();
+}
+
+void ItemIndex::_refresh()
+{
+    if (_dirty.empty()) {
+        return;
+    }
+
+    if (_dirty.size() > _leaves.size() / 2) {
+        // most items changed, e.g. after loading the document: pack the tree again
+        std::vector<Entry> entries;
+        _collect(_root, entries);
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [this](Entry const &entry) { return _dirty.count(entry.second); }),
+                      entries.end());
+        for (auto item : _dirty) {
+            if (Geom::OptRect box = index_bounds(item)) {
+                entries.emplace_back(*box, item);
+            }
+        }
+        _dirty.clear();
+        _pack(entries);
+        return;
+    }
+
+    std::vector<SPItem *> dirty(_dirty.begin(), _dirty.end());
+    _dirty.clear();
+    for (auto item : dirty) {
+        _erase(item);
+        if (Geom::OptRect box = index_bounds(item)) {
+            _insert(Entry(*box, item));
+        }
+    }
+}
+
+void ItemIndex::_insert(Entry const &entry)
+{
+    // descend into the child which grows least
+    Node *node = _root;
+    while (!node->leaf) {
+        Node *best = nullptr;
+        double best_growth = 0, best_area = 0;
+        for (auto child : node->children) {
+            Geom::Rect grown = *child->box;
+            double area = grown.area();
+            grown.unionWith(entry.first);
+            double growth = grown.area() - area;
+            if (!best || growth < best_growth || (growth == best_growth && area < best_area)) {
+                best = child;
+                best_growth = growth;
+                best_area = area;
+            }
+        }
+        node = best;
+    }
+
+    node->items.push_back(entry);
+    _leaves[entry.second] = node;
+    for (Node *n = node; n; n = n->parent) {
+        n->box.unionWith(entry.first);
+    }
+    if (node->items.size() > MAX_ENTRIES) {
+        _split(node);
+    }
+}
+
+void ItemIndex::_split(Node *node)
+{
+    Node *sibling = new Node();
+    sibling->leaf = node->leaf;
+    if (node->leaf) {
+        split_elements(node->items, sibling->items, [](Entry const &entry) { return entry.first; });
+        for (auto const &entry : sibling->items) {
+            _leaves[entry.second] = sibling;
+        }
+    } else {
+        split_elements(node->children, sibling->children, [](Node const *child) { return *child->box; });
+        for (auto child : sibling->children) {
+            child->parent = sibling;
+        }
+    }
+    node->updateBox();
+    sibling->updateBox();
+
+    if (!node->parent) {
+        _root = new Node();
+        _root->leaf = false;
+        _root->children = {node, sibling};
+        _root->updateBox();
+        node->parent = _root;
+        sibling->parent = _root;
+    } else {
+        Node *parent = node->parent;
+        sibling->parent = parent;
+        parent->children.push_back(sibling);
+        if (parent->children.size() > MAX_ENTRIES) {
+            _split(parent);
+        }
+    }
+}
+
+void ItemIndex::_erase(SPItem *item)
+{
+    auto found = _leaves.find(item);
+    if (found == _leaves.end()) {
+        return;
+    }
+    Node *node = found->second;
+    _leaves.erase(found);
+
+    auto &items = node->items;
+    auto entry = std::find_if(items.begin(), items.end(), [=](Entry const &e) { return e.second == item; });
+    *entry = items.back();
+    items.pop_back();
+
+    // remove nodes which became too small and insert their items again
+    std::vector<Entry> orphans;
+    while (node->parent) {
+        Node *parent = node->parent;
+        if (node->size() < MIN_ENTRIES) {
+            auto &siblings = parent->children;
+            siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+            _collect(node, orphans);
+        } else {
+            node->updateBox();
+        }
+        node = parent;
+    }
+    _root->updateBox();
+
+    while (!_root->leaf && _root->children.size() <= 1) {
+        if (_root->children.empty()) {
+            _root->leaf = true;
+            break;
+        }
+        Node *child = _root->children.front();
+        _root->children.clear();
+        delete _root;
+        child->parent = nullptr;
+        _root = child;
+    }
+
+    for (auto const &orphan : orphans) {
+        _insert(orphan);
+    }
+}
+
+/// Moves the entries below node to entries and deletes node.
+void ItemIndex::_collect(Node *node, std::vector<Entry> &entries)
+{
+    for (auto const &entry : node->items) {
+        _leaves.erase(entry.second);
+        entries.push_back(entry);
+    }
+    for (auto child : node->children) {
+        _collect(child, entries);
+    }
+    node->children.clear();
+    delete node;
+}
+
+/// Builds a new tree from entries. The old tree must have been collected.
+void ItemIndex::_pack(std::vector<Entry> &entries)
+{
+    std::vector<Node *> nodes;
+    for (auto &group : pack_elements(entries, [](Entry const &entry) { return entry.first; })) {
+        Node *leaf = new Node();
+        leaf->items = std::move(group);
+        for (auto const &entry : leaf->items) {
+            _leaves[entry.second] = leaf;
+        }
+        leaf->updateBox();
+        nodes.push_back(leaf);
+    }
+
+    while (nodes.size() > 1) {
+        std::vector<Node *> parents;
+        for (auto &group : pack_elements(nodes, [](Node const *node) { return *node->box; })) {
+            Node *parent = new Node();
+            parent->leaf = false;
+            parent->children = std::move(group);
+            for (auto child : parent->children) {
+                child->parent = parent;
+            }
+            parent->updateBox();
+            parents.push_back(parent);
+        }
+        nodes.swap(parents);
+    }
+
+    _root = nodes.empty() ? new Node() : nodes.front();
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Spatial index of the items of a document
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_OBJECT_ITEM_INDEX_H
+#define SEEN_INKSCAPE_OBJECT_ITEM_INDEX_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <2geom/rect.h>
+
+class SPItem;
+
+namespace Inkscape {
+
+/**
+ * R-tree of the visual bounding boxes of the items of a document, in document coordinates.
+ *
+ * Items report that their bounding box may have changed from SPItem::update(), which is
+ * also where SPItem invalidates its cached document bounding box. Changed items are only
+ * collected there; the tree is brought up to date by the next query, by moving the changed
+ * entries, or by packing the whole tree again when most of the items changed.
+ *
+ * Only items whose parent is a group can be found by the document queries, so others are
+ * not indexed. Text is indexed with a margin of its font size, since it is picked by the
+ * boxes of its characters, which extend past the glyph outlines.
+ *
+ * Queries return candidates whose indexed box intersects the query area; the caller
+ * applies the exact test.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    ItemIndex(ItemIndex const &) = delete;
+    ItemIndex &operator=(ItemIndex const &) = delete;
+
+    /// Notes that the bounding box of the item may have changed.
+    void invalidate(SPItem *item);
+
+    /// Removes an item which is released.
+    void remove(SPItem *item);
+
+    /// Returns the items whose indexed bounding box intersects area, in no particular order.
+    std::vector<SPItem *> query(Geom::Rect const &area);
+
+    /// Number of indexed items, after bringing the index up to date.
+    size_t size();
+
+private:
+    typedef std::pair<Geom::Rect, SPItem *> Entry;
+    struct Node;
+
+    void _refresh();
+    void _insert(Entry const &entry);
+    void _split(Node *node);
+    void _erase(SPItem *item);
+    void _collect(Node *node, std::vector<Entry> &entries);
+    void _pack(std::vector<Entry> &entries);
+
+    Node *_root;
+    std::unordered_map<SPItem *, Node *> _leaves; ///< Leaf node of each indexed item
+    std::unordered_set<SPItem *> _dirty;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_OBJECT_ITEM_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
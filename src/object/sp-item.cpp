@@ -32,6 +32,7 @@
 #include "conditions.h"
 #include "filter-chemistry.h"
 
+#include "item-index.h"
 #include "sp-clippath.h"
 #include "sp-desc.h"
 #include "sp-guide.h"
@@ -434,6 +435,7 @@ void SPItem::build(SPDocument *document, Inkscape::XML::Node *repr) {
     object->readAttr(SPAttr::INKSCAPE_HIGHLIGHT_COLOR);
 
     SPObject::build(document, repr);
+    document->getItemIndex().invalidate(this);
 #ifdef OBJECT_TRACE
     objectTrace( "SPItem::build", false);
 #endif
@@ -453,6 +455,8 @@ void SPItem::release() {
     delete item->clip_ref;
     delete item->mask_ref;
 
+    document->getItemIndex().remove(this);
+
     SPObject::release();
 
     SPPaintServer *fill_ps = style->getFillPaintServer();
@@ -555,7 +559,7 @@ void SPItem::set(SPAttr key, gchar const* value) {
 
                 // Propergate the property change to all clones
                 style->readFromObject(object);
-                object->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG);
+                object->requestStyleUpdate();
             } else {
                 SPObject::set(key, value);
             }
@@ -681,6 +685,7 @@ void SPItem::update(SPCtx* ctx, guint flags) {
     // Any of the modifications defined in sp-object.h might change bbox,
     // so we invalidate it unconditionally
     bbox_valid = FALSE;
+    document->getItemIndex().invalidate(this);
 
     viewport = ictx->viewport; // Cache viewport
 
@@ -1029,7 +1029,7 @@ void SPObject::set(SPAttr key, gchar const* value) {
 
         case SPAttr::STYLE:
             object->style->readFromObject( object );
-            object->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG);
+            object->requestStyleUpdate();
             break;
 
         default:
@@ -1158,7 +1158,7 @@ Inkscape::XML::Node* SPObject::write(Inkscape::XML::Document *doc, Inkscape::XML
                 // We need to ask the object to update the style and keep things in sync
                 // see `case SPAttr::STYLE` above for how the style attr itself does this.
                 style->readFromObject(this);
-                requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG);
+                requestStyleUpdate();
             }
 
             // Check for valid attributes. This may be time consuming.
@@ -1255,6 +1255,21 @@ Inkscape::XML::Node * SPObject::updateRepr(Inkscape::XML::Document *doc, Inkscap
 /* Modification */
 
 void SPObject::requestDisplayUpdate(unsigned int flags)
+{
+    if (style && (flags & SP_OBJECT_STYLE_MODIFIED_FLAG)) {
+        // we are not told which properties changed
+        style->markChanged();
+    }
+    _requestDisplayUpdate(flags);
+}
+
+void SPObject::requestStyleUpdate()
+{
+    // read() has worked out which properties changed
+    _requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG);
+}
+
+void SPObject::_requestDisplayUpdate(unsigned int flags)
 {
     g_return_if_fail( this->document != nullptr );
 
@@ -1330,8 +1345,14 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
     if (style) {
         if ((flags & SP_OBJECT_STYLESHEET_MODIFIED_FLAG)) {
             style->readFromObject(this);
-        } else if (parent && (flags & SP_OBJECT_STYLE_MODIFIED_FLAG) && (flags & SP_OBJECT_PARENT_MODIFIED_FLAG)) {
-            style->cascade( this->parent->style );
+        } else if (parent && parent->style && (flags & SP_OBJECT_STYLE_MODIFIED_FLAG) && (flags & SP_OBJECT_PARENT_MODIFIED_FLAG)) {
+            // only what the parent changed, and what depends on it here
+            style->cascade( this->parent->style, this->parent->style->changedProperties() );
+        }
+        if (style->changedProperties().none()) {
+            // Nothing this object or its descendants show has changed, so they don't have to
+            // reset their drawing styles, though the children still get PARENT_MODIFIED.
+            flags &= ~SP_OBJECT_STYLE_MODIFIED_FLAG;
         }
     }
 
@@ -1349,6 +1370,11 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
         g_warning("SPObject::updateDisplay(SPCtx *ctx, unsigned int flags) : throw in ((SPObjectClass *) G_OBJECT_GET_CLASS(this))->update(this, ctx, flags);");
     }
 
+    if (style) {
+        // the children have cascaded the changes by now
+        style->clearChanged();
+    }
+
     assert((document->update_in_progress)--);
 
 #ifdef OBJECT_TRACE
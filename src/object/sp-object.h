@@ -576,6 +576,12 @@ public:
      */
     void requestDisplayUpdate(unsigned int flags);
 
+    /**
+     * Requests a display update after the style has been read again with readFromObject(), which
+     * records the properties that changed, so that only those are cascaded to the descendants.
+     */
+    void requestStyleUpdate();
+
     /**
      * Updates the object's display immediately
      *
@@ -729,6 +735,8 @@ public:
     bool storeAsDouble( char const *key, double *val ) const;
 
 private:
+    void _requestDisplayUpdate(unsigned int flags);
+
     // Private member functions used in the definitions of setTitle(),
     // setDesc(), title() and desc().
 
@@ -363,6 +363,9 @@ void SPOffset::set_shape() {
     	this->rad = (this->rad < 0) ? -0.01 : 0.01;
     }
 
+    // the shapes of the outline and of each part of the offset reuse each other's memory
+    Shape::ScratchScope scratch;
+
     Path *orig = new Path;
     orig->Copy ((Path *)this->originalPath);
 
@@ -23,6 +23,7 @@
 
 #include "message-stack.h"
 #include "path-chemistry.h"     // copy_object_properties()
+#include "preferences.h"
 
 #include "helper/geom.h"        // pathv_to_linear_and_cubic_beziers()
 
@@ -42,6 +43,10 @@
 
 #include "xml/repr-sorting.h"
 
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 using Inkscape::DocumentUndo;
 
 // fonctions utilitaires
@@ -144,6 +149,125 @@ double get_threshold(SPItem const *item, double threshold)
     return threshold;
 }
 
+/**
+ * Number of threads for uniting many paths.
+ */
+static int boolop_threads()
+{
+#ifdef HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    return prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    return 1;
+#endif
+}
+
+/**
+ * Unites paths, each with its fill rule and the threshold for converting it to polygons.
+ * Path i gets the path ID i in the back data of the result, which can thus be converted with
+ * Shape::ConvertToForme(res, originaux.size(), &originaux[0]).
+ *
+ * Adding one path at a time to the result sweeps the whole result once per path. Here the
+ * shapes are united pairwise in a balanced tree instead, so that each sweep works on shapes
+ * of similar size. The sweeps of one level of the tree are independent and run in parallel.
+ */
+static Shape *sp_union_shapes(std::vector<Path *> const &originaux, std::vector<FillRule> const &origWind,
+                              std::vector<double> const &thresholds, int threads)
+{
+    int const count = originaux.size();
+    std::vector<Shape *> shapes(count);
+
+#ifdef HAVE_OPENMP
+    #pragma omp parallel num_threads(threads)
+#endif
+    {
+        // the sweeps of each thread reuse each other's memory
+        Shape::ScratchScope scratch;
+#ifdef HAVE_OPENMP
+        #pragma omp for schedule(dynamic)
+#endif
+        for (int i = 0; i < count; i++) {
+            Shape polygon;
+            originaux[i]->ConvertWithBackData(thresholds[i]);
+            originaux[i]->Fill(&polygon, i);
+            shapes[i] = new Shape;
+            shapes[i]->ConvertToShape(&polygon, origWind[i]);
+        }
+    }
+
+    while (shapes.size() > 1) {
+        int const pairs = shapes.size() / 2;
+        std::vector<Shape *> united(shapes.size() - pairs);
+
+#ifdef HAVE_OPENMP
+        #pragma omp parallel num_threads(threads)
+#endif
+        {
+            Shape::ScratchScope scratch;
+#ifdef HAVE_OPENMP
+            #pragma omp for schedule(dynamic)
+#endif
+            for (int i = 0; i < pairs; i++) {
+                Shape *a = shapes[2 * i];
+                Shape *b = shapes[2 * i + 1];
+                // quantization may leave a shape empty, in which case the other one is the union
+                if (a->numberOfEdges() == 0) {
+                    std::swap(a, b);
+                }
+                if (b->numberOfEdges() == 0) {
+                    united[i] = a;
+                } else {
+                    united[i] = new Shape;
+                    united[i]->Booleen(b, a, bool_op_union);
+                    delete a;
+                }
+                delete b;
+            }
+        }
+
+        if (shapes.size() % 2) {
+            united.back() = shapes.back();
+        }
+        shapes.swap(united);
+    }
+
+    return shapes.front();
+}
+
+Geom::PathVector sp_pathvector_union(std::vector<Geom::PathVector> const &pathvs, FillRule fill, int threads)
+{
+    if (pathvs.empty()) {
+        return Geom::PathVector();
+    }
+
+    std::vector<Path *> originaux;
+    std::vector<FillRule> origWind(pathvs.size(), fill);
+    std::vector<double> thresholds;
+    for (auto const &pathv : pathvs) {
+        // Livarot's outline of arcs is broken, see sp_pathvector_boolop
+        originaux.push_back(Path_for_pathvector(pathv_to_linear_and_cubic_beziers(pathv)));
+        thresholds.push_back(get_threshold(pathv, 0.1));
+    }
+
+    Shape *theShape = sp_union_shapes(originaux, origWind, thresholds, threads > 0 ? threads : boolop_threads());
+
+    Path *res = new Path;
+    res->SetBackData(false);
+    theShape->ConvertToForme(res, originaux.size(), &originaux[0]);
+
+    delete theShape;
+    for (auto orig : originaux) {
+        delete orig;
+    }
+
+    gchar *result_str = res->svg_dump_path();
+    Geom::PathVector outres = Geom::parse_svg_path(result_str);
+    g_free(result_str);
+
+    delete res;
+    return outres;
+}
+
 void
 sp_flatten(Geom::PathVector &pathvector, FillRule fillkind)
 {
@@ -565,7 +689,15 @@ BoolOpErrors Inkscape::ObjectSet::pathBoolOp(bool_op bop, const bool skip_undo,
     Path::cut_position  *toCut=nullptr;
     int                  nbToCut=0;
 
-    if ( bop == bool_op_inters || bop == bool_op_union || bop == bool_op_diff || bop == bool_op_symdiff ) {
+    if ( bop == bool_op_union && nbOriginaux > 2 ) {
+        std::vector<double> thresholds;
+        for (auto item : il) {
+            thresholds.push_back(get_threshold(item, 0.1));
+        }
+        delete theShape;
+        theShape = sp_union_shapes(originaux, origWind, thresholds, boolop_threads());
+
+    } else if ( bop == bool_op_inters || bop == bool_op_union || bop == bool_op_diff || bop == bool_op_symdiff ) {
         // true boolean op
         // get the polygons of each path, with the winding rule specified, and apply the operation iteratively
         originaux[0]->ConvertWithBackData(get_threshold(il[0], 0.1));
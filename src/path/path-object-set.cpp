@@ -19,6 +19,8 @@
 
 #include "attribute-rel-util.h"
 
+#include "livarot/Shape.h"
+
 #include "object/object-set.h"
 #include "path/path-outline.h"
 #include "path/path-simplify.h"
@@ -48,6 +50,9 @@ ObjectSet::strokesToPaths(bool legacy, bool skip_undo)
 
   std::vector<SPItem *> my_items(items().begin(), items().end());
 
+  // the outlines of all items reuse each other's memory
+  Shape::ScratchScope scratch;
+
   for (auto item : my_items) {
     // Do not remove the object from the selection here 
     // as we want to keep it selected if the whole operation fails
@@ -152,6 +152,7 @@ void sp_selected_path_create_offset_object(SPDesktop *desktop, int expand, bool
     res->SetBackData(false);
 
     {
+        Shape::ScratchScope scratch;
         Shape *theShape = new Shape;
         Shape *theRes = new Shape;
 
@@ -282,6 +283,8 @@ sp_selected_path_do_offset(SPDesktop *desktop, bool expand, double prefOffset)
 
     bool did = false;
     std::vector<SPItem*> il(selection->items().begin(), selection->items().end());
+    // the offsets of all items reuse each other's memory
+    Shape::ScratchScope scratch;
     for (auto item : il){
         if (auto shape = dynamic_cast<SPShape const *>(item)) {
             if (!shape->curve())
@@ -164,12 +164,14 @@ item_find_paths(const SPItem *item, Geom::PathVector& fill, Geom::PathVector& st
 
         offset->ConvertWithBackData(1.0); // Approximate by polyline
 
-        Shape *theShape  = new Shape;
-        offset->Fill(theShape, 0); // Convert polyline to shape, step 1.
+        Shape::ScratchScope scratch;
 
-        Shape *theOffset = new Shape;
-        theOffset->ConvertToShape(theShape, fill_positive); // Create an intersection free polygon (theOffset), step2.
-        theOffset->ConvertToForme(origin, 1, &offset); // Turn shape into contour (stored in origin).
+        Shape theShape;
+        offset->Fill(&theShape, 0); // Convert polyline to shape, step 1.
+
+        Shape theOffset;
+        theOffset.ConvertToShape(&theShape, fill_positive); // Create an intersection free polygon (theOffset), step2.
+        theOffset.ConvertToForme(origin, 1, &offset); // Turn shape into contour (stored in origin).
 
         stroke = origin->MakePathVector(); // Note origin was replaced above by stroke!
     }
@@ -476,8 +476,11 @@ void Preferences::mergeStyle(Glib::ustring const &pref_path, SPCSSAttr *style)
  */
 void Preferences::remove(Glib::ustring const &pref_path)
 {
-    auto it = cachedRawValue.find(pref_path.c_str());
-    if (it != cachedRawValue.end()) cachedRawValue.erase(it);
+    {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        auto it = cachedRawValue.find(pref_path.c_str());
+        if (it != cachedRawValue.end()) cachedRawValue.erase(it);
+    }
 
     Inkscape::XML::Node *node = _getNode(pref_path, false);
     if (node && node->parent()) {
@@ -713,6 +716,9 @@ Inkscape::XML::Node *Preferences::_getNode(Glib::ustring const &pref_key, bool c
 
 void Preferences::_getRawValue(Glib::ustring const &path, gchar const *&result)
 {
+    // values are read from the canvas render threads too, see Canvas::paint_rect_threaded()
+    std::lock_guard<std::mutex> lock(_cache_mutex);
+
     // will return empty string if `path` was not in the cache yet
     auto& cacheref = cachedRawValue[path.c_str()];
 
@@ -760,6 +766,7 @@ void Preferences::_setRawValue(Glib::ustring const &path, Glib::ustring const &v
     // update cache first, so by the time notification change fires and observers are called,
     // they have access to current settings even if they watch a group
     if (_initialized) {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
         cachedRawValue[path.c_str()] = RAWCACHE_CODE_VALUE + value;
     }
 
@@ -19,6 +19,7 @@
 #include <glibmm/ustring.h>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -650,6 +651,7 @@ private:
     bool _hasError = false; ///< Indication that some error has occurred;
     bool _initialized = false; ///< Is this instance fully initialized? Caching should be avoided before.
     std::unordered_map<std::string, Glib::ustring> cachedRawValue;
+    std::mutex _cache_mutex; ///< Guards cachedRawValue, getters may be called from render threads.
 
     /// Wrapper class for XML node observers
     class PrefNodeObserver;
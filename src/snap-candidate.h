@@ -18,6 +18,7 @@
 #include <2geom/point.h>
 #include <2geom/rect.h>
 #include <cstdio>
+#include <memory>
 #include <utility>
 
 #include "snap-enums.h"
@@ -139,11 +140,11 @@ class SnapCandidatePath
 {
 
 public:
-    SnapCandidatePath(Geom::PathVector* path, SnapTargetType target, Geom::OptRect bbox, bool edited = false)
-        : path_vector(path), target_type(target), target_bbox(std::move(bbox)), currently_being_edited(edited) {};
+    SnapCandidatePath(std::shared_ptr<Geom::PathVector const> path, SnapTargetType target, Geom::OptRect bbox, bool edited = false)
+        : path_vector(std::move(path)), target_type(target), target_bbox(std::move(bbox)), currently_being_edited(edited) {};
     ~SnapCandidatePath() = default;;
 
-    Geom::PathVector* path_vector;
+    std::shared_ptr<Geom::PathVector const> path_vector; // in document coordinates; may be shared with the snapper's cache
     SnapTargetType target_type;
     Geom::OptRect target_bbox;
     bool currently_being_edited; // true for the path that's currently being edited in the node tool (if any)
@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Bounding volume hierarchy of snap targets, for finding the targets near a point
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_SNAP_TARGET_TREE_H
+#define SEEN_SNAP_TARGET_TREE_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <2geom/rect.h>
+
+namespace Inkscape {
+
+/**
+ * Tree of the bounding boxes of a set of snap targets, such as the items of a document or the
+ * points and path segments of those items. It finds the targets whose box meets a query area,
+ * such as the snap tolerance around the point being snapped, in logarithmic time.
+ *
+ * The tree is kept while targets come and go. Each target gets an id when it is added, by
+ * which it can be moved or removed again. A moved target stays in its leaf, whose box and
+ * those of its ancestors are refitted; added targets are searched linearly until the tree is
+ * rebuilt. The tree is rebuilt, by splitting the targets at the median of the longer side
+ * until a handful are left in each leaf, once the changes since the last build amount to half
+ * of the targets.
+ */
+template <typename T>
+class SnapTargetTree
+{
+public:
+    typedef std::pair<Geom::Rect, T> Entry;
+
+    /// Replaces the targets by those of entries, whose ids are their positions in entries.
+    void build(std::vector<Entry> entries)
+    {
+        clear();
+        for (auto &entry : entries) {
+            _targets.push_back(Target{entry.first, std::move(entry.second), NONE, true});
+        }
+        _live = _targets.size();
+        _rebuild();
+    }
+
+    void clear()
+    {
+        _targets.clear();
+        _free.clear();
+        _removed.clear();
+        _added.clear();
+        _order.clear();
+        _nodes.clear();
+        _live = 0;
+        _changes = 0;
+    }
+
+    bool empty() const { return _live == 0; }
+    size_t size() const { return _live; }
+
+    /// Adds a target and returns its id.
+    size_t insert(Geom::Rect const &box, T value)
+    {
+        size_t id;
+        if (_free.empty()) {
+            id = _targets.size();
+            _targets.push_back(Target{box, std::move(value), NONE, true});
+        } else {
+            id = _free.back();
+            _free.pop_back();
+            _targets[id] = Target{box, std::move(value), NONE, true};
+        }
+        _added.push_back(id);
+        _live++;
+        _changed();
+        return id;
+    }
+
+    /// Gives a target a new box.
+    void update(size_t id, Geom::Rect const &box)
+    {
+        Target &target = _targets[id];
+        target.box = box;
+        if (target.leaf != NONE) {
+            _refit(target.leaf);
+        }
+        _changed();
+    }
+
+    /// Removes a target. Its id may be given to a target added later.
+    void remove(size_t id)
+    {
+        Target &target = _targets[id];
+        target.live = false;
+        _live--;
+        if (target.leaf == NONE) {
+            _added.erase(std::find(_added.begin(), _added.end(), id));
+            _free.push_back(id);
+        } else {
+            // still referred to by its leaf
+            _removed.push_back(id);
+        }
+        _changed();
+    }
+
+    T const &value(size_t id) const { return _targets[id].value; }
+
+    /// Calls f with each target whose box intersects area, in no particular order.
+    template <typename F>
+    void query(Geom::Rect const &area, F &&f) const
+    {
+        if (!_nodes.empty()) {
+            size_t stack[64];
+            size_t depth = 0;
+            stack[depth++] = 0;
+            while (depth > 0) {
+                Node const &node = _nodes[stack[--depth]];
+                if (!node.box.intersects(area)) {
+                    continue;
+                }
+                if (node.left == NONE) {
+                    for (size_t i = node.begin; i < node.end; ++i) {
+                        Target const &target = _targets[_order[i]];
+                        if (target.live && target.box.intersects(area)) {
+                            f(target.value);
+                        }
+                    }
+                } else {
+                    stack[depth++] = node.left;
+                    stack[depth++] = node.right;
+                }
+            }
+        }
+        for (auto id : _added) {
+            if (_targets[id].box.intersects(area)) {
+                f(_targets[id].value);
+            }
+        }
+    }
+
+private:
+    static size_t const LEAF_SIZE = 8;
+    static size_t const NONE = size_t(-1);
+
+    struct Target
+    {
+        Geom::Rect box;
+        T value;
+        size_t leaf; ///< Index of the leaf holding the target, or NONE if it was added since the last build
+        bool live;
+    };
+
+    struct Node
+    {
+        Geom::Rect box;
+        size_t begin; ///< Range of the targets in _order
+        size_t end;
+        size_t left;  ///< Index of the first child, or NONE for a leaf
+        size_t right;
+        size_t parent;
+    };
+
+    void _changed()
+    {
+        if (++_changes > LEAF_SIZE + _live / 2) {
+            _rebuild();
+        }
+    }
+
+    void _rebuild()
+    {
+        _free.insert(_free.end(), _removed.begin(), _removed.end());
+        _removed.clear();
+        _added.clear();
+        _order.clear();
+        _nodes.clear();
+        _changes = 0;
+        for (size_t id = 0; id < _targets.size(); ++id) {
+            if (_targets[id].live) {
+                _order.push_back(id);
+            }
+        }
+        if (!_order.empty()) {
+            _build(0, _order.size(), NONE);
+        }
+    }
+
+    /// Returns the index of the node of the targets from begin to end.
+    size_t _build(size_t begin, size_t end, size_t parent)
+    {
+        size_t const index = _nodes.size();
+        _nodes.push_back(Node{_targets[_order[begin]].box, begin, end, NONE, NONE, parent});
+
+        Geom::Rect box = _targets[_order[begin]].box;
+        for (size_t i = begin + 1; i < end; ++i) {
+            box.unionWith(_targets[_order[i]].box);
+        }
+
+        size_t left = NONE;
+        size_t right = NONE;
+        if (end - begin > LEAF_SIZE) {
+            Geom::Dim2 d = box.width() >= box.height() ? Geom::X : Geom::Y;
+            size_t const middle = begin + (end - begin) / 2;
+            std::nth_element(_order.begin() + begin, _order.begin() + middle, _order.begin() + end,
+                             [this, d](size_t a, size_t b) {
+                                 return _targets[a].box.midpoint()[d] < _targets[b].box.midpoint()[d];
+                             });
+            left = _build(begin, middle, index);
+            right = _build(middle, end, index);
+        } else {
+            for (size_t i = begin; i < end; ++i) {
+                _targets[_order[i]].leaf = index;
+            }
+        }
+
+        // the children may have reallocated the nodes
+        Node &node = _nodes[index];
+        node.box = box;
+        node.left = left;
+        node.right = right;
+        return index;
+    }
+
+    /// Recomputes the boxes of a leaf and its ancestors after a target in it moved.
+    void _refit(size_t leaf)
+    {
+        Node &node = _nodes[leaf];
+        node.box = _targets[_order[node.begin]].box;
+        for (size_t i = node.begin + 1; i < node.end; ++i) {
+            node.box.unionWith(_targets[_order[i]].box);
+        }
+        for (size_t i = node.parent; i != NONE; i = _nodes[i].parent) {
+            _nodes[i].box = _nodes[_nodes[i].left].box;
+            _nodes[i].box.unionWith(_nodes[_nodes[i].right].box);
+        }
+    }
+
+    std::vector<Target> _targets; ///< By id
+    std::vector<size_t> _free;    ///< Ids which can be given out again
+    std::vector<size_t> _removed; ///< Ids of removed targets which are still in a leaf
+    std::vector<size_t> _added;   ///< Ids of targets added since the last build
+    std::vector<size_t> _order;   ///< Ids of the targets of the tree, ordered by leaf
+    std::vector<Node> _nodes;     ///< The root first
+    size_t _live = 0;
+    size_t _changes = 0; ///< Changes since the last build
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_SNAP_TARGET_TREE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -16,6 +16,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -31,6 +32,7 @@
 #include "object/sp-mask.h"
 #include "live_effects/effect-enum.h"
 #include "object/sp-filter.h"
+#include "object/sp-item-group.h"
 #include "object/sp-object.h"
 #include "object/sp-page.h"
 #include "object/sp-clippath.h"
@@ -64,7 +66,8 @@ SnapManager::SnapManager(SPNamedView const *v, Inkscape::SnapPreferences& prefer
     _rotation_center_source_items(std::vector<SPItem*>()),
     _desktop(nullptr),
     _snapindicator(true),
-    _unselected_nodes(nullptr)
+    _unselected_nodes(nullptr),
+    _indexed_document(nullptr)
 {
     obj_snapper_candidates = std::make_unique<std::vector<Inkscape::SnapCandidateItem>>();
     align_snapper_candidates = std::make_unique<std::vector<Inkscape::SnapCandidateItem>>();
@@ -74,6 +77,7 @@ SnapManager::~SnapManager()
 {
     obj_snapper_candidates->clear();
     align_snapper_candidates->clear();
+    _clearItemIndex();
 }
 
 SnapManager::SnapperList SnapManager::getSnappers() const
@@ -159,7 +163,7 @@ Inkscape::SnappedPoint SnapManager::freeSnap(Inkscape::SnapCandidatePoint const
 
     if (p.getSourceNum() <= 0){
         Geom::Rect const local_bbox_to_snap = bbox_to_snap ? *bbox_to_snap : Geom::Rect(p.getPoint(), p.getPoint());
-        _findCandidates(getDocument()->getRoot(), &_objects_to_ignore, p.getSourceNum() <= 0, local_bbox_to_snap, false, Geom::identity());
+        _findCandidates(&_objects_to_ignore, p.getSourceNum() <= 0, local_bbox_to_snap);
     }
 
     for (auto snapper : snappers) {
@@ -287,7 +291,7 @@ Inkscape::SnappedPoint SnapManager::constrainedSnap(Inkscape::SnapCandidatePoint
     // this makes sure that _findCandidates populates the respective vectors for a snapper.
     if (p.getSourceNum() <= 0){
         Geom::Rect const local_bbox_to_snap = bbox_to_snap ? *bbox_to_snap : Geom::Rect(p.getPoint(), p.getPoint());
-        _findCandidates(getDocument()->getRoot(), &_objects_to_ignore, p.getSourceNum() <= 0, local_bbox_to_snap, false, Geom::identity());
+        _findCandidates(&_objects_to_ignore, p.getSourceNum() <= 0, local_bbox_to_snap);
     }
 
     IntermSnapResults isr;
@@ -441,7 +445,7 @@ void SnapManager::guideFreeSnap(Geom::Point &p, Geom::Point &origin_or_vector, b
     }
 
     // collect candidates
-    _findCandidates(getDocument()->getRoot(), &_objects_to_ignore, true, Geom::Rect(p, p), false, Geom::identity());
+    _findCandidates(&_objects_to_ignore, true, Geom::Rect(p, p));
 
     IntermSnapResults isr;
     SnapperList snappers = getSnappers();
@@ -473,7 +477,7 @@ void SnapManager::guideConstrainedSnap(Geom::Point &p, SPGuide const &guideline)
     Inkscape::Snapper::SnapConstraint cl(guideline.getPoint(), Geom::rot90(guideline.getNormal()));
 
     // collect candidates
-    _findCandidates(getDocument()->getRoot(), &_objects_to_ignore, true, Geom::Rect(p, p), false, Geom::identity());
+    _findCandidates(&_objects_to_ignore, true, Geom::Rect(p, p));
 
     SnapperList snappers = getSnappers();
     for (SnapperList::const_iterator i = snappers.begin(); i != snappers.end(); ++i) {
@@ -846,12 +850,27 @@ SPPage const *SnapManager::getPageToIgnore() const
 }
 
 
-void SnapManager::_findCandidates(SPObject* parent,
-                                 std::vector<SPObject const *> const *it,
+namespace {
+
+/// Whether snapping to an item would let a boolean operation snap to itself
+bool is_stopper(SPItem const *item)
+{
+    if (!item->style) {
+        return false;
+    }
+    SPFilter *filt = item->style->getFilter();
+    if (filt && filt->getId() && strcmp(filt->getId(), "selectable_hidder_filter") == 0) {
+        return true;
+    }
+    SPLPEItem const *lpeitem = dynamic_cast<SPLPEItem const *>(item);
+    return lpeitem && lpeitem->hasPathEffectOfType(Inkscape::LivePathEffect::EffectType::BOOL_OP);
+}
+
+} // namespace
+
+void SnapManager::_findCandidates(std::vector<SPObject const *> const *it,
                                  bool const &first_point,
-                                 Geom::Rect const &bbox_to_snap,
-                                 bool const clip_or_mask,
-                                 Geom::Affine const additional_affine) const
+                                 Geom::Rect const &bbox_to_snap) const
 {
     SPDesktop const *dt = getDesktop();
     if (dt == nullptr) {
@@ -865,134 +884,298 @@ void SnapManager::_findCandidates(SPObject* parent,
         align_snapper_candidates->clear();
     }
 
+    _updateItemIndex();
+
     Geom::Rect bbox_to_snap_incl = bbox_to_snap; // _incl means: will include the snapper tolerance
     bbox_to_snap_incl.expandBy(object.getSnapperTolerance()); // see?
 
-    for (auto& o: parent->children) {
-        SPItem *item = dynamic_cast<SPItem *>(&o);
-        if (item && !(dt->itemIsHidden(item) && !clip_or_mask)) {
-            // Fix LPE boolops selfsnaping
-            bool stop = false;
-            if (item->style) {
-                SPFilter *filt = item->style->getFilter();
-                if (filt && filt->getId() && strcmp(filt->getId(), "selectable_hidder_filter") == 0) {
-                    stop = true;
-                }
-                SPLPEItem *lpeitem = dynamic_cast<SPLPEItem *>(item);
-                if (lpeitem && lpeitem->hasPathEffectOfType(Inkscape::LivePathEffect::EffectType::BOOL_OP)) {
-                    stop = true;
-                }
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    int prefs_bbox = prefs->getBool("/tools/bounding_box", false);
+    // We'll only need to obtain the visual bounding box if the user preferences tell
+    // us to, AND if we are snapping to the bounding box itself. If we're snapping to
+    // paths only, then we can just as well use the geometric bounding box (which is faster)
+    SPItem::BBoxType bbox_type = (!prefs_bbox && snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_BBOX_CATEGORY)) ?
+        SPItem::VISUAL_BBOX : SPItem::GEOMETRIC_BBOX;
+
+    // Fix LPE boolops selfsnaping
+    bool ignoring_stoppers = false;
+    if (it != nullptr) {
+        for (auto skipitem : *it) {
+            SPItem const *toskip = dynamic_cast<SPItem const *>(skipitem);
+            if (toskip && is_stopper(toskip)) {
+                ignoring_stoppers = true;
+                break;
             }
-            if (stop) {
-                stop = false;
-                for (auto skipitem : *it) {
-                    if (skipitem && skipitem->style) {
-                        SPItem *toskip = dynamic_cast<SPItem *>(const_cast<SPObject *>(skipitem));
-                        if (toskip) {
-                            SPFilter *filt = toskip->style->getFilter();
-                            if (filt && filt->getId() && strcmp(filt->getId(), "selectable_hidder_filter") == 0) {
-                                stop = true;
-                                break;
-                            }
-
-                            SPLPEItem *lpeitem = dynamic_cast<SPLPEItem *>(toskip);
-                            if (!stop && lpeitem &&
-                                lpeitem->hasPathEffectOfType(Inkscape::LivePathEffect::EffectType::BOOL_OP)) {
-                                stop = true;
-                                break;
-                            }
-                        }
-                    }
-                }
-                if (stop) {
-                    continue;
-                }
+        }
+    }
+
+    // Only the items with a corner of their box on screen are candidates
+    auto display_area = dt->get_display_area();
+    std::vector<IndexedItem const *> found;
+    _item_tree.query(display_area.bounds(), [&](IndexedItem const *entry) {
+        Geom::OptRect const &bbox_of_item = bbox_type == SPItem::VISUAL_BBOX ? entry->visual_bbox : entry->geometric_bbox;
+        if (bbox_of_item && (display_area.contains(bbox_of_item->min()) || display_area.contains(bbox_of_item->max()))) {
+            found.push_back(entry);
+        }
+    });
+
+    // List the candidates in document order, the items of the clip and mask of an item before
+    // the item itself or, for a group, its children
+    std::sort(found.begin(), found.end(), [](IndexedItem const *a, IndexedItem const *b) {
+        SPObject const *a_anchor = a->owner ? a->owner : a->item;
+        SPObject const *b_anchor = b->owner ? b->owner : b->item;
+        if (a_anchor != b_anchor) {
+            if (a_anchor->isAncestorOf(b_anchor) || b_anchor->isAncestorOf(a_anchor)) {
+                return a_anchor->isAncestorOf(b_anchor);
             }
-            // Snapping to items in a locked layer is allowed
-            // Don't snap to hidden objects, unless they're a clipped path or a mask
-            /* See if this item is on the ignore list */
-            std::vector<SPObject const *>::const_iterator i;
-            if (it != nullptr) {
-                i = it->begin();
-                while (i != it->end() && *i != &o) {
-                    ++i;
-                }
+            return sp_object_compare_position_bool(a_anchor, b_anchor);
+        }
+        if ((a->owner != nullptr) != (b->owner != nullptr)) {
+            return a->owner != nullptr;
+        }
+        return sp_object_compare_position_bool(a->item, b->item);
+    });
+
+    SPObject const *root = getDocument()->getRoot();
+    for (auto entry : found) {
+        SPItem *item = entry->item;
+        bool const clip_or_mask = entry->owner != nullptr;
+        Geom::Affine additional_affine = Geom::identity();
+
+        // Snapping to items in a locked layer is allowed
+        // Don't snap to hidden objects, unless they're a clipped path or a mask
+        if (clip_or_mask) {
+            // The item is the subject of clipping or masking by a path or mask which we
+            // should also consider for snapping to
+            SPObject const *clip = entry->owner->getClipObject();
+            SPObject const *mask = entry->owner->getMaskObject();
+            SPObject const *top = item->parent;
+            while (top && top != clip && top != mask) {
+                top = top->parent;
+            }
+            if (!top || (top == clip && !snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_CLIP))
+                    || (top == mask && !snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_MASK))) {
+                continue;
             }
+            if (!_isSnapTarget(item, top, true, it, ignoring_stoppers)
+                    || !_isSnapTarget(entry->owner, root, false, it, ignoring_stoppers)) {
+                continue;
+            }
+            additional_affine = entry->owner->i2doc_affine();
+        } else if (!_isSnapTarget(item, root, false, it, ignoring_stoppers)) {
+            continue;
+        }
 
-            if (it == nullptr || i == it->end()) {
-                if (item) {
-                    if (!clip_or_mask) { // cannot clip or mask more than once
-                        // The current item is not a clipping path or a mask, but might
-                        // still be the subject of clipping or masking itself ; if so, then
-                        // we should also consider that path or mask for snapping to
-                        SPObject *obj = item->getClipObject();
-                        if (obj && snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_CLIP)) {
-                            _findCandidates(obj, it, false, bbox_to_snap, true, item->i2doc_affine());
-                        }
-                        obj = item->getMaskObject();
-                        if (obj && snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_MASK)) {
-                            _findCandidates(obj, it, false, bbox_to_snap, true, item->i2doc_affine());
-                        }
-                    }
-
-                    if (dynamic_cast<SPGroup *>(item)) {
-                        _findCandidates(&o, it, false, bbox_to_snap, clip_or_mask, additional_affine);
-                    } else {
-                        Geom::OptRect bbox_of_item;
-                        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-                        int prefs_bbox = prefs->getBool("/tools/bounding_box", false);
-                        // We'll only need to obtain the visual bounding box if the user preferences tell
-                        // us to, AND if we are snapping to the bounding box itself. If we're snapping to
-                        // paths only, then we can just as well use the geometric bounding box (which is faster)
-                        SPItem::BBoxType bbox_type = (!prefs_bbox && snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_BBOX_CATEGORY)) ?
-                            SPItem::VISUAL_BBOX : SPItem::GEOMETRIC_BBOX;
-                        if (clip_or_mask) {
-                            // Oh oh, this will get ugly. We cannot use sp_item_i2d_affine directly because we need to
-                            // insert an additional transformation in document coordinates (code copied from sp_item_i2d_affine)
-                            bbox_of_item = item->bounds(bbox_type, item->i2doc_affine() * additional_affine * dt->doc2dt());
-                        } else {
-                            bbox_of_item = item->desktopBounds(bbox_type);
-                        }
-                        if (bbox_of_item) {
-                            bool overflow = false;
-                            // See if the item is within range
-                            auto display_area = getDesktop()->get_display_area();
-                            if (display_area.contains(bbox_of_item->min()) || display_area.contains(bbox_of_item->max())) {
-                                // Finally add the object to _candidates.
-                                align_snapper_candidates->push_back(Inkscape::SnapCandidateItem(item, clip_or_mask, additional_affine));
-                                // For debugging: print the id of the candidate to the console
-                                // SPObject *obj = (SPObject*)item;
-                                // std::cout << "Snap candidate added: " << obj->getId() << std::endl;
-
-                                if (bbox_to_snap_incl.intersects(*bbox_of_item)
-                                        || (snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_ROTATION_CENTER) && bbox_to_snap_incl.contains(item->getCenter()))) { // rotation center might be outside of the bounding box
-                                    // This item is within snapping range, so record it as a candidate
-                                    obj_snapper_candidates->push_back(Inkscape::SnapCandidateItem(item, clip_or_mask, additional_affine));
-                                    // For debugging: print the id of the candidate to the console
-                                    // SPObject *obj = (SPObject*)item;
-                                    // std::cout << "Snap candidate added: " << obj->getId() << std::endl;
-                                }
-
-                                if (align_snapper_candidates->size() > 200) { // This makes Inkscape crawl already
-                                    overflow = true;
-                                }
-                            }
-
-                            if (overflow) {
-                                static Glib::Timer timer;
-                                if (timer.elapsed() > 1.0) {
-                                    timer.reset();
-                                    std::cout << "Warning: limit of 200 snap target paths reached, some will be ignored" << std::endl;
-                                }
-                                break;
-                            }
-                        }
-                    }
-                }
+        // Finally add the object to _candidates.
+        align_snapper_candidates->push_back(Inkscape::SnapCandidateItem(item, clip_or_mask, additional_affine));
+
+        Geom::OptRect const &bbox_of_item = bbox_type == SPItem::VISUAL_BBOX ? entry->visual_bbox : entry->geometric_bbox;
+        if (bbox_to_snap_incl.intersects(*bbox_of_item)
+                || (snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_ROTATION_CENTER) && bbox_to_snap_incl.contains(item->getCenter()))) { // rotation center might be outside of the bounding box
+            // This item is within snapping range, so record it as a candidate
+            obj_snapper_candidates->push_back(Inkscape::SnapCandidateItem(item, clip_or_mask, additional_affine));
+        }
+
+        if (align_snapper_candidates->size() > 200) { // This makes Inkscape crawl already
+            static Glib::Timer timer;
+            if (timer.elapsed() > 1.0) {
+                timer.reset();
+                std::cout << "Warning: limit of 200 snap target paths reached, some will be ignored" << std::endl;
             }
+            break;
+        }
+    }
+}
+
+/**
+ * Whether an item may be snapped to: neither it nor any group it is in below top is
+ * hidden, unless in a clip or mask, or on the list of items to ignore.
+ */
+bool SnapManager::_isSnapTarget(SPItem *item, SPObject const *top, bool clip_or_mask,
+                                std::vector<SPObject const *> const *it, bool ignoring_stoppers) const
+{
+    for (SPObject *o = item; o != top; o = o->parent) {
+        SPItem *ancestor = dynamic_cast<SPItem *>(o);
+        if (!ancestor) {
+            // not in the document anymore
+            return false;
+        }
+        if (!clip_or_mask && getDesktop()->itemIsHidden(ancestor)) {
+            return false;
+        }
+        if (ignoring_stoppers && is_stopper(ancestor)) {
+            return false;
+        }
+        if (it != nullptr && std::find(it->begin(), it->end(), o) != it->end()) {
+            return false;
         }
     }
+    return true;
 }
+
+/**
+ * Brings the index of the items up to date: indexes the whole document if it was replaced or
+ * its transform to the desktop changed, and otherwise updates the items modified since.
+ */
+void SnapManager::_updateItemIndex() const
+{
+    SPDocument *document = getDocument();
+    Geom::Affine const doc2dt = getDesktop()->doc2dt();
+    if (document != _indexed_document || doc2dt != _indexed_doc2dt) {
+        _clearItemIndex();
+        _indexed_document = document;
+        _indexed_doc2dt = doc2dt;
+        if (document && document->getRoot()) {
+            _indexItem(document->getRoot(), nullptr);
+        }
+        return;
+    }
+
+    // updating a group may index new items, which are up to date already
+    while (!_dirty_items.empty()) {
+        ItemKey const key = _dirty_items.back();
+        _dirty_items.pop_back();
+        auto found = _indexed_items.find(key);
+        if (found != _indexed_items.end() && found->second.dirty) {
+            _updateIndexedItem(found->second);
+        }
+    }
+}
+
+void SnapManager::_indexChildren(SPObject *parent, SPItem *owner) const
+{
+    for (auto &child : parent->children) {
+        if (auto item = dynamic_cast<SPItem *>(&child)) {
+            _indexItem(item, owner);
+        }
+    }
+}
+
+/**
+ * Adds an item to the index, with its children if it is a group. The item is updated
+ * whenever it is modified, and forgotten when it is released.
+ */
+void SnapManager::_indexItem(SPItem *item, SPItem *owner) const
+{
+    ItemKey const key(owner, item);
+    if (_indexed_items.count(key)) {
+        return;
+    }
+
+    IndexedItem &entry = _indexed_items[key];
+    entry.item = item;
+    entry.owner = owner;
+    bool const group = dynamic_cast<SPGroup *>(item);
+    entry.modified_connection = item->connectModified([this, &entry, key, group](SPObject *, unsigned int flags) {
+        // a group only changes when its children or its transform do, not when a child is modified
+        if (group && !(flags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_PARENT_MODIFIED_FLAG))) {
+            return;
+        }
+        if (!entry.dirty) {
+            entry.dirty = true;
+            _dirty_items.push_back(key);
+        }
+    });
+    entry.release_connection = item->connectRelease([this, key](SPObject *) {
+        _forgetIndexedItem(key);
+    });
+    _updateIndexedItem(entry);
+}
+
+/// Indexes the items of the clip and mask of an item anew, as either or the item may have changed.
+void SnapManager::_indexClips(SPItem *owner) const
+{
+    _forgetOwnedItems(owner);
+    if (auto clip = owner->getClipObject()) {
+        _indexChildren(clip, owner);
+    }
+    if (auto mask = owner->getMaskObject()) {
+        _indexChildren(mask, owner);
+    }
+}
+
+void SnapManager::_updateIndexedItem(IndexedItem &entry) const
+{
+    entry.dirty = false;
+    SPItem *item = entry.item;
+
+    if (dynamic_cast<SPGroup *>(item)) {
+        // children may have been added; removed ones are forgotten when released
+        _indexChildren(item, entry.owner);
+    } else {
+        if (entry.owner) {
+            // Oh oh, this will get ugly. We cannot use sp_item_i2d_affine directly because we need to
+            // insert an additional transformation in document coordinates (code copied from sp_item_i2d_affine)
+            Geom::Affine const i2dt = item->i2doc_affine() * entry.owner->i2doc_affine() * _indexed_doc2dt;
+            entry.visual_bbox = item->bounds(SPItem::VISUAL_BBOX, i2dt);
+            entry.geometric_bbox = item->bounds(SPItem::GEOMETRIC_BBOX, i2dt);
+        } else {
+            entry.visual_bbox = item->desktopBounds(SPItem::VISUAL_BBOX);
+            entry.geometric_bbox = item->desktopBounds(SPItem::GEOMETRIC_BBOX);
+        }
+
+        Geom::OptRect box = entry.visual_bbox;
+        box.unionWith(entry.geometric_bbox);
+        if (box && entry.in_tree) {
+            _item_tree.update(entry.id, *box);
+        } else if (box) {
+            entry.id = _item_tree.insert(*box, &entry);
+            entry.in_tree = true;
+        } else if (entry.in_tree) {
+            _item_tree.remove(entry.id);
+            entry.in_tree = false;
+        }
+    }
+
+    if (!entry.owner) {
+        // cannot clip or mask more than once
+        _indexClips(item);
+    }
+}
+
+void SnapManager::_forgetIndexedItem(ItemKey const &key) const
+{
+    auto found = _indexed_items.find(key);
+    if (found != _indexed_items.end()) {
+        _unindex(found->second);
+        _indexed_items.erase(found);
+    }
+    if (!key.first) {
+        _forgetOwnedItems(key.second);
+    }
+}
+
+void SnapManager::_forgetOwnedItems(SPItem const *owner) const
+{
+    auto it = _indexed_items.lower_bound(ItemKey(owner, nullptr));
+    while (it != _indexed_items.end() && it->first.first == owner) {
+        _unindex(it->second);
+        it = _indexed_items.erase(it);
+    }
+}
+
+void SnapManager::_unindex(IndexedItem &entry) const
+{
+    entry.modified_connection.disconnect();
+    entry.release_connection.disconnect();
+    if (entry.in_tree) {
+        _item_tree.remove(entry.id);
+        entry.in_tree = false;
+    }
+}
+
+void SnapManager::_clearItemIndex() const
+{
+    for (auto &indexed : _indexed_items) {
+        indexed.second.modified_connection.disconnect();
+        indexed.second.release_connection.disconnect();
+    }
+    _indexed_items.clear();
+    _item_tree.clear();
+    _dirty_items.clear();
+    _indexed_document = nullptr;
+}
+
 /*
   Local Variables:
   mode:c++
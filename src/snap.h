@@ -18,14 +18,18 @@
 #ifndef SEEN_SNAP_H
 #define SEEN_SNAP_H
 
+#include <map>
 #include <memory>
+#include <utility>
 #include <vector>
+#include <sigc++/connection.h>
 
 #include "guide-snapper.h"
 #include "object-snapper.h"
 #include "alignment-snapper.h"
 #include "snap-preferences.h"
 #include "distribution-snapper.h"
+#include "snap-target-tree.h"
 
 
 // Guides
@@ -430,17 +434,49 @@ private:
 
     /**
      * Find all items within snapping range.
-     * @param parent Pointer to the document's root, or to a clipped path or mask object.
      * @param it List of items to ignore.
      * @param bbox_to_snap Bounding box hulling the whole bunch of points, all from the same selection and having the same transformation.
-     * @param clip_or_mask The parent object being passed is either a clip or mask.
      */
-    void _findCandidates(SPObject* parent,
-                       std::vector<SPObject const *> const *it,
+    void _findCandidates(std::vector<SPObject const *> const *it,
                        bool const &first_point,
-                       Geom::Rect const &bbox_to_snap,
-                       bool const _clip_or_mask,
-                       Geom::Affine const additional_affine) const;
+                       Geom::Rect const &bbox_to_snap) const;
+
+    /**
+     * An item of the document with its bounding boxes in desktop coordinates. The items of
+     * a clip or mask are kept once for each item it applies to, their owner. Groups are kept
+     * to notice their children coming and going, but have no boxes of their own.
+     */
+    struct IndexedItem {
+        SPItem *item;
+        SPItem *owner; ///< Item which the clip or mask holding item applies to, or null
+        Geom::OptRect visual_bbox;
+        Geom::OptRect geometric_bbox;
+        size_t id;     ///< Of the entry in _item_tree, if in_tree
+        bool in_tree = false;
+        bool dirty = false; ///< Whether the item was modified since its boxes were taken
+        sigc::connection modified_connection;
+        sigc::connection release_connection;
+    };
+    typedef std::pair<SPItem const *, SPItem const *> ItemKey; ///< The owner and the item
+
+    // The items of the document, kept from one snap to the next and updated as they are modified
+    mutable std::map<ItemKey, IndexedItem> _indexed_items;
+    mutable SnapTargetTree<IndexedItem const *> _item_tree;
+    mutable std::vector<ItemKey> _dirty_items;
+    mutable SPDocument *_indexed_document;
+    mutable Geom::Affine _indexed_doc2dt;
+
+    void _updateItemIndex() const;
+    void _indexChildren(SPObject *parent, SPItem *owner) const;
+    void _indexItem(SPItem *item, SPItem *owner) const;
+    void _indexClips(SPItem *owner) const;
+    void _updateIndexedItem(IndexedItem &entry) const;
+    void _forgetIndexedItem(ItemKey const &key) const;
+    void _forgetOwnedItems(SPItem const *owner) const;
+    void _unindex(IndexedItem &entry) const;
+    void _clearItemIndex() const;
+    bool _isSnapTarget(SPItem *item, SPObject const *top, bool clip_or_mask,
+                       std::vector<SPObject const *> const *it, bool ignoring_stoppers) const;
 
     std::unique_ptr<std::vector<Inkscape::SnapCandidateItem>> obj_snapper_candidates;
     std::unique_ptr<std::vector<Inkscape::SnapCandidateItem>> align_snapper_candidates;
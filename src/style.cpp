@@ -22,9 +22,12 @@
 
 #include "style.h"
 
+#include <array>
 #include <cstring>
 #include <string>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -188,6 +191,26 @@ class SPStylePropHelper {
 
         REGISTER_PROPERTY(SPAttr::STOP_COLOR, stop_color, "stop-color");
         REGISTER_PROPERTY(SPAttr::STOP_OPACITY, stop_opacity, "stop-opacity");
+
+        g_assert(m_vector.size() <= SPStyle::PropertyMask().size());
+
+        // Properties whose computed values are calculated from 'font-size' or 'color' of the
+        // same style (or, for 'baseline-shift', of the parent style).
+        font_size_dependents = _mask({SPAttr::FONT, SPAttr::LINE_HEIGHT, SPAttr::TEXT_INDENT,
+                                      SPAttr::LETTER_SPACING, SPAttr::WORD_SPACING, SPAttr::BASELINE_SHIFT,
+                                      SPAttr::SHAPE_PADDING, SPAttr::SHAPE_MARGIN, SPAttr::INLINE_SIZE,
+                                      SPAttr::STROKE_WIDTH, SPAttr::STROKE_DASHOFFSET});
+        color_dependents = _mask({SPAttr::TEXT_DECORATION_COLOR, SPAttr::SOLID_COLOR, SPAttr::FILL,
+                                  SPAttr::STROKE, SPAttr::STOP_COLOR});
+        font_size = _mask({SPAttr::FONT_SIZE});
+        color = _mask({SPAttr::COLOR});
+
+        // Properties whose computed values depend on the parent's even when they are set.
+        relative = _mask({SPAttr::FONT_SIZE, SPAttr::FONT_WEIGHT, SPAttr::FONT_STRETCH,
+                          SPAttr::BASELINE_SHIFT, SPAttr::TEXT_DECORATION});
+
+        // Properties that set others when they are read.
+        shorthands = _mask({SPAttr::FONT, SPAttr::TEXT_DECORATION});
     }
 
     // this is a singleton, copy not allowed
@@ -213,6 +236,14 @@ public:
         return nullptr;
     }
 
+    /**
+     * Get the position of a property in the vector of properties, or -1
+     */
+    int index(SPAttr id) const {
+        auto it = m_index_map.find(id);
+        return it != m_index_map.end() ? it->second : -1;
+    }
+
     /**
      * Get property pointer by name
      */
@@ -241,15 +272,131 @@ private:
 
         if (id != SPAttr::INVALID) {
             m_id_map[id] = ptr;
+            m_index_map[id] = m_vector.size() - 1;
+        }
+    }
+
+    SPStyle::PropertyMask _mask(std::initializer_list<SPAttr> ids) {
+        SPStyle::PropertyMask mask;
+        for (auto id : ids) {
+            auto it = std::find(m_vector.begin(), m_vector.end(), m_id_map.at(id));
+            mask.set(it - m_vector.begin());
         }
+        return mask;
     }
 
     std::unordered_map<SPAttr, SPIBasePtr> m_id_map;
+    std::unordered_map<SPAttr, int> m_index_map;
     std::vector<SPIBasePtr> m_vector;
+
+public:
+    SPStyle::PropertyMask font_size_dependents;
+    SPStyle::PropertyMask color_dependents;
+    SPStyle::PropertyMask font_size;
+    SPStyle::PropertyMask color;
+    SPStyle::PropertyMask relative;
+    SPStyle::PropertyMask shorthands;
 };
 
 auto &_prop_helper = SPStylePropHelper::instance();
 
+namespace {
+
+/// A declaration of a style attribute, with its value as the property reads it.
+struct StyleDeclaration {
+    SPAttr id;       ///< SPAttr::INVALID for extended ("-inkscape-...") properties
+    bool important;
+    std::string key; ///< The name of an extended property
+    std::string value;
+};
+
+/// The declarations of a style attribute, in the order they are merged in: last one first.
+typedef std::vector<StyleDeclaration> StyleDeclarations;
+
+StyleDeclarations parse_style_declarations(gchar const *const p)
+{
+    StyleDeclarations declarations;
+    CRDeclaration *const decl_list
+        = cr_declaration_parse_list_from_buf(reinterpret_cast<guchar const *>(p), CR_UTF_8);
+    for (CRDeclaration const *decl = decl_list; decl; decl = decl->next) {
+        gchar const *key = decl->property->stryng->str;
+        auto value = reinterpret_cast<gchar *>(cr_term_to_string(decl->value));
+        auto prop_idx = sp_attribute_lookup(key);
+        if (prop_idx != SPAttr::INVALID) {
+            // Add "!important" rule if necessary as this is not handled by cr_term_to_string().
+            std::string str_value = value ? value : "";
+            if (decl->important) {
+                str_value += " !important";
+            }
+            declarations.push_back({prop_idx, static_cast<bool>(decl->important), "", std::move(str_value)});
+        } else if (g_str_has_prefix(key, "--")) {
+            g_warning("Ignoring CSS variable: %s", key);
+        } else if (g_str_has_prefix(key, "-")) {
+            declarations.push_back({SPAttr::INVALID, false, key, value ? value : ""});
+        } else {
+            g_warning("Ignoring unrecognized CSS property: %s", key);
+        }
+        g_free(value);
+    }
+    if (decl_list) {
+        cr_declaration_destroy(decl_list);
+    }
+    std::reverse(declarations.begin(), declarations.end());
+    return declarations;
+}
+
+/**
+ * Style attributes parsed so far, shared by all the documents.
+ *
+ * Drawings exported from GIS and CAD programs repeat a few hundred style attributes over
+ * hundreds of thousands of elements, which libcroco would otherwise parse again each time.
+ */
+class StyleDeclarationCache {
+public:
+    static StyleDeclarationCache &get()
+    {
+        static StyleDeclarationCache *cache = new StyleDeclarationCache();
+        return *cache;
+    }
+
+    std::shared_ptr<StyleDeclarations const> lookup(gchar const *const p)
+    {
+        std::size_t const length = std::strlen(p);
+        if (length > MAX_LENGTH) {
+            // unlikely to be repeated, so not worth keeping
+            return std::make_shared<StyleDeclarations const>(parse_style_declarations(p));
+        }
+
+        std::string key(p, length);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _entries.find(key);
+            if (it != _entries.end()) {
+                return it->second;
+            }
+        }
+
+        auto declarations = std::make_shared<StyleDeclarations const>(parse_style_declarations(p));
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_entries.size() >= MAX_ENTRIES) {
+            // styles still being merged keep their declarations
+            _entries.clear();
+        }
+        _entries.emplace(std::move(key), declarations);
+        return declarations;
+    }
+
+private:
+    static constexpr std::size_t MAX_LENGTH = 4096;
+    static constexpr std::size_t MAX_ENTRIES = 8192;
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, std::shared_ptr<StyleDeclarations const>> _entries;
+};
+
+} // namespace
+
 // C++11 allows one constructor to call another... might be useful. The original C code
 // had separate calls to create SPStyle, one with only SPDocument and the other with only
 // SPObject as parameters.
@@ -469,6 +616,9 @@ SPStyle::SPStyle(SPDocument *document_in, SPObject *object_in) :
 
     // This might be too resource hungary... but for now it possible to loop over properties
     _properties = _prop_helper.get_vector(this);
+
+    // nothing has been cascaded from a new style yet
+    markChanged();
 }
 
 SPStyle::~SPStyle() {
@@ -581,6 +731,12 @@ SPStyle::read( SPObject *object, Inkscape::XML::Node *repr ) {
         cloned = true;
     }
 
+    // Compare what the properties are read from with what they were read from last time,
+    // rather than the values with the current ones, which callers may have changed in place
+    // before writing them back to the repr.
+    std::array<std::uint64_t, PropertyMask().size()> input_hashes{};
+    _input_hashes = input_hashes.data();
+
     /* 1. Style attribute */
     // std::cout << " MERGING STYLE ATTRIBUTE" << std::endl;
     gchar const *val = repr->attribute("style");
@@ -599,15 +755,53 @@ SPStyle::read( SPObject *object, Inkscape::XML::Node *repr ) {
         // font-variant are converted to shorthands in CSS 3 but can still be read as a
         // non-shorthand for compatibility with older renders, so they should not be in this list.
         if (p->id() != SPAttr::FONT && p->id() != SPAttr::MARKER) {
-            p->readAttribute( repr );
+            gchar const *value = repr->attribute(p->name().c_str());
+            if (value) {
+                _hashInput(p->id(), 'a', value);
+                p->readIfUnset(value, SPStyleSrc::ATTRIBUTE);
+            }
+        }
+    }
+    _input_hashes = nullptr;
+
+    PropertyMask changed;
+    auto old_input = _read_inputs.begin();
+    for (unsigned i = 0; i < _properties.size(); ++i) {
+        std::uint64_t old_hash = 0;
+        if (old_input != _read_inputs.end() && old_input->first == i) {
+            old_hash = (old_input++)->second;
         }
+        if (old_hash != input_hashes[i]) {
+            changed.set(i);
+        }
+    }
+    _read_inputs.clear();
+    for (unsigned i = 0; i < _properties.size(); ++i) {
+        if (input_hashes[i]) {
+            _read_inputs.emplace_back(i, input_hashes[i]);
+        }
+    }
+    if ((changed & _prop_helper.shorthands).any()) {
+        // might have set any of the properties they stand for
+        changed.set();
+    }
+    if (changed.any()) {
+        changed |= _cascadeChanges(changed, nullptr);
     }
 
     /* 4 Cascade from parent */
     if( object ) {
-        if( object->parent ) {
-            cascade( object->parent->style );
+        if( object->parent && object->parent->style ) {
+            SPStyle const *parent = object->parent->style;
+            for (size_t i = 0; i != _properties.size(); ++i) {
+                _properties[i]->cascade( parent->_properties[i] );
+            }
+            // Changes of the parent that its children have not cascaded yet
+            if (parent->_changed.any()) {
+                changed |= _cascadeChanges(parent->_changed, nullptr);
+            }
         }
+        _changed |= changed;
     } else if( repr->parent() ) { // When does this happen?
         // std::cout << "SPStyle::read(): reading via repr->parent()" << std::endl;
         SPStyle *parent = new SPStyle();
@@ -840,6 +1034,80 @@ SPStyle::cascade( SPStyle const *const parent ) {
     for(std::vector<SPIBase*>::size_type i = 0; i != _properties.size(); ++i) {
         _properties[i]->cascade( parent->_properties[i] );
     }
+    markChanged();
+}
+
+/**
+ * Cascades only what may differ after the properties in \a parent_changed changed in \a parent,
+ * and remembers which properties changed here in turn, for cascading to the children.
+ *
+ * Properties that are set here, and do not depend on the parent's value, stay as they are. When
+ * nothing changed here, the children do not need to cascade from this style at all.
+ */
+void
+SPStyle::cascade( SPStyle const *const parent, PropertyMask const &parent_changed ) {
+    if (parent_changed.none()) {
+        return;
+    }
+    PropertyMask recascade;
+    _changed |= _cascadeChanges(parent_changed, &recascade);
+    for (std::vector<SPIBase*>::size_type i = 0; i != _properties.size(); ++i) {
+        if (recascade[i]) {
+            _properties[i]->cascade( parent->_properties[i] );
+        }
+    }
+}
+
+/**
+ * The properties of this style that may change when the properties in \a changed change in the
+ * parent or, for 'font-size' and 'color', here.
+ *
+ * @param recascade If not null, set to the properties that have to be cascaded again.
+ */
+SPStyle::PropertyMask
+SPStyle::_cascadeChanges( PropertyMask const &changed, PropertyMask *recascade ) const {
+    PropertyMask dependents;
+    if ((changed & _prop_helper.font_size).any()) {
+        dependents |= _prop_helper.font_size_dependents;
+    }
+    if ((changed & _prop_helper.color).any()) {
+        dependents |= _prop_helper.color_dependents;
+    }
+    if (recascade) {
+        *recascade = changed | dependents;
+    }
+
+    PropertyMask result = dependents;
+    for (std::vector<SPIBase*>::size_type i = 0; i != _properties.size(); ++i) {
+        if (changed[i]) {
+            SPIBase const *p = _properties[i];
+            if (p->inherit || (p->inherits && !p->set) || _prop_helper.relative[i]) {
+                result.set(i);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * While read() runs, mixes a string that the property is read from into the hash of its
+ * inputs, with the kind of \a source it comes from.
+ */
+void
+SPStyle::_hashInput( SPAttr id, char source, char const *value ) {
+    int const i = _input_hashes ? _prop_helper.index(id) : -1;
+    if (i < 0) {
+        return;
+    }
+    // FNV-1a
+    std::uint64_t hash = _input_hashes[i] ? _input_hashes[i] : 14695981039346656037ull;
+    hash = (hash ^ static_cast<unsigned char>(source)) * 1099511628211ull;
+    for (char const *c = value; *c; ++c) {
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ull;
+    }
+    hash = hash * 1099511628211ull; // the end of the string
+    // zero stands for no input
+    _input_hashes[i] = hash ? hash : 1;
 }
 
 // Corresponds to sp_style_merge_from_dying_parent()
@@ -915,11 +1183,16 @@ void
 SPStyle::_mergeString( gchar const *const p ) {
 
     // std::cout << "SPStyle::_mergeString: " << (p?p:"null") << std::endl;
-    CRDeclaration *const decl_list
-        = cr_declaration_parse_list_from_buf(reinterpret_cast<guchar const *>(p), CR_UTF_8);
-    if (decl_list) {
-        _mergeDeclList( decl_list, SPStyleSrc::STYLE_PROP );
-        cr_declaration_destroy(decl_list);
+    auto declarations = StyleDeclarationCache::get().lookup(p);
+    for (auto const &decl : *declarations) {
+        if (decl.id != SPAttr::INVALID) {
+            if (!isSet(decl.id) || decl.important) {
+                _hashInput(decl.id, 's', decl.value.c_str());
+                readIfUnset(decl.id, decl.value.c_str(), SPStyleSrc::STYLE_PROP);
+            }
+        } else {
+            extended_properties[decl.key] = decl.value;
+        }
     }
 }
 
@@ -957,8 +1230,10 @@ SPStyle::_mergeDecl(  CRDeclaration const *const decl, SPStyleSrc const &source
             gchar const *important = decl->important ? " !important" : "";
             Inkscape::CSSOStringStream os;
             os << str_value << important;
+            std::string const value = os.str();
 
-            readIfUnset(prop_idx, os.str().c_str(), source);
+            _hashInput(prop_idx, 'c', value.c_str());
+            readIfUnset(prop_idx, value.c_str(), source);
             g_free(str_value);
         }
     } else {
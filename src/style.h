@@ -22,6 +22,8 @@
 #include "style-internal.h"
 
 #include <sigc++/connection.h>
+#include <bitset>
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <vector>
@@ -65,12 +67,25 @@ public:
     Glib::ustring write(SPStyleSrc style_src_req) const;
     Glib::ustring writeIfDiff(SPStyle const *base) const;
 
+    /// One bit for each property, in the order of properties().
+    typedef std::bitset<128> PropertyMask;
+
     void cascade( SPStyle const *const parent );
+    void cascade( SPStyle const *const parent, PropertyMask const &parent_changed );
     void merge(   SPStyle const *const parent );
     void mergeString( char const *const p );
     void mergeStatement( CRStatement *statement );
     bool operator==(const SPStyle& rhs);
 
+    /**
+     * Properties whose values may have changed since the children of the object last cascaded
+     * from this style: set by read() and cascade(), cleared once the object has been updated.
+     */
+    PropertyMask const &changedProperties() const { return _changed; }
+    /// For changes that were not made through read(), which might have changed any property.
+    void markChanged() { _changed.set(); }
+    void clearChanged() { _changed.reset(); }
+
     int style_ref()   { ++_refcount; return _refcount; }
     int style_unref() { --_refcount; return _refcount; }
     int refCount() { return _refcount; }
@@ -82,9 +97,17 @@ private:
     void _mergeProps( CRPropList *const props );
     void _mergeObjectStylesheet( SPObject const *const object );
     void _mergeObjectStylesheet( SPObject const *const object, SPDocument *const document );
+    PropertyMask _cascadeChanges( PropertyMask const &parent_changed, PropertyMask *recascade ) const;
+    void _hashInput( SPAttr id, char source, char const *value );
 
 private:
     int _refcount;
+    PropertyMask _changed;
+    /// Hashes of the strings that the last read() read each property from, in the order of
+    /// properties(), for the properties it read from any.
+    std::vector<std::pair<unsigned, std::uint64_t>> _read_inputs;
+    /// While read() runs, the hashes of the strings read so far, one for each property.
+    std::uint64_t *_input_hashes = nullptr;
     static int _count; // Poor man's leak detector
 
 // FIXME: Make private
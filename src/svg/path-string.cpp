@@ -144,15 +144,16 @@ void Inkscape::SVG::PathString::State::appendRelative(Geom::Coord v, Geom::Coord
 }
 
 void Inkscape::SVG::PathString::State::appendNumber(double v, int precision, int minexp) {
-
-    str.append(sp_svg_number_write_de(v, precision, minexp));
+    // written straight into str, which grows geometrically, rather than through a temporary
+    sp_svg_number_append_de(str, v, precision, minexp);
 }
 
 void Inkscape::SVG::PathString::State::appendNumber(double v, double &rv, int precision, int minexp) {
     size_t const oldsize = str.size();
     appendNumber(v, precision, minexp);
-    char* begin_of_num = const_cast<char*>(str.data()+oldsize); // Slightly evil, I know (but std::string should be storing its data in one big block of memory, so...)
-    sp_svg_number_read_d(begin_of_num, &rv);
+    // the value as it will be read back from the file
+    char const *begin_of_num = str.c_str() + oldsize;
+    sp_svg_number_scan(&begin_of_num, &rv);
 }
 
 /*
@@ -12,6 +12,7 @@
  */
 
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 #include <glib.h>
@@ -62,14 +63,36 @@ unsigned int sp_svg_number_read_d(gchar const *str, double *val)
     return 1;
 }
 
-static std::string sp_svg_number_write_d( double val, unsigned int tprec, unsigned int fprec)
+namespace {
+
+/// Powers of ten that are exact as doubles.
+double const exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+inline bool is_digit(char c)
 {
+    return c >= '0' && c <= '9';
+}
 
-    std::string buf;
+void append_integer(std::string &buf, unsigned long long value)
+{
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *begin = end;
+    do {
+        *--begin = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    buf.append(begin, end);
+}
+
+void sp_svg_number_append_d(std::string &buf, double val, unsigned int tprec, unsigned int fprec)
+{
     /* Process sign */
-    int i = 0;
     if (val < 0.0) {
-        buf.append("-");
+        buf += '-';
         val = fabs(val);
     }
 
@@ -88,40 +111,130 @@ static std::string sp_svg_number_write_d( double val, unsigned int tprec, unsign
     double fval = val - dival;
     /* Write integra */
     if (idigits > (int)tprec) {
-        buf.append(std::to_string((unsigned int)floor(dival/pow(10.0, idigits-tprec) + .5)));
-        for(unsigned int j=0; j<(unsigned int)idigits-tprec; j++) {
-            buf.append("0");
-        }
-        i += idigits-tprec;
+        append_integer(buf, (unsigned long long)floor(dival/pow(10.0, idigits-tprec) + .5));
+        buf.append(idigits - tprec, '0');
     } else {
-       buf.append(std::to_string((unsigned int)dival));
+        append_integer(buf, (unsigned long long)dival);
     }
 
     if (fprec > 0 && fval > 0.0) {
-        std::string s(".");
+        // trailing zeros are dropped again, with the point if all digits are zero
+        std::size_t end = buf.size();
+        buf += '.';
         do {
             fval *= 10.0;
             dival = floor(fval);
             fval -= dival;
             int const int_dival = (int) dival;
-            s.append(std::to_string(int_dival));
-            if(int_dival != 0){
-                buf.append(s);
-                s="";
+            buf += static_cast<char>('0' + int_dival);
+            if (int_dival != 0) {
+                end = buf.size();
             }
             fprec -= 1;
-        } while(fprec > 0 && fval > 0.0);
+        } while (fprec > 0 && fval > 0.0);
+        buf.resize(end);
     }
-    return buf;
 }
 
-std::string sp_svg_number_write_de(double val, unsigned int tprec, int min_exp)
+} // namespace
+
+bool sp_svg_number_scan(char const **str, double *val)
+{
+    char const *const begin = *str;
+    char const *p = begin;
+
+    bool negative = false;
+    if (*p == '+' || *p == '-') {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // The first 19 significant digits fit in the mantissa, the rest only move the exponent.
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool any = false;
+
+    for (; *p == '0'; ++p) {
+        any = true;
+    }
+    for (; is_digit(*p); ++p) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits++;
+        } else {
+            exponent++;
+            truncated = truncated || *p != '0';
+        }
+    }
+    if (*p == '.') {
+        ++p;
+        if (digits == 0) {
+            for (; *p == '0'; ++p) {
+                exponent--;
+                any = true;
+            }
+        }
+        for (; is_digit(*p); ++p) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits++;
+                exponent--;
+            } else {
+                truncated = truncated || *p != '0';
+            }
+        }
+    }
+    if (!any) {
+        return false;
+    }
+
+    // As with strtod, an 'e' without digits is not part of the number.
+    if (*p == 'e' || *p == 'E') {
+        char const *e = p + 1;
+        bool negative_exponent = false;
+        if (*e == '+' || *e == '-') {
+            negative_exponent = *e == '-';
+            ++e;
+        }
+        if (is_digit(*e)) {
+            int value = 0;
+            for (; is_digit(*e); ++e) {
+                if (value < 100000) {
+                    value = value * 10 + (*e - '0');
+                }
+            }
+            exponent += negative_exponent ? -value : value;
+            p = e;
+        }
+    }
+
+    if (mantissa == 0 && !truncated) {
+        *val = negative ? -0.0 : 0.0;
+    } else if (!truncated && digits <= 15 && exponent >= -22 && exponent <= 22) {
+        // Both the mantissa and the power of ten are exact, so a single rounding gives the
+        // correctly rounded result, the same as strtod's.
+        double v = static_cast<double>(mantissa);
+        v = exponent < 0 ? v / exact_powers_of_ten[-exponent] : v * exact_powers_of_ten[exponent];
+        *val = negative ? -v : v;
+    } else {
+        std::string number(begin, p);
+        *val = g_ascii_strtod(number.c_str(), nullptr);
+    }
+
+    *str = p;
+    return true;
+}
+
+void sp_svg_number_append_de(std::string &buf, double val, unsigned int tprec, int min_exp)
 {
-    std::string buf;
     int eval = (int)floor(log10(fabs(val)));
     if (val == 0.0 || eval < min_exp) {
-        buf.append("0");
-        return buf;
+        buf += '0';
+        return;
     }
     unsigned int maxnumdigitsWithoutExp = // This doesn't include the sign because it is included in either representation
         eval<0?tprec+(unsigned int)-eval+1:
@@ -129,15 +242,23 @@ std::string sp_svg_number_write_de(double val, unsigned int tprec, int min_exp)
         (unsigned int)eval+1;
     unsigned int maxnumdigitsWithExp = tprec + ( eval<0 ? 4 : 3 ); // It's not necessary to take larger exponents into account, because then maxnumdigitsWithoutExp is DEFINITELY larger
     if (maxnumdigitsWithoutExp <= maxnumdigitsWithExp) {
-        buf.append(sp_svg_number_write_d(val, tprec, 0));
+        sp_svg_number_append_d(buf, val, tprec, 0);
     } else {
         val = eval < 0 ? val * pow(10.0, -eval) : val / pow(10.0, eval);
-        buf.append(sp_svg_number_write_d(val, tprec, 0));
-        buf.append("e");
-        buf.append(std::to_string(eval));
+        sp_svg_number_append_d(buf, val, tprec, 0);
+        buf += 'e';
+        if (eval < 0) {
+            buf += '-';
+        }
+        append_integer(buf, std::abs(eval));
     }
-    return buf;
+}
 
+std::string sp_svg_number_write_de(double val, unsigned int tprec, int min_exp)
+{
+    std::string buf;
+    sp_svg_number_append_de(buf, val, tprec, min_exp);
+    return buf;
 }
 
 SVGLength::SVGLength()
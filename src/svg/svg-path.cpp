@@ -29,6 +29,179 @@
 #include "svg/svg.h"
 #include "svg/path-string.h"
 
+namespace {
+
+inline char const *skip_space(char const *p)
+{
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') {
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * Reads the path data found in practice, such as maps made of millions of line segments,
+ * faster than Geom::SVGPathParser, which reads numbers through g_ascii_strtod.
+ *
+ * Only moves, lines, cubic Béziers and closes are read, feeding the builder as the 2geom parser
+ * does. Anything else, be it an error, a quadratic curve, an arc, a command after a close or a
+ * close that the 2geom parser would snap onto the start of the subpath, makes the reader give
+ * up, leaving the path to the 2geom parser. This keeps the two in step without reproducing
+ * the handling of errors and of the rarer commands.
+ */
+class PathDataReader {
+public:
+    explicit PathDataReader(Geom::PathVector &pathv) : _builder(pathv) {}
+
+    /// Returns false if the path must be read by Geom::SVGPathParser instead.
+    bool read(char const *str);
+
+private:
+    bool _number(double &value)
+    {
+        if (!sp_svg_number_scan(&_p, &value)) {
+            return false;
+        }
+        _p = skip_space(_p);
+        _comma = *_p == ',';
+        if (_comma) {
+            _p = skip_space(_p + 1);
+        }
+        return true;
+    }
+
+    bool _point(Geom::Point &point, bool relative)
+    {
+        if (!_number(point[Geom::X]) || !_number(point[Geom::Y])) {
+            return false;
+        }
+        if (relative) {
+            point += _current;
+        }
+        return true;
+    }
+
+    Geom::PathBuilder _builder;
+    char const *_p = nullptr;
+    bool _comma = false; ///< Whether the last number was followed by a comma, so that another must follow
+    Geom::Point _initial;
+    Geom::Point _current;
+    Geom::Point _tangent; ///< First control point of a smooth curve from the current point
+};
+
+bool PathDataReader::read(char const *str)
+{
+    _p = skip_space(str);
+    char command = 0;
+    bool closed = true; // no subpath, so only a move can come next
+
+    while (*_p) {
+        bool const letter = g_ascii_isalpha(*_p);
+        if (letter) {
+            if (_comma) {
+                return false;
+            }
+            command = *_p++;
+            _p = skip_space(_p);
+            if (closed && command != 'M' && command != 'm') {
+                return false;
+            }
+        } else if (closed) {
+            // numbers after a close, or before the first command
+            return false;
+        }
+
+        bool const relative = g_ascii_islower(command);
+        Geom::Point p;
+        switch (command) {
+            case 'M':
+            case 'm':
+                if (!_point(p, relative)) {
+                    return false;
+                }
+                _builder.moveTo(p);
+                _initial = _current = _tangent = p;
+                closed = false;
+                // further pairs are lines
+                command = relative ? 'l' : 'L';
+                break;
+            case 'L':
+            case 'l':
+                if (!_point(p, relative)) {
+                    return false;
+                }
+                _builder.lineTo(p);
+                _current = _tangent = p;
+                break;
+            case 'H':
+            case 'h':
+                p = _current;
+                if (!_number(p[Geom::X])) {
+                    return false;
+                }
+                if (relative) {
+                    p[Geom::X] += _current[Geom::X];
+                }
+                _builder.lineTo(p);
+                _current = _tangent = p;
+                break;
+            case 'V':
+            case 'v':
+                p = _current;
+                if (!_number(p[Geom::Y])) {
+                    return false;
+                }
+                if (relative) {
+                    p[Geom::Y] += _current[Geom::Y];
+                }
+                _builder.lineTo(p);
+                _current = _tangent = p;
+                break;
+            case 'C':
+            case 'c': {
+                Geom::Point c0, c1;
+                if (!_point(c0, relative) || !_point(c1, relative) || !_point(p, relative)) {
+                    return false;
+                }
+                _builder.curveTo(c0, c1, p);
+                _tangent = p + (p - c1);
+                _current = p;
+                break;
+            }
+            case 'S':
+            case 's': {
+                Geom::Point c1;
+                if (!_point(c1, relative) || !_point(p, relative)) {
+                    return false;
+                }
+                _builder.curveTo(_tangent, c1, p);
+                _tangent = p + (p - c1);
+                _current = p;
+                break;
+            }
+            case 'Z':
+            case 'z':
+                if (_current != _initial && Geom::are_near(_current, _initial, Geom::EPSILON)) {
+                    return false;
+                }
+                _builder.closePath();
+                _current = _tangent = _initial;
+                closed = true;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    if (_comma) {
+        return false;
+    }
+    _builder.flush();
+    return true;
+}
+
+} // namespace
+
 /*
  * Parses the path in str. When an error is found in the pathstring, this method
  * returns a truncated path up to where the error was found in the pathstring.
@@ -40,6 +213,11 @@ Geom::PathVector sp_svg_read_pathv(char const * str)
     if (!str)
         return pathv;  // return empty pathvector when str == NULL
 
+    if (PathDataReader(pathv).read(str)) {
+        return pathv;
+    }
+    pathv.clear();
+
     Geom::PathBuilder builder(pathv);
     Geom::SVGPathParser parser(builder);
     parser.setZSnapThreshold(Geom::EPSILON);
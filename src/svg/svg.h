@@ -32,11 +32,24 @@
 unsigned int sp_svg_number_read_f( const char *str, float *val );
 unsigned int sp_svg_number_read_d( const char *str, double *val );
 
+/*
+ * Reads a number in the grammar of SVG path data (no "inf", "nan" or hexadecimal) from *str
+ * and moves *str past it. Gives the same value as strtod, but only calls it for numbers with
+ * more than 15 significant digits or a large exponent.
+ * Return FALSE and let str and val untouched if there is no number
+ */
+bool sp_svg_number_scan( const char **str, double *val );
+
 /*
  * No buffer overflow checking is done, so better wrap them if needed
  */
 std::string sp_svg_number_write_de( double val, unsigned int tprec, int min_exp );
 
+/*
+ * As sp_svg_number_write_de, but appends to buf, which can be reused to avoid allocations
+ */
+void sp_svg_number_append_de( std::string &buf, double val, unsigned int tprec, int min_exp );
+
 /* Length */
 
 /*
@@ -2336,6 +2336,8 @@ void InkscapePreferences::initPageIO()
     _page_autosave.add_line(false, _("_Interval (in minutes):"), _save_autosave_interval, "", _("Interval (in minutes) at which document will be autosaved"), false);
     _save_autosave_max.init("/options/autosave/max", 1.0, 10000.0, 1.0, 10.0, 10.0, true, false);
     _page_autosave.add_line(false, _("_Maximum number of autosaves:"), _save_autosave_max, "", _("Maximum number of autosaved files; use this to limit the storage space used"), false);
+    _save_autosave_journal.init( _("Keep a crash-recovery journal"), "/options/autosave/journal", false);
+    _page_autosave.add_line(false, "", _save_autosave_journal, "", _("Write each change to documents opened from now on to the autosave directory as it is made, instead of saving the whole document at intervals. Documents left behind by a crash are recovered into the autosave directory on the next start."), false);
 
     // When changing the interval or enabling/disabling the autosave function,
     // update our running configuration
@@ -2633,10 +2635,25 @@ void InkscapePreferences::initPageRendering()
     _page_rendering.add_line( false, _("Number of _Threads:"), _filter_multi_threaded, _("(requires restart)"),
                            _("Configure number of processors/threads to use when rendering filters"), false);
 
+    _rendering_threaded.init(_("Render canvas using multiple threads"), "/options/rendering/threaded", false);
+    _page_rendering.add_line( false, "", _rendering_threaded, "",
+                           _("Render the drawing for several parts of the canvas at once, using the number of threads set above."), false);
+
     // rendering cache
     _rendering_cache_size.init("/options/renderingcache/size", 0.0, 4096.0, 1.0, 32.0, 64.0, true, false);
     _page_rendering.add_line( false, _("Rendering _cache size:"), _rendering_cache_size, C_("mebibyte (2^20 bytes) abbreviation","MiB"), _("Set the amount of memory per document which can be used to store rendered parts of the drawing for later reuse; set to zero to disable caching"), false);
 
+    // results of filter primitives
+    _rendering_filter_cache_size.init("/options/renderingcache/filterresults", 0.0, 4096.0, 1.0, 32.0, 0.0, true, false);
+    _page_rendering.add_line( false, _("Filter result cache size:"), _rendering_filter_cache_size, C_("mebibyte (2^20 bytes) abbreviation","MiB"), _("Set the amount of memory which can be used to keep the results of expensive filter primitives, such as turbulence, lighting and large blurs, so that they are not computed again when only later primitives change or the canvas is scrolled; set to zero to disable. Takes effect after restart."), false);
+
+    // disk cache of filtered objects
+    _rendering_disk_cache.init(_("Keep rendered filters on disk"), "/options/renderingcache/disk", false);
+    _page_rendering.add_line( false, "", _rendering_disk_cache, "",
+                           _("Store the rendering of filtered objects in the cache directory, so that it can be reused when the document is opened again, exported or panned"), false);
+    _rendering_disk_cache_size.init("/options/renderingcache/disksize", 1.0, 65536.0, 1.0, 64.0, 256.0, true, false);
+    _page_rendering.add_line( false, _("Disk cache size:"), _rendering_disk_cache_size, C_("mebibyte (2^20 bytes) abbreviation","MiB"), _("Set the amount of disk space used for rendered filters; the least recently used renderings are removed first. Takes effect after restart."), false);
+
     // rendering tile multiplier
     _rendering_tile_multiplier.init("/options/rendering/tile-multiplier", 1.0, 512.0, 1.0, 16.0, 16.0, true, false);
     _page_rendering.add_line( false, _("Rendering tile multiplier:"), _rendering_tile_multiplier, "",
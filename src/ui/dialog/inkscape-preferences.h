@@ -333,11 +333,15 @@ protected:
     UI::Widget::PrefCheckButton _show_filters_info_box;
     UI::Widget::PrefCheckButton _rendering_image_outline;
     UI::Widget::PrefSpinButton  _rendering_cache_size;
+    UI::Widget::PrefSpinButton  _rendering_filter_cache_size;
+    UI::Widget::PrefCheckButton _rendering_disk_cache;
+    UI::Widget::PrefSpinButton  _rendering_disk_cache_size;
     UI::Widget::PrefSpinButton  _rendering_tile_multiplier;
     UI::Widget::PrefSpinButton  _rendering_xray_radius;
     UI::Widget::PrefSpinButton  _rendering_outline_overlay_opacity;
     UI::Widget::PrefCombo       _rendering_redraw_priority;
     UI::Widget::PrefSpinButton  _filter_multi_threaded;
+    UI::Widget::PrefCheckButton _rendering_threaded;
 
     UI::Widget::PrefCheckButton _trans_scale_stroke;
     UI::Widget::PrefCheckButton _trans_scale_corner;
@@ -450,6 +454,7 @@ protected:
     UI::Widget::PrefSpinButton  _save_autosave_interval;
     UI::Widget::PrefEntry       _save_autosave_path;
     UI::Widget::PrefSpinButton  _save_autosave_max;
+    UI::Widget::PrefCheckButton _save_autosave_journal;
 
     Gtk::ComboBoxText   _cms_display_profile;
     UI::Widget::PrefCheckButton     _cms_from_display;
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Scanline flood fill of the paint bucket tool
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_UI_TOOLS_FLOOD_FILL_H
+#define SEEN_INKSCAPE_UI_TOOLS_FLOOD_FILL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <2geom/int-rect.h>
+#include <2geom/rect.h>
+
+namespace Inkscape {
+namespace UI {
+namespace Tools {
+
+/**
+ * A bitmap of one bit per pixel, packed row by row into 64 bit words.
+ */
+class PixelMask
+{
+public:
+    PixelMask(int width, int height)
+        : _words((width + 63) / 64)
+        , _bits(size_t(_words) * height, 0)
+    {}
+
+    bool test(int x, int y) const { return (_bits[index(x, y)] >> (x & 63)) & 1; }
+
+    /// Sets the pixels from x0 to x1, both included, in row y.
+    void setSpan(int x0, int x1, int y)
+    {
+        for (int w = x0 >> 6; w <= x1 >> 6; w++) {
+            uint64_t bits = ~uint64_t(0);
+            if (w == x0 >> 6) {
+                bits &= ~uint64_t(0) << (x0 & 63);
+            }
+            if (w == x1 >> 6) {
+                bits &= ~uint64_t(0) >> (63 - (x1 & 63));
+            }
+            _bits[size_t(y) * _words + w] |= bits;
+        }
+    }
+
+    /// The word holding the pixels from 64 * w to 64 * w + 63 of row y.
+    uint64_t &word(int w, int y) { return _bits[size_t(y) * _words + w]; }
+
+private:
+    size_t index(int x, int y) const { return size_t(y) * _words + (x >> 6); }
+
+    int _words; ///< Words per row
+    std::vector<uint64_t> _bits;
+};
+
+/**
+ * The possible return states of perform_scanline_fill().
+ */
+enum ScanlineCheckResult {
+    SCANLINE_CHECK_OK,
+    SCANLINE_CHECK_ABORTED,
+    SCANLINE_CHECK_BOUNDARY
+};
+
+/**
+ * Fill the paintable area around the seed points one horizontal span at a time.
+ *
+ * With autogap, the fill only passes through pixels whose surrounding square of the gap radius
+ * is paintable, so that it does not leak through gaps narrower than the square. The squares
+ * around the filled pixels are colored afterwards, which grows the result back to the edges.
+ *
+ * @param image The rendered image, classified for the target color: anything with width(),
+ *              height() and paintable(x, y).
+ * @param seeds The points to fill from.
+ * @param radius The autogap radius.
+ * @param bbox The visual bounds of the drawing.
+ * @param screen The visible area.
+ * @param checked The pixels already filled, updated with the filled spans.
+ * @param colored The pixels to trace, updated with the filled spans widened by the radius.
+ * @param colored_area The bounds of the colored pixels, updated with the new ones.
+ */
+template <typename Image>
+ScanlineCheckResult perform_scanline_fill(Image &image, std::vector<Geom::IntPoint> seeds, int radius,
+                                          Geom::Rect const &bbox, Geom::Rect const &screen,
+                                          PixelMask &checked, PixelMask &colored, Geom::OptIntRect &colored_area)
+{
+    int const width = image.width();
+    int const height = image.height();
+
+    auto passable = [&](int x, int y) {
+        if (!image.paintable(x, y)) {
+            return false;
+        }
+        for (int ty = std::max(y - radius, 0); ty <= std::min(y + radius, height - 1); ty++) {
+            for (int tx = std::max(x - radius, 0); tx <= std::min(x + radius, width - 1); tx++) {
+                if (!image.paintable(tx, ty)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    ScanlineCheckResult result = SCANLINE_CHECK_OK;
+    std::vector<Geom::IntPoint> &stack = seeds;
+
+    while (!stack.empty()) {
+        Geom::IntPoint p = stack.back();
+        stack.pop_back();
+        int const y = p.y();
+        if (checked.test(p.x(), y) || !passable(p.x(), y)) {
+            continue;
+        }
+
+        int x0 = p.x();
+        int x1 = p.x();
+        while (x0 > 0 && !checked.test(x0 - 1, y) && passable(x0 - 1, y)) {
+            x0--;
+        }
+        while (x1 < width - 1 && !checked.test(x1 + 1, y) && passable(x1 + 1, y)) {
+            x1++;
+        }
+        checked.setSpan(x0, x1, y);
+
+        // Reaching the edge of the image means the area is not bounded, unless the drawing
+        // goes on beyond the screen on that side; then only the visible part is filled.
+        bool const left = x0 == 0;
+        bool const right = x1 == width - 1;
+        bool const top = y == 0;
+        bool const bottom = y == height - 1;
+        if ((left && bbox.min()[Geom::X] > screen.min()[Geom::X]) ||
+            (right && bbox.max()[Geom::X] < screen.max()[Geom::X]) ||
+            (top && bbox.min()[Geom::Y] > screen.min()[Geom::Y]) ||
+            (bottom && bbox.max()[Geom::Y] < screen.max()[Geom::Y])) {
+            return SCANLINE_CHECK_ABORTED;
+        }
+        if (left || right || top || bottom) {
+            result = SCANLINE_CHECK_BOUNDARY;
+        }
+
+        // every pixel of the span is paintable together with its square, so is the widened span
+        int const cx0 = std::max(x0 - radius, 0);
+        int const cx1 = std::min(x1 + radius, width - 1);
+        int const cy0 = std::max(y - radius, 0);
+        int const cy1 = std::min(y + radius, height - 1);
+        for (int ty = cy0; ty <= cy1; ty++) {
+            colored.setSpan(cx0, cx1, ty);
+        }
+        colored_area.unionWith(Geom::IntRect(cx0, cy0, cx1 + 1, cy1 + 1));
+
+        // queue the first pixel of each run of fillable pixels in the rows above and below
+        for (int ny : {y - 1, y + 1}) {
+            if (ny < 0 || ny >= height) {
+                continue;
+            }
+            bool in_run = false;
+            for (int nx = x0; nx <= x1; nx++) {
+                bool const open = !checked.test(nx, ny) && passable(nx, ny);
+                if (open && !in_run) {
+                    stack.emplace_back(nx, ny);
+                }
+                in_run = open;
+            }
+        }
+    }
+
+    return result;
+}
+
+} // namespace Tools
+} // namespace UI
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_UI_TOOLS_FLOOD_FILL_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
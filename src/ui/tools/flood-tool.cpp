@@ -19,9 +19,11 @@
  */
 
 #include "flood-tool.h"
+#include "flood-fill.h"
 
 #include <cmath>
-#include <queue>
+#include <cstdint>
+#include <vector>
 
 #include <gdk/gdkkeysyms.h>
 #include <glibmm/i18n.h>
@@ -189,10 +191,6 @@ inline guint32 get_pixel(guchar *px, int x, int y, int stride) {
     return *reinterpret_cast<guint32*>(px + y * stride + x * 4);
 }
 
-inline unsigned char * get_trace_pixel(guchar *trace_px, int x, int y, int width) {
-    return trace_px + (x + y * width);
-}
-
 /**
  * \brief Check whether two unsigned integers are close to each other
  *
@@ -284,101 +282,169 @@ static bool compare_pixels(guint32 check, guint32 orig, guint32 merged_orig_pixe
     return false;
 }
 
-enum {
-  PIXEL_CHECKED = 1,
-  PIXEL_QUEUED  = 2,
-  PIXEL_PAINTABLE = 4,
-  PIXEL_NOT_PAINTABLE = 8,
-  PIXEL_COLORED = 16
-};
-
-static inline bool is_pixel_checked(unsigned char *t) { return (*t & PIXEL_CHECKED) == PIXEL_CHECKED; }
-static inline bool is_pixel_queued(unsigned char *t) { return (*t & PIXEL_QUEUED) == PIXEL_QUEUED; }
-static inline bool is_pixel_paintability_checked(unsigned char *t) {
-  return !((*t & PIXEL_PAINTABLE) == 0) && ((*t & PIXEL_NOT_PAINTABLE) == 0);
-}
-static inline bool is_pixel_paintable(unsigned char *t) { return (*t & PIXEL_PAINTABLE) == PIXEL_PAINTABLE; }
-static inline bool is_pixel_colored(unsigned char *t) { return (*t & PIXEL_COLORED) == PIXEL_COLORED; }
-
-static inline void mark_pixel_checked(unsigned char *t) { *t |= PIXEL_CHECKED; }
-static inline void mark_pixel_queued(unsigned char *t) { *t |= PIXEL_QUEUED; }
-static inline void mark_pixel_paintable(unsigned char *t) { *t |= PIXEL_PAINTABLE; *t ^= PIXEL_NOT_PAINTABLE; }
-static inline void mark_pixel_not_paintable(unsigned char *t) { *t |= PIXEL_NOT_PAINTABLE; *t ^= PIXEL_PAINTABLE; }
-static inline void mark_pixel_colored(unsigned char *t) { *t |= PIXEL_COLORED; }
-
-static inline void clear_pixel_paintability(unsigned char *t) { *t ^= PIXEL_PAINTABLE; *t ^= PIXEL_NOT_PAINTABLE; }
-
-struct bitmap_coords_info {
-    bool is_left;
-    unsigned int x;
-    unsigned int y;
-    int y_limit;
-    unsigned int width;
-    unsigned int height;
-    unsigned int stride;
-    unsigned int threshold;
-    unsigned int radius;
-    PaintBucketChannels method;
-    guint32 dtc;
-    guint32 merged_orig_pixel;
-    Geom::Rect bbox;
-    Geom::Rect screen;
-    unsigned int max_queue_size;
-    unsigned int current_step;
-};
+namespace {
 
 /**
- * Check if a pixel can be included in the fill.
- * @param px The rendered pixel buffer to check.
- * @param trace_t The pixel in the trace pixel buffer to check or mark.
- * @param x The X coordinate.
- * @param y The y coordinate.
- * @param orig_color The original selected pixel to use as the fill target color.
- * @param bci The bitmap_coords_info structure.
+ * The area around the screen on which the fill runs. It is rendered a tile at a time when the
+ * fill first reads a pixel of the tile, so that a small fill renders little of a large area.
+ * The pixels of each rendered tile are compared with the fill target color once, and whether
+ * they can be painted is kept as one bit per pixel.
  */
-inline static bool check_if_pixel_is_paintable(guchar *px, unsigned char *trace_t, int x, int y, guint32 orig_color, bitmap_coords_info bci) {
-    if (is_pixel_paintability_checked(trace_t)) {
-        return is_pixel_paintable(trace_t);
-    } else {
-        guint32 pixel = get_pixel(px, x, y, bci.stride);
-        if (compare_pixels(pixel, orig_color, bci.merged_orig_pixel, bci.dtc, bci.threshold, bci.method)) {
-            mark_pixel_paintable(trace_t);
-            return true;
-        } else {
-            mark_pixel_not_paintable(trace_t);
-            return false;
+class FloodImage
+{
+public:
+    static int const TILE_SIZE = 256;
+
+    FloodImage(Inkscape::Drawing &drawing, int width, int height, guint32 bgcolor, int threshold,
+               PaintBucketChannels method)
+        : _drawing(drawing)
+        , _width(width)
+        , _height(height)
+        , _columns((width + TILE_SIZE - 1) / TILE_SIZE)
+        , _stride(cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, TILE_SIZE))
+        , _tiles(size_t(_columns) * ((height + TILE_SIZE - 1) / TILE_SIZE))
+        , _paintable(width, height)
+        , _bgcolor(bgcolor)
+        // bgcolor is 0xrrggbbaa, we need 0xaarrggbb
+        , _dtc((bgcolor >> 8) | (bgcolor << 24))
+        , _threshold(threshold)
+        , _method(method)
+    {}
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    guint32 pixel(int x, int y)
+    {
+        return get_pixel(tile(x, y).px.data(), x % TILE_SIZE, y % TILE_SIZE, _stride);
+    }
+
+    /// Whether the pixel is close enough to the target color to be filled.
+    bool paintable(int x, int y)
+    {
+        Tile &t = tile(x, y);
+        if (t.target != _target) {
+            classify(t, x / TILE_SIZE * TILE_SIZE, y / TILE_SIZE * TILE_SIZE);
         }
+        return _paintable.test(x, y);
     }
-}
+
+    /// Sets the color that paintable pixels are compared with.
+    void setTarget(guint32 color)
+    {
+        _color = color;
+        _merged_color = compose_onto(color, _dtc);
+        _target++;
+    }
+
+    int renderedTiles() const { return _rendered; }
+    int tiles() const { return int(_tiles.size()); }
+    /// Time spent rendering tiles, in microseconds.
+    gint64 renderTime() const { return _render_time; }
+
+private:
+    struct Tile
+    {
+        std::vector<guchar> px;
+        unsigned target = 0; ///< The target color the pixels were classified for, 0 if none
+    };
+
+    Tile &tile(int x, int y)
+    {
+        Tile &t = _tiles[(y / TILE_SIZE) * _columns + x / TILE_SIZE];
+        if (t.px.empty()) {
+            render(t, x / TILE_SIZE * TILE_SIZE, y / TILE_SIZE * TILE_SIZE);
+        }
+        return t;
+    }
+
+    void render(Tile &t, int x0, int y0)
+    {
+        gint64 start = g_get_monotonic_time();
+
+        t.px.resize(_stride * TILE_SIZE);
+        Geom::IntRect area = Geom::IntRect::from_xywh(x0, y0, TILE_SIZE, TILE_SIZE);
+        cairo_surface_t *s = cairo_image_surface_create_for_data(
+            t.px.data(), CAIRO_FORMAT_ARGB32, TILE_SIZE, TILE_SIZE, _stride);
+        {
+            Inkscape::DrawingContext dc(s, area.min());
+            dc.setSource(_bgcolor);
+            dc.setOperator(CAIRO_OPERATOR_SOURCE);
+            dc.paint();
+            dc.setOperator(CAIRO_OPERATOR_OVER);
+            _drawing.render(dc, area);
+        }
+        cairo_surface_flush(s);
+        cairo_surface_destroy(s);
+
+        _rendered++;
+        _render_time += g_get_monotonic_time() - start;
+    }
+
+    void classify(Tile &t, int x0, int y0)
+    {
+        // tiles start at multiples of 64 pixels and so fill whole words of the mask
+        int const x1 = std::min(x0 + TILE_SIZE, _width);
+        int const y1 = std::min(y0 + TILE_SIZE, _height);
+        for (int y = y0; y < y1; y++) {
+            for (int wx = x0; wx < x1; wx += 64) {
+                uint64_t bits = 0;
+                for (int x = wx; x < std::min(wx + 64, x1); x++) {
+                    guint32 px = get_pixel(t.px.data(), x - x0, y - y0, _stride);
+                    if (compare_pixels(px, _color, _merged_color, _dtc, _threshold, _method)) {
+                        bits |= uint64_t(1) << (x - wx);
+                    }
+                }
+                _paintable.word(wx / 64, y) = bits;
+            }
+        }
+        t.target = _target;
+    }
+
+    Inkscape::Drawing &_drawing;
+    int _width;
+    int _height;
+    int _columns; ///< Tiles per row
+    int _stride;
+    std::vector<Tile> _tiles;
+    PixelMask _paintable;
+
+    guint32 _bgcolor;
+    guint32 _dtc;
+    int _threshold;
+    PaintBucketChannels _method;
+    guint32 _color = 0;
+    guint32 _merged_color = 0;
+    unsigned _target = 0;
+
+    int _rendered = 0;
+    gint64 _render_time = 0;
+};
+
+} // namespace
 
 /**
  * Perform the bitmap-to-vector tracing and place the traced path onto the document.
- * @param px The trace pixel buffer to trace to SVG.
+ * @param colored The pixels to trace to SVG.
+ * @param area The area of the pixels to trace.
  * @param desktop The desktop on which to place the final SVG path.
  * @param transform The transform to apply to the final SVG path.
  * @param union_with_selection If true, merge the final SVG path with the current selection.
  */
-static void do_trace(bitmap_coords_info bci, guchar *trace_px, SPDesktop *desktop, Geom::Affine transform, unsigned int min_x, unsigned int max_x, unsigned int min_y, unsigned int max_y, bool union_with_selection) {
+static void do_trace(PixelMask const &colored, Geom::IntRect const &area, SPDesktop *desktop, Geom::Affine transform, bool union_with_selection) {
     SPDocument *document = desktop->getDocument();
 
-    unsigned char *trace_t;
-
-    GrayMap *gray_map = GrayMapCreate((max_x - min_x + 1), (max_y - min_y + 1));
+    GrayMap *gray_map = GrayMapCreate(area.width(), area.height());
     if (!gray_map) {
         desktop->messageStack()->flash(Inkscape::ERROR_MESSAGE, _("Failed mid-operation, no objects created."));
         return;
     }
-    unsigned int gray_map_y = 0;
-    for (unsigned int y = min_y; y <= max_y; y++) {
-        unsigned long *gray_map_t = gray_map->rows[gray_map_y];
-
-        trace_t = get_trace_pixel(trace_px, min_x, y, bci.width);
-        for (unsigned int x = min_x; x <= max_x; x++) {
-            *gray_map_t = is_pixel_colored(trace_t) ? GRAYMAP_BLACK : GRAYMAP_WHITE;
+    for (int y = area.top(); y < area.bottom(); y++) {
+        unsigned long *gray_map_t = gray_map->rows[y - area.top()];
+        for (int x = area.left(); x < area.right(); x++) {
+            *gray_map_t = colored.test(x, y) ? GRAYMAP_BLACK : GRAYMAP_WHITE;
             gray_map_t++;
-            trace_t++;
         }
-        gray_map_y++;
     }
 
     Inkscape::Trace::Potrace::PotraceTracingEngine pte;
@@ -492,248 +558,6 @@ static void do_trace(bitmap_coords_info bci, guchar *trace_px, SPDesktop *deskto
     }
 }
 
-/**
- * The possible return states of perform_bitmap_scanline_check().
- */
-enum ScanlineCheckResult {
-    SCANLINE_CHECK_OK,
-    SCANLINE_CHECK_ABORTED,
-    SCANLINE_CHECK_BOUNDARY
-};
-
-/**
- * Determine if the provided coordinates are within the pixel buffer limits.
- * @param x The X coordinate.
- * @param y The Y coordinate.
- * @param bci The bitmap_coords_info structure.
- */
-inline static bool coords_in_range(unsigned int x, unsigned int y, bitmap_coords_info bci) {
-    return (x < bci.width) &&
-           (y < bci.height);
-}
-
-#define PAINT_DIRECTION_LEFT 1
-#define PAINT_DIRECTION_RIGHT 2
-#define PAINT_DIRECTION_UP 4
-#define PAINT_DIRECTION_DOWN 8
-#define PAINT_DIRECTION_ALL 15
-
-/**
- * Paint a pixel or a square (if autogap is enabled) on the trace pixel buffer.
- * @param px The rendered pixel buffer to check.
- * @param trace_px The trace pixel buffer.
- * @param orig_color The original selected pixel to use as the fill target color.
- * @param bci The bitmap_coords_info structure.
- * @param original_point_trace_t The original pixel in the trace pixel buffer to check.
- */
-inline static unsigned int paint_pixel(guchar *px, guchar *trace_px, guint32 orig_color, bitmap_coords_info bci, unsigned char *original_point_trace_t) {
-    if (bci.radius == 0) {
-        mark_pixel_colored(original_point_trace_t); 
-        return PAINT_DIRECTION_ALL;
-    } else {
-        unsigned char *trace_t;
-  
-        bool can_paint_up = true;
-        bool can_paint_down = true;
-        bool can_paint_left = true;
-        bool can_paint_right = true;
-      
-        for (unsigned int ty = bci.y - bci.radius; ty <= bci.y + bci.radius; ty++) {
-            for (unsigned int tx = bci.x - bci.radius; tx <= bci.x + bci.radius; tx++) {
-                if (coords_in_range(tx, ty, bci)) {
-                    trace_t = get_trace_pixel(trace_px, tx, ty, bci.width);
-                    if (!is_pixel_colored(trace_t)) {
-                        if (check_if_pixel_is_paintable(px, trace_t, tx, ty, orig_color, bci)) {
-                            mark_pixel_colored(trace_t); 
-                        } else {
-                            if (tx < bci.x) { can_paint_left = false; }
-                            if (tx > bci.x) { can_paint_right = false; }
-                            if (ty < bci.y) { can_paint_up = false; }
-                            if (ty > bci.y) { can_paint_down = false; }
-                        }
-                    }
-                }
-            }
-        }
-    
-        unsigned int paint_directions = 0;
-        if (can_paint_left) { paint_directions += PAINT_DIRECTION_LEFT; }
-        if (can_paint_right) { paint_directions += PAINT_DIRECTION_RIGHT; }
-        if (can_paint_up) { paint_directions += PAINT_DIRECTION_UP; }
-        if (can_paint_down) { paint_directions += PAINT_DIRECTION_DOWN; }
-        
-        return paint_directions;
-    }
-}
-
-/**
- * Push a point to be checked onto the bottom of the rendered pixel buffer check queue.
- * @param fill_queue The fill queue to add the point to.
- * @param max_queue_size The maximum size of the fill queue.
- * @param trace_t The trace pixel buffer pixel.
- * @param x The X coordinate.
- * @param y The Y coordinate.
- */
-static void push_point_onto_queue(std::deque<Geom::Point> *fill_queue, unsigned int max_queue_size, unsigned char *trace_t, unsigned int x, unsigned int y) {
-    if (!is_pixel_queued(trace_t)) {
-        if ((fill_queue->size() < max_queue_size)) {
-            fill_queue->push_back(Geom::Point(x, y));
-            mark_pixel_queued(trace_t);
-        }
-    }
-}
-
-/**
- * Shift a point to be checked onto the top of the rendered pixel buffer check queue.
- * @param fill_queue The fill queue to add the point to.
- * @param max_queue_size The maximum size of the fill queue.
- * @param trace_t The trace pixel buffer pixel.
- * @param x The X coordinate.
- * @param y The Y coordinate.
- */
-static void shift_point_onto_queue(std::deque<Geom::Point> *fill_queue, unsigned int max_queue_size, unsigned char *trace_t, unsigned int x, unsigned int y) {
-    if (!is_pixel_queued(trace_t)) {
-        if ((fill_queue->size() < max_queue_size)) {
-            fill_queue->push_front(Geom::Point(x, y));
-            mark_pixel_queued(trace_t);
-        }
-    }
-}
-
-/**
- * Scan a row in the rendered pixel buffer and add points to the fill queue as necessary.
- * @param fill_queue The fill queue to add the point to.
- * @param px The rendered pixel buffer.
- * @param trace_px The trace pixel buffer.
- * @param orig_color The original selected pixel to use as the fill target color.
- * @param bci The bitmap_coords_info structure.
- */
-static ScanlineCheckResult perform_bitmap_scanline_check(std::deque<Geom::Point> *fill_queue, guchar *px, guchar *trace_px, guint32 orig_color, bitmap_coords_info bci, unsigned int *min_x, unsigned int *max_x) {
-    bool aborted = false;
-    bool reached_screen_boundary = false;
-    bool ok;
-
-    bool keep_tracing;
-    bool initial_paint = true;
-
-    unsigned char *current_trace_t = get_trace_pixel(trace_px, bci.x, bci.y, bci.width);
-    unsigned int paint_directions;
-
-    bool currently_painting_top = false;
-    bool currently_painting_bottom = false;
-
-    unsigned int top_ty = (bci.y > 0) ? bci.y - 1 : 0;
-    unsigned int bottom_ty = bci.y + 1;
-
-    bool can_paint_top = (top_ty > 0);
-    bool can_paint_bottom = (bottom_ty < bci.height);
-
-    Geom::Point front_of_queue = fill_queue->empty() ? Geom::Point() : fill_queue->front();
-
-    do {
-        ok = false;
-        if (bci.is_left) {
-            keep_tracing = (bci.x != 0);
-        } else {
-            keep_tracing = (bci.x < bci.width);
-        }
-
-        *min_x = MIN(*min_x, bci.x);
-        *max_x = MAX(*max_x, bci.x);
-
-        if (keep_tracing) {
-            if (check_if_pixel_is_paintable(px, current_trace_t, bci.x, bci.y, orig_color, bci)) {
-                paint_directions = paint_pixel(px, trace_px, orig_color, bci, current_trace_t);
-                if (bci.radius == 0) {
-                    mark_pixel_checked(current_trace_t);
-                    if ((!fill_queue->empty()) &&
-                        (front_of_queue[Geom::X] == bci.x) &&
-                        (front_of_queue[Geom::Y] == bci.y)) {
-                        fill_queue->pop_front();
-                        front_of_queue = fill_queue->empty() ? Geom::Point() : fill_queue->front();
-                    }
-                }
-
-                if (can_paint_top) {
-                    if (paint_directions & PAINT_DIRECTION_UP) { 
-                        unsigned char *trace_t = current_trace_t - bci.width;
-                        if (!is_pixel_queued(trace_t)) {
-                            bool ok_to_paint = check_if_pixel_is_paintable(px, trace_t, bci.x, top_ty, orig_color, bci);
-
-                            if (initial_paint) { currently_painting_top = !ok_to_paint; }
-
-                            if (ok_to_paint && (!currently_painting_top)) {
-                                currently_painting_top = true;
-                                push_point_onto_queue(fill_queue, bci.max_queue_size, trace_t, bci.x, top_ty);
-                            }
-                            if ((!ok_to_paint) && currently_painting_top) {
-                                currently_painting_top = false;
-                            }
-                        }
-                    }
-                }
-
-                if (can_paint_bottom) {
-                    if (paint_directions & PAINT_DIRECTION_DOWN) { 
-                        unsigned char *trace_t = current_trace_t + bci.width;
-                        if (!is_pixel_queued(trace_t)) {
-                            bool ok_to_paint = check_if_pixel_is_paintable(px, trace_t, bci.x, bottom_ty, orig_color, bci);
-
-                            if (initial_paint) { currently_painting_bottom = !ok_to_paint; }
-
-                            if (ok_to_paint && (!currently_painting_bottom)) {
-                                currently_painting_bottom = true;
-                                push_point_onto_queue(fill_queue, bci.max_queue_size, trace_t, bci.x, bottom_ty);
-                            }
-                            if ((!ok_to_paint) && currently_painting_bottom) {
-                                currently_painting_bottom = false;
-                            }
-                        }
-                    }
-                }
-
-                if (bci.is_left) {
-                    if (paint_directions & PAINT_DIRECTION_LEFT) {
-                        bci.x--; current_trace_t--;
-                        ok = true;
-                    }
-                } else {
-                    if (paint_directions & PAINT_DIRECTION_RIGHT) {
-                        bci.x++; current_trace_t++;
-                        ok = true;
-                    }
-                }
-
-                initial_paint = false;
-            }
-        } else {
-            if (bci.bbox.min()[Geom::X] > bci.screen.min()[Geom::X]) {
-                aborted = true; break;
-            } else {
-                reached_screen_boundary = true;
-            }
-        }
-    } while (ok);
-
-    if (aborted) { return SCANLINE_CHECK_ABORTED; }
-    if (reached_screen_boundary) { return SCANLINE_CHECK_BOUNDARY; }
-    return SCANLINE_CHECK_OK;
-}
-
-/**
- * Sort the rendered pixel buffer check queue vertically.
- */
-static bool sort_fill_queue_vertical(Geom::Point a, Geom::Point b) {
-    return a[Geom::Y] > b[Geom::Y];
-}
-
-/**
- * Sort the rendered pixel buffer check queue horizontally.
- */
-static bool sort_fill_queue_horizontal(Geom::Point a, Geom::Point b) {
-    return a[Geom::X] > b[Geom::X];
-}
-
 /**
  * Perform a flood fill operation.
  * @param event_context The event context for this tool.
@@ -769,68 +593,6 @@ static void sp_flood_do_flood_fill(ToolBase *event_context, GdkEvent *event, boo
     auto const width = img_dims.x();
     auto const height = img_dims.y();
 
-    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-    guchar *px = g_new(guchar, stride * height);
-    guint32 bgcolor, dtc;
-
-    // Draw image into data block px
-    { // this block limits the lifetime of Drawing and DrawingContext
-        /* Create DrawingItems and set transform */
-        unsigned dkey = SPItem::display_key_new(1);
-        Inkscape::Drawing drawing;
-        Inkscape::DrawingItem *root = document->getRoot()->invoke_show( drawing, dkey, SP_ITEM_SHOW_DISPLAY);
-        root->setTransform(doc2img);
-        drawing.setRoot(root);
-
-        Geom::IntRect final_bbox = Geom::IntRect::from_xywh(0, 0, width, height);
-        drawing.update(final_bbox);
-
-        cairo_surface_t *s = cairo_image_surface_create_for_data(
-            px, CAIRO_FORMAT_ARGB32, width, height, stride);
-        Inkscape::DrawingContext dc(s, Geom::Point(0,0));
-        // cairo_translate not necessary here - surface origin is at 0,0
-
-        auto pm = desktop->getNamedView()->getPageManager();
-        bgcolor = pm->background_color;
-
-        // bgcolor is 0xrrggbbaa, we need 0xaarrggbb
-        dtc = (bgcolor >> 8) | (bgcolor << 24);
-
-        dc.setSource(bgcolor);
-        dc.setOperator(CAIRO_OPERATOR_SOURCE);
-        dc.paint();
-        dc.setOperator(CAIRO_OPERATOR_OVER);
-
-        drawing.render(dc, final_bbox);
-
-        //cairo_surface_write_to_png( s, "cairo.png" );
-
-        cairo_surface_flush(s);
-        cairo_surface_destroy(s);
-        
-        // Hide items
-        document->getRoot()->invoke_hide(dkey);
-    }
-
-    // {
-    //     // Dump data to png
-    //     cairo_surface_t *s = cairo_image_surface_create_for_data(
-    //         px, CAIRO_FORMAT_ARGB32, width, height, stride);
-    //     cairo_surface_write_to_png( s, "cairo2.png" );
-    //     std::cout << "  Wrote cairo2.png" << std::endl;
-    // }
-
-    guchar *trace_px = g_new(guchar, width * height);
-    memset(trace_px, 0x00, width * height);
-    
-    std::deque<Geom::Point> fill_queue;
-    std::queue<Geom::Point> color_queue;
-    
-    std::vector<Geom::Point> fill_points;
-    
-    bool aborted = false;
-    int y_limit = height - 1;
-
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     PaintBucketChannels method = (PaintBucketChannels) prefs->getInt("/tools/paintbucket/channels", 0);
     int threshold = prefs->getIntLimited("/tools/paintbucket/threshold", 1, 0, 100);
@@ -849,21 +611,24 @@ static void sp_flood_do_flood_fill(ToolBase *event_context, GdkEvent *event, boo
             break;
     }
 
-    bitmap_coords_info bci;
-    
-    bci.y_limit = y_limit;
-    bci.width = width;
-    bci.height = height;
-    bci.stride = stride;
-    bci.threshold = threshold;
-    bci.method = method;
-    bci.bbox = *bbox;
-    bci.screen = screen;
-    bci.dtc = dtc;
-    bci.radius = prefs->getIntLimited("/tools/paintbucket/autogap", 0, 0, 3);
-    bci.max_queue_size = (width * height) / 4;
-    bci.current_step = 0;
+    int const radius = prefs->getIntLimited("/tools/paintbucket/autogap", 0, 0, 3);
+
+    gint64 const start_time = g_get_monotonic_time();
+
+    /* Create DrawingItems and set transform; the tiles of the image are rendered as the fill reaches them */
+    unsigned dkey = SPItem::display_key_new(1);
+    Inkscape::Drawing drawing;
+    Inkscape::DrawingItem *root = document->getRoot()->invoke_show( drawing, dkey, SP_ITEM_SHOW_DISPLAY);
+    root->setTransform(doc2img);
+    drawing.setRoot(root);
+    drawing.update(Geom::IntRect::from_xywh(0, 0, width, height));
+
+    auto pm = desktop->getNamedView()->getPageManager();
+    FloodImage image(drawing, width, height, pm->background_color, threshold, method);
+
+    gint64 const fill_time = g_get_monotonic_time();
 
+    std::vector<Geom::Point> fill_points;
     if (is_point_fill) {
         fill_points.emplace_back(event->button.x, event->button.y);
     } else {
@@ -871,212 +636,82 @@ static void sp_flood_do_flood_fill(ToolBase *event_context, GdkEvent *event, boo
         fill_points = r->getPoints();
     }
 
+    // With touch fill, the first point gives the color and the others are filled with it too
+    std::vector<Geom::IntPoint> color_points;
+    std::vector<Geom::IntPoint> touch_points;
     auto const img_max_indices = Geom::Rect::from_xywh(0, 0, width - 1, height - 1);
-
     for (unsigned int i = 0; i < fill_points.size(); i++) {
-        Geom::Point pw = fill_points[i] * world2img;
-
-        pw = img_max_indices.clamp(pw);
-
-        if (is_touch_fill) {
-            if (i == 0) {
-                color_queue.push(pw);
-            } else {
-                unsigned char *trace_t = get_trace_pixel(trace_px, (int)pw[Geom::X], (int)pw[Geom::Y], width);
-                push_point_onto_queue(&fill_queue, bci.max_queue_size, trace_t, (int)pw[Geom::X], (int)pw[Geom::Y]);
-            }
+        Geom::Point pw = img_max_indices.clamp(fill_points[i] * world2img);
+        Geom::IntPoint p = pw.floor();
+        if (is_touch_fill && i > 0) {
+            touch_points.push_back(p);
         } else {
-            color_queue.push(pw);
+            color_points.push_back(p);
         }
     }
 
+    PixelMask checked(width, height);
+    PixelMask colored(width, height);
+    Geom::OptIntRect colored_area;
+    bool aborted = false;
     bool reached_screen_boundary = false;
 
-    bool first_run = true;
-
-    unsigned long sort_size_threshold = 5;
-
-    unsigned int min_y = height;
-    unsigned int max_y = 0;
-    unsigned int min_x = width;
-    unsigned int max_x = 0;
-
-    while (!color_queue.empty() && !aborted) {
-        Geom::Point color_point = color_queue.front();
-        color_queue.pop();
-
-        int cx = (int)color_point[Geom::X];
-        int cy = (int)color_point[Geom::Y];
-
-        guint32 orig_color = get_pixel(px, cx, cy, stride);
-        bci.merged_orig_pixel = compose_onto(orig_color, dtc);
-
-        unsigned char *trace_t = get_trace_pixel(trace_px, cx, cy, width);
-        if (!is_pixel_checked(trace_t) && !is_pixel_colored(trace_t)) {
-            if (check_if_pixel_is_paintable(px, trace_px, cx, cy, orig_color, bci)) {
-                shift_point_onto_queue(&fill_queue, bci.max_queue_size, trace_t, cx, cy);
-
-                if (!first_run) {
-                    for (unsigned int y = 0; y < height; y++) {
-                        trace_t = get_trace_pixel(trace_px, 0, y, width);
-                        for (unsigned int x = 0; x < width; x++) {
-                            clear_pixel_paintability(trace_t);
-                            trace_t++;
-                        }
-                    }
-                }
-                first_run = false;
-            }
+    for (unsigned int i = 0; i < color_points.size() && !aborted; i++) {
+        Geom::IntPoint const &cp = color_points[i];
+        if (checked.test(cp.x(), cp.y()) || colored.test(cp.x(), cp.y())) {
+            continue;
         }
+        image.setTarget(image.pixel(cp.x(), cp.y()));
 
-        unsigned long old_fill_queue_size = fill_queue.size();
-
-        while (!fill_queue.empty() && !aborted) {
-            Geom::Point cp = fill_queue.front();
-
-            if (bci.radius == 0) {
-                unsigned long new_fill_queue_size = fill_queue.size();
-
-                /*
-                 * To reduce the number of points in the fill queue, periodically
-                 * resort all of the points in the queue so that scanline checks
-                 * can complete more quickly.  A point cannot be checked twice
-                 * in a normal scanline checks, so forcing scanline checks to start
-                 * from one corner of the rendered area as often as possible
-                 * will reduce the number of points that need to be checked and queued.
-                 */
-                if (new_fill_queue_size > sort_size_threshold) {
-                    if (new_fill_queue_size > old_fill_queue_size) {
-                        std::sort(fill_queue.begin(), fill_queue.end(), sort_fill_queue_vertical);
-
-                        std::deque<Geom::Point>::iterator start_sort = fill_queue.begin();
-                        std::deque<Geom::Point>::iterator end_sort = fill_queue.begin();
-                        unsigned int sort_y = (unsigned int)cp[Geom::Y];
-                        unsigned int current_y;
-                        
-                        for (std::deque<Geom::Point>::iterator i = fill_queue.begin(); i != fill_queue.end(); ++i) {
-                            Geom::Point current = *i;
-                            current_y = (unsigned int)current[Geom::Y];
-                            if (current_y != sort_y) {
-                                if (start_sort != end_sort) {
-                                    std::sort(start_sort, end_sort, sort_fill_queue_horizontal);
-                                }
-                                sort_y = current_y;
-                                start_sort = i;
-                            }
-                            end_sort = i;
-                        }
-                        if (start_sort != end_sort) {
-                            std::sort(start_sort, end_sort, sort_fill_queue_horizontal);
-                        }
-                        
-                        cp = fill_queue.front();
-                    }
-                }
-
-                old_fill_queue_size = new_fill_queue_size;
-            }
-
-            fill_queue.pop_front();
-
-            int x = (int)cp[Geom::X];
-            int y = (int)cp[Geom::Y];
-
-            min_y = MIN((unsigned int)y, min_y);
-            max_y = MAX((unsigned int)y, max_y);
-
-            unsigned char *trace_t = get_trace_pixel(trace_px, x, y, width);
-            if (!is_pixel_checked(trace_t)) {
-                mark_pixel_checked(trace_t);
-
-                if (y == 0) {
-                    if (bbox->min()[Geom::Y] > screen.min()[Geom::Y]) {
-                        aborted = true; break;
-                    } else {
-                        reached_screen_boundary = true;
-                    }
-                }
-
-                if (y == y_limit) {
-                    if (bbox->max()[Geom::Y] < screen.max()[Geom::Y]) {
-                        aborted = true; break;
-                    } else {
-                        reached_screen_boundary = true;
-                    }
-                }
-
-                bci.is_left = true;
-                bci.x = x;
-                bci.y = y;
-
-                ScanlineCheckResult result = perform_bitmap_scanline_check(&fill_queue, px, trace_px, orig_color, bci, &min_x, &max_x);
-
-                switch (result) {
-                    case SCANLINE_CHECK_ABORTED:
-                        aborted = true;
-                        break;
-                    case SCANLINE_CHECK_BOUNDARY:
-                        reached_screen_boundary = true;
-                        break;
-                    default:
-                        break;
-                }
-
-                if (bci.x < width) {
-                    trace_t++;
-                    if (!is_pixel_checked(trace_t) && !is_pixel_queued(trace_t)) {
-                        mark_pixel_checked(trace_t);
-                        bci.is_left = false;
-                        bci.x = x + 1;
-
-                        result = perform_bitmap_scanline_check(&fill_queue, px, trace_px, orig_color, bci, &min_x, &max_x);
-
-                        switch (result) {
-                            case SCANLINE_CHECK_ABORTED:
-                                aborted = true;
-                                break;
-                            case SCANLINE_CHECK_BOUNDARY:
-                                reached_screen_boundary = true;
-                                break;
-                            default:
-                                break;
-                        }
-                    }
-                }
-            }
-
-            bci.current_step++;
+        std::vector<Geom::IntPoint> seeds{cp};
+        if (i == 0) {
+            seeds.insert(seeds.end(), touch_points.begin(), touch_points.end());
+        }
 
-            if (bci.current_step > bci.max_queue_size) {
+        switch (perform_scanline_fill(image, seeds, radius, *bbox, screen, checked, colored, colored_area)) {
+            case SCANLINE_CHECK_ABORTED:
                 aborted = true;
-            }
+                break;
+            case SCANLINE_CHECK_BOUNDARY:
+                reached_screen_boundary = true;
+                break;
+            default:
+                break;
         }
     }
-    
-    g_free(px);
-    
+
+    // Hide items
+    document->getRoot()->invoke_hide(dkey);
+
+    gint64 const trace_time = g_get_monotonic_time();
+
     if (aborted) {
-        g_free(trace_px);
         desktop->messageStack()->flash(Inkscape::WARNING_MESSAGE, _("<b>Area is not bounded</b>, cannot fill."));
         return;
     }
+    if (!colored_area) {
+        // the seed pixel matches its own color, so only the autogap square can have stopped the fill
+        desktop->messageStack()->flash(Inkscape::WARNING_MESSAGE, _("<b>No area to fill</b> at this point. Try a smaller gap setting."));
+        return;
+    }
     
     if (reached_screen_boundary) {
         desktop->messageStack()->flash(Inkscape::WARNING_MESSAGE, _("<b>Only the visible part of the bounded area was filled.</b> If you want to fill all of the area, undo, zoom out, and fill again.")); 
     }
 
-    unsigned int trace_padding = bci.radius + 1;
-    if (min_y > trace_padding) { min_y -= trace_padding; }
-    if (max_y < (y_limit - trace_padding)) { max_y += trace_padding; }
-    if (min_x > trace_padding) { min_x -= trace_padding; }
-    if (max_x < (width - 1 - trace_padding)) { max_x += trace_padding; }
+    Geom::OptIntRect trace_area = colored_area;
+    trace_area->expandBy(radius + 1);
+    trace_area.intersectWith(Geom::IntRect::from_xywh(0, 0, width, height));
 
-    Geom::Affine inverted_affine = Geom::Translate(min_x, min_y) * doc2img.inverse();
+    Geom::Affine inverted_affine = Geom::Translate(trace_area->left(), trace_area->top()) * doc2img.inverse();
     
-    do_trace(bci, trace_px, desktop, inverted_affine, min_x, max_x, min_y, max_y, union_with_selection);
+    do_trace(colored, *trace_area, desktop, inverted_affine, union_with_selection);
+
+    gint64 const end_time = g_get_monotonic_time();
+    g_debug("Paint bucket: setup %.1f ms, fill %.1f ms (rendering %d of %d tiles %.1f ms), trace %.1f ms",
+            (fill_time - start_time) / 1000.0, (trace_time - fill_time) / 1000.0, image.renderedTiles(),
+            image.tiles(), image.renderTime() / 1000.0, (end_time - trace_time) / 1000.0);
 
-    g_free(trace_px);
-    
     DocumentUndo::done(document, _("Fill bounded area"), INKSCAPE_ICON("color-fill"));
 }
 
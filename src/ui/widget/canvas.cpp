@@ -11,7 +11,10 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include <glibmm/i18n.h>
 
@@ -27,11 +30,19 @@
 
 #include "display/cairo-utils.h"     // Checkerboard background.
 #include "display/drawing.h"
+#include "display/drawing-context.h"
+#include "display/drawing-surface.h"
 #include "display/control/canvas-item-group.h"
 #include "display/control/snap-indicator.h"
 
+#include "debug/trace.h"
+
 #include "ui/tools/tool-base.h"      // Default cursor
 
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 /*
  *   The canvas is responsible for rendering the SVG drawing with various "control"
  *   items below and on top of the drawing. Rendering is triggered by a call to one of:
@@ -61,8 +72,10 @@
  *
  *   * paint_rect_internal()  Which recursively divides the area into smaller pieces until a piece is small
  *                            enough to render. It renders the pieces closest to the cursor first. The pieces
- *                            are rendered onto a Cairo surface "backing_store". After a piece is rendered
- *                            there is a call to:
+ *                            are rendered onto a Cairo surface "backing_store". (If "/options/rendering/threaded"
+ *                            is set, paint_rect_threaded() is used instead. It divides the area the same way,
+ *                            but renders the drawing for several pieces at once on worker threads.)
+ *                            After a piece is rendered there is a call to:
  *
  *   * queue_draw_area() A Gtk function for drawing into a widget which when the time is right calls:
  *
@@ -88,6 +101,7 @@ struct PaintRectSetup {
     gint64 start_time;
     int max_pixels;
     Geom::Point mouse_loc;
+    int threads; // Number of threads rendering the drawing, 1 if not threaded.
 };
 
 
@@ -1027,6 +1041,8 @@ Canvas::do_update()
 bool
 Canvas::paint()
 {
+    Inkscape::Debug::TraceScope trace("Canvas::paint", Inkscape::Debug::Event::RENDERING);
+
     if (_need_update) {
         std::cerr << "Canvas::Paint: called while needing update!" << std::endl;
     }
@@ -1092,23 +1108,25 @@ Canvas::paint_rect(Cairo::RectangleInt& rect)
         setup.max_pixels = 262144;
     }
 
+    setup.threads = 1;
+#ifdef HAVE_OPENMP
+    if (prefs->getBool("/options/rendering/threaded", false)) {
+        setup.threads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+    }
+#endif
+
+    if (setup.threads > 1) {
+        return paint_rect_threaded(&setup, paint_rect);
+    }
     return paint_rect_internal(&setup, paint_rect);
 }
 
-
 /*
- * Returns true on successful rendering of rectangle (unless error).
- * Returns false if rectangle has no area or if timed out.
- * Queues Gtk redraw of widget.
+ * Returns true if painting should stop to give control back to the idle loop.
  */
 bool
-Canvas::paint_rect_internal(PaintRectSetup const *setup, Geom::IntRect const &this_rect)
+Canvas::paint_timed_out(PaintRectSetup const *setup)
 {
-    if (!_drawing) {
-        std::cerr << "Canvas::paint_rect_internal: no CanvasItemDrawing!" << std::endl;
-        return false;
-    }
-
     gint64 now = g_get_monotonic_time();
     gint64 elapsed = now - setup->start_time;
 
@@ -1131,11 +1149,32 @@ Canvas::paint_rect_internal(PaintRectSetup const *setup, Geom::IntRect const &th
             if (_forced_redraw_limit != -1) {
                 _forced_redraw_count++;
             }
-            return false;
+            return true;
         }
         _forced_redraw_count = 0;
     }
 
+    return false;
+}
+
+
+/*
+ * Returns true on successful rendering of rectangle (unless error).
+ * Returns false if rectangle has no area or if timed out.
+ * Queues Gtk redraw of widget.
+ */
+bool
+Canvas::paint_rect_internal(PaintRectSetup const *setup, Geom::IntRect const &this_rect)
+{
+    if (!_drawing) {
+        std::cerr << "Canvas::paint_rect_internal: no CanvasItemDrawing!" << std::endl;
+        return false;
+    }
+
+    if (paint_timed_out(setup)) {
+        return false;
+    }
+
     // Find optimal buffer dimension
     int bw = this_rect.width();
     int bh = this_rect.height();
@@ -1147,25 +1186,7 @@ Canvas::paint_rect_internal(PaintRectSetup const *setup, Geom::IntRect const &th
 
     if (bw * bh < setup->max_pixels) {
         // We are small enough!
-
-        _drawing->setRenderMode(_render_mode);
-        _drawing->setColorMode(_color_mode);
-
-        paint_single_buffer(this_rect, setup->canvas_rect, _backing_store);
-        bool outline_overlay = _drawing->outlineOverlay();
-        if (_split_mode != Inkscape::SplitMode::NORMAL || outline_overlay) {
-            _drawing->setRenderMode(Inkscape::RenderMode::OUTLINE);
-            paint_single_buffer(this_rect, setup->canvas_rect, _outline_store);
-            if (outline_overlay) {
-                _drawing->setRenderMode(Inkscape::RenderMode::OUTLINE_OVERLAY);
-            }
-        }
-
-        Cairo::RectangleInt crect = { this_rect.left(), this_rect.top(), this_rect.width(), this_rect.height() };
-        _clean_region->do_union( crect );
-
-        queue_draw_area(this_rect.left() - _x0, this_rect.top() - _y0, this_rect.width(), this_rect.height());
-
+        paint_buffers(this_rect, setup->canvas_rect);
         return true;
     }
 
@@ -1217,15 +1238,142 @@ Canvas::paint_rect_internal(PaintRectSetup const *setup, Geom::IntRect const &th
     }
 }
 
+/*
+ * Threaded version of paint_rect_internal(). The drawing is rendered for a batch of
+ * pieces at once, each worker using its own surface and flagging the render as read-only,
+ * so that it only modifies the item caches, which are shared under a lock. The rest (canvas
+ * items, outline store, color management) is done here as before, piece by piece.
+ */
+bool
+Canvas::paint_rect_threaded(PaintRectSetup const *setup, Geom::IntRect const &this_rect)
+{
+    if (!_drawing) {
+        std::cerr << "Canvas::paint_rect_threaded: no CanvasItemDrawing!" << std::endl;
+        return false;
+    }
+
+    // Make sure there are enough pieces to keep all threads busy, but don't make them so small
+    // that the area filters need around each of them dominates.
+    PaintRectSetup threaded_setup = *setup;
+    int const min_pixels = 65536;
+    int const area_pixels = this_rect.width() * this_rect.height();
+    threaded_setup.max_pixels = std::clamp(area_pixels / (2 * setup->threads), min_pixels,
+                                           std::max(min_pixels, setup->max_pixels));
+
+    std::vector<Geom::IntRect> pieces;
+    split_rect(&threaded_setup, this_rect, pieces);
+
+    std::size_t const batch_size = 2 * setup->threads;
+    for (std::size_t first = 0; first < pieces.size(); first += batch_size) {
+        if (paint_timed_out(setup)) {
+            return false;
+        }
+
+        int const count = std::min(batch_size, pieces.size() - first);
+        std::vector<std::unique_ptr<Inkscape::DrawingSurface>> tiles(count);
+
+        // Bring the drawing up to date here, the workers must not modify it.
+        _drawing->setRenderMode(_render_mode);
+        _drawing->setColorMode(_color_mode);
+        _drawing->update();
+
+#ifdef HAVE_OPENMP
+        #pragma omp parallel for schedule(dynamic) num_threads(setup->threads)
+#endif
+        for (int i = 0; i < count; ++i) {
+            Geom::IntRect const &piece = pieces[first + i];
+            auto tile = std::make_unique<Inkscape::DrawingSurface>(piece, _device_scale);
+            {
+                Inkscape::DrawingContext dc(*tile);
+                _drawing->render(dc, piece, Inkscape::DrawingItem::RENDER_READONLY);
+            }
+            tiles[i] = std::move(tile);
+        }
+
+        for (int i = 0; i < count; ++i) {
+            paint_buffers(pieces[first + i], setup->canvas_rect, tiles[i].get());
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Divides a rectangle the same way as paint_rect_internal() does, appending the pieces
+ * to "pieces" in the order they should be painted (closest to the cursor first).
+ */
+void
+Canvas::split_rect(PaintRectSetup const *setup, Geom::IntRect const &this_rect, std::vector<Geom::IntRect> &pieces)
+{
+    int bw = this_rect.width();
+    int bh = this_rect.height();
+
+    if (bw < 1 || bh < 1) {
+        return;
+    }
+
+    if (bw * bh < setup->max_pixels) {
+        pieces.push_back(this_rect);
+        return;
+    }
+
+    static int TILE_SIZE = 16;
+    Geom::IntRect lo, hi;
+    bool lo_first;
+
+    if (bw < bh || bh < 2 * TILE_SIZE) {
+        int mid = this_rect[Geom::X].middle();
+        lo = Geom::IntRect(this_rect.left(), this_rect.top(), mid,               this_rect.bottom());
+        hi = Geom::IntRect(mid,              this_rect.top(), this_rect.right(), this_rect.bottom());
+        lo_first = setup->mouse_loc[Geom::X] < mid;
+    } else {
+        int mid = this_rect[Geom::Y].middle();
+        lo = Geom::IntRect(this_rect.left(), this_rect.top(), this_rect.right(), mid                );
+        hi = Geom::IntRect(this_rect.left(), mid,             this_rect.right(), this_rect.bottom());
+        lo_first = setup->mouse_loc[Geom::Y] < mid;
+    }
+
+    split_rect(setup, lo_first ? lo : hi, pieces);
+    split_rect(setup, lo_first ? hi : lo, pieces);
+}
+
+/*
+ * Paint a rectangle into the backing store (and outline store if needed) and mark it clean.
+ * drawing_tile: the drawing already rendered for paint_rect, or null to render it here.
+ */
+void
+Canvas::paint_buffers(Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect,
+                      Inkscape::DrawingSurface *drawing_tile)
+{
+    _drawing->setRenderMode(_render_mode);
+    _drawing->setColorMode(_color_mode);
+
+    paint_single_buffer(paint_rect, canvas_rect, _backing_store, drawing_tile);
+    bool outline_overlay = _drawing->outlineOverlay();
+    if (_split_mode != Inkscape::SplitMode::NORMAL || outline_overlay) {
+        _drawing->setRenderMode(Inkscape::RenderMode::OUTLINE);
+        paint_single_buffer(paint_rect, canvas_rect, _outline_store);
+        if (outline_overlay) {
+            _drawing->setRenderMode(Inkscape::RenderMode::OUTLINE_OVERLAY);
+        }
+    }
+
+    Cairo::RectangleInt crect = { paint_rect.left(), paint_rect.top(), paint_rect.width(), paint_rect.height() };
+    _clean_region->do_union( crect );
+
+    queue_draw_area(paint_rect.left() - _x0, paint_rect.top() - _y0, paint_rect.width(), paint_rect.height());
+}
+
 /*
  * Paint a single buffer.
  * paint_rect: buffer rectangle.
  * canvas_rect: canvas rectangle.
  * store: Cairo surface to draw on.
+ * drawing_tile: the drawing already rendered for paint_rect, or null.
  */
 void
 Canvas::paint_single_buffer(Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect,
-                            Cairo::RefPtr<Cairo::ImageSurface> &store)
+                            Cairo::RefPtr<Cairo::ImageSurface> &store, Inkscape::DrawingSurface *drawing_tile)
 {
     if (!store) {
         std::cerr << "Canvas::paint_single_buffer: store not created!" << std::endl;
@@ -1234,6 +1382,7 @@ Canvas::paint_single_buffer(Geom::IntRect const &paint_rect, Geom::IntRect const
     }
 
     Inkscape::CanvasItemBuffer buf(paint_rect, canvas_rect, _device_scale);
+    buf.drawing_tile = drawing_tile;
 
     // Make sure the following code does not go outside of store's data
     assert(store->get_format() == Cairo::FORMAT_ARGB32);
@@ -15,6 +15,8 @@
 #include "config.h"
 #endif
 
+#include <vector>
+
 #include <gtkmm.h>
 
 #include <2geom/rect.h>
@@ -34,6 +36,7 @@ namespace Inkscape {
 class CanvasItem;
 class CanvasItemGroup;
 class Drawing;
+class DrawingSurface;
 
 namespace UI {
 namespace Widget {
@@ -160,8 +163,14 @@ private:
     bool paint();
     bool paint_rect(Cairo::RectangleInt& rect);
     bool paint_rect_internal(PaintRectSetup const *setup, Geom::IntRect const &this_rect);
+    bool paint_rect_threaded(PaintRectSetup const *setup, Geom::IntRect const &this_rect);
+    bool paint_timed_out(PaintRectSetup const *setup);
+    void split_rect(PaintRectSetup const *setup, Geom::IntRect const &this_rect, std::vector<Geom::IntRect> &pieces);
+    void paint_buffers(Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect,
+                       Inkscape::DrawingSurface *drawing_tile = nullptr);
     void paint_single_buffer(Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect,
-                             Cairo::RefPtr<Cairo::ImageSurface> &store);
+                             Cairo::RefPtr<Cairo::ImageSurface> &store,
+                             Inkscape::DrawingSurface *drawing_tile = nullptr);
 
     void shift_content(Geom::IntPoint shift, Cairo::RefPtr<Cairo::ImageSurface> &store);
     void add_clippath(const Cairo::RefPtr<Cairo::Context>& cr);
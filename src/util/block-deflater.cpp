@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Inkscape::Util::BlockDeflater - deflate compression of independent blocks on several threads
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "block-deflater.h"
+
+namespace Inkscape {
+namespace Util {
+
+namespace {
+
+/// The largest distance deflate refers back to.
+std::size_t const WINDOW_SIZE = 32 * 1024;
+
+} // namespace
+
+struct BlockDeflater::Block {
+    void compress(unsigned char const *dictionary, std::size_t dictionary_size, bool last, int level);
+
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> output;
+    unsigned long crc = 0;
+    bool ok = true;
+};
+
+/**
+ * Compresses the input into a raw deflate stream that ends on a byte boundary, or for the last
+ * block, into one that ends the whole stream.
+ */
+void BlockDeflater::Block::compress(unsigned char const *dictionary, std::size_t dictionary_size, bool last,
+                                    int level)
+{
+    crc = crc32(crc32(0L, Z_NULL, 0), input.data(), input.size());
+    output.clear();
+    ok = true;
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        ok = false;
+        return;
+    }
+    if (dictionary_size) {
+        deflateSetDictionary(&stream, dictionary, dictionary_size);
+    }
+
+    // a sync flush adds a few bytes to the bound of a finished stream
+    output.resize(deflateBound(&stream, input.size()) + 16);
+    stream.next_in = const_cast<Bytef *>(input.data());
+    stream.avail_in = input.size();
+
+    int const flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    std::size_t used = 0;
+    while (true) {
+        stream.next_out = output.data() + used;
+        stream.avail_out = output.size() - used;
+        int const err = ::deflate(&stream, flush);
+        used = output.size() - stream.avail_out;
+        if (err == Z_STREAM_END || (!last && err == Z_OK && stream.avail_out != 0)) {
+            break;
+        }
+        if (err != Z_OK && err != Z_BUF_ERROR) {
+            ok = false;
+            break;
+        }
+        output.resize(output.size() * 2);
+    }
+    output.resize(used);
+    // reports an error for a stream left unfinished, as all but the last block are
+    deflateEnd(&stream);
+}
+
+BlockDeflater::BlockDeflater(Sink sink, int threads, int level)
+    : _sink(std::move(sink))
+    , _threads(std::max(threads, 1))
+    , _level(level)
+    , _blocks(_threads)
+    , _crc(crc32(0L, Z_NULL, 0))
+{
+}
+
+BlockDeflater::~BlockDeflater() = default;
+
+void BlockDeflater::write(unsigned char const *data, std::size_t size)
+{
+    while (size > 0) {
+        if (_used > 0 && _blocks[_used - 1].input.size() < BLOCK_SIZE) {
+            auto &input = _blocks[_used - 1].input;
+            std::size_t const count = std::min(size, BLOCK_SIZE - input.size());
+            input.insert(input.end(), data, data + count);
+            data += count;
+            size -= count;
+        } else {
+            // More data follows the full blocks, so none of them is the last.
+            if (_used == _blocks.size()) {
+                _compress(false);
+            }
+            _blocks[_used++].input.clear();
+        }
+    }
+}
+
+bool BlockDeflater::finish()
+{
+    if (!_finished) {
+        _finished = true;
+        if (_used == 0) {
+            // an empty stream is still one final block
+            _blocks[_used++].input.clear();
+        }
+        _compress(true);
+    }
+    return _ok;
+}
+
+/**
+ * Compresses the blocks of the batch, on as many threads as there are blocks, and hands them
+ * to the sink in order.
+ */
+void BlockDeflater::_compress(bool last)
+{
+    int const count = _used;
+    int const level = _level;
+
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for schedule(static, 1) num_threads(_threads) if (count > 1)
+#endif
+    for (int i = 0; i < count; i++) {
+        std::vector<unsigned char> const &previous = i == 0 ? _dictionary : _blocks[i - 1].input;
+        std::size_t const dictionary_size = std::min(previous.size(), WINDOW_SIZE);
+        _blocks[i].compress(previous.data() + previous.size() - dictionary_size, dictionary_size,
+                            last && i == count - 1, level);
+    }
+
+    for (int i = 0; i < count; i++) {
+        auto const &block = _blocks[i];
+        _ok = _ok && block.ok;
+        _crc = crc32_combine(_crc, block.crc, block.input.size());
+        _size += block.input.size();
+        _sink(block.output.data(), block.output.size());
+    }
+
+    auto const &input = _blocks[count - 1].input;
+    std::size_t const dictionary_size = std::min(input.size(), WINDOW_SIZE);
+    _dictionary.assign(input.end() - dictionary_size, input.end());
+    _used = 0;
+}
+
+bool BlockDeflater::deflate(std::vector<unsigned char> &dest, std::vector<unsigned char> const &src,
+                            int threads, int level)
+{
+    dest.clear();
+    BlockDeflater deflater([&](unsigned char const *data, std::size_t size) {
+        dest.insert(dest.end(), data, data + size);
+    }, threads, level);
+    deflater.write(src.data(), src.size());
+    return deflater.finish();
+}
+
+} // namespace Util
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
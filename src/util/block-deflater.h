@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Inkscape::Util::BlockDeflater - deflate compression of independent blocks on several threads
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_UTIL_BLOCK_DEFLATER_H
+#define SEEN_INKSCAPE_UTIL_BLOCK_DEFLATER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <zlib.h>
+
+namespace Inkscape {
+namespace Util {
+
+/**
+ * Compresses data into a raw deflate stream, as found in gzip and zip files, in the way of
+ * pigz. The data is cut into blocks of BLOCK_SIZE bytes that are compressed on several threads
+ * at once, each primed with the last 32 KiB of the block before it as its dictionary, so that
+ * little is lost to the cuts. Every block but the last ends with a sync flush, which ends it on
+ * a byte boundary, so the compressed blocks concatenate into one valid stream.
+ *
+ * The sink receives the compressed data in order, on the thread that calls write() and
+ * finish(), once per batch of as many blocks as there are threads. Only one batch is held in
+ * memory at a time.
+ */
+class BlockDeflater {
+public:
+    using Sink = std::function<void(unsigned char const *data, std::size_t size)>;
+
+    static constexpr std::size_t BLOCK_SIZE = 128 * 1024;
+
+    /**
+     * @param threads Number of blocks compressed at once. With 1, each block is compressed on
+     *                the calling thread as soon as it is full.
+     * @param level zlib compression level.
+     */
+    BlockDeflater(Sink sink, int threads = 1, int level = Z_DEFAULT_COMPRESSION);
+    ~BlockDeflater();
+
+    BlockDeflater(BlockDeflater const &) = delete;
+    BlockDeflater &operator=(BlockDeflater const &) = delete;
+
+    void write(unsigned char const *data, std::size_t size);
+
+    /// Compresses what is left and ends the stream. Returns false if compressing failed.
+    bool finish();
+
+    /// CRC-32 of the data compressed so far, as gzip and zip files record it.
+    unsigned long crc() const { return _crc; }
+
+    /// Number of bytes compressed so far.
+    std::uint64_t size() const { return _size; }
+
+    /// Compresses data in one go.
+    static bool deflate(std::vector<unsigned char> &dest, std::vector<unsigned char> const &src,
+                        int threads = 1, int level = Z_DEFAULT_COMPRESSION);
+
+private:
+    struct Block;
+
+    void _compress(bool last);
+
+    Sink _sink;
+    int _threads;
+    int _level;
+    std::vector<Block> _blocks;    ///< The batch being filled, of which _used blocks have data
+    std::size_t _used = 0;
+    std::vector<unsigned char> _dictionary; ///< End of the last block of the previous batch
+    unsigned long _crc;
+    std::uint64_t _size = 0;
+    bool _ok = true;
+    bool _finished = false;
+};
+
+} // namespace Util
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_UTIL_BLOCK_DEFLATER_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -32,9 +32,8 @@
  * non-optimized, it is not useful in cases where very large
  * archives are needed or where high performance is desired.
  * However, it should hopefully work very well for smaller,
- * one-at-a-time tasks.  What you get in return is the ability
- * to drop these files into your project and remove the dependencies
- * on ZLib and Info-Zip.  Enjoy.
+ * one-at-a-time tasks.  Compression is done by zlib, on several
+ * threads for large entries, see Inkscape::Util::BlockDeflater.
  */
 
 
@@ -46,6 +45,7 @@
 #include <utility>
 
 #include "ziptool.h"
+#include "block-deflater.h"
 
 
 
@@ -805,627 +805,6 @@ bool Inflater::inflate(std::vector<unsigned char> &destination,
 
 
 
-//########################################################################
-//#  D E F L A T E R
-//########################################################################
-
-
-#define DEFLATER_BUF_SIZE 32768
-class Deflater
-{
-public:
-
-    /**
-     *
-     */
-    Deflater();
-
-    /**
-     *
-     */
-    virtual ~Deflater();
-
-    /**
-     *
-     */
-    virtual void reset();
-
-    /**
-     *
-     */
-    virtual bool update(int ch);
-
-    /**
-     *
-     */
-    virtual bool finish();
-
-    /**
-     *
-     */
-    virtual std::vector<unsigned char> &getCompressed();
-
-    /**
-     *
-     */
-    bool deflate(std::vector<unsigned char> &dest,
-                 const std::vector<unsigned char> &src);
-
-    void encodeDistStatic(unsigned int len, unsigned int dist);
-
-private:
-
-    //debug messages
-    void error(char const *fmt, ...)
-    #ifdef G_GNUC_PRINTF
-    G_GNUC_PRINTF(2, 3)
-    #endif
-    ;
-
-    void trace(char const *fmt, ...)
-    #ifdef G_GNUC_PRINTF
-    G_GNUC_PRINTF(2, 3)
-    #endif
-    ;
-
-    bool compressWindow();
-
-    bool compress();
-
-    std::vector<unsigned char> compressed;
-
-    std::vector<unsigned char> uncompressed;
-
-    std::vector<unsigned char> window;
-
-    unsigned int windowPos;
-
-    //#### Output
-    unsigned int outputBitBuf;
-    unsigned int outputNrBits;
-
-    void put(int ch);
-
-    void putWord(int ch);
-
-    void putFlush();
-
-    void putBits(unsigned int ch, unsigned int bitsWanted);
-
-    void putBitsR(unsigned int ch, unsigned int bitsWanted);
-
-    //#### Huffman Encode
-    void encodeLiteralStatic(unsigned int ch);
-
-    unsigned char windowBuf[DEFLATER_BUF_SIZE];
-    //assume 32-bit ints
-    unsigned int windowHashBuf[DEFLATER_BUF_SIZE];
-};
-
-
-//########################################################################
-//# A P I
-//########################################################################
-
-
-/**
- *
- */
-Deflater::Deflater()
-{
-    reset();
-}
-
-/**
- *
- */
-Deflater::~Deflater()
-= default;
-
-/**
- *
- */
-void Deflater::reset()
-{
-    compressed.clear();
-    uncompressed.clear();
-    window.clear();
-	windowPos = 0;
-    outputBitBuf = 0;
-    outputNrBits = 0;
-    for (int k=0; k<DEFLATER_BUF_SIZE; k++)
-    {
-        windowBuf[k]=0;
-        windowHashBuf[k]=0;
-    }
-}
-
-/**
- *
- */
-bool Deflater::update(int ch)
-{
-    uncompressed.push_back((unsigned char)(ch & 0xff));
-    return true;
-}
-
-/**
- *
- */
-bool Deflater::finish()
-{
-    return compress();
-}
-
-/**
- *
- */
-std::vector<unsigned char> &Deflater::getCompressed()
-{
-    return compressed;
-}
-
-
-/**
- *
- */
-bool Deflater::deflate(std::vector<unsigned char> &dest,
-                       const std::vector<unsigned char> &src)
-{
-    reset();
-    uncompressed = src;
-    if (!compress())
-        return false;
-    dest = compressed;
-    return true;
-}
-
-
-
-
-
-
-
-//########################################################################
-//# W O R K I N G    C O D E
-//########################################################################
-
-
-//#############################
-//#  M E S S A G E S
-//#############################
-
-/**
- *  Print error messages
- */
-void Deflater::error(char const *fmt, ...)
-{
-    va_list args;
-    va_start(args, fmt);
-    fprintf(stdout, "Deflater error:");
-    vfprintf(stdout, fmt, args);
-    fprintf(stdout, "\n");
-    va_end(args);
-}
-
-/**
- *  Print trace messages
- */
-void Deflater::trace(char const *fmt, ...)
-{
-    va_list args;
-    va_start(args, fmt);
-    fprintf(stdout, "Deflater:");
-    vfprintf(stdout, fmt, args);
-    fprintf(stdout, "\n");
-    va_end(args);
-}
-
-
-
-
-//#############################
-//#  O U T P U T
-//#############################
-
-/**
- *
- */
-void Deflater::put(int ch)
-{
-    compressed.push_back(ch);
-    outputBitBuf = 0;
-    outputNrBits = 0;
-}
-
-/**
- *
- */
-void Deflater::putWord(int ch)
-{
-    int lo = (ch   ) & 0xff;
-    int hi = (ch>>8) & 0xff;
-    put(lo);
-    put(hi);
-}
-
-/**
- *
- */
-void Deflater::putFlush()
-{
-    if (outputNrBits > 0)
-        {
-        put(outputBitBuf & 0xff);
-        }
-    outputBitBuf = 0;
-    outputNrBits = 0;
-}
-
-/**
- *
- */
-void Deflater::putBits(unsigned int ch, unsigned int bitsWanted)
-{
-    //trace("n:%4u, %d\n", ch, bitsWanted);
-
-    while (bitsWanted--)
-        {
-        //add bits to position 7.  shift right
-        outputBitBuf = (outputBitBuf>>1) + (ch<<7 & 0x80);
-        ch >>= 1;
-        outputNrBits++;
-        if (outputNrBits >= 8)
-            {
-            unsigned char b = outputBitBuf & 0xff;
-            //printf("b:%02x\n", b);
-            put(b);
-            }
-        }
-}
-
-static unsigned int bitReverse(unsigned int code, unsigned int nrBits)
-{
-    unsigned int outb = 0;
-    while (nrBits--)
-        {
-        outb = (outb << 1) | (code & 0x01);
-        code >>= 1;
-        }
-    return outb;
-}
-
-
-/**
- *
- */
-void Deflater::putBitsR(unsigned int ch, unsigned int bitsWanted)
-{
-    //trace("r:%4u, %d", ch, bitsWanted);
-
-    unsigned int rcode = bitReverse(ch, bitsWanted);
-
-    putBits(rcode, bitsWanted);
-
-}
-
-
-//#############################
-//#  E N C O D E
-//#############################
-
-
-
-void Deflater::encodeLiteralStatic(unsigned int ch)
-{
-    //trace("c: %d", ch);
-
-    if (ch < 144)
-        {
-        putBitsR(ch + 0x0030 , 8); // 00110000
-        }
-    else if (ch < 256)
-        {
-        putBitsR(ch - 144 + 0x0190 , 9); // 110010000
-        }
-    else if (ch < 280)
-        {
-        putBitsR(ch - 256 + 0x0000 , 7); // 0000000
-        }
-    else if (ch < 288)
-        {
-        putBitsR(ch - 280 + 0x00c0 , 8); // 11000000
-        }
-    else //out of range
-        {
-        error("Literal out of range: %d", ch);
-        }
-
-}
-
-
-struct LenBase
-{
-    unsigned int base;
-    unsigned int range;
-    unsigned int bits;
-};
-
-LenBase lenBases[] =
-{
-    // clang-format off
-    {   3,  1, 0 },
-    {   4,  1, 0 },
-    {   5,  1, 0 },
-    {   6,  1, 0 },
-    {   7,  1, 0 },
-    {   8,  1, 0 },
-    {   9,  1, 0 },
-    {  10,  1, 0 },
-    {  11,  2, 1 },
-    {  13,  2, 1 },
-    {  15,  2, 1 },
-    {  17,  2, 1 },
-    {  19,  4, 2 },
-    {  23,  4, 2 },
-    {  27,  4, 2 },
-    {  31,  4, 2 },
-    {  35,  8, 3 },
-    {  43,  8, 3 },
-    {  51,  8, 3 },
-    {  59,  8, 3 },
-    {  67, 16, 4 },
-    {  83, 16, 4 },
-    {  99, 16, 4 },
-    { 115, 16, 4 },
-    { 131, 32, 5 },
-    { 163, 32, 5 },
-    { 195, 32, 5 },
-    { 227, 32, 5 },
-    { 258,  1, 0 }
-    // clang-format on
-};
-
-struct DistBase
-{
-    unsigned int base;
-    unsigned int range;
-    unsigned int bits;
-};
-
-DistBase distBases[] =
-{
-    // clang-format off
-    {     1,    1,  0 },
-    {     2,    1,  0 },
-    {     3,    1,  0 },
-    {     4,    1,  0 },
-    {     5,    2,  1 },
-    {     7,    2,  1 },
-    {     9,    4,  2 },
-    {    13,    4,  2 },
-    {    17,    8,  3 },
-    {    25,    8,  3 },
-    {    33,   16,  4 },
-    {    49,   16,  4 },
-    {    65,   32,  5 },
-    {    97,   32,  5 },
-    {   129,   64,  6 },
-    {   193,   64,  6 },
-    {   257,  128,  7 },
-    {   385,  128,  7 },
-    {   513,  256,  8 },
-    {   769,  256,  8 },
-    {  1025,  512,  9 },
-    {  1537,  512,  9 },
-    {  2049, 1024, 10 },
-    {  3073, 1024, 10 },
-    {  4097, 2048, 11 },
-    {  6145, 2048, 11 },
-    {  8193, 4096, 12 },
-    { 12289, 4096, 12 },
-    { 16385, 8192, 13 },
-    { 24577, 8192, 13 }
-    // clang-format on
-};
-
-void Deflater::encodeDistStatic(unsigned int len, unsigned int dist)
-{
-
-    //## Output length
-
-    if (len < 3 || len > 258)
-        {
-        error("Length out of range:%d", len);
-        return;
-        }
-
-    bool found = false;
-    for (int i=0 ; i<29 ; i++)
-        {
-        unsigned int base  = lenBases[i].base;
-        unsigned int range = lenBases[i].range;
-        if (base + range > len)
-            {
-            unsigned int lenCode = 257 + i;
-            unsigned int length  = len - base;
-            //trace("--- %d %d %d %d", len, base, range, length);
-            encodeLiteralStatic(lenCode);
-            putBits(length, lenBases[i].bits);
-            found = true;
-            break;
-            }
-        }
-    if (!found)
-        {
-        error("Length not found in table:%d", len);
-        return;
-        }
-
-    //## Output distance
-
-    if (dist < 4 || dist > 32768)
-        {
-        error("Distance out of range:%d", dist);
-        return;
-        }
-
-    found = false;
-    for (int i=0 ; i<30 ; i++)
-        {
-        unsigned int base  = distBases[i].base;
-        unsigned int range = distBases[i].range;
-        if (base + range > dist)
-            {
-            unsigned int distCode = i;
-            unsigned int distance = dist - base;
-            //error("--- %d %d %d %d", dist, base, range, distance);
-            putBitsR(distCode, 5);
-            putBits(distance, distBases[i].bits);
-            found = true;
-            break;
-            }
-        }
-    if (!found)
-        {
-        error("Distance not found in table:%d", dist);
-        return;
-        }
-}
-
-
-//#############################
-//#  C O M P R E S S
-//#############################
-
-
-/**
- * This method does the dirty work of dictionary
- * compression.  Basically it looks for redundant
- * strings and has the current duplicate refer back
- * to the previous one.
- */
-bool Deflater::compressWindow()
-{
-    windowPos = 0;
-    unsigned int windowSize = window.size();
-    //### Compress as much of the window as possible
-
-    unsigned int hash = 0;
-    //Have each value be a long with the byte at this position,
-    //plus the 3 bytes after it in the window
-    for (int i=windowSize-1 ; i>=0 ; i--)
-        {
-        unsigned char ch = window[i];
-        windowBuf[i] = ch;
-        hash = ((hash<<8) & 0xffffff00) | ch;
-        windowHashBuf[i] = hash;
-        }
-
-    while (windowPos < windowSize - 3)
-        {
-        //### Find best match, if any
-        unsigned int bestMatchLen  = 0;
-        unsigned int bestMatchDist = 0;
-        if (windowPos >= 4)
-            {
-            for (unsigned int lookBack=0 ; lookBack<windowPos-4 ; lookBack++)
-                {
-                //Check 4-char hashes first, before continuing with string
-                if (windowHashBuf[lookBack] == windowHashBuf[windowPos])
-                    {
-                    unsigned int lookAhead=4;
-                    unsigned int lookAheadMax = windowSize - 4 - windowPos;
-                    if (lookBack + lookAheadMax >= windowPos -4 )
-                        lookAheadMax = windowPos - 4 - lookBack;
-                    if (lookAheadMax > 258)
-                        lookAheadMax = 258;
-                    unsigned char *wp = &(windowBuf[windowPos+4]);
-                    unsigned char *lb = &(windowBuf[lookBack+4]);
-                    while (lookAhead<lookAheadMax)
-                        {
-                        if (*lb++ != *wp++)
-                            break;
-                        lookAhead++;
-                        }
-                    if (lookAhead > bestMatchLen)
-                        {
-                        bestMatchLen  = lookAhead;
-                        bestMatchDist = windowPos - lookBack;
-                        }
-                    }
-                }
-            }
-        if (bestMatchLen > 3)
-            {
-            //Distance encode
-            //trace("### distance");
-            /*
-            printf("### 1 '");
-            for (int i=0 ; i < bestMatchLen ; i++)
-                fputc(window[windowPos+i], stdout);
-            printf("'\n### 2 '");
-            for (int i=0 ; i < bestMatchLen ; i++)
-                fputc(window[windowPos-bestMatchDist+i], stdout);
-            printf("'\n");
-            */
-            encodeDistStatic(bestMatchLen, bestMatchDist);
-            windowPos += bestMatchLen;
-            }
-        else
-            {
-            //Literal encode
-            //trace("### literal");
-            encodeLiteralStatic(windowBuf[windowPos]);
-            windowPos++;
-            }
-        }
-
-    while (windowPos < windowSize)
-        encodeLiteralStatic(windowBuf[windowPos++]);
-
-    encodeLiteralStatic(256);
-    return true;
-}
-
-
-/**
- *
- */
-bool Deflater::compress()
-{
-    //trace("compress");
-    unsigned long total = 0L;
-    windowPos = 0;
-    std::vector<unsigned char>::iterator iter;
-    for (iter = uncompressed.begin(); iter != uncompressed.end() ; )
-        {
-        total += windowPos;
-        trace("total:%ld", total);
-        if (windowPos > window.size())
-            windowPos = window.size();
-        window.erase(window.begin() , window.begin()+windowPos);
-        while (window.size() < 32768 && iter != uncompressed.end())
-            {
-            window.push_back(*iter);
-            ++iter;
-            }
-        if (window.size() >= 32768)
-            putBits(0x00, 1); //0  -- more blocks
-        else
-            putBits(0x01, 1); //1  -- last block
-        putBits(0x01, 2); //01 -- static trees
-        if (!compressWindow())
-            return false;
-        }
-    putFlush();
-    return true;
-}
-
-
-
-
-
 //########################################################################
 //#  G Z I P    F I L E
 //########################################################################
@@ -1610,8 +989,7 @@ bool GzipFile::write()
 
     //compress
     std::vector<unsigned char> compBuf;
-    Deflater deflater;
-    if (!deflater.deflate(compBuf, data))
+    if (!Inkscape::Util::BlockDeflater::deflate(compBuf, data))
         {
         return false;
         }
@@ -1908,7 +1286,8 @@ ZipEntry::ZipEntry() :
     compressionMethod (8),
     compressedData (),
     uncompressedData (),
-    position (0)
+    position (0),
+    threads (1)
 {
 }
 
@@ -1923,7 +1302,8 @@ ZipEntry::ZipEntry(std::string fileNameArg,
     compressionMethod (8),
     compressedData (),
     uncompressedData (),
-    position (0)
+    position (0),
+    threads (1)
 {
 }
 
@@ -1990,6 +1370,14 @@ void ZipEntry::setCompressionMethod(int val)
     compressionMethod = val;
 }
 
+/**
+ *
+ */
+void ZipEntry::setThreads(int val)
+{
+    threads = val;
+}
+
 /**
  *
  */
@@ -2089,8 +1477,7 @@ void ZipEntry::finish()
             }
         case 8: //deflate
             {
-            Deflater deflater;
-            if (!deflater.deflate(compressedData, uncompressedData))
+            if (!Inkscape::Util::BlockDeflater::deflate(compressedData, uncompressedData, threads))
                 {
                 //some error
                 }
@@ -2164,7 +1551,8 @@ ZipFile::ZipFile() :
     entries(),
     fileBuf(),
     fileBufPos(0),
-    comment()
+    comment(),
+    threads(1)
 {
 }
 
@@ -2198,6 +1586,14 @@ std::string ZipFile::getComment()
     return comment;
 }
 
+/**
+ *
+ */
+void ZipFile::setThreads(int val)
+{
+    threads = val;
+}
+
 
 /**
  *
@@ -2244,6 +1640,7 @@ ZipEntry *ZipFile::addFile(const std::string &fileName,
                       const std::string &comment)
 {
     ZipEntry *ze = new ZipEntry();
+    ze->setThreads(threads);
     if (!ze->readFile(fileName, comment))
         {
         delete ze;
@@ -2261,6 +1658,7 @@ ZipEntry *ZipFile::newEntry(const std::string &fileName,
                             const std::string &comment)
 {
     ZipEntry *ze = new ZipEntry(fileName, comment);
+    ze->setThreads(threads);
     entries.push_back(ze);
     return ze;
 }
@@ -34,9 +34,8 @@
  * non-optimized, it is not useful in cases where very large
  * archives are needed or where high performance is desired.
  * However, it should hopefully work well for smaller,
- * one-at-a-time tasks.  What you get in return is the ability
- * to drop these files into your project and remove the dependencies
- * on ZLib and Info-Zip.  Enjoy.
+ * one-at-a-time tasks.  Compression is done by zlib, on several
+ * threads for large entries, see Inkscape::Util::BlockDeflater.
  */
 
 
@@ -301,6 +300,11 @@ public:
      */
     virtual void setCompressionMethod(int val);
 
+    /**
+     * Number of threads that finish() compresses the data on
+     */
+    virtual void setThreads(int val);
+
     /**
      *
      */
@@ -376,6 +380,8 @@ private:
     std::vector<unsigned char> uncompressedData;
 
     unsigned long position;
+
+    int threads;
 };
 
 
@@ -419,6 +425,12 @@ public:
      */
     virtual std::string getComment();
 
+    /**
+     * Number of threads that the entries added from now on are
+     * compressed on
+     */
+    virtual void setThreads(int val);
+
     /**
      * Return the list of entries currently in this file
      */
@@ -559,6 +571,8 @@ private:
     unsigned long fileBufPos;
 
     std::string comment;
+
+    int threads;
 };
 
 
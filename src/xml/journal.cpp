@@ -0,0 +1,669 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Append-only journal of the changes made to an XML document, for crash recovery
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "xml/journal.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "io/sys.h"
+#include "xml/document.h"
+#include "xml/node.h"
+#include "xml/simple-document.h"
+#include "xml/text-node.h"
+
+namespace Inkscape {
+namespace XML {
+
+namespace {
+
+/*
+ * Both files start with a magic line and the generation of the checkpoint, which a journal has
+ * to match to be replayed whole. The checkpoint then holds the size of the frames of the
+ * previous journal that it contains: a crash between writing a checkpoint and starting its
+ * journal leaves the old journal behind, of which only the frames past that are replayed.
+ *
+ * The checkpoint then holds the attributes and the children of the document node. A journal
+ * holds frames of a 32 bit little endian length, a checksum and that many bytes of records:
+ *
+ *   'a' <path> <index> <node>      child added at index
+ *   'd' <path> <index>             child at index removed
+ *   'o' <path> <old> <new>         child moved from index old to index new
+ *   'c' <path> <string>            content changed
+ *   't' <path> <name> <string>     attribute set, or removed if the string is null
+ *   'n' <path> <name>              element renamed
+ *
+ * Numbers are LEB128 varints. Strings are their length plus one followed by the bytes, with
+ * zero for null. A path is the number of steps from the document node followed by the child
+ * indices. A node is its type followed by, for elements, the name, the attributes and the
+ * children; for text, the content and whether it is CDATA; for comments, the content; for
+ * processing instructions, the target and the content.
+ */
+char const CHECKPOINT_MAGIC[] = "inkscape-checkpoint 1\n";
+char const JOURNAL_MAGIC[] = "inkscape-journal 1\n";
+
+/// Journals smaller than this are not worth a new checkpoint.
+std::size_t const MIN_JOURNAL_SIZE = 1 << 20;
+
+void put_uint(std::string &out, std::uint64_t value)
+{
+    do {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+        out += char(value ? byte | 0x80 : byte);
+    } while (value);
+}
+
+void put_string(std::string &out, char const *value)
+{
+    if (!value) {
+        put_uint(out, 0);
+        return;
+    }
+    std::size_t length = std::strlen(value);
+    put_uint(out, length + 1);
+    out.append(value, length);
+}
+
+void put_u32(std::string &out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        out += char((value >> (8 * i)) & 0xff);
+    }
+}
+
+std::uint32_t checksum(char const *data, std::size_t length)
+{
+    // FNV-1a
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < length; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+void put_path(std::string &out, Node const &node)
+{
+    std::vector<unsigned> indices;
+    for (Node const *current = &node; current->parent(); current = current->parent()) {
+        indices.push_back(current->position());
+    }
+    put_uint(out, indices.size());
+    for (auto i = indices.rbegin(); i != indices.rend(); ++i) {
+        put_uint(out, *i);
+    }
+}
+
+void put_node(std::string &out, Node const &node)
+{
+    put_uint(out, static_cast<unsigned>(node.type()));
+    switch (node.type()) {
+        case NodeType::ELEMENT_NODE:
+            put_string(out, node.name());
+            put_uint(out, node.attributeList().size());
+            for (auto const &attribute : node.attributeList()) {
+                put_string(out, g_quark_to_string(attribute.key));
+                put_string(out, attribute.value.pointer());
+            }
+            put_uint(out, node.childCount());
+            for (Node const *child = node.firstChild(); child; child = child->next()) {
+                put_node(out, *child);
+            }
+            break;
+        case NodeType::TEXT_NODE: {
+            put_string(out, node.content());
+            auto text = dynamic_cast<TextNode const *>(&node);
+            put_uint(out, text && text->is_CData());
+            break;
+        }
+        case NodeType::COMMENT_NODE:
+            put_string(out, node.content());
+            break;
+        case NodeType::PI_NODE:
+            put_string(out, node.name());
+            put_string(out, node.content());
+            break;
+        case NodeType::DOCUMENT_NODE:
+            g_assert_not_reached();
+            break;
+    }
+}
+
+/// Reads what the put_ functions wrote, failing for good at the first thing that does not fit.
+class Reader {
+public:
+    Reader(char const *data, std::size_t length) : _pos(data), _end(data + length) {}
+
+    bool ok() const { return _ok; }
+    bool atEnd() const { return _pos == _end; }
+
+    std::uint64_t uint()
+    {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!check(1)) {
+                return 0;
+            }
+            unsigned char byte = *_pos++;
+            value |= std::uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        _ok = false;
+        return 0;
+    }
+
+    /// Returns false for a null string.
+    bool string(std::string &value)
+    {
+        auto length = uint();
+        if (length == 0 || !check(length - 1)) {
+            value.clear();
+            return false;
+        }
+        value.assign(_pos, length - 1);
+        _pos += length - 1;
+        return true;
+    }
+
+    std::uint32_t u32()
+    {
+        if (!check(4)) {
+            return 0;
+        }
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= std::uint32_t(static_cast<unsigned char>(*_pos++)) << (8 * i);
+        }
+        return value;
+    }
+
+    bool magic(char const *magic)
+    {
+        std::size_t length = std::strlen(magic);
+        if (!check(length) || std::memcmp(_pos, magic, length) != 0) {
+            _ok = false;
+            return false;
+        }
+        _pos += length;
+        return true;
+    }
+
+    char const *take(std::size_t length)
+    {
+        if (!check(length)) {
+            return nullptr;
+        }
+        char const *start = _pos;
+        _pos += length;
+        return start;
+    }
+
+    void fail() { _ok = false; }
+
+private:
+    bool check(std::uint64_t length)
+    {
+        if (_ok && std::uint64_t(_end - _pos) < length) {
+            _ok = false;
+        }
+        return _ok;
+    }
+
+    char const *_pos;
+    char const *_end;
+    bool _ok = true;
+};
+
+Node *read_path(Reader &in, Document *doc)
+{
+    Node *node = doc;
+    auto depth = in.uint();
+    for (std::uint64_t i = 0; i < depth && node && in.ok(); i++) {
+        node = node->nthChild(in.uint());
+    }
+    if (!node) {
+        in.fail();
+    }
+    return in.ok() ? node : nullptr;
+}
+
+/// Returns a new node, with a reference the caller has to release.
+Node *read_node(Reader &in, Document *doc, int depth = 0)
+{
+    std::string name;
+    std::string content;
+    bool has_content = false;
+    Node *node = nullptr;
+    switch (static_cast<NodeType>(in.uint())) {
+        case NodeType::ELEMENT_NODE: {
+            if (!in.string(name) || depth > 1000) {
+                in.fail();
+                return nullptr;
+            }
+            node = doc->createElement(name.c_str());
+            std::string key;
+            std::string value;
+            for (auto count = in.uint(); count > 0 && in.ok(); count--) {
+                in.string(key);
+                if (in.string(value)) {
+                    node->setAttribute(key.c_str(), value.c_str());
+                }
+            }
+            for (auto count = in.uint(); count > 0 && in.ok(); count--) {
+                if (Node *child = read_node(in, doc, depth + 1)) {
+                    node->appendChild(child);
+                    Inkscape::GC::release(child);
+                }
+            }
+            break;
+        }
+        case NodeType::TEXT_NODE:
+            has_content = in.string(content);
+            node = doc->createTextNode(has_content ? content.c_str() : "", in.uint() != 0);
+            break;
+        case NodeType::COMMENT_NODE:
+            has_content = in.string(content);
+            node = doc->createComment(has_content ? content.c_str() : "");
+            break;
+        case NodeType::PI_NODE:
+            in.string(name);
+            has_content = in.string(content);
+            node = doc->createPI(name.c_str(), has_content ? content.c_str() : "");
+            break;
+        default:
+            in.fail();
+            break;
+    }
+    if (!in.ok() && node) {
+        Inkscape::GC::release(node);
+        return nullptr;
+    }
+    return node;
+}
+
+/// Applies one record of a journal frame.
+void replay_record(Reader &in, Document *doc)
+{
+    char const *type = in.take(1);
+    if (!type) {
+        return;
+    }
+    Node *node = read_path(in, doc);
+    if (!node) {
+        return;
+    }
+    std::string name;
+    std::string value;
+    switch (*type) {
+        case 'a': {
+            auto index = in.uint();
+            Node *child = read_node(in, doc);
+            if (!child) {
+                return;
+            }
+            if (index > node->childCount()) {
+                in.fail();
+            } else {
+                node->addChild(child, index ? node->nthChild(index - 1) : nullptr);
+            }
+            Inkscape::GC::release(child);
+            break;
+        }
+        case 'd': {
+            Node *child = node->nthChild(in.uint());
+            if (!child || !in.ok()) {
+                in.fail();
+                return;
+            }
+            node->removeChild(child);
+            break;
+        }
+        case 'o': {
+            auto old_index = in.uint();
+            auto new_index = in.uint();
+            Node *child = node->nthChild(old_index);
+            if (!child || !in.ok() || new_index >= node->childCount()) {
+                in.fail();
+                return;
+            }
+            // the node that ends up before the child, counted without the child
+            Node *ref = nullptr;
+            if (new_index > 0) {
+                auto ref_index = new_index - 1;
+                ref = node->nthChild(ref_index < old_index ? ref_index : ref_index + 1);
+            }
+            node->changeOrder(child, ref);
+            break;
+        }
+        case 'c': {
+            bool set = in.string(value);
+            if (in.ok()) {
+                node->setContent(set ? value.c_str() : nullptr);
+            }
+            break;
+        }
+        case 't': {
+            in.string(name);
+            bool set = in.string(value);
+            if (in.ok()) {
+                node->setAttribute(name.c_str(), set ? value.c_str() : nullptr);
+            }
+            break;
+        }
+        case 'n':
+            if (in.string(name)) {
+                node->setCodeUnsafe(g_quark_from_string(name.c_str()));
+            } else {
+                in.fail();
+            }
+            break;
+        default:
+            in.fail();
+            break;
+    }
+}
+
+std::string read_file(std::string const &path)
+{
+    gchar *contents = nullptr;
+    gsize length = 0;
+    if (!g_file_get_contents(path.c_str(), &contents, &length, nullptr)) {
+        return std::string();
+    }
+    std::string result(contents, length);
+    g_free(contents);
+    return result;
+}
+
+} // namespace
+
+Journal::Journal(Document *doc, std::string checkpoint_path, std::string journal_path)
+    : _doc(doc)
+    , _checkpoint_path(std::move(checkpoint_path))
+    , _journal_path(std::move(journal_path))
+{
+    _doc->addSubtreeObserver(*this);
+    _observing = true;
+}
+
+Journal::~Journal()
+{
+    if (_observing) {
+        _doc->removeSubtreeObserver(*this);
+    }
+    if (_file) {
+        fclose(_file);
+    }
+    g_unlink(_journal_path.c_str());
+    g_unlink(_checkpoint_path.c_str());
+}
+
+bool Journal::commit()
+{
+    if (_failed) {
+        return false;
+    }
+    if (_pending.empty()) {
+        return true;
+    }
+
+    std::string frame;
+    put_u32(frame, _pending.size());
+    put_u32(frame, checksum(_pending.data(), _pending.size()));
+    frame += _pending;
+    _pending.clear();
+
+    // the frames committed while a checkpoint is written also start its journal
+    if (_checkpointing) {
+        _since_checkpoint += frame;
+    }
+    if (!_file) {
+        // no checkpoint written yet: the first one to be copied contains the changes
+        return true;
+    }
+
+    // Flushed rather than synced to the disk: this is to survive Inkscape crashing, not the
+    // system.
+    if (fwrite(frame.data(), 1, frame.size(), _file) != frame.size() || fflush(_file) != 0) {
+        _fail(_journal_path.c_str());
+        return false;
+    }
+    _journal_size += frame.size();
+    return true;
+}
+
+bool Journal::wantsCheckpoint() const
+{
+    return !_failed && !_checkpointing &&
+           (_generation == 0 || _journal_size > std::max(MIN_JOURNAL_SIZE, _checkpoint_size));
+}
+
+std::unique_ptr<Journal::Checkpoint> Journal::checkpoint()
+{
+    // the copy has to be taken between frames
+    if (!commit()) {
+        return nullptr;
+    }
+
+    std::string header = CHECKPOINT_MAGIC;
+    put_uint(header, _generation + 1);
+    put_uint(header, _journal_size);
+    put_uint(header, _doc->attributeList().size());
+    for (auto const &attribute : _doc->attributeList()) {
+        put_string(header, g_quark_to_string(attribute.key));
+        put_string(header, attribute.value.pointer());
+    }
+
+    _checkpointing = true;
+    _since_checkpoint.clear();
+    return std::unique_ptr<Checkpoint>(new Checkpoint(_doc, _generation + 1, std::move(header), _checkpoint_path));
+}
+
+bool Journal::checkpointWritten(Checkpoint const &checkpoint)
+{
+    _checkpointing = false;
+    if (_failed) {
+        return false;
+    }
+    if (!checkpoint._written) {
+        _fail(_checkpoint_path.c_str());
+        return false;
+    }
+    _generation = checkpoint._generation;
+    _checkpoint_size = checkpoint._size;
+
+    if (_file) {
+        fclose(_file);
+    }
+    _file = Inkscape::IO::fopen_utf8name(_journal_path.c_str(), "wb");
+    std::string out = JOURNAL_MAGIC;
+    put_uint(out, _generation);
+    out += _since_checkpoint;
+    _journal_size = _since_checkpoint.size();
+    _since_checkpoint.clear();
+    if (!_file || fwrite(out.data(), 1, out.size(), _file) != out.size() || fflush(_file) != 0) {
+        _fail(_journal_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+Journal::Checkpoint::Checkpoint(Document const *doc, unsigned long generation, std::string header,
+                                std::string path)
+    : _snapshot(doc, nullptr)
+    , _generation(generation)
+    , _header(std::move(header))
+    , _path(std::move(path))
+{}
+
+bool Journal::Checkpoint::write()
+{
+    std::string out = _header;
+    Document const *doc = _snapshot.document();
+    put_uint(out, doc->childCount());
+    for (Node const *child = doc->firstChild(); child; child = child->next()) {
+        put_node(out, *child);
+    }
+
+    // replaced in one go, so that there is always a whole checkpoint
+    _written = g_file_set_contents(_path.c_str(), out.data(), out.size(), nullptr);
+    _size = out.size();
+    return _written;
+}
+
+void Journal::_fail(char const *path)
+{
+    g_warning("Could not write the recovery journal to '%s', no longer keeping it.", path);
+    if (_observing) {
+        _doc->removeSubtreeObserver(*this);
+        _observing = false;
+    }
+    _failed = true;
+    _pending.clear();
+}
+
+void Journal::notifyChildAdded(Node &node, Node &child, Node * /*prev*/)
+{
+    _pending += 'a';
+    put_path(_pending, node);
+    put_uint(_pending, child.position());
+    put_node(_pending, child);
+}
+
+void Journal::notifyChildRemoved(Node &node, Node & /*child*/, Node *prev)
+{
+    _pending += 'd';
+    put_path(_pending, node);
+    put_uint(_pending, prev ? prev->position() + 1 : 0);
+}
+
+void Journal::notifyChildOrderChanged(Node &node, Node &child, Node *old_prev, Node * /*new_prev*/)
+{
+    unsigned new_index = child.position();
+    unsigned old_index = 0;
+    if (old_prev) {
+        // The child came right after old_prev, which moved up by one if the child moved before it.
+        unsigned prev_index = old_prev->position();
+        old_index = new_index <= prev_index ? prev_index : prev_index + 1;
+    }
+    _pending += 'o';
+    put_path(_pending, node);
+    put_uint(_pending, old_index);
+    put_uint(_pending, new_index);
+}
+
+void Journal::notifyContentChanged(Node &node, Util::ptr_shared /*old_content*/, Util::ptr_shared new_content)
+{
+    _pending += 'c';
+    put_path(_pending, node);
+    put_string(_pending, new_content.pointer());
+}
+
+void Journal::notifyAttributeChanged(Node &node, GQuark name, Util::ptr_shared /*old_value*/,
+                                     Util::ptr_shared new_value)
+{
+    _pending += 't';
+    put_path(_pending, node);
+    put_string(_pending, g_quark_to_string(name));
+    put_string(_pending, new_value.pointer());
+}
+
+void Journal::notifyElementNameChanged(Node &node, GQuark /*old_name*/, GQuark new_name)
+{
+    _pending += 'n';
+    put_path(_pending, node);
+    put_string(_pending, g_quark_to_string(new_name));
+}
+
+Document *Journal::recover(std::string const &checkpoint_path, std::string const &journal_path)
+{
+    std::string checkpoint = read_file(checkpoint_path);
+    Reader in(checkpoint.data(), checkpoint.size());
+    if (!in.magic(CHECKPOINT_MAGIC)) {
+        return nullptr;
+    }
+    auto generation = in.uint();
+    auto previous_size = in.uint();
+
+    Document *doc = new SimpleDocument();
+    std::string key;
+    std::string value;
+    for (auto count = in.uint(); count > 0 && in.ok(); count--) {
+        in.string(key);
+        if (in.string(value)) {
+            doc->setAttribute(key.c_str(), value.c_str());
+        }
+    }
+    for (auto count = in.uint(); count > 0 && in.ok(); count--) {
+        if (Node *child = read_node(in, doc)) {
+            doc->appendChild(child);
+            Inkscape::GC::release(child);
+        }
+    }
+    if (!in.ok() || !doc->root()) {
+        Inkscape::GC::release(doc);
+        return nullptr;
+    }
+
+    std::string journal = read_file(journal_path);
+    Reader frames(journal.data(), journal.size());
+    if (!frames.magic(JOURNAL_MAGIC)) {
+        return doc;
+    }
+    auto journal_generation = frames.uint();
+    if (journal_generation + 1 == generation) {
+        // the journal of the previous checkpoint, of which this one contains the start
+        if (!frames.take(previous_size)) {
+            return doc;
+        }
+    } else if (journal_generation != generation) {
+        return doc;
+    }
+    while (!frames.atEnd()) {
+        auto length = frames.u32();
+        auto sum = frames.u32();
+        char const *data = frames.take(length);
+        if (!data || checksum(data, length) != sum) {
+            // the frame being written when Inkscape crashed
+            break;
+        }
+        Reader records(data, length);
+        while (records.ok() && !records.atEnd()) {
+            replay_record(records, doc);
+        }
+        if (!records.ok()) {
+            g_warning("Could not replay all of the recovery journal '%s'.", journal_path.c_str());
+            break;
+        }
+    }
+    return doc;
+}
+
+} // namespace XML
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Append-only journal of the changes made to an XML document, for crash recovery
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_XML_JOURNAL_H
+#define SEEN_INKSCAPE_XML_JOURNAL_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "xml/node-observer.h"
+#include "xml/repr.h"
+
+namespace Inkscape {
+namespace XML {
+
+class Document;
+
+/**
+ * Keeps enough of a document on disk to rebuild it after a crash, at a cost in proportion to
+ * the changes made rather than to the size of the document.
+ *
+ * The journal starts from a checkpoint, a compact binary copy of the whole tree. It observes
+ * every change made to the tree, which are the changes the undo log records and replays, and
+ * commit() appends those made since the previous commit to the journal file as one frame.
+ * Nodes are addressed by their path of child indices at the time of the change, so that
+ * recover() can replay the frames onto the checkpoint in order.
+ *
+ * Checkpoints are copied from the document by checkpoint() and written by another thread, so
+ * that editing doesn't wait for the whole document to be written. One is due when the journal
+ * starts and once the journal has grown as large as the checkpoint; checkpointWritten() then
+ * starts the journal afresh. Until then, frames are still appended to the old journal, and the
+ * new checkpoint records where in it the changes it does not contain begin.
+ *
+ * The files are removed when the journal is destroyed; they are only left behind by a crash.
+ */
+class Journal : public NodeObserver {
+public:
+    class Checkpoint;
+
+    /// Starts a journal of the given document, which needs a checkpoint before it can be recovered.
+    Journal(Document *doc, std::string checkpoint_path, std::string journal_path);
+    ~Journal() override;
+
+    Journal(Journal const &) = delete;
+    Journal &operator=(Journal const &) = delete;
+
+    /// Appends the changes made since the last commit. Returns false once writing has failed.
+    bool commit();
+
+    /// Whether a new checkpoint is due and none is being written.
+    bool wantsCheckpoint() const;
+
+    /**
+     * Commits and copies the document for a new checkpoint, in the main thread.
+     * @return The checkpoint to write, or null if writing has failed.
+     */
+    std::unique_ptr<Checkpoint> checkpoint();
+
+    /// Starts the journal afresh from a checkpoint that was written, or fails if it was not.
+    bool checkpointWritten(Checkpoint const &checkpoint);
+
+    /// Whether writing has failed, after which the journal no longer follows the document.
+    bool failed() const { return _failed; }
+
+    /**
+     * Rebuilds a document from its checkpoint and the frames of its journal that were written
+     * completely.
+     * @return The document, or null if the checkpoint cannot be read.
+     */
+    static Document *recover(std::string const &checkpoint_path, std::string const &journal_path);
+
+    void notifyChildAdded(Node &node, Node &child, Node *prev) override;
+    void notifyChildRemoved(Node &node, Node &child, Node *prev) override;
+    void notifyChildOrderChanged(Node &node, Node &child, Node *old_prev, Node *new_prev) override;
+    void notifyContentChanged(Node &node, Util::ptr_shared old_content, Util::ptr_shared new_content) override;
+    void notifyAttributeChanged(Node &node, GQuark name, Util::ptr_shared old_value,
+                                Util::ptr_shared new_value) override;
+    void notifyElementNameChanged(Node &node, GQuark old_name, GQuark new_name) override;
+
+private:
+    void _fail(char const *path);
+
+    Document *_doc;
+    std::string _checkpoint_path;
+    std::string _journal_path;
+    FILE *_file = nullptr;
+    unsigned long _generation = 0;     ///< Of the last checkpoint written, or 0 before the first
+    std::string _pending;              ///< Changes not committed yet
+    std::size_t _journal_size = 0;     ///< Bytes written to the journal since the checkpoint
+    std::size_t _checkpoint_size = 0;
+    bool _checkpointing = false;       ///< Whether a checkpoint is being written
+    std::string _since_checkpoint;     ///< Frames committed since the copy of that checkpoint
+    bool _observing = false;
+    bool _failed = false;
+};
+
+/**
+ * A copy of a document to be written as a checkpoint of its journal. It is taken and destroyed
+ * in the main thread, as a DocumentSnapshot, and written in any thread.
+ */
+class Journal::Checkpoint {
+public:
+    Checkpoint(Checkpoint const &) = delete;
+    Checkpoint &operator=(Checkpoint const &) = delete;
+
+    /// Replaces the checkpoint file. Returns whether it was written.
+    bool write();
+
+private:
+    friend class Journal;
+    Checkpoint(Document const *doc, unsigned long generation, std::string header, std::string path);
+
+    DocumentSnapshot _snapshot;
+    unsigned long _generation;
+    std::string _header; ///< The start of the file, up to the children of the document node
+    std::string _path;
+    std::size_t _size = 0;
+    bool _written = false;
+};
+
+} // namespace XML
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_XML_JOURNAL_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
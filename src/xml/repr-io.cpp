@@ -11,12 +11,19 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <stdexcept>
+#include <vector>
 
 #include <libxml/parser.h>
 #include <libxml/xinclude.h>
+#include <libxml/xmlreader.h>
 
 #include "xml/repr.h"
 #include "xml/attribute-record.h"
@@ -39,6 +46,10 @@
 
 #include <glibmm/miscutils.h>
 
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 using Inkscape::IO::Writer;
 using Inkscape::XML::Document;
 using Inkscape::XML::SimpleDocument;
@@ -48,8 +59,12 @@ using Inkscape::XML::AttributeVector;
 using Inkscape::XML::rebase_href_attrs;
 
 Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns);
+static Document *sp_repr_do_read_stream (xmlTextReaderPtr reader, const gchar *default_ns);
+static void sp_repr_finish_read (Node *root, const gchar *default_ns);
 static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gchar *default_ns, std::map<std::string, std::string> &prefix_map);
 static gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar *default_ns, std::map<std::string, std::string> &prefix_map);
+static gint sp_repr_qualified_name (gchar *p, gint len, const xmlChar *href, const xmlChar *ns_prefix, const xmlChar *name, std::map<std::string, std::string> &prefix_map);
+static bool sp_repr_keep_text (const xmlChar *content, bool preserve);
 static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
                                               bool add_whitespace, gchar const *default_ns,
                                               int inlineattrs, int indent,
@@ -64,6 +79,9 @@ static void sp_repr_write_stream_element(Node *repr, Writer &out,
                                          gchar const *old_href_abs_base,
                                          gchar const *new_href_abs_base);
 
+static AttributeVector sp_repr_root_element_attributes(Node *repr, gchar const *default_ns,
+                                                       GQuark &elide_prefix);
+
 
 class XmlSource
 {
@@ -96,6 +114,7 @@ public:
     int setFile( char const * filename, bool load_entities );
 
     xmlDocPtr readXml();
+    xmlTextReaderPtr openReader();
 
     static int readCb( void * context, char * buffer, int len );
     static int closeCb( void * context );
@@ -104,6 +123,8 @@ public:
     int read( char * buffer, int len );
     int close();
 private:
+    int parseOptions() const;
+
     const char* filename;
     char* encoding;
     FILE* fp;
@@ -210,7 +231,7 @@ int XmlSource::setFile(char const *filename, bool load_entities=false)
     return retVal;
 }
 
-xmlDocPtr XmlSource::readXml()
+int XmlSource::parseOptions() const
 {
     int parse_options = XML_PARSE_HUGE | XML_PARSE_RECOVER;
 
@@ -221,8 +242,13 @@ xmlDocPtr XmlSource::readXml()
     // Allow NOENT only if we're filtering out SYSTEM and PUBLIC entities
     if (LoadEntities)     parse_options |= XML_PARSE_NOENT;
 
+    return parse_options;
+}
+
+xmlDocPtr XmlSource::readXml()
+{
     auto doc = xmlReadIO( readCb, closeCb, this,
-                      filename, getEncoding(), parse_options);
+                      filename, getEncoding(), parseOptions());
 
     if (doc && doc->properties && xmlXIncludeProcessFlags(doc, XML_PARSE_NOXINCNODE) < 0) {
         g_warning("XInclude processing failed for %s", filename);
@@ -231,6 +257,16 @@ xmlDocPtr XmlSource::readXml()
     return doc;
 }
 
+/**
+ * Returns a reader of the nodes of the file, which parses it while they are read.
+ * XIncludes are processed by the reader.
+ */
+xmlTextReaderPtr XmlSource::openReader()
+{
+    return xmlReaderForIO( readCb, closeCb, this,
+                           filename, getEncoding(), parseOptions() | XML_PARSE_XINCLUDE | XML_PARSE_NOXINCNODE );
+}
+
 int XmlSource::readCb( void * context, char * buffer, int len )
 {
     int retVal = -1;
@@ -318,13 +354,49 @@ int XmlSource::close()
     return 0;
 }
 
+/**
+ * Reads a document from a file with the given source.
+ */
+static Document *sp_repr_read_source(XmlSource &src, const gchar *filename, bool load_entities,
+                                     const gchar *default_ns, bool streaming)
+{
+    if (src.setFile(filename, load_entities) != 0) {
+        return nullptr;
+    }
+
+    if (streaming) {
+        xmlTextReaderPtr reader = src.openReader();
+        Document *rdoc = reader ? sp_repr_do_read_stream(reader, default_ns) : nullptr;
+        if (reader) {
+            xmlFreeTextReader(reader);
+        }
+        if (rdoc) {
+            return rdoc;
+        }
+        // The reader stops at errors which building the tree recovers from.
+        if (src.setFile(filename, load_entities) != 0) {
+            return nullptr;
+        }
+    }
+
+    xmlDocPtr doc = src.readXml();
+    Document *rdoc = sp_repr_do_read(doc, default_ns);
+    if (doc) {
+        xmlFreeDoc(doc);
+    }
+    return rdoc;
+}
+
 /**
  * Reads XML from a file, and returns the Document.
  * The default namespace can also be specified, if desired.
+ *
+ * @param streaming Whether to build the document directly from the nodes the parser reports,
+ *                  instead of from a complete libxml2 tree of the file. Both give the same
+ *                  document; streaming needs much less memory for large files.
  */
-Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
+Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns, bool streaming)
 {
-    xmlDocPtr doc = nullptr;
     Document * rdoc = nullptr;
 
     xmlSubstituteEntitiesDefault(1);
@@ -350,21 +422,12 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
 
     XmlSource src;
 
-    if (src.setFile(filename) == 0) {
-        doc = src.readXml();
-        rdoc = sp_repr_do_read(doc, default_ns);
-        // For some reason, failed ns loading results in this
-        // We try a system check version of load with NOENT for adobe
-        if (rdoc && strcmp(rdoc->root()->name(), "ns:svg") == 0) {
-            xmlFreeDoc(doc);
-            src.setFile(filename, true);
-            doc = src.readXml();
-            rdoc = sp_repr_do_read(doc, default_ns);
-        }
-    }
-
-    if (doc) {
-        xmlFreeDoc(doc);
+    rdoc = sp_repr_read_source(src, filename, false, default_ns, streaming);
+    // For some reason, failed ns loading results in this
+    // We try a system check version of load with NOENT for adobe
+    if (rdoc && strcmp(rdoc->root()->name(), "ns:svg") == 0) {
+        Inkscape::GC::release(rdoc);
+        rdoc = sp_repr_read_source(src, filename, true, default_ns, streaming);
     }
 
     if (localFilename) {
@@ -423,6 +486,7 @@ namespace {
 
 typedef std::map<Glib::QueryQuark, Glib::QueryQuark, Inkscape::compare_quark_ids> PrefixMap;
 
+/// Not thread-safe: the map is shared by all documents read and written in the main thread.
 Glib::QueryQuark qname_prefix(Glib::QueryQuark qname) {
     static PrefixMap prefix_map;
     PrefixMap::iterator iter = prefix_map.find(qname);
@@ -499,48 +563,187 @@ Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
     }
 
     if (root != nullptr) {
-        /* promote elements of some XML documents that don't use namespaces
-         * into their default namespace */
-        if ( default_ns && !strchr(root->name(), ':') ) {
-            if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
-                promote_to_namespace(root, "svg");
-            }
-            if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
-                promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
-            }
+        sp_repr_finish_read(root, default_ns);
+    }
+
+    return rdoc;
+}
+
+/**
+ * Reads a document from the nodes reported by an xmlTextReader, without a libxml2 tree of the
+ * whole file. Gives the same document as sp_repr_do_read on the tree of the same file.
+ */
+static Document *sp_repr_do_read_stream (xmlTextReaderPtr reader, const gchar *default_ns)
+{
+    std::map<std::string, std::string> prefix_map;
+    gchar c[256];
+
+    Document *rdoc = new Inkscape::XML::SimpleDocument();
+
+    Node *root = nullptr;
+    bool found_element = false;
+    std::vector<Node *> open_elements;
+    std::vector<bool> preserve(1, false); // xml:space of the open elements, innermost last
+    std::string text; // character data up to the next node of another kind
+
+    auto append = [&](Node *repr) {
+        if (open_elements.empty()) {
+            rdoc->appendChild(repr);
+        } else {
+            open_elements.back()->appendChild(repr);
         }
+        Inkscape::GC::release(repr);
+    };
 
+    auto flush_text = [&]() {
+        if (!open_elements.empty() &&
+            sp_repr_keep_text(reinterpret_cast<const xmlChar *>(text.c_str()), preserve.back())) {
+            append(rdoc->createTextNode(text.c_str(), false));
+        }
+        text.clear();
+    };
+
+    int status;
+    while ((status = xmlTextReaderRead(reader)) == 1) {
+        int const type = xmlTextReaderNodeType(reader);
+        if (type == XML_READER_TYPE_TEXT || type == XML_READER_TYPE_WHITESPACE ||
+            type == XML_READER_TYPE_SIGNIFICANT_WHITESPACE) {
+            if (const xmlChar *value = xmlTextReaderConstValue(reader)) {
+                text += reinterpret_cast<const char *>(value);
+            }
+            continue;
+        }
+        flush_text();
+
+        switch (type) {
+            case XML_READER_TYPE_ELEMENT: {
+                sp_repr_qualified_name (c, 256, xmlTextReaderConstNamespaceUri(reader), xmlTextReaderConstPrefix(reader),
+                                        xmlTextReaderConstLocalName(reader), prefix_map);
+                Node *repr = rdoc->createElement(c);
+                bool const empty = xmlTextReaderIsEmptyElement(reader);
+                bool space_preserve = preserve.back();
+
+                while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+                    if (xmlTextReaderIsNamespaceDecl(reader)) {
+                        continue; // namespace definitions, not attributes in the libxml2 tree
+                    }
+                    const xmlChar *href = xmlTextReaderConstNamespaceUri(reader);
+                    const xmlChar *name = xmlTextReaderConstLocalName(reader);
+                    const xmlChar *value = xmlTextReaderConstValue(reader);
+                    if (href && xmlStrEqual(href, XML_XML_NAMESPACE) && xmlStrEqual(name, BAD_CAST "space")) {
+                        if (xmlStrEqual(value, BAD_CAST "preserve")) {
+                            space_preserve = true;
+                        } else if (xmlStrEqual(value, BAD_CAST "default")) {
+                            space_preserve = false;
+                        }
+                    }
+                    sp_repr_qualified_name (c, 256, href, xmlTextReaderConstPrefix(reader), name, prefix_map);
+                    repr->setAttribute(c, reinterpret_cast<const gchar *>(value ? value : BAD_CAST ""));
+                }
+                xmlTextReaderMoveToElement(reader);
 
-        // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
-        // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
-        // icons.svg). How can one tell if a file is internal?
-        if ( !strcmp(root->name(), "svg:svg" ) ) {
-            Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-            bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
-            if( clean ) {
-                sp_attribute_clean_tree( root );
+                bool const top_level = open_elements.empty();
+                append(repr);
+                if (top_level) {
+                    root = found_element ? nullptr : repr;
+                    found_element = true;
+                }
+                if (!empty) {
+                    open_elements.push_back(repr);
+                    preserve.push_back(space_preserve);
+                }
+                break;
+            }
+            case XML_READER_TYPE_END_ELEMENT:
+                if (!open_elements.empty()) {
+                    open_elements.pop_back();
+                    preserve.pop_back();
+                }
+                break;
+            case XML_READER_TYPE_CDATA: {
+                const xmlChar *value = xmlTextReaderConstValue(reader);
+                if (!open_elements.empty() && sp_repr_keep_text(value, preserve.back())) {
+                    // We keep track of original node type so that CDATA sections are preserved on output.
+                    append(rdoc->createTextNode(reinterpret_cast<const gchar *>(value), true));
+                }
+                break;
             }
+            case XML_READER_TYPE_COMMENT:
+                append(rdoc->createComment(reinterpret_cast<const gchar *>(xmlTextReaderConstValue(reader))));
+                break;
+            case XML_READER_TYPE_PROCESSING_INSTRUCTION:
+                append(rdoc->createPI(reinterpret_cast<const gchar *>(xmlTextReaderConstName(reader)),
+                                      reinterpret_cast<const gchar *>(xmlTextReaderConstValue(reader))));
+                break;
+            case XML_READER_TYPE_ENTITY_REFERENCE:
+                // sp_repr_svg_read_node makes an empty element of an entity reference which
+                // is not substituted
+                append(rdoc->createElement(reinterpret_cast<const gchar *>(xmlTextReaderConstName(reader))));
+                break;
+            default:
+                break;
         }
+
+        if (found_element && !root) {
+            break; // more than one root element, which sp_repr_do_read gives up on as well
+        }
+    }
+
+    flush_text();
+
+    if (!found_element || status < 0) {
+        Inkscape::GC::release(rdoc);
+        return nullptr;
+    }
+
+    if (root != nullptr) {
+        sp_repr_finish_read(root, default_ns);
     }
 
     return rdoc;
 }
 
-gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar */*default_ns*/, std::map<std::string, std::string> &prefix_map)
+/**
+ * Steps after reading the tree of a document which both readers share.
+ */
+static void sp_repr_finish_read (Node *root, const gchar *default_ns)
 {
-    const xmlChar *prefix;
-    if (ns){
-        if (ns->href ) {
-            prefix = reinterpret_cast<const xmlChar*>( sp_xml_ns_uri_prefix(reinterpret_cast<const gchar*>(ns->href),
-                                                                            reinterpret_cast<const char*>(ns->prefix)) );
-            prefix_map[reinterpret_cast<const char*>(prefix)] = reinterpret_cast<const char*>(ns->href);
+    /* promote elements of some XML documents that don't use namespaces
+     * into their default namespace */
+    if ( default_ns && !strchr(root->name(), ':') ) {
+        if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
+            promote_to_namespace(root, "svg");
         }
-        else {
-            prefix = nullptr;
+        if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
+            promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
         }
     }
-    else {
-        prefix = nullptr;
+
+
+    // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
+    // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
+    // icons.svg). How can one tell if a file is internal?
+    if ( !strcmp(root->name(), "svg:svg" ) ) {
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
+        if( clean ) {
+            sp_attribute_clean_tree( root );
+        }
+    }
+}
+
+gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar */*default_ns*/, std::map<std::string, std::string> &prefix_map)
+{
+    return sp_repr_qualified_name(p, len, ns ? ns->href : nullptr, ns ? ns->prefix : nullptr, name, prefix_map);
+}
+
+gint sp_repr_qualified_name (gchar *p, gint len, const xmlChar *href, const xmlChar *ns_prefix, const xmlChar *name, std::map<std::string, std::string> &prefix_map)
+{
+    const xmlChar *prefix = nullptr;
+    if (href) {
+        prefix = reinterpret_cast<const xmlChar*>( sp_xml_ns_uri_prefix(reinterpret_cast<const gchar*>(href),
+                                                                        reinterpret_cast<const char*>(ns_prefix)) );
+        prefix_map[reinterpret_cast<const char*>(prefix)] = reinterpret_cast<const char*>(href);
     }
 
     if (prefix) {
@@ -550,6 +753,20 @@ gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *nam
     }
 }
 
+/**
+ * Whether a text node with the given content is kept. This only handles XML's rules for
+ * white space. SVG's specific rules are handled in sp-string.cpp.
+ */
+static bool sp_repr_keep_text (const xmlChar *content, bool preserve)
+{
+    if (content == nullptr || *content == '\0') {
+        return false; // empty text node
+    }
+    // we do not preserve all-whitespace nodes unless we are asked to
+    return preserve || !std::all_of(content, content + xmlStrlen(content),
+                                    [](xmlChar ch) { return g_ascii_isspace(ch); });
+}
+
 static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gchar *default_ns, std::map<std::string, std::string> &prefix_map)
 {
     xmlAttrPtr prop;
@@ -558,21 +775,11 @@ static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gc
 
     if (node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE) {
 
-        if (node->content == nullptr || *(node->content) == '\0') {
-            return nullptr; // empty text node
-        }
-
         // Since libxml2 2.9.0, only element nodes are checked, thus check parent.
-        // Note: this only handles XML's rules for white space. SVG's specific rules
-        // are handled in sp-string.cpp.
         bool preserve = (xmlNodeGetSpacePreserve (node->parent) == 1);
 
-        xmlChar *p;
-        for (p = node->content; *p && g_ascii_isspace (*p) && !preserve; p++)
-            ; // skip all whitespace
-
-        if (!(*p)) { // this is an all-whitespace node, and preserve == default
-            return nullptr; // we do not preserve all-whitespace nodes unless we are asked to
+        if (!sp_repr_keep_text(node->content, preserve)) {
+            return nullptr;
         }
 
         // We keep track of original node type so that CDATA sections are preserved on output.
@@ -670,12 +877,25 @@ Glib::ustring sp_repr_save_buf(Document *doc)
 }
 
 
+/**
+ * Number of threads for compressing svgz files.
+ */
+static int sp_repr_compress_threads()
+{
+#ifdef HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    return prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    return 1;
+#endif
+}
+
 void sp_repr_save_stream(Document *doc, FILE *fp, gchar const *default_ns, bool compress,
                     gchar const *const old_href_abs_base,
                     gchar const *const new_href_abs_base)
 {
     Inkscape::IO::FileOutputStream bout(fp);
-    Inkscape::IO::GzipOutputStream *gout = compress ? new Inkscape::IO::GzipOutputStream(bout) : nullptr;
+    Inkscape::IO::GzipOutputStream *gout = compress ? new Inkscape::IO::GzipOutputStream(bout, sp_repr_compress_threads()) : nullptr;
     Inkscape::IO::OutputStreamWriter *out  = compress ? new Inkscape::IO::OutputStreamWriter( *gout ) : new Inkscape::IO::OutputStreamWriter( bout );
 
     sp_repr_save_writer(doc, out, default_ns, old_href_abs_base, new_href_abs_base);
@@ -684,6 +904,71 @@ void sp_repr_save_stream(Document *doc, FILE *fp, gchar const *default_ns, bool
     delete gout;
 }
 
+namespace Inkscape {
+namespace XML {
+
+DocumentSnapshot::DocumentSnapshot(Document const *doc, char const *default_ns)
+    : _doc(new SimpleDocument())
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    _inlineattrs = prefs->getBool("/options/svgoutput/inlineattrs");
+    _indent = prefs->getInt("/options/svgoutput/indent", 2);
+
+    if (gchar const *doctype = static_cast<Node const *>(doc)->attribute("doctype")) {
+        _doctype = doctype;
+    }
+
+    // The copy shares the attribute values and the contents with the document, so that it only
+    // allocates the nodes and their attribute lists.
+    for (Node const *child = doc->firstChild(); child; child = child->next()) {
+        Node *copy = child->duplicate(_doc);
+        _doc->appendChild(copy);
+        Inkscape::GC::release(copy);
+
+        if (copy->type() == NodeType::ELEMENT_NODE) {
+            RootElement root{copy, 0, {}};
+            root.attributes = sp_repr_root_element_attributes(copy, default_ns, root.elide_prefix);
+            _roots.push_back(std::move(root));
+        }
+    }
+}
+
+DocumentSnapshot::~DocumentSnapshot()
+{
+    _roots.clear();
+    Inkscape::GC::release(_doc);
+}
+
+void DocumentSnapshot::save(FILE *fp) const
+{
+    Inkscape::IO::FileOutputStream bout(fp);
+    Inkscape::IO::OutputStreamWriter out(bout);
+
+    out.writeString( "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n" );
+    if (!_doctype.empty()) {
+        out.writeString( _doctype.c_str() );
+    }
+
+    auto root = _roots.begin();
+    for (Node *repr = _doc->firstChild(); repr; repr = repr->next()) {
+        Inkscape::XML::NodeType const node_type = repr->type();
+        if ( node_type == Inkscape::XML::NodeType::ELEMENT_NODE ) {
+            sp_repr_write_stream_element(repr, out, 0, TRUE, root->elide_prefix, root->attributes,
+                                         _inlineattrs, _indent, nullptr, nullptr);
+            ++root;
+        } else {
+            sp_repr_write_stream(repr, out, 0, TRUE, GQuark(0), _inlineattrs, _indent);
+            if ( node_type == Inkscape::XML::NodeType::COMMENT_NODE ) {
+                out.writeChar('\n');
+            }
+        }
+    }
+    out.flush();
+}
+
+} // namespace XML
+} // namespace Inkscape
+
 
 
 /**
@@ -793,25 +1078,33 @@ static void repr_write_comment( Writer &out, const gchar * val, bool addWhitespa
 
 namespace {
 
-typedef std::map<Glib::QueryQuark, gchar const *, Inkscape::compare_quark_ids> LocalNameMap;
 typedef std::map<Glib::QueryQuark, Inkscape::Util::ptr_shared, Inkscape::compare_quark_ids> NSMap;
 
 gchar const *qname_local_name(Glib::QueryQuark qname) {
-    static LocalNameMap local_name_map;
-    LocalNameMap::iterator iter = local_name_map.find(qname);
-    if ( iter != local_name_map.end() ) {
-        return (*iter).second;
+    gchar const *name_string=g_quark_to_string(qname);
+    gchar const *prefix_end=strchr(name_string, ':');
+    if (prefix_end) {
+        return prefix_end + 1;
     } else {
-        gchar const *name_string=g_quark_to_string(qname);
-        gchar const *prefix_end=strchr(name_string, ':');
-        if (prefix_end) {
-            return prefix_end + 1;
-        } else {
-            return name_string;
-        }
+        return name_string;
     }
 }
 
+/**
+ * Whether \a qname has the given prefix, or none if \a prefix is 0. Unlike qname_prefix(),
+ * this uses no shared state, so that a DocumentSnapshot can be written in another thread.
+ */
+bool qname_has_prefix(Glib::QueryQuark qname, Glib::QueryQuark prefix) {
+    gchar const *name_string = g_quark_to_string(qname);
+    gchar const *prefix_end = strchr(name_string, ':');
+    if (!prefix.id() || !prefix_end) {
+        return !prefix.id() && !prefix_end;
+    }
+    gchar const *prefix_string = g_quark_to_string(prefix);
+    std::size_t const length = prefix_end - name_string;
+    return strlen(prefix_string) == length && strncmp(name_string, prefix_string, length) == 0;
+}
+
 void add_ns_map_entry(NSMap &ns_map, Glib::QueryQuark prefix) {
     using Inkscape::Util::ptr_shared;
     using Inkscape::Util::share_unsafe;
@@ -859,8 +1152,6 @@ static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
                                   gchar const *const old_href_base,
                                   gchar const *const new_href_base)
 {
-    using Inkscape::Util::ptr_shared;
-
     g_assert(repr != nullptr);
 
     // Clean unnecessary attributes and stype properties. (Controlled by preferences.)
@@ -872,6 +1163,22 @@ static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
     bool sort = !prefs->getBool("/options/svgoutput/disable_optimizations") && prefs->getBool("/options/svgoutput/sort_attributes");
     if (sort) sp_attribute_sort_tree( *repr );
 
+    GQuark elide_prefix = 0;
+    auto attributes = sp_repr_root_element_attributes(repr, default_ns, elide_prefix);
+
+    return sp_repr_write_stream_element(repr, out, 0, add_whitespace, elide_prefix, attributes,
+                                        inlineattrs, indent, old_href_base, new_href_base);
+}
+
+/**
+ * The attributes to write for a root element, including the declarations of the namespaces
+ * used in its subtree. Sets \a elide_prefix to the prefix of the default namespace, if any.
+ */
+static AttributeVector sp_repr_root_element_attributes(Node *repr, gchar const *default_ns,
+                                                       GQuark &elide_prefix_out)
+{
+    using Inkscape::Util::ptr_shared;
+
     Glib::QueryQuark xml_prefix=g_quark_from_static_string("xml");
 
     NSMap ns_map;
@@ -910,8 +1217,8 @@ static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
         }
     }
 
-    return sp_repr_write_stream_element(repr, out, 0, add_whitespace, elide_prefix, attributes,
-                                        inlineattrs, indent, old_href_base, new_href_base);
+    elide_prefix_out = elide_prefix;
+    return attributes;
 }
 
 void sp_repr_write_stream( Node *repr, Writer &out, gint indent_level,
@@ -987,7 +1294,7 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
 
     GQuark code = repr->code();
     gchar const *element_name;
-    if ( elide_prefix == qname_prefix(code) ) {
+    if (qname_has_prefix(code, elide_prefix)) {
         element_name = qname_local_name(code);
     } else {
         element_name = g_quark_to_string(code);
@@ -1009,8 +1316,12 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         }
     }
 
-    const auto rbd = rebase_href_attrs(old_href_base, new_href_base, attributes);
-    for (const auto &iter : rbd) {
+    // Rebasing works on a copy, which would also be the only allocation made here.
+    AttributeVector rebased;
+    if (old_href_base != new_href_base) {
+        rebased = rebase_href_attrs(old_href_base, new_href_base, attributes);
+    }
+    for (const auto &iter : (old_href_base != new_href_base ? rebased : attributes)) {
         if (!inlineattrs) {
             out.writeChar('\n');
             if (indent) {
@@ -15,6 +15,7 @@
 #ifndef SEEN_SP_REPR_H
 #define SEEN_SP_REPR_H
 
+#include <string>
 #include <vector>
 #include <glibmm/quark.h>
 
@@ -52,7 +53,7 @@ Inkscape::XML::Document *sp_repr_document_new(char const *rootname);
 
 /* IO */
 
-Inkscape::XML::Document *sp_repr_read_file(char const *filename, char const *default_ns);
+Inkscape::XML::Document *sp_repr_read_file(char const *filename, char const *default_ns, bool streaming = true);
 Inkscape::XML::Document *sp_repr_read_mem(char const *buffer, int length, char const *default_ns);
 void sp_repr_write_stream(Inkscape::XML::Node *repr, Inkscape::IO::Writer &out,
                           int indent_level,  bool add_whitespace, Glib::QueryQuark elide_prefix,
@@ -73,6 +74,48 @@ bool sp_repr_save_rebased_file(Inkscape::XML::Document *doc, char const *filenam
                                char const *default_ns,
                                char const *old_base, char const *new_base_filename);
 
+namespace Inkscape {
+namespace XML {
+
+/**
+ * A copy of a document to write out from another thread while the document is being edited.
+ *
+ * Taking the copy, and destroying it, has to happen in the main thread. Writing it reads neither
+ * the preferences nor allocates from the garbage collector, so that it can happen in any thread,
+ * one at a time. Unlike sp_repr_save_stream(), it does not clean or sort the attributes, which
+ * would change the copy.
+ */
+class DocumentSnapshot {
+public:
+    DocumentSnapshot(Document const *doc, char const *default_ns);
+    ~DocumentSnapshot();
+
+    DocumentSnapshot(DocumentSnapshot const &) = delete;
+    DocumentSnapshot &operator=(DocumentSnapshot const &) = delete;
+
+    /// Writes the copy as sp_repr_save_stream() writes a document.
+    void save(FILE *to_file) const;
+
+    /// The copy, which may be read in any thread.
+    Document const *document() const { return _doc; }
+
+private:
+    struct RootElement {
+        Node *node;
+        GQuark elide_prefix;
+        AttributeVector attributes;
+    };
+
+    Document *_doc;
+    std::string _doctype;
+    std::vector<RootElement> _roots;
+    bool _inlineattrs;
+    int _indent;
+};
+
+} // namespace XML
+} // namespace Inkscape
+
 
 /* CSS stuff */
 
@@ -40,6 +40,16 @@ namespace XML {
 
 namespace {
 
+/// Nodes with more attributes than this find them through a hash table.
+size_t const ATTRIBUTE_INDEX_THRESHOLD = 8;
+
+/// First slot to probe for key in a table of mask + 1 slots. Quarks are allocated
+/// sequentially, and multiplying by an odd constant keeps consecutive quarks apart.
+inline size_t attribute_slot(GQuark key, size_t mask)
+{
+    return (key * 2654435761u) & mask;
+}
+
 std::shared_ptr<std::string> stringify_node(Node const &node) {
     gchar *string;
     switch (node.type()) {
@@ -213,6 +223,7 @@ SimpleNode::SimpleNode(SimpleNode const &node, Document *document)
     }
 
     _attributes = node._attributes;
+    _attribute_index = node._attribute_index;
 
     _observers.add(_subtree_observers);
 }
@@ -228,16 +239,69 @@ gchar const *SimpleNode::content() const {
 gchar const *SimpleNode::attribute(gchar const *name) const {
     g_return_val_if_fail(name != nullptr, NULL);
 
-    GQuark const key = g_quark_from_string(name);
+    // A name that was never interned cannot be the key of any attribute. Unlike
+    // g_quark_from_string, this does not add the name to the quark table.
+    GQuark const key = g_quark_try_string(name);
+    if (!key) {
+        return nullptr;
+    }
 
-    for (const auto & iter : _attributes)
-    {
-        if ( iter.key == key ) {
-            return iter.value;
+    int const pos = _findAttribute(key);
+    return pos < 0 ? nullptr : _attributes[pos].value;
+}
+
+/// Returns the position of the attribute with the given key in _attributes, or -1.
+int SimpleNode::_findAttribute(GQuark key) const {
+    if (_attribute_index.empty()) {
+        for (size_t i = 0; i < _attributes.size(); ++i) {
+            if (_attributes[i].key == key) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    size_t const mask = _attribute_index.size() - 1;
+    for (size_t slot = attribute_slot(key, mask); _attribute_index[slot]; slot = (slot + 1) & mask) {
+        unsigned const pos = _attribute_index[slot] - 1;
+        if (_attributes[pos].key == key) {
+            return pos;
         }
     }
+    return -1;
+}
 
-    return nullptr;
+/**
+ * Brings _attribute_index up to date after _attributes changed.
+ * @param appended Whether the only change was a new attribute at the end.
+ */
+void SimpleNode::_indexAttributes(bool appended) {
+    size_t const count = _attributes.size();
+    if (count <= ATTRIBUTE_INDEX_THRESHOLD) {
+        _attribute_index.clear();
+        return;
+    }
+
+    size_t first = 0;
+    if (appended && !_attribute_index.empty() && 2 * count <= _attribute_index.size()) {
+        // the table stays at most half full, so only the new attribute needs a slot
+        first = count - 1;
+    } else {
+        size_t size = 32;
+        while (size < 2 * count) {
+            size *= 2;
+        }
+        _attribute_index.assign(size, 0);
+    }
+
+    size_t const mask = _attribute_index.size() - 1;
+    for (size_t pos = first; pos < count; ++pos) {
+        size_t slot = attribute_slot(_attributes[pos].key, mask);
+        while (_attribute_index[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        _attribute_index[slot] = pos + 1;
+    }
 }
 
 unsigned SimpleNode::position() const {
@@ -319,16 +383,15 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
     g_assert(std::none_of(name, name + strlen(name), [](char c) { return g_ascii_isspace(c); }));
 
     // Check usefulness of attributes on elements in the svg namespace, optionally don't add them to tree.
-    Glib::ustring element = g_quark_to_string(_name);
-    //g_message("setAttribute:  %s: %s: %s", element.c_str(), name, value);
     gchar* cleaned_value = g_strdup( value );
 
     // Only check elements in SVG name space and don't block setting attribute to NULL.
-    if( element.substr(0,4) == "svg:" && value != nullptr) {
+    if( g_str_has_prefix(g_quark_to_string(_name), "svg:") && value != nullptr) {
 
         Inkscape::Preferences *prefs = Inkscape::Preferences::get();
         if( prefs->getBool("/options/svgoutput/check_on_editing") ) {
 
+            Glib::ustring element = g_quark_to_string(_name);
             gchar const *id_char = attribute("id");
             Glib::ustring id = (id_char == nullptr ? "" : id_char );
             unsigned int flags = sp_attribute_clean_get_prefs();
@@ -360,13 +423,8 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
 
     GQuark const key = g_quark_from_string(name);
 
-    AttributeRecord *ref = nullptr;
-    for ( auto & existing : _attributes ) {
-        if ( existing.key == key ) {
-            ref = &existing;
-            break;
-        }
-    }
+    int const pos = _findAttribute(key);
+    AttributeRecord *ref = pos < 0 ? nullptr : &_attributes[pos];
     Debug::EventTracker<> tracker;
 
     ptr_shared old_value=( ref ? ref->value : ptr_shared() );
@@ -376,14 +434,16 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
         new_value = share_string(cleaned_value);
         tracker.set<DebugSetAttribute>(*this, key, new_value);
         if (!ref) {
-	    _attributes.emplace_back(key, new_value);
+            _attributes.emplace_back(key, new_value);
+            _indexAttributes(true);
         } else {
             ref->value = new_value;
         }
     } else { //clearing attribute
         tracker.set<DebugClearAttribute>(*this, key);
         if (ref) {
-	    _attributes.erase(std::find(_attributes.begin(),_attributes.end(),(*ref)));
+            _attributes.erase(_attributes.begin() + pos);
+            _indexAttributes(false);
         }
     }
 
@@ -134,6 +134,9 @@ private:
     void _setParent(SimpleNode *parent);
     unsigned _childPosition(SimpleNode const &child) const;
 
+    int _findAttribute(GQuark key) const;
+    void _indexAttributes(bool appended);
+
     SimpleNode *_parent;
     SimpleNode *_next;
     SimpleNode *_prev;
@@ -143,6 +146,12 @@ private:
     int _name;
 
     AttributeVector _attributes;
+    /**
+     * Open addressing hash table of the positions in _attributes plus one, keyed by GQuark.
+     * Only used once a node has more than a few attributes; below that a linear scan of
+     * _attributes is faster. Empty slots are zero.
+     */
+    std::vector<unsigned, Inkscape::GC::Alloc<unsigned, Inkscape::GC::MANUAL>> _attribute_index;
 
     Inkscape::Util::ptr_shared _content;
 
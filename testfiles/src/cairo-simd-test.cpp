@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests and benchmark for the SIMD pixel kernels in display/cairo-simd.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <src/display/cairo-simd.h>
+#include <src/display/cairo-templates.h>
+#include <src/display/cairo-utils.h>
+#include <src/display/nr-filter-colormatrix.h>
+#include <src/display/nr-filter-component-transfer.h>
+#include <src/display/nr-filter-composite.h>
+
+using namespace Inkscape::Display;
+using Inkscape::Filters::FilterColorMatrix;
+using Inkscape::Filters::FilterComponentTransfer;
+using Inkscape::Filters::FilterComposite;
+
+namespace {
+
+std::vector<guint32> random_pixels(int n, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<guint32> px(n);
+    for (int i = 0; i < n; ++i) {
+        px[i] = rng();
+        // include fully transparent and opaque pixels
+        if (i % 7 == 0) {
+            px[i] &= 0x00ffffff;
+        } else if (i % 11 == 0) {
+            px[i] |= 0xff000000;
+        }
+    }
+    return px;
+}
+
+std::vector<SimdLevel> simd_levels()
+{
+    std::vector<SimdLevel> levels;
+    for (auto level : {SimdLevel::SSE2, SimdLevel::AVX2}) {
+        if (level <= simd_supported_level()) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+// Runs the color matrix through ink_cairo_surface_filter without its span method.
+struct ScalarColorMatrix {
+    FilterColorMatrix::ColorMatrixMatrix matrix;
+    guint32 operator()(guint32 in) { return matrix(in); }
+};
+
+} // namespace
+
+class CairoSimdTest : public ::testing::Test {
+  protected:
+    void TearDown() override { simd_set_level(simd_supported_level()); }
+
+    static int const N = 4099; // not a multiple of the block size
+};
+
+TEST_F(CairoSimdTest, PremultiplyMatchesScalar)
+{
+    auto in = random_pixels(N, 1);
+    for (auto level : simd_levels()) {
+        simd_set_level(level);
+        FilterComponentTransfer::MultiplyAlpha premultiply;
+        std::vector<guint32> out(N);
+        int done = premultiply.filterSpan(in.data(), out.data(), N);
+        EXPECT_GT(done, 0);
+        for (int i = 0; i < done; ++i) {
+            ASSERT_EQ(out[i], premultiply(in[i])) << "pixel " << i << " level " << int(level);
+        }
+    }
+}
+
+TEST_F(CairoSimdTest, UnpremultiplyMatchesScalar)
+{
+    // every combination of color and alpha
+    std::vector<guint32> in;
+    for (guint32 a = 0; a < 256; ++a) {
+        for (guint32 c = 0; c < 256; ++c) {
+            in.push_back((a << 24) | (c << 16) | ((255 - c) << 8) | (c / 2));
+        }
+    }
+    for (auto level : simd_levels()) {
+        simd_set_level(level);
+        FilterComponentTransfer::UnmultiplyAlpha unpremultiply;
+        std::vector<guint32> out(in.size());
+        int done = unpremultiply.filterSpan(in.data(), out.data(), in.size());
+        EXPECT_EQ(done, int(in.size()));
+        for (int i = 0; i < done; ++i) {
+            ASSERT_EQ(out[i], unpremultiply(in[i])) << "pixel " << i << " level " << int(level);
+        }
+    }
+}
+
+TEST_F(CairoSimdTest, CompositeArithmeticMatchesScalar)
+{
+    auto in1 = random_pixels(N, 2);
+    auto in2 = random_pixels(N, 3);
+    double const k[][4] = {
+        {0, 1, 0, 0},
+        {1, 0, 0, 0},
+        {-0.5, 0.46, -0.31, 0.24},
+        {1.57, -1, 1, -1},
+    };
+    for (auto level : simd_levels()) {
+        simd_set_level(level);
+        for (auto const &kk : k) {
+            FilterComposite::ComposeArithmetic arithmetic(kk[0], kk[1], kk[2], kk[3]);
+            std::vector<guint32> out(N);
+            int done = arithmetic.blendSpan(in1.data(), in2.data(), out.data(), N);
+            EXPECT_GT(done, 0);
+            for (int i = 0; i < done; ++i) {
+                ASSERT_EQ(out[i], arithmetic(in1[i], in2[i])) << "pixel " << i << " level " << int(level);
+            }
+        }
+    }
+}
+
+TEST_F(CairoSimdTest, ColorMatrixMatchesScalar)
+{
+    auto in = random_pixels(N, 4);
+    std::vector<std::vector<double>> matrices = {
+        {1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0},
+        {0.2125, 0.7154, 0.0721, 0, 0, 0.2125, 0.7154, 0.0721, 0, 0, 0.2125, 0.7154, 0.0721, 0, 0, 0, 0, 0, 1, 0},
+        {-1, 0.5, 2, 0, 0.5, 1.5, -0.3, 0, 0.2, -0.25, 0, 0, -1, 1, 1, 0.3, 0.3, 0.3, 0.5, -0.1},
+    };
+    for (auto level : simd_levels()) {
+        simd_set_level(level);
+        for (auto const &values : matrices) {
+            FilterColorMatrix::ColorMatrixMatrix matrix(values);
+            std::vector<guint32> out(N);
+            int done = matrix.filterSpan(in.data(), out.data(), N);
+            EXPECT_GT(done, 0);
+            for (int i = 0; i < done; ++i) {
+                ASSERT_EQ(out[i], matrix(in[i])) << "pixel " << i << " level " << int(level);
+            }
+        }
+    }
+}
+
+// Not a correctness test: reports the speed of ink_cairo_surface_filter with and without SIMD.
+TEST_F(CairoSimdTest, BenchmarkColorMatrix)
+{
+    int const size = 1024;
+    int const rounds = 10;
+    auto px = random_pixels(size * size, 5);
+
+    cairo_surface_t *in = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+    cairo_surface_t *out = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+    ASSERT_EQ(cairo_image_surface_get_stride(in), size * 4);
+    std::copy(px.begin(), px.end(), reinterpret_cast<guint32 *>(cairo_image_surface_get_data(in)));
+    cairo_surface_mark_dirty(in);
+
+    std::vector<double> values = {-1, 0.5, 2, 0, 0.5, 1.5, -0.3, 0, 0.2, -0.25, 0, 0, -1, 1, 1, 0.3, 0.3, 0.3, 0.5, -0.1};
+    FilterColorMatrix::ColorMatrixMatrix matrix(values);
+
+    auto time = [&](auto filter) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            ink_cairo_surface_filter(in, out, filter);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / rounds;
+    };
+
+    std::cout << "feColorMatrix on " << size << "x" << size << " px:" << std::endl;
+    std::cout << "  scalar: " << time(ScalarColorMatrix{matrix}) << " ms" << std::endl;
+    for (auto level : simd_levels()) {
+        simd_set_level(level);
+        std::cout << "  " << (level == SimdLevel::AVX2 ? "AVX2" : "SSE2") << ":   " << time(matrix) << " ms" << std::endl;
+    }
+
+    cairo_surface_destroy(in);
+    cairo_surface_destroy(out);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
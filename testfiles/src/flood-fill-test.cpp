@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests of the scanline flood fill of the paint bucket tool
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "ui/tools/flood-fill.h"
+
+using namespace Inkscape::UI::Tools;
+
+namespace {
+
+/// An image drawn with '.' for paintable pixels and anything else for the others.
+class TestImage
+{
+public:
+    TestImage(std::vector<std::string> rows)
+        : _rows(std::move(rows))
+    {}
+
+    int width() const { return _rows[0].size(); }
+    int height() const { return _rows.size(); }
+    bool paintable(int x, int y) const { return _rows[y][x] == '.'; }
+
+private:
+    std::vector<std::string> _rows;
+};
+
+struct FillResult
+{
+    ScanlineCheckResult result;
+    std::vector<std::string> colored; ///< '*' for colored pixels, ' ' for the others
+    Geom::OptIntRect colored_area;
+};
+
+/**
+ * Fills from the seed. The drawing extends beyond the image on all sides if the bbox is not
+ * given, so that reaching an edge is not an error.
+ */
+FillResult fill(TestImage &image, Geom::IntPoint const &seed, int radius,
+                Geom::OptRect bbox = Geom::OptRect())
+{
+    Geom::Rect const screen(0, 0, image.width(), image.height());
+    if (!bbox) {
+        bbox = Geom::Rect(-10, -10, image.width() + 10, image.height() + 10);
+    }
+    PixelMask checked(image.width(), image.height());
+    PixelMask colored(image.width(), image.height());
+    FillResult result;
+    result.result = perform_scanline_fill(image, {seed}, radius, *bbox, screen, checked, colored,
+                                          result.colored_area);
+    for (int y = 0; y < image.height(); y++) {
+        std::string row;
+        for (int x = 0; x < image.width(); x++) {
+            row += colored.test(x, y) ? '*' : ' ';
+        }
+        result.colored.push_back(row);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(FloodFillTest, PixelMask)
+{
+    PixelMask mask(200, 3);
+    EXPECT_FALSE(mask.test(0, 0));
+
+    // across the words of a row
+    mask.setSpan(60, 130, 1);
+    for (int x = 0; x < 200; x++) {
+        EXPECT_EQ(mask.test(x, 1), x >= 60 && x <= 130) << x;
+        EXPECT_FALSE(mask.test(x, 0)) << x;
+        EXPECT_FALSE(mask.test(x, 2)) << x;
+    }
+
+    // a single pixel at the end of a word and at the end of the row
+    mask.setSpan(63, 63, 2);
+    mask.setSpan(199, 199, 2);
+    EXPECT_TRUE(mask.test(63, 2));
+    EXPECT_FALSE(mask.test(64, 2));
+    EXPECT_TRUE(mask.test(199, 2));
+    EXPECT_FALSE(mask.test(198, 2));
+
+    mask.word(1, 0) = 1;
+    EXPECT_TRUE(mask.test(64, 0));
+    EXPECT_FALSE(mask.test(65, 0));
+}
+
+TEST(FloodFillTest, BoundedArea)
+{
+    TestImage image({
+        "..........",
+        ".######...",
+        ".#....#...",
+        ".#..#.#...",
+        ".######...",
+        "..........",
+    });
+    auto result = fill(image, {2, 2}, 0);
+    EXPECT_EQ(result.result, SCANLINE_CHECK_OK);
+    std::vector<std::string> expected{
+        "          ",
+        "          ",
+        "  ****    ",
+        "  ** *    ",
+        "          ",
+        "          ",
+    };
+    EXPECT_EQ(result.colored, expected);
+    ASSERT_TRUE(result.colored_area);
+    EXPECT_EQ(*result.colored_area, Geom::IntRect(2, 2, 6, 4));
+}
+
+TEST(FloodFillTest, UnboundedArea)
+{
+    TestImage image({
+        "......",
+        ".####.",
+        "......",
+    });
+
+    // the drawing ends within the screen, so the area around it is not bounded
+    auto result = fill(image, {0, 0}, 0, Geom::Rect(1, 1, 5, 2));
+    EXPECT_EQ(result.result, SCANLINE_CHECK_ABORTED);
+
+    // the drawing goes on beyond the screen, so only the visible part is filled
+    result = fill(image, {0, 0}, 0);
+    EXPECT_EQ(result.result, SCANLINE_CHECK_BOUNDARY);
+    std::vector<std::string> expected{
+        "******",
+        "*    *",
+        "******",
+    };
+    EXPECT_EQ(result.colored, expected);
+}
+
+TEST(FloodFillTest, SeedAtEdge)
+{
+    TestImage image({
+        "...#....",
+        "...#....",
+        "####....",
+    });
+    auto result = fill(image, {0, 0}, 0);
+    EXPECT_EQ(result.result, SCANLINE_CHECK_BOUNDARY);
+    std::vector<std::string> expected{
+        "***     ",
+        "***     ",
+        "        ",
+    };
+    EXPECT_EQ(result.colored, expected);
+    EXPECT_EQ(*result.colored_area, Geom::IntRect(0, 0, 3, 2));
+
+    // the bottom right corner, on the other side of the wall
+    result = fill(image, {7, 2}, 0);
+    EXPECT_EQ(result.result, SCANLINE_CHECK_BOUNDARY);
+    EXPECT_EQ(*result.colored_area, Geom::IntRect(4, 0, 8, 3));
+}
+
+TEST(FloodFillTest, Autogap)
+{
+    // two rooms joined by a gap one pixel wide
+    TestImage image({
+        "###########",
+        "#...#.....#",
+        "#.........#",
+        "#...#.....#",
+        "#...#.....#",
+        "###########",
+    });
+
+    // without autogap, the fill leaks through the gap
+    auto result = fill(image, {2, 3}, 0);
+    EXPECT_EQ(result.result, SCANLINE_CHECK_OK);
+    EXPECT_EQ(result.colored[3], " *** ***** ");
+    EXPECT_EQ(*result.colored_area, Geom::IntRect(1, 1, 10, 5));
+
+    // the gap is narrower than the square of radius 1, which the left room is wide enough for
+    TestImage left_room({
+        "#########",
+        "#...#...#",
+        "#.......#",
+        "#...#...#",
+        "#...#...#",
+        "#########",
+    });
+    result = fill(left_room, {2, 3}, 1);
+    EXPECT_EQ(result.result, SCANLINE_CHECK_OK);
+    std::vector<std::string> expected{
+        "         ",
+        " ***     ",
+        " ***     ",
+        " ***     ",
+        " ***     ",
+        "         ",
+    };
+    EXPECT_EQ(result.colored, expected);
+
+    // a seed whose square is not paintable fills nothing
+    result = fill(left_room, {1, 1}, 1);
+    EXPECT_FALSE(result.colored_area);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
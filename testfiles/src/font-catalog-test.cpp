@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the font catalog kept between sessions
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtest/gtest.h>
+#include <src/libnrtype/font-catalog.h>
+
+class FontCatalogTest : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        gchar *dir = g_dir_make_tmp("font-catalog-XXXXXX", nullptr);
+        ASSERT_TRUE(dir);
+        _dir = dir;
+        g_free(dir);
+        filename = _dir + "/cache/font-catalog";
+    }
+
+    void TearDown() override
+    {
+        g_remove(filename.c_str());
+        g_rmdir((_dir + "/cache").c_str());
+        g_rmdir(_dir.c_str());
+    }
+
+    std::string _dir;
+    std::string filename;
+};
+
+TEST_F(FontCatalogTest, ReadsWhatItWrote)
+{
+    FontCatalog catalog;
+    catalog.reset("stamp", {"DejaVu Sans", "Noto Sans CJK JP", "Odd\tname\\with\nbreaks", "源ノ角ゴシック"});
+    catalog.setStyles("DejaVu Sans", {StyleNames("Normal", "Book"), StyleNames("Bold", "Bold")});
+    catalog.setStyles("Odd\tname\\with\nbreaks", {});
+    ASSERT_TRUE(catalog.save(filename));
+
+    FontCatalog read;
+    ASSERT_TRUE(read.load(filename, "stamp"));
+    EXPECT_EQ(read.stamp(), "stamp");
+    EXPECT_EQ(read.families(), catalog.families());
+
+    auto styles = read.styles("DejaVu Sans");
+    ASSERT_TRUE(styles);
+    ASSERT_EQ(styles->size(), 2u);
+    EXPECT_EQ((*styles)[0].CssName, "Normal");
+    EXPECT_EQ((*styles)[0].DisplayName, "Book");
+    EXPECT_EQ((*styles)[1].CssName, "Bold");
+
+    // known to have no styles is not the same as not known
+    ASSERT_TRUE(read.styles("Odd\tname\\with\nbreaks"));
+    EXPECT_TRUE(read.styles("Odd\tname\\with\nbreaks")->empty());
+    EXPECT_FALSE(read.styles("Noto Sans CJK JP"));
+}
+
+TEST_F(FontCatalogTest, IgnoresCatalogOfOtherFonts)
+{
+    FontCatalog catalog;
+    catalog.reset("old fonts", {"DejaVu Sans"});
+    ASSERT_TRUE(catalog.save(filename));
+
+    FontCatalog read;
+    EXPECT_FALSE(read.load(filename, "new fonts"));
+    EXPECT_TRUE(read.families().empty());
+}
+
+TEST_F(FontCatalogTest, IgnoresBrokenFiles)
+{
+    FontCatalog read;
+    EXPECT_FALSE(read.load(filename, "stamp"));
+
+    std::string truncated = "inkscape-font-catalog 1\nstamp\nF\tDejaVu Sans\ns\tNormal";
+    g_mkdir((_dir + "/cache").c_str(), 0755);
+    ASSERT_TRUE(g_file_set_contents(filename.c_str(), truncated.data(), truncated.size(), nullptr));
+    EXPECT_FALSE(read.load(filename, "stamp"));
+    EXPECT_TRUE(read.families().empty());
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the glyph cache shared by font instances
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <2geom/pathvector.h>
+#include <src/libnrtype/FontFactory.h>
+#include <src/libnrtype/font-instance.h>
+
+TEST(FontInstanceTest, GlyphsAreSharedBetweenThreads)
+{
+    font_instance *font = font_factory::Default()->FaceFromFontSpecification("sans-serif");
+    ASSERT_TRUE(font);
+    int const glyph = font->MapUnicodeChar('A');
+
+    std::vector<std::shared_ptr<Geom::PathVector const>> outlines(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < outlines.size(); i++) {
+        threads.emplace_back([&, i]() {
+            for (int g = 0; g < 200; g++) {
+                font->PathVector(g);
+                font->Advance(g, false);
+            }
+            outlines[i] = font->PathVector(glyph);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_TRUE(outlines[0]);
+    EXPECT_FALSE(outlines[0]->empty());
+    for (auto outline : outlines) {
+        EXPECT_EQ(outline, outlines[0]);
+    }
+    font->Unref();
+}
+
+TEST(FontInstanceTest, GlyphsAreSharedBetweenInstancesOfAFace)
+{
+    font_instance *font = font_factory::Default()->FaceFromFontSpecification("sans-serif");
+    ASSERT_TRUE(font);
+    int const glyph = font->MapUnicodeChar('g');
+
+    // the same face, asked for by its own family name instead of the generic one
+    PangoFontDescription *descr = pango_font_describe(font->pFont);
+    font_instance *other = font_factory::Default()->Face(descr);
+    pango_font_description_free(descr);
+    ASSERT_TRUE(other);
+
+    EXPECT_EQ(other->PathVector(other->MapUnicodeChar('g')), font->PathVector(glyph));
+    EXPECT_EQ(other->Advance(glyph, false), font->Advance(glyph, false));
+
+    other->Unref();
+    font->Unref();
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Benchmark of gzip compression
+ *
+ * Compresses the contents of a file, such as a large uncompressed SVG, with a single zlib
+ * stream as svgz files were written before, and with Inkscape::Util::BlockDeflater on one
+ * thread and more, and reports the throughput and the compressed size of each.
+ *
+ * Usage: benchmark_gzip [file] [max threads] [repetitions]
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "util/block-deflater.h"
+
+namespace {
+
+std::vector<unsigned char> deflate_single(std::vector<unsigned char> const &src)
+{
+    std::vector<unsigned char> dest(compressBound(src.size()));
+    uLongf size = dest.size();
+    compress2(dest.data(), &size, src.data(), src.size(), Z_DEFAULT_COMPRESSION);
+    dest.resize(size);
+    return dest;
+}
+
+template <typename F>
+double measure(int repetitions, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i) {
+        f();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repetitions;
+}
+
+void report(std::string const &name, double seconds, size_t bytes, size_t compressed)
+{
+    std::cout << name << ": " << seconds * 1000 << " ms, " << bytes / seconds / 1e6 << " MB/s, "
+              << compressed << " bytes" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string filename = argc > 1 ? argv[1] : INKSCAPE_TESTS_DIR "/../share/examples/filters.svg";
+    int max_threads = argc > 2 ? std::stoi(argv[2]) : 8;
+    int repetitions = argc > 3 ? std::stoi(argv[3]) : 5;
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot read " << filename << std::endl;
+        return 1;
+    }
+    std::vector<unsigned char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    std::cout << filename << ": " << data.size() << " bytes" << std::endl;
+
+    std::vector<unsigned char> compressed;
+    double single = measure(repetitions, [&]() { compressed = deflate_single(data); });
+    report("zlib, one stream", single, data.size(), compressed.size());
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double blocks = measure(repetitions, [&]() {
+            Inkscape::Util::BlockDeflater::deflate(compressed, data, threads);
+        });
+        report("BlockDeflater, " + std::to_string(threads) + " threads", blocks, data.size(), compressed.size());
+    }
+
+    return 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
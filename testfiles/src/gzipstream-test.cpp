@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests of gzip compression with Inkscape::Util::BlockDeflater and the gzip streams
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <zlib.h>
+
+#include "io/stream/bufferstream.h"
+#include "io/stream/gzipstream.h"
+#include "util/block-deflater.h"
+
+namespace {
+
+/// Text that compresses somewhat like SVG does.
+std::vector<unsigned char> make_data(std::size_t size)
+{
+    static char const alphabet[] = "<path d=\"M 0,0 L 10.5,3 Z\" />\n";
+    std::mt19937 random(size);
+    std::vector<unsigned char> data(size);
+    for (auto &c : data) {
+        c = alphabet[random() % (sizeof(alphabet) - 1)];
+    }
+    return data;
+}
+
+std::vector<unsigned char> inflate_raw(std::vector<unsigned char> const &compressed, std::size_t size)
+{
+    std::vector<unsigned char> result(size + 1);
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    inflateInit2(&stream, -MAX_WBITS);
+    stream.next_in = const_cast<Bytef *>(compressed.data());
+    stream.avail_in = compressed.size();
+    stream.next_out = result.data();
+    stream.avail_out = result.size();
+    int err = inflate(&stream, Z_FINISH);
+    EXPECT_EQ(err, Z_STREAM_END);
+    EXPECT_EQ(stream.avail_in, 0u);
+    result.resize(result.size() - stream.avail_out);
+    inflateEnd(&stream);
+    return result;
+}
+
+} // namespace
+
+TEST(GzipStreamTest, BlockDeflaterMakesOneStream)
+{
+    std::size_t const block = Inkscape::Util::BlockDeflater::BLOCK_SIZE;
+    for (std::size_t size : {std::size_t(0), std::size_t(1), block - 1, block, block + 1, 5 * block + 17}) {
+        auto data = make_data(size);
+        std::vector<unsigned char> single;
+        ASSERT_TRUE(Inkscape::Util::BlockDeflater::deflate(single, data, 1));
+        EXPECT_EQ(inflate_raw(single, size), data);
+
+        for (int threads : {2, 4}) {
+            std::vector<unsigned char> parallel;
+            ASSERT_TRUE(Inkscape::Util::BlockDeflater::deflate(parallel, data, threads));
+            // the blocks are the same whichever thread compresses them
+            EXPECT_EQ(parallel, single);
+        }
+    }
+}
+
+TEST(GzipStreamTest, BlockDeflaterChecksum)
+{
+    auto data = make_data(3 * Inkscape::Util::BlockDeflater::BLOCK_SIZE + 5);
+    Inkscape::Util::BlockDeflater deflater([](unsigned char const *, std::size_t) {}, 2);
+    deflater.write(data.data(), 100);
+    deflater.write(data.data() + 100, data.size() - 100);
+    ASSERT_TRUE(deflater.finish());
+    EXPECT_EQ(deflater.crc(), crc32(crc32(0L, Z_NULL, 0), data.data(), data.size()));
+    EXPECT_EQ(deflater.size(), data.size());
+}
+
+TEST(GzipStreamTest, RoundTrip)
+{
+    for (int threads : {1, 4}) {
+        auto data = make_data(1000000);
+
+        Inkscape::IO::BufferOutputStream bout;
+        {
+            Inkscape::IO::GzipOutputStream gout(bout, threads);
+            for (std::size_t i = 0; i < data.size(); i++) {
+                gout.put(data[i]);
+                if (i == 1000) {
+                    gout.flush();
+                }
+            }
+            gout.close();
+        }
+        auto const &compressed = bout.getBuffer();
+        ASSERT_GT(compressed.size(), 18u);
+        EXPECT_LT(compressed.size(), data.size());
+        EXPECT_EQ(compressed[0], 0x1f);
+        EXPECT_EQ(compressed[1], 0x8b);
+
+        Inkscape::IO::BufferInputStream bin(compressed);
+        Inkscape::IO::GzipInputStream gin(bin);
+        std::vector<unsigned char> result;
+        for (int ch = gin.get(); ch >= 0; ch = gin.get()) {
+            result.push_back(ch);
+        }
+        EXPECT_EQ(result, data);
+    }
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the spatial index behind SPDocument::getItemsInBox and friends
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <gtest/gtest.h>
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/object/sp-item.h>
+
+using namespace Inkscape;
+
+class ItemIndexTest : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        // setup hidden dependency
+        Application::create(false);
+
+        std::string svg("\
+<svg xmlns='http://www.w3.org/2000/svg' xmlns:inkscape='http://www.inkscape.org/namespaces/inkscape' width='100' height='100'>\
+  <defs>\
+    <rect id='inDefs' x='0' y='0' width='10' height='10' />\
+  </defs>\
+  <g id='layer' inkscape:groupmode='layer'>\
+    <rect id='a' x='0' y='0' width='10' height='10' />\
+    <g id='group'>\
+      <rect id='b' x='20' y='0' width='10' height='10' />\
+      <rect id='c' x='40' y='0' width='10' height='10' />\
+    </g>\
+    <rect id='d' x='60' y='0' width='10' height='10' style='display:none' />\
+  </g>\
+</svg>");
+        doc.reset(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), true));
+        doc->ensureUpToDate();
+    }
+
+    std::vector<std::string> ids(std::vector<SPItem *> const &items)
+    {
+        std::vector<std::string> result;
+        for (auto item : items) {
+            result.emplace_back(item->getId());
+        }
+        return result;
+    }
+
+    std::unique_ptr<SPDocument> doc;
+};
+
+TEST_F(ItemIndexTest, FindsItemsLikeTreeWalk)
+{
+    Geom::Rect all(Geom::Point(-1, -1), Geom::Point(101, 101));
+
+    EXPECT_EQ(ids(doc->getItemsInBox(0, all)), (std::vector<std::string>{"a", "group"}));
+    EXPECT_EQ(ids(doc->getItemsInBox(0, all, true)), (std::vector<std::string>{"a", "group", "d"}));
+    // groups come after their children
+    EXPECT_EQ(ids(doc->getItemsInBox(0, all, false, false, true, true)),
+              (std::vector<std::string>{"a", "b", "c", "group"}));
+    EXPECT_EQ(ids(doc->getItemsInBox(0, all, false, false, false, true)),
+              (std::vector<std::string>{"a", "b", "c"}));
+
+    Geom::Rect left(Geom::Point(-1, -1), Geom::Point(25, 5));
+    EXPECT_EQ(ids(doc->getItemsInBox(0, left, false, false, true, true)), (std::vector<std::string>{"a"}));
+    EXPECT_EQ(ids(doc->getItemsPartiallyInBox(0, left, false, false, true, true)),
+              (std::vector<std::string>{"a", "b", "group"}));
+}
+
+TEST_F(ItemIndexTest, FollowsChanges)
+{
+    Geom::Rect right(Geom::Point(75, -1), Geom::Point(101, 101));
+    EXPECT_TRUE(doc->getItemsInBox(0, right).empty());
+
+    doc->getObjectById("a")->setAttribute("x", "80");
+    doc->ensureUpToDate();
+    EXPECT_EQ(ids(doc->getItemsInBox(0, right)), (std::vector<std::string>{"a"}));
+
+    // moving a group moves its children
+    doc->getObjectById("group")->setAttribute("transform", "translate(50,50)");
+    doc->ensureUpToDate();
+    EXPECT_EQ(ids(doc->getItemsInBox(0, right, false, false, true, true)),
+              (std::vector<std::string>{"a", "c"}));
+
+    doc->getObjectById("a")->deleteObject();
+    doc->ensureUpToDate();
+    EXPECT_EQ(ids(doc->getItemsInBox(0, right, false, false, true, true)), (std::vector<std::string>{"c"}));
+}
+
+TEST_F(ItemIndexTest, StaysConsistentWithManyItems)
+{
+    auto layer = doc->getObjectById("layer")->getRepr();
+    for (int i = 0; i < 1000; ++i) {
+        auto rect = doc->getReprDoc()->createElement("svg:rect");
+        rect->setAttribute("x", std::to_string(i % 100));
+        rect->setAttribute("y", std::to_string(i / 10));
+        rect->setAttribute("width", "1");
+        rect->setAttribute("height", "1");
+        layer->appendChild(rect);
+        Inkscape::GC::release(rect);
+    }
+    doc->ensureUpToDate();
+
+    Geom::Rect box(Geom::Point(9.5, 9.5), Geom::Point(20.5, 20.5));
+    auto items = doc->getItemsInBox(0, box);
+    for (auto item : items) {
+        auto bbox = item->documentVisualBounds();
+        ASSERT_TRUE(bbox);
+        EXPECT_TRUE(box.contains(*bbox));
+    }
+    EXPECT_FALSE(items.empty());
+
+    int count = 0;
+    for (auto &child : doc->getObjectById("layer")->children) {
+        auto item = dynamic_cast<SPItem *>(&child);
+        auto bbox = item ? item->documentVisualBounds() : Geom::OptRect();
+        if (bbox && box.contains(*bbox) && !item->isHidden()) {
+            ++count;
+        }
+    }
+    EXPECT_EQ(int(items.size()), count);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
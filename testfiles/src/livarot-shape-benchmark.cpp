@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Microbenchmark of Shape::ConvertToShape on large polygons
+ *
+ * Builds a path of overlapping star polygons with many vertices each and converts it to an
+ * intersection-free polygon over and over, once freeing the memory of the sweeps after every
+ * conversion and once keeping it for the next one with a Shape::ScratchScope. Both are timed
+ * with the sweepline kept in an AVL tree and in blocks.
+ *
+ * Usage: benchmark_livarot_shape [vertices] [polygons] [repetitions]
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "livarot/Path.h"
+#include "livarot/Shape.h"
+#include "livarot/sweep-tree-list.h"
+
+namespace {
+
+void make_stars(Path &path, int vertices, int polygons)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> radius(95, 100);
+    for (int p = 0; p < polygons; p++) {
+        Geom::Point center(30.0 * p, 0);
+        for (int i = 0; i < vertices; i++) {
+            double angle = 2 * M_PI * i / vertices;
+            Geom::Point point = center + radius(random) * Geom::Point(std::cos(angle), std::sin(angle));
+            if (i == 0) {
+                path.MoveTo(point);
+            } else {
+                path.LineTo(point);
+            }
+        }
+        path.Close();
+    }
+}
+
+template <typename F>
+double measure(int repetitions, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i) {
+        f();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repetitions;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int vertices = argc > 1 ? std::stoi(argv[1]) : 20000;
+    int polygons = argc > 2 ? std::stoi(argv[2]) : 4;
+    int repetitions = argc > 3 ? std::stoi(argv[3]) : 20;
+
+    Path path;
+    make_stars(path, vertices, polygons);
+    path.Convert(1.0);
+
+    Shape polygon;
+    path.Fill(&polygon, 0);
+    std::cout << polygon.numberOfEdges() << " edges" << std::endl;
+
+    int edges = 0;
+    auto convert = [&]() {
+        Shape result;
+        result.ConvertToShape(&polygon, fill_nonZero);
+        edges = result.numberOfEdges();
+    };
+
+    // the first conversion also sorts the points of the polygon
+    convert();
+
+    for (auto storage : {SweepTreeList::AVL_TREE, SweepTreeList::BLOCK_ARRAY}) {
+        SweepTreeList::defaultStorage = storage;
+        double fresh = measure(repetitions, convert);
+        double reused;
+        {
+            Shape::ScratchScope scratch;
+            reused = measure(repetitions, convert);
+        }
+        char const *name = storage == SweepTreeList::AVL_TREE ? "tree" : "blocks";
+        std::cout << name << ", fresh memory:  " << fresh * 1000 << " ms per conversion\n"
+                  << name << ", reused memory: " << reused * 1000 << " ms per conversion" << std::endl;
+    }
+    std::cout << edges << " edges in the result" << std::endl;
+    return 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -12,6 +12,9 @@
  */
 
 #include <gtest/gtest.h>
+
+#include <algorithm>
+
 #include <doc-per-case-test.h>
 
 #include <src/style.h>
@@ -197,3 +200,47 @@ TEST_F(ObjectTest, StyleFontSizes) {
     // 50% is 118.59 == ((300^2 + 150^2) / 2)^0.5 * 0.5
     EXPECT_FLOAT_EQ(eight->style->stroke_width.computed, 118.58541);
 }
+
+/*
+ * Test that changing the style of a group only cascades what changed to its children.
+ */
+TEST_F(ObjectTest, StyleChangeCascade) {
+    ASSERT_TRUE(doc != nullptr);
+
+    SPRect *one = dynamic_cast<SPRect *>(doc->getObjectById("one"));
+    SPRect *three = dynamic_cast<SPRect *>(doc->getObjectById("three"));
+    SPRect *six = dynamic_cast<SPRect *>(doc->getObjectById("six"));
+    ASSERT_TRUE(one != nullptr && three != nullptr && six != nullptr);
+    SPObject *group = one->parent;
+    EXPECT_TRUE(group->style->changedProperties().none());
+
+    group->setAttribute("style", "fill:blue; stroke-width:3px;font-size: 20px;");
+    EXPECT_TRUE(group->style->changedProperties().any());
+    doc->ensureUpToDate();
+    EXPECT_TRUE(group->style->changedProperties().none());
+    EXPECT_TRUE(one->style->changedProperties().none());
+
+    EXPECT_EQ(one->style->fill.get_value(), Glib::ustring("#ff0000"));
+    EXPECT_EQ(one->style->stroke_width.get_value(), Glib::ustring("3px"));
+    EXPECT_EQ(three->style->stroke_width.get_value(), Glib::ustring("3px"));
+    // set locally, but relative to the changed font size
+    EXPECT_EQ(six->style->stroke_width.computed, 20);
+
+    // writing the same style again changes nothing
+    group->setAttribute("style", "fill:blue; stroke-width:3px;font-size: 20px;");
+    EXPECT_TRUE(group->style->changedProperties().none());
+    doc->ensureUpToDate();
+    EXPECT_EQ(six->style->stroke_width.computed, 20);
+
+    // only the property whose declaration changed
+    auto properties = group->style->properties();
+    auto index = [&](SPIBase const &property) {
+        return std::find(properties.begin(), properties.end(), &property) - properties.begin();
+    };
+    group->setAttribute("style", "fill:green; stroke-width:3px;font-size: 20px;");
+    EXPECT_TRUE(group->style->changedProperties()[index(group->style->fill)]);
+    EXPECT_FALSE(group->style->changedProperties()[index(group->style->stroke_width)]);
+    EXPECT_FALSE(group->style->changedProperties()[index(group->style->font_size)]);
+    doc->ensureUpToDate();
+    EXPECT_EQ(one->style->fill.get_value(), Glib::ustring("#ff0000"));
+}
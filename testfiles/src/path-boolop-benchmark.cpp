@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Benchmark of the union of many paths
+ *
+ * Generates a map of parcels, quadrilaterals on a jittered grid which share their edges with
+ * their neighbours, and unites them with different numbers of threads. With "fold", also
+ * unites them one at a time, as in the boolean operations on two paths.
+ *
+ * Usage: benchmark_path_boolop [columns] [rows] [max threads] [fold]
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <2geom/path.h>
+#include <2geom/pathvector.h>
+
+#include "path/path-boolop.h"
+
+namespace {
+
+std::vector<Geom::PathVector> make_parcels(int columns, int rows)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> jitter(-0.3, 0.3);
+    std::vector<Geom::Point> corners;
+    for (int y = 0; y <= rows; y++) {
+        for (int x = 0; x <= columns; x++) {
+            corners.emplace_back(x + jitter(random), y + jitter(random));
+        }
+    }
+
+    auto corner = [&](int x, int y) { return corners[y * (columns + 1) + x]; };
+    std::vector<Geom::PathVector> parcels;
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < columns; x++) {
+            Geom::Path parcel(corner(x, y));
+            parcel.appendNew<Geom::LineSegment>(corner(x + 1, y));
+            parcel.appendNew<Geom::LineSegment>(corner(x + 1, y + 1));
+            parcel.appendNew<Geom::LineSegment>(corner(x, y + 1));
+            parcel.close();
+            parcels.emplace_back(parcel);
+        }
+    }
+    return parcels;
+}
+
+template <typename F>
+double measure(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int columns = argc > 1 ? std::stoi(argv[1]) : 100;
+    int rows = argc > 2 ? std::stoi(argv[2]) : 100;
+    int max_threads = argc > 3 ? std::stoi(argv[3]) : 8;
+    bool fold = argc > 4 && std::strcmp(argv[4], "fold") == 0;
+
+    auto parcels = make_parcels(columns, rows);
+    std::cout << parcels.size() << " parcels" << std::endl;
+
+    double single = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        Geom::PathVector result;
+        double time = measure([&]() { result = sp_pathvector_union(parcels, fill_nonZero, threads); });
+        if (threads == 1) {
+            single = time;
+        }
+        std::cout << "tree, " << threads << " threads: " << time << " s, speedup " << single / time << ", "
+                  << result.size() << " paths" << std::endl;
+    }
+
+    if (fold) {
+        Geom::PathVector result;
+        double time = measure([&]() {
+            result = parcels.front();
+            for (size_t i = 1; i < parcels.size(); i++) {
+                result = sp_pathvector_boolop(parcels[i], result, bool_op_union, fill_nonZero, fill_nonZero, true);
+            }
+        });
+        std::cout << "one at a time: " << time << " s, " << result.size() << " paths" << std::endl;
+    }
+    return 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 #include <gtest/gtest.h>
+#include <src/livarot/sweep-tree-list.h>
 #include <src/path/path-boolop.h>
 #include <src/svg/svg.h>
 #include <2geom/svg-path-writer.h>
@@ -84,4 +85,36 @@ TEST_F(PathBoolopTest, DifferenceOutside){
     comparePaths(pvRectangleDifference, pvBothPaths);
 }
 
+TEST_F(PathBoolopTest, UnionMany){
+    // test that uniting many shapes at once gives one shape, whatever the number of threads
+    std::vector<Geom::PathVector> pvParcels;
+    for (int x = 0; x < 5; x++) {
+        for (int y = 0; y < 3; y++) {
+            pvParcels.push_back(Geom::PathVector(Geom::Path(Geom::Rect(x, y, x + 1, y + 1))));
+        }
+    }
+    pvParcels.push_back(pvRectangleSmaller);
+    Geom::PathVector pvUnion = sp_pathvector_union(pvParcels, fill_nonZero, 1);
+    ASSERT_EQ(pvUnion.size(), 1u);
+    EXPECT_EQ(pvUnion.boundsExact(), Geom::OptRect(Geom::Rect(0, 0, 5, 3)));
+    comparePaths(sp_pathvector_union(pvParcels, fill_nonZero, 4), pvUnion);
+}
+
+TEST_F(PathBoolopTest, SweeplineStorage){
+    // test that keeping the sweepline in blocks gives the same results as keeping it in a tree
+    Geom::PathVector pvStar = sp_svg_read_pathv("M 1,0 L 0.2,1.8 L 1.8,0.6 L 0.2,0.6 L 1.8,1.8 z");
+    std::vector<Geom::PathVector> results[2];
+    auto storage = SweepTreeList::defaultStorage;
+    for (int i = 0; i < 2; i++) {
+        SweepTreeList::defaultStorage = i ? SweepTreeList::BLOCK_ARRAY : SweepTreeList::AVL_TREE;
+        for (auto op : {bool_op_union, bool_op_inters, bool_op_diff, bool_op_symdiff}) {
+            results[i].push_back(sp_pathvector_boolop(pvStar, pvRectangleSmaller, op, fill_nonZero, fill_oddEven));
+        }
+    }
+    SweepTreeList::defaultStorage = storage;
+    for (size_t j = 0; j < results[0].size(); j++) {
+        comparePaths(results[1][j], results[0][j]);
+    }
+}
+
 //
\ No newline at end of file
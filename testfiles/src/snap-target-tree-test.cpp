@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests of Inkscape::SnapTargetTree
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <set>
+
+#include "snap-target-tree.h"
+
+using Inkscape::SnapTargetTree;
+
+TEST(SnapTargetTreeTest, Empty)
+{
+    SnapTargetTree<int> tree;
+    EXPECT_TRUE(tree.empty());
+    int found = 0;
+    tree.query(Geom::Rect(0, 0, 10, 10), [&](int) { found++; });
+    EXPECT_EQ(found, 0);
+}
+
+TEST(SnapTargetTreeTest, QueryMatchesLinearSearch)
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> coord(0, 1000);
+
+    for (int n : {1, 8, 9, 100, 5000}) {
+        std::vector<SnapTargetTree<int>::Entry> entries;
+        for (int i = 0; i < n; ++i) {
+            Geom::Point corner(coord(random), coord(random));
+            // half of the targets are points, the others boxes of segments
+            Geom::Point size = i % 2 ? Geom::Point(coord(random), coord(random)) / 50 : Geom::Point(0, 0);
+            entries.emplace_back(Geom::Rect(corner, corner + size), i);
+        }
+
+        SnapTargetTree<int> tree;
+        tree.build(entries);
+        EXPECT_FALSE(tree.empty());
+
+        for (int q = 0; q < 200; ++q) {
+            Geom::Point center(coord(random), coord(random));
+            Geom::Point range(coord(random) / 20, coord(random) / 20);
+            Geom::Rect area(center - range, center + range);
+
+            std::set<int> found;
+            tree.query(area, [&](int i) { EXPECT_TRUE(found.insert(i).second); });
+
+            std::set<int> expected;
+            for (auto const &entry : entries) {
+                if (entry.first.intersects(area)) {
+                    expected.insert(entry.second);
+                }
+            }
+            EXPECT_EQ(found, expected);
+        }
+    }
+}
+
+TEST(SnapTargetTreeTest, ChangesMatchLinearSearch)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> coord(0, 1000);
+    auto random_box = [&]() {
+        Geom::Point corner(coord(random), coord(random));
+        return Geom::Rect(corner, corner + Geom::Point(coord(random), coord(random)) / 50);
+    };
+
+    std::vector<SnapTargetTree<int>::Entry> entries;
+    for (int i = 0; i < 500; ++i) {
+        entries.emplace_back(random_box(), i);
+    }
+    SnapTargetTree<int> tree;
+    tree.build(entries);
+
+    // value -> id and box of the targets expected in the tree
+    std::map<int, std::pair<size_t, Geom::Rect>> targets;
+    for (int i = 0; i < 500; ++i) {
+        targets[i] = {i, entries[i].first};
+    }
+    int next = 500;
+
+    for (int step = 0; step < 2000; ++step) {
+        int action = random() % 3;
+        if (action == 0 || targets.empty()) {
+            Geom::Rect box = random_box();
+            targets[next] = {tree.insert(box, next), box};
+            next++;
+        } else {
+            auto it = targets.begin();
+            std::advance(it, random() % targets.size());
+            if (action == 1) {
+                it->second.second = random_box();
+                tree.update(it->second.first, it->second.second);
+                EXPECT_EQ(tree.value(it->second.first), it->first);
+            } else {
+                tree.remove(it->second.first);
+                targets.erase(it);
+            }
+        }
+        ASSERT_EQ(tree.size(), targets.size());
+
+        Geom::Point center(coord(random), coord(random));
+        Geom::Point range(coord(random) / 20, coord(random) / 20);
+        Geom::Rect area(center - range, center + range);
+
+        std::set<int> found;
+        tree.query(area, [&](int i) { EXPECT_TRUE(found.insert(i).second); });
+
+        std::set<int> expected;
+        for (auto const &target : targets) {
+            if (target.second.second.intersects(area)) {
+                expected.insert(target.first);
+            }
+        }
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST(SnapTargetTreeTest, PointOnEdgeOfArea)
+{
+    SnapTargetTree<int> tree;
+    tree.build({{Geom::Rect(Geom::Point(10, 0), Geom::Point(10, 0)), 1}});
+    int found = 0;
+    tree.query(Geom::Rect(0, -5, 10, 5), [&](int i) { found = i; });
+    EXPECT_EQ(found, 1);
+
+    tree.clear();
+    EXPECT_TRUE(tree.empty());
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -590,6 +590,24 @@ TEST(StyleTest, Cascade) {
 }
 
 
+TEST(StyleTest, RepeatedStyleString) {
+  // The second style merges the declarations parsed for the first.
+  char const *src = "fill:#ff0000;fill:#0000ff !important;stroke:#008000;-inkscape-font-specification:Sans;-inkscape-font-specification:Serif";
+  SPStyle first;
+  SPStyle second;
+  second.stroke.read("#ffff00");
+  first.mergeString(src);
+  second.mergeString(src);
+
+  EXPECT_EQ(first.fill.get_value(), Glib::ustring("#0000ff"));
+  EXPECT_EQ(first.stroke.get_value(), Glib::ustring("#008000"));
+  EXPECT_EQ(second.fill.get_value(), Glib::ustring("#0000ff"));
+  EXPECT_TRUE(second.fill.important);
+  EXPECT_EQ(second.stroke.get_value(), Glib::ustring("#ffff00"));
+  EXPECT_EQ(first.extended_properties["-inkscape-font-specification"], "Sans");
+  EXPECT_EQ(second.extended_properties["-inkscape-font-specification"], "Sans");
+}
+
 } // namespace
 
 /*
@@ -182,6 +182,50 @@ TEST(SvgLengthTest, testPlaces)
     }
 }
 
+TEST(SvgLengthTest, testPlacesOfLargeNumbers)
+{
+    // more integral digits than fit in 32 bits
+    ASSERT_EQ(sp_svg_number_write_de(5000000000.25, 16, -8), "5000000000.25");
+    ASSERT_EQ(sp_svg_number_write_de(-12345678901234., 8, -8), "-1.2345679e13");
+}
+
+TEST(SvgLengthTest, testScan)
+{
+    struct testd_t
+    {
+        char const *str;
+        double val;
+        size_t length;
+    };
+
+    testd_t const scanTests[] = {
+        {"0", 0, 1},
+        {"-.5e-3,2", -.5e-3, 6},
+        {"+12.250L", 12.25, 7},
+        {"1e", 1, 1},
+        {"1.5.5", 1.5, 3},
+        {"0.000000000000000000000000123", 1.23e-25, 29},
+        {"123456789012345678901234", 123456789012345678901234., 24},
+        {"3.14159265358979323846", 3.14159265358979323846, 22},
+    };
+
+    for (auto const &test : scanTests) {
+        char const *str = test.str;
+        double val = -1;
+        ASSERT_TRUE(sp_svg_number_scan(&str, &val)) << test.str;
+        ASSERT_EQ(val, test.val) << test.str;
+        ASSERT_EQ(str, test.str + test.length) << test.str;
+    }
+
+    for (char const *fail : {"", ".", "-", "+.e5", "e5", ",1"}) {
+        char const *str = fail;
+        double val = -1;
+        ASSERT_FALSE(sp_svg_number_scan(&str, &val)) << fail;
+        ASSERT_EQ(str, fail);
+        ASSERT_EQ(val, -1);
+    }
+}
+
 // TODO: More tests
 
 // vim: filetype=cpp:expandtab:shiftwidth=4:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Benchmark of reading and writing SVG path data
+ *
+ * Collects the "d" attributes of a real file, such as a map exported from a GIS, and reads them
+ * both with sp_svg_read_pathv and with lib2geom's parser alone, which is what sp_svg_read_pathv
+ * used before it had a reader of its own, then writes the paths back with sp_svg_write_path.
+ *
+ * Usage: benchmark_svg_path [file.svg] [repetitions]
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <2geom/path-sink.h>
+#include <2geom/pathvector.h>
+#include <2geom/svg-path-parser.h>
+
+#include "svg/svg.h"
+#include "xml/node.h"
+#include "xml/repr.h"
+
+namespace {
+
+void collect(Inkscape::XML::Node const *node, std::vector<std::string> &paths)
+{
+    if (char const *d = node->attribute("d")) {
+        paths.emplace_back(d);
+    }
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        collect(child, paths);
+    }
+}
+
+Geom::PathVector read_with_2geom(char const *str)
+{
+    Geom::PathVector pathv;
+    Geom::PathBuilder builder(pathv);
+    Geom::SVGPathParser parser(builder);
+    parser.setZSnapThreshold(Geom::EPSILON);
+    try {
+        parser.parse(str);
+    } catch (Geom::SVGPathParseError &) {
+        builder.flush();
+    }
+    return pathv;
+}
+
+template <typename F>
+double measure(int repetitions, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i) {
+        f();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void report(char const *name, double seconds, size_t bytes, size_t curves)
+{
+    std::cout << name << ": " << seconds * 1000 << " ms, " << bytes / seconds / 1e6 << " MB/s, "
+              << curves / seconds / 1e6 << " M segments/s" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string filename = argc > 1 ? argv[1] : INKSCAPE_TESTS_DIR "/../share/examples/car.svgz";
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    Inkscape::XML::Document *doc = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI);
+    if (!doc) {
+        std::cerr << "Cannot read " << filename << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> paths;
+    collect(doc->root(), paths);
+
+    size_t bytes = 0;
+    size_t curves = 0;
+    size_t differences = 0;
+    std::vector<Geom::PathVector> pathvs;
+    for (auto const &path : paths) {
+        bytes += path.size();
+        pathvs.push_back(sp_svg_read_pathv(path.c_str()));
+        curves += pathvs.back().curveCount();
+        if (pathvs.back() != read_with_2geom(path.c_str())) {
+            differences++;
+        }
+    }
+    std::cout << paths.size() << " paths, " << bytes << " bytes, " << curves << " segments, " << differences
+              << " read differently" << std::endl;
+
+    double read = measure(repetitions, [&]() {
+        for (auto const &path : paths) {
+            sp_svg_read_pathv(path.c_str());
+        }
+    });
+    report("sp_svg_read_pathv", read / repetitions, bytes, curves);
+
+    double read_2geom = measure(repetitions, [&]() {
+        for (auto const &path : paths) {
+            read_with_2geom(path.c_str());
+        }
+    });
+    report("Geom::SVGPathParser", read_2geom / repetitions, bytes, curves);
+
+    size_t written = 0;
+    double write = measure(repetitions, [&]() {
+        written = 0;
+        for (auto const &pathv : pathvs) {
+            written += sp_svg_write_path(pathv).size();
+        }
+    });
+    report("sp_svg_write_path", write / repetitions, written, curves);
+
+    Inkscape::GC::release(doc);
+    return 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -307,6 +307,26 @@ TEST_F(SvgPathGeomTest, testReadImplicitSeparation)
     }
 }
 
+TEST_F(SvgPathGeomTest, testReadCurves)
+{
+    Geom::PathVector pv_good;
+    pv_good.push_back(Geom::Path(Geom::Point(1, 2)));
+    pv_good.back().append(Geom::CubicBezier(Geom::Point(1, 2), Geom::Point(2, 3), Geom::Point(3, 3), Geom::Point(4, 2)));
+    pv_good.back().append(Geom::CubicBezier(Geom::Point(4, 2), Geom::Point(5, 1), Geom::Point(6, 1), Geom::Point(7, 2)));
+    pv_good.back().append(Geom::LineSegment(Geom::Point(7, 2), Geom::Point(7, 5)));
+    pv_good.back().close();
+    { // Test absolute
+        char const *path_str = "M 1,2 C 2,3 3,3 4,2 S 6,1 7,2 V 5 Z";
+        Geom::PathVector pv = sp_svg_read_pathv(path_str);
+        ASSERT_TRUE(bpathEqual(pv, pv_good)) << path_str;
+    }
+    { // Test relative
+        char const *path_str = "m 1,2 c 1,1 2,1 3,0 s 2,-1 3,0 v 3 z";
+        Geom::PathVector pv = sp_svg_read_pathv(path_str);
+        ASSERT_TRUE(bpathEqual(pv, pv_good)) << path_str;
+    }
+}
+
 TEST_F(SvgPathGeomTest, testReadErrorMisplacedCharacter)
 {
 
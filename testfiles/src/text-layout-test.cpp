@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the reuse of shaped paragraphs by Inkscape::Text::Layout
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <gtest/gtest.h>
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/libnrtype/Layout-TNG.h>
+#include <src/object/sp-text.h>
+
+using namespace Inkscape;
+using Inkscape::Text::Layout;
+
+class TextLayoutTest : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        // setup hidden dependency
+        Application::create(false);
+
+        std::string svg("\
+<svg xmlns='http://www.w3.org/2000/svg' xmlns:sodipodi='http://sodipodi.sourceforge.net/DTD/sodipodi-0.dtd' width='100' height='100'>\
+  <text id='text' x='10' y='20' style='font-family:sans-serif;font-size:10px'>\
+    <tspan id='line1' sodipodi:role='line'>First line</tspan>\
+    <tspan id='line2' sodipodi:role='line'>Second line</tspan>\
+    <tspan id='line3' sodipodi:role='line' style='font-weight:bold'>Third line</tspan>\
+  </text>\
+</svg>");
+        doc.reset(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), true));
+        doc->ensureUpToDate();
+        text = dynamic_cast<SPText *>(doc->getObjectById("text"));
+        ASSERT_TRUE(text);
+    }
+
+    std::unique_ptr<SPDocument> doc;
+    SPText *text = nullptr;
+};
+
+TEST_F(TextLayoutTest, ReshapesOnlyChangedParagraphs)
+{
+    Layout::ShapingCacheStats before = Layout::shapingCacheStats();
+
+    doc->getObjectById("line2")->getRepr()->firstChild()->setContent("Changed line");
+    doc->ensureUpToDate();
+
+    Layout::ShapingCacheStats after = Layout::shapingCacheStats();
+    EXPECT_EQ(after.paragraph_misses - before.paragraph_misses, 1ul);
+    EXPECT_GE(after.paragraph_hits - before.paragraph_hits, 2ul);
+    EXPECT_GT(after.span_hits, before.span_hits);
+}
+
+TEST_F(TextLayoutTest, CachedLayoutMatchesFreshLayout)
+{
+    text->rebuildLayout();
+    Glib::ustring cached = text->layout.dumpAsText();
+
+    Layout::clearShapingCache();
+    Layout::ShapingCacheStats before = Layout::shapingCacheStats();
+    text->rebuildLayout();
+    EXPECT_EQ(Layout::shapingCacheStats().paragraph_hits, before.paragraph_hits);
+    EXPECT_EQ(text->layout.dumpAsText(), cached);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the trace of hot code paths
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <src/debug/trace.h>
+
+using namespace Inkscape::Debug;
+
+namespace {
+
+int count(std::string const &text, std::string const &what)
+{
+    int n = 0;
+    for (auto pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+} // namespace
+
+TEST(TraceTest, RecordsNothingWhileDisabled)
+{
+    Trace::shutdown();
+    {
+        TraceScope trace("disabled", Event::OTHER);
+    }
+    std::ostringstream os;
+    Trace::write(os);
+    EXPECT_EQ(count(os.str(), "\"disabled\""), 0);
+}
+
+TEST(TraceTest, KeepsTheLatestEventsOfEachThread)
+{
+    Trace::start("", 10);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 25; j++) {
+                TraceScope trace("worker", Event::RENDERING);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    {
+        TraceScope trace("quoted \"name\"", Event::DOCUMENT);
+    }
+    std::ostringstream os;
+    Trace::write(os);
+    Trace::shutdown();
+
+    std::string json = os.str();
+    EXPECT_EQ(json.compare(0, 15, "{\"traceEvents\":"), 0);
+    EXPECT_EQ(count(json, "{\"name\":\"worker\",\"cat\":\"RENDERING\",\"ph\":\"X\""), 40);
+    EXPECT_EQ(count(json, "\"quoted \\\"name\\\"\""), 1);
+    EXPECT_EQ(count(json, "\"droppedEvents\":60"), 1);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
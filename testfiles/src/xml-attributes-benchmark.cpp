@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Microbenchmark of XML attribute access
+ *
+ * Replays the attribute access pattern of loading and editing a document on the XML tree of
+ * a real file: every element reads the attributes SPObject and its subclasses look for when
+ * they are built, most of which are not set, reads each attribute it has, and writes back a
+ * changed value of each of its attributes as undo and redo do.
+ *
+ * Usage: benchmark_xml_attributes [file.svg] [repetitions]
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "xml/node.h"
+#include "xml/repr.h"
+
+namespace {
+
+/// Attributes read while building objects, whether the element has them or not.
+char const *const PROBED[] = {
+    "id", "style", "class", "transform", "clip-path", "mask", "xml:space",
+    "inkscape:label", "inkscape:collect", "inkscape:groupmode", "inkscape:highlight-color",
+    "sodipodi:type", "sodipodi:insensitive", "systemLanguage", "requiredFeatures",
+    "x", "y", "width", "height", "d", "inkscape:original-d", "inkscape:path-effect",
+    "fill", "stroke", "opacity", "display", "visibility", "filter",
+};
+
+void collect(Inkscape::XML::Node *node, std::vector<Inkscape::XML::Node *> &elements)
+{
+    if (node->type() == Inkscape::XML::NodeType::ELEMENT_NODE) {
+        elements.push_back(node);
+    }
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        collect(child, elements);
+    }
+}
+
+template <typename F>
+double measure(int repetitions, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i) {
+        f();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string filename = argc > 1 ? argv[1] : INKSCAPE_TESTS_DIR "/../share/examples/car.svgz";
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    Inkscape::XML::Document *doc = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI);
+    if (!doc) {
+        std::cerr << "Cannot read " << filename << std::endl;
+        return 1;
+    }
+
+    std::vector<Inkscape::XML::Node *> elements;
+    collect(doc->root(), elements);
+
+    // keys of all attributes, copied so that the reads below pass names like callers do
+    std::vector<std::vector<std::string>> keys(elements.size());
+    size_t attributes = 0;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        for (auto const &attr : elements[i]->attributeList()) {
+            keys[i].emplace_back(g_quark_to_string(attr.key));
+        }
+        attributes += keys[i].size();
+    }
+
+    size_t found = 0;
+    double probe_time = measure(repetitions, [&]() {
+        for (auto element : elements) {
+            for (auto name : PROBED) {
+                found += element->attribute(name) != nullptr;
+            }
+        }
+    });
+
+    double read_time = measure(repetitions, [&]() {
+        for (size_t i = 0; i < elements.size(); ++i) {
+            for (auto const &key : keys[i]) {
+                found += elements[i]->attribute(key.c_str()) != nullptr;
+            }
+        }
+    });
+
+    // write values that differ from the old ones, then restore them, like undo and redo
+    std::vector<std::vector<std::string>> values(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) {
+        for (auto const &key : keys[i]) {
+            values[i].emplace_back(elements[i]->attribute(key.c_str()));
+        }
+    }
+    double write_time = measure(repetitions, [&]() {
+        for (size_t i = 0; i < elements.size(); ++i) {
+            for (size_t j = 0; j < keys[i].size(); ++j) {
+                elements[i]->setAttribute(keys[i][j], values[i][j] + " ");
+                elements[i]->setAttribute(keys[i][j], values[i][j]);
+            }
+        }
+    });
+
+    double probes = double(repetitions) * elements.size() * G_N_ELEMENTS(PROBED);
+    double reads = double(repetitions) * attributes;
+    std::cout << filename << ": " << elements.size() << " elements, " << attributes << " attributes\n"
+              << "probe: " << probe_time * 1e9 / probes << " ns per lookup\n"
+              << "read:  " << read_time * 1e9 / reads << " ns per lookup\n"
+              << "write: " << write_time * 1e9 / (2 * reads) << " ns per change\n"
+              << "(" << found << ")" << std::endl;
+
+    Inkscape::GC::release(doc);
+    return 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Benchmark of reading SVG files into XML documents
+ *
+ * Reads a file either through a complete libxml2 tree or by streaming the nodes the parser
+ * reports, and prints the time taken and the peak memory use of the process. Run it once for
+ * each way of reading, since the peak memory use covers the whole process.
+ *
+ * Usage: benchmark_xml_load file.svg [dom|stream] [repetitions]
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "xml/node.h"
+#include "xml/repr.h"
+
+namespace {
+
+size_t count_nodes(Inkscape::XML::Node const *node)
+{
+    size_t count = 1;
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        count += count_nodes(child);
+    }
+    return count;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " file.svg [dom|stream] [repetitions]" << std::endl;
+        return 1;
+    }
+    char const *filename = argv[1];
+    bool streaming = argc < 3 || std::strcmp(argv[2], "dom") != 0;
+    int repetitions = argc > 3 ? std::stoi(argv[3]) : 1;
+
+    size_t nodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i) {
+        Inkscape::XML::Document *doc = sp_repr_read_file(filename, SP_SVG_NS_URI, streaming);
+        if (!doc) {
+            std::cerr << "Cannot read " << filename << std::endl;
+            return 1;
+        }
+        nodes = count_nodes(doc);
+        Inkscape::GC::release(doc);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << filename << " (" << (streaming ? "stream" : "dom") << "): " << nodes << " nodes, "
+              << elapsed.count() * 1000 / repetitions << " ms per read";
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        // kilobytes on Linux, bytes on macOS
+        std::cout << ", peak resident size " << usage.ru_maxrss;
+    }
+#endif
+    std::cout << std::endl;
+    return 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
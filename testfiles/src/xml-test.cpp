@@ -12,7 +12,14 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#include <glib/gstdio.h>
+
 #include "gtest/gtest.h"
+#include "xml/journal.h"
 #include "xml/repr.h"
 
 TEST(XmlTest, nodeiter)
@@ -72,6 +79,222 @@ TEST(XmlTest, nodeiter)
     ASSERT_EQ(testdoc->root()->findChildPath(path), nullptr);
 }
 
+TEST(XmlTest, manyAttributes)
+{
+    auto testdoc = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf("<svg><g/></svg>", SP_SVG_NS_URI));
+    ASSERT_TRUE(testdoc);
+    auto node = testdoc->root()->firstChild();
+
+    // enough attributes for the node to index them
+    for (int i = 0; i < 40; ++i) {
+        node->setAttribute("attr" + std::to_string(i), std::to_string(i));
+    }
+    for (int i = 0; i < 40; i += 3) {
+        node->removeAttribute("attr" + std::to_string(i));
+    }
+    node->setAttribute("attr1", "changed");
+
+    for (int i = 0; i < 40; ++i) {
+        auto value = node->attribute(("attr" + std::to_string(i)).c_str());
+        if (i % 3 == 0) {
+            EXPECT_EQ(value, nullptr);
+        } else if (i == 1) {
+            EXPECT_STREQ(value, "changed");
+        } else {
+            EXPECT_STREQ(value, std::to_string(i).c_str());
+        }
+    }
+    EXPECT_EQ(node->attribute("never-used-anywhere"), nullptr);
+    EXPECT_EQ(node->attributeList().size(), 26u);
+
+    // order of the attributes is kept
+    EXPECT_STREQ(g_quark_to_string(node->attributeList().front().key), "attr1");
+    EXPECT_STREQ(g_quark_to_string(node->attributeList().back().key), "attr38");
+
+    auto copy = node->duplicate(testdoc.get());
+    EXPECT_STREQ(copy->attribute("attr20"), "20");
+    EXPECT_EQ(copy->attribute("attr21"), nullptr);
+    Inkscape::GC::release(copy);
+}
+
+TEST(XmlTest, streamingReadMatchesTree)
+{
+    for (auto name : {"/rendering_tests/multi-style.svg", "/rendering_tests/test-rtl-vertical.svg",
+                      "/rendering_tests/text-glyphs-combining.svg", "/rendering_tests/test-empty.svg"}) {
+        std::string filename = std::string(INKSCAPE_TESTS_DIR) + name;
+        auto tree = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI, false);
+        auto stream = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI, true);
+        ASSERT_TRUE(tree);
+        ASSERT_TRUE(stream);
+        EXPECT_EQ(sp_repr_save_buf(tree), sp_repr_save_buf(stream)) << name;
+        Inkscape::GC::release(tree);
+        Inkscape::GC::release(stream);
+    }
+}
+
+static std::string read_back(FILE *file)
+{
+    std::string contents;
+    std::rewind(file);
+    char buffer[4096];
+    while (auto n = std::fread(buffer, 1, sizeof(buffer), file)) {
+        contents.append(buffer, n);
+    }
+    std::fclose(file);
+    return contents;
+}
+
+TEST(XmlTest, snapshotWritesCopy)
+{
+    std::string filename = std::string(INKSCAPE_TESTS_DIR) + "/rendering_tests/multi-style.svg";
+    auto doc = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI);
+    ASSERT_TRUE(doc);
+
+    FILE *expected = std::tmpfile();
+    ASSERT_TRUE(expected);
+    sp_repr_save_stream(doc, expected, SP_SVG_NS_URI);
+
+    auto snapshot = std::make_unique<Inkscape::XML::DocumentSnapshot>(doc, SP_SVG_NS_URI);
+    doc->root()->setAttribute("id", "changed-after-snapshot");
+    auto group = doc->createElement("svg:g");
+    doc->root()->appendChild(group);
+    Inkscape::GC::release(group);
+
+    FILE *written = std::tmpfile();
+    ASSERT_TRUE(written);
+    std::thread([&]() { snapshot->save(written); }).join();
+
+    auto copy = read_back(written);
+    EXPECT_EQ(copy, read_back(expected));
+    EXPECT_EQ(copy.find("changed-after-snapshot"), std::string::npos);
+
+    snapshot.reset();
+    Inkscape::GC::release(doc);
+}
+
+TEST(XmlTest, journalRecoversCommittedChanges)
+{
+    gchar *tmp = g_dir_make_tmp("xml-journal-XXXXXX", nullptr);
+    ASSERT_TRUE(tmp);
+    std::string dir = tmp;
+    g_free(tmp);
+    std::string checkpoint_path = dir + "/doc.checkpoint";
+    std::string journal_path = dir + "/doc.journal";
+
+    auto doc = sp_repr_read_buf("<svg xmlns=\"http://www.w3.org/2000/svg\" id=\"root\">"
+                                "<g id=\"a\"><text id=\"t\">before</text></g><g id=\"b\"/><g id=\"c\"/></svg>",
+                                SP_SVG_NS_URI);
+    ASSERT_TRUE(doc);
+    auto root = doc->root();
+    {
+        auto journal = std::make_unique<Inkscape::XML::Journal>(doc, checkpoint_path, journal_path);
+        EXPECT_TRUE(journal->wantsCheckpoint());
+        auto checkpoint = journal->checkpoint();
+        ASSERT_TRUE(checkpoint);
+        EXPECT_FALSE(journal->wantsCheckpoint());
+
+        // committed while the checkpoint is written
+        root->setAttribute("width", "100");
+        auto a = root->firstChild();
+        a->setAttribute("id", nullptr);
+        a->firstChild()->firstChild()->setContent("after");
+        EXPECT_TRUE(journal->commit());
+
+        std::thread([&]() { EXPECT_TRUE(checkpoint->write()); }).join();
+        EXPECT_TRUE(journal->checkpointWritten(*checkpoint));
+        checkpoint.reset();
+
+        auto rect = doc->createElement("svg:rect");
+        rect->setAttribute("x", "1");
+        root->addChild(rect, a);
+        Inkscape::GC::release(rect);
+        root->changeOrder(root->lastChild(), nullptr);
+        root->removeChild(root->nthChild(2));
+        rect->setCodeUnsafe(g_quark_from_string("svg:circle"));
+        EXPECT_TRUE(journal->commit());
+        EXPECT_FALSE(journal->failed());
+        auto expected = sp_repr_save_buf(doc);
+
+        // not committed, so not recovered
+        root->setAttribute("height", "50");
+
+        auto recovered = Inkscape::XML::Journal::recover(checkpoint_path, journal_path);
+        ASSERT_TRUE(recovered);
+        EXPECT_EQ(sp_repr_save_buf(recovered), expected);
+        Inkscape::GC::release(recovered);
+    }
+
+    // the files are removed once the journal is closed
+    EXPECT_FALSE(g_file_test(checkpoint_path.c_str(), G_FILE_TEST_EXISTS));
+    EXPECT_FALSE(g_file_test(journal_path.c_str(), G_FILE_TEST_EXISTS));
+    g_rmdir(dir.c_str());
+    Inkscape::GC::release(doc);
+}
+
+TEST(XmlTest, journalRecoversChangesAfterUnfinishedCheckpoint)
+{
+    gchar *tmp = g_dir_make_tmp("xml-journal-XXXXXX", nullptr);
+    ASSERT_TRUE(tmp);
+    std::string dir = tmp;
+    g_free(tmp);
+    std::string checkpoint_path = dir + "/doc.checkpoint";
+    std::string journal_path = dir + "/doc.journal";
+
+    auto doc = sp_repr_read_buf("<svg xmlns=\"http://www.w3.org/2000/svg\"><g id=\"a\"/></svg>", SP_SVG_NS_URI);
+    ASSERT_TRUE(doc);
+    auto root = doc->root();
+    {
+        Inkscape::XML::Journal journal(doc, checkpoint_path, journal_path);
+        auto checkpoint = journal.checkpoint();
+        ASSERT_TRUE(checkpoint && checkpoint->write());
+        EXPECT_TRUE(journal.checkpointWritten(*checkpoint));
+
+        root->setAttribute("width", "100");
+        EXPECT_TRUE(journal.commit());
+
+        // The new checkpoint is written, but Inkscape crashes before its journal is started:
+        // the old journal holds the changes made since the copy.
+        checkpoint = journal.checkpoint();
+        root->firstChild()->setAttribute("id", "b");
+        EXPECT_TRUE(journal.commit());
+        ASSERT_TRUE(checkpoint->write());
+        auto expected = sp_repr_save_buf(doc);
+
+        auto recovered = Inkscape::XML::Journal::recover(checkpoint_path, journal_path);
+        ASSERT_TRUE(recovered);
+        EXPECT_EQ(sp_repr_save_buf(recovered), expected);
+        Inkscape::GC::release(recovered);
+
+        EXPECT_TRUE(journal.checkpointWritten(*checkpoint));
+        recovered = Inkscape::XML::Journal::recover(checkpoint_path, journal_path);
+        ASSERT_TRUE(recovered);
+        EXPECT_EQ(sp_repr_save_buf(recovered), expected);
+        Inkscape::GC::release(recovered);
+    }
+    g_rmdir(dir.c_str());
+    Inkscape::GC::release(doc);
+}
+
+TEST(XmlTest, journalReportsFailure)
+{
+    auto doc = sp_repr_read_buf("<svg xmlns=\"http://www.w3.org/2000/svg\"/>", SP_SVG_NS_URI);
+    ASSERT_TRUE(doc);
+    {
+        // the directory does not exist, so not even the checkpoint can be written
+        Inkscape::XML::Journal journal(doc, "/nonexistent-inkscape-dir/doc.checkpoint",
+                                       "/nonexistent-inkscape-dir/doc.journal");
+        auto checkpoint = journal.checkpoint();
+        ASSERT_TRUE(checkpoint);
+        EXPECT_FALSE(checkpoint->write());
+        EXPECT_FALSE(journal.checkpointWritten(*checkpoint));
+        EXPECT_TRUE(journal.failed());
+        EXPECT_FALSE(journal.wantsCheckpoint());
+        doc->root()->setAttribute("width", "100");
+        EXPECT_FALSE(journal.commit());
+    }
+    Inkscape::GC::release(doc);
+}
+
 /*
   Local Variables:
   mode:c++